@@ -16,6 +16,13 @@ namespace elle
 
     Channel::Channel(ChanneledStream& backend, int id)
       : Super(backend.scheduler())
+      , _weight(1)
+      , _credit(backend.window())
+      , _sending()
+      , _active(false)
+      , _deficit(0)
+      , _consumed(0)
+      , _partial()
       , _backend(backend)
       , _id(id)
     {
@@ -35,6 +42,13 @@ namespace elle
 
     Channel::Channel(Channel&& source)
       : Super(source.scheduler())
+      , _weight(source._weight)
+      , _credit(source._credit)
+      , _sending(std::move(source._sending))
+      , _active(source._active)
+      , _deficit(source._deficit)
+      , _consumed(source._consumed)
+      , _partial(std::move(source._partial))
       , _backend(source._backend)
       , _id(source._id)
       , _packets(std::move(source._packets))
@@ -94,7 +108,9 @@ namespace elle
     elle::Buffer
     Channel::_read()
     {
-      return this->_packets.get();
+      auto res = this->_packets.get();
+      this->_backend._consumed(*this, res.size());
+      return res;
     }
 
     /*--------.
@@ -104,7 +120,7 @@ namespace elle
     void
     Channel::_write(elle::Buffer const& packet)
     {
-      this->_backend._write(packet, this->_id);
+      this->_backend._write(packet, *this);
     }
   }
 }
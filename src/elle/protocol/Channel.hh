@@ -1,5 +1,8 @@
 #pragma once
 
+#include <deque>
+#include <memory>
+
 #include <elle/Printable.hh>
 
 #include <elle/reactor/Channel.hh>
@@ -20,6 +23,10 @@ namespace elle
     /// be prefixed by the Id of the Channel allowing the ChanneledStream to
     /// determine the destination of the packet through a single connection.
     ///
+    /// From version 0.4.0, packets of concurrent Channels are interleaved
+    /// according to their weight, and each Channel may only send as much as
+    /// its peer agreed to buffer.
+    ///
     /// @see ChanneledStream for more information.
     ///
     /// @code{.cc}
@@ -97,6 +104,29 @@ namespace elle
       void
       _write(elle::Buffer const& packet) override;
 
+    /*-----------.
+    | Scheduling |
+    `-----------*/
+    public:
+      /// The share of the connection this Channel gets when others send at
+      /// the same time, 1 by default.
+      ELLE_ATTRIBUTE_RW(int, weight);
+      /// Bytes this Channel may still start sending before the peer reads
+      /// some.
+      ELLE_ATTRIBUTE_R(int64_t, credit);
+    private:
+      /// A packet being sent.
+      struct Send;
+      ELLE_ATTRIBUTE(std::deque<std::shared_ptr<Send>>, sending);
+      /// Whether this Channel is in line to send.
+      ELLE_ATTRIBUTE(bool, active);
+      /// Bytes this Channel may send during its turn.
+      ELLE_ATTRIBUTE(int64_t, deficit);
+      /// Bytes read and not granted back to the peer yet.
+      ELLE_ATTRIBUTE(int64_t, consumed);
+      /// The packet being received, until its last frame.
+      ELLE_ATTRIBUTE(elle::Buffer, partial);
+
     /*--------.
     | Details |
     `--------*/
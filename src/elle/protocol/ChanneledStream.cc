@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <array>
 #include <iostream>
 
+#include <elle/With.hh>
+#include <elle/finally.hh>
 #include <elle/find.hh>
 #include <elle/log.hh>
+#include <elle/os/environ.hh>
 
 #include <elle/reactor/scheduler.hh>
 #include <elle/reactor/Thread.hh>
@@ -10,6 +15,7 @@
 
 #include <elle/protocol/Channel.hh>
 #include <elle/protocol/ChanneledStream.hh>
+#include <elle/protocol/exceptions.hh>
 
 ELLE_LOG_COMPONENT("elle.protocol.Channel");
 
@@ -17,6 +23,54 @@ namespace elle
 {
   namespace protocol
   {
+    // From 0.4.0, a backend packet is a frame: a piece of a packet, credit
+    // granted or nothing, followed by a trailer. Being at the end, the
+    // trailer is stripped by shrinking the buffer, without moving data.
+    enum Frame: unsigned char
+    {
+      // The last frame of a packet.
+      last = 1,
+      // The sender gave up on the packet being sent.
+      abort = 2,
+      // The receiver read data and grants as much credit back.
+      credit = 4,
+    };
+
+    // The channel id, 4 bytes big endian, and the flags.
+    static auto const trailer_size = 5;
+
+    static
+    std::array<unsigned char, trailer_size>
+    trailer(Channel::Id id, unsigned char flags)
+    {
+      auto const i = uint32_t(id);
+      return {{
+        static_cast<unsigned char>(i >> 24),
+        static_cast<unsigned char>(i >> 16),
+        static_cast<unsigned char>(i >> 8),
+        static_cast<unsigned char>(i),
+        flags,
+      }};
+    }
+
+    struct Channel::Send
+    {
+      Send(elle::Buffer const& packet)
+        : packet(packet)
+        , offset(0)
+        , done()
+        , writing(false)
+        , written()
+      {}
+
+      elle::Buffer const& packet;
+      elle::Buffer::Size offset;
+      reactor::Barrier done;
+      /// Whether a frame pointing into the packet is being written.
+      bool writing;
+      reactor::Signal written;
+    };
+
     /*-------------.
     | Construction |
     `-------------*/
@@ -27,11 +81,20 @@ namespace elle
       , _backend(backend)
       , _master(this->_handshake())
       , _id_current(0)
+      , _framed(this->version() >= elle::Version(0, 4, 0))
+      , _frame_size(
+        elle::os::getenv("ELLE_PROTOCOL_CHANNEL_FRAME", 1 << 16))
+      , _window(elle::os::getenv("ELLE_PROTOCOL_CHANNEL_WINDOW", 1 << 20))
       , _default(*this)
     {
       this->_thread.reset(
         new reactor::Thread(
           elle::sprintf("%s", this), [this] { this->_read_thread(); }));
+      if (this->_framed)
+        this->_writer.reset(
+          new reactor::Thread(
+            elle::sprintf("%s writer", this),
+            [this] { this->_write_thread(); }));
     }
 
     ChanneledStream::ChanneledStream(Stream& backend)
@@ -42,6 +105,8 @@ namespace elle
     {
       try
       {
+        if (this->_writer)
+          this->_writer->terminate_now();
         this->_thread->terminate_now();
       }
       catch (...)
@@ -60,6 +125,32 @@ namespace elle
         while (true)
         {
           auto p = this->_backend.read();
+          if (this->_framed)
+          {
+            if (p.size() < trailer_size)
+              elle::err<protocol::Error>("frame too short: %s", p.size());
+            auto const t = p.contents() + p.size() - trailer_size;
+            auto const channel_id = Channel::Id(
+              uint32_t(t[0]) << 24 | uint32_t(t[1]) << 16 |
+              uint32_t(t[2]) << 8 | uint32_t(t[3]));
+            auto const flags = t[4];
+            p.size(p.size() - trailer_size);
+            if (auto it = elle::find(this->_channels, channel_id))
+              this->_receive(*it->second, flags, std::move(p));
+            else if (this->_master && channel_id > 0
+                     || !this->_master && channel_id < 0
+                     || flags & (Frame::abort | Frame::credit))
+              ELLE_TRACE("discard orphaned frame on channel %s", channel_id);
+            else
+            {
+              auto res = Channel(*this, channel_id);
+              ELLE_DEBUG("new channel %s", channel_id);
+              this->_receive(res, flags, std::move(p));
+              this->_channels_new.put(std::move(res));
+            }
+            continue;
+          }
+          // The id precedes the data before 0.4.0.
           int channel_id = this->uint32_get(p, this->version());
           // FIXME: The size of the packet isn't adjusted. This is cosmetic
           // though.
@@ -174,14 +265,239 @@ namespace elle
     }
 
     void
-    ChanneledStream::_write(elle::Buffer const& packet, int id)
+    ChanneledStream::_write(elle::Buffer const& packet, Channel& channel)
     {
+      auto const id = channel.id();
       ELLE_TRACE_SCOPE("%s: send %f on channel %s", *this, packet, id);
+      if (!this->_framed)
+      {
+        auto header = elle::Buffer{};
+        this->uint32_put(header, id, this->version());
+        this->_backend.write(Buffers{header, packet});
+        return;
+      }
+      if (this->_write_exception)
+        std::rethrow_exception(this->_write_exception);
+      auto send = std::make_shared<Channel::Send>(packet);
+      channel._sending.push_back(send);
+      this->_activate(channel);
+      try
+      {
+        reactor::wait(send->done);
+      }
+      catch (...)
+      {
+        // The writer may be sending a frame straight from the packet.
+        elle::With<reactor::Thread::NonInterruptible>() << [&]
+        {
+          while (send->writing)
+            reactor::wait(send->written);
+        };
+        auto& sending = channel._sending;
+        auto it = std::find(sending.begin(), sending.end(), send);
+        if (it != sending.end())
+        {
+          sending.erase(it);
+          if (send->offset > 0)
+          {
+            ELLE_DEBUG("%s: abort packet after %s bytes on channel %s",
+                       this, send->offset, id);
+            // The unsent part of the packet was accounted for already.
+            channel._credit += packet.size() - send->offset;
+            this->_control(id, Frame::abort);
+          }
+        }
+        throw;
+      }
+    }
+
+    /*--------.
+    | Framing |
+    `--------*/
+
+    void
+    ChanneledStream::_activate(Channel& channel)
+    {
+      if (!channel._active)
+      {
+        channel._active = true;
+        this->_active.push_back(channel.id());
+        this->_writable.signal();
+      }
+    }
+
+    void
+    ChanneledStream::_control(Channel::Id id,
+                              unsigned char flags,
+                              elle::Buffer payload)
+    {
+      auto const t = trailer(id, flags);
+      payload.append(t.data(), t.size());
+      this->_controls.emplace_back(std::move(payload));
+      this->_writable.signal();
+    }
+
+    void
+    ChanneledStream::_write_thread()
+    {
+      ELLE_TRACE_SCOPE("%s: write frames", this);
+      try
+      {
+        while (true)
+        {
+          if (!this->_controls.empty())
+          {
+            auto frame = std::move(this->_controls.front());
+            this->_controls.pop_front();
+            this->_backend.write(frame);
+            continue;
+          }
+          if (this->_active.empty())
+          {
+            reactor::wait(this->_writable);
+            continue;
+          }
+          auto const id = this->_active.front();
+          this->_active.pop_front();
+          auto it = elle::find(this->_channels, id);
+          if (!it)
+            continue;
+          // Channels may be moved or closed while we write: look them up
+          // again after each frame.
+          auto channel = it->second;
+          channel->_active = false;
+          // Deficit round robin: each turn allows weight frames worth of
+          // data, and what is not used carries over while the channel has
+          // data to send.
+          channel->_deficit +=
+            std::max(1, channel->weight()) * this->_frame_size;
+          while (!channel->_sending.empty())
+          {
+            auto send = channel->_sending.front();
+            auto const& packet = send->packet;
+            auto const size = std::min<int64_t>(
+              this->_frame_size, packet.size() - send->offset);
+            if (size > channel->_deficit)
+              break;
+            if (send->offset == 0)
+            {
+              // Wait for the peer to read before starting a new packet.
+              if (channel->_credit <= 0)
+              {
+                ELLE_DEBUG("%s: channel %s is out of credit", this, id);
+                channel->_deficit = 0;
+                break;
+              }
+              channel->_credit -= packet.size();
+            }
+            channel->_deficit -= size;
+            auto const offset = send->offset;
+            send->offset += size;
+            unsigned char flags = 0;
+            if (send->offset == packet.size())
+            {
+              flags |= Frame::last;
+              channel->_sending.pop_front();
+            }
+            auto const t = trailer(id, flags);
+            ELLE_DUMP("%s: send %s bytes at %s on channel %s",
+                      this, size, offset, id);
+            {
+              send->writing = true;
+              elle::SafeFinally written([&]
+                {
+                  send->writing = false;
+                  send->written.signal();
+                });
+              this->_backend.write(
+                Buffers{elle::ConstWeakBuffer(packet.contents() + offset, size),
+                        elle::ConstWeakBuffer(t.data(), t.size())});
+            }
+            if (flags & Frame::last)
+              send->done.open();
+            if (auto it = elle::find(this->_channels, id))
+              channel = it->second;
+            else
+            {
+              channel = nullptr;
+              break;
+            }
+            // Let control frames through.
+            if (!this->_controls.empty())
+              break;
+          }
+          if (channel)
+          {
+            if (channel->_sending.empty())
+              channel->_deficit = 0;
+            else if (channel->_sending.front()->offset > 0 ||
+                     channel->_credit > 0)
+              this->_activate(*channel);
+          }
+        }
+      }
+      catch (elle::Error const&)
+      {
+        ELLE_TRACE("%s: write failed: %s", this, elle::exception_string());
+        this->_write_exception = std::current_exception();
+        for (auto& c: this->_channels)
+          for (auto& send: c.second->_sending)
+            send->done.raise(std::current_exception());
+      }
+    }
 
-      auto backend_packet = elle::Buffer{};
-      this->uint32_put(backend_packet, id, this->version());
-      backend_packet.append(packet.contents(), packet.size());
-      this->_backend.write(backend_packet);
+    void
+    ChanneledStream::_receive(Channel& channel,
+                              unsigned char flags,
+                              elle::Buffer frame)
+    {
+      if (flags & Frame::credit)
+      {
+        auto const granted = this->uint32_get(frame, this->version());
+        ELLE_DEBUG("%s: %s granted %s bytes", this, channel, granted);
+        channel._credit += granted;
+        if (!channel._sending.empty())
+          this->_activate(channel);
+      }
+      else if (flags & Frame::abort)
+      {
+        ELLE_DEBUG("%s: %s aborted packet after %s bytes",
+                   this, channel, channel._partial.size());
+        this->_consumed(channel, channel._partial.size());
+        channel._partial = elle::Buffer{};
+      }
+      else if (flags & Frame::last)
+      {
+        if (channel._partial.empty())
+          channel._packets.put(std::move(frame));
+        else
+        {
+          channel._partial.append(frame.contents(), frame.size());
+          channel._packets.put(std::move(channel._partial));
+          channel._partial = elle::Buffer{};
+        }
+        ELLE_DEBUG("received packet on %s", channel);
+      }
+      else
+        channel._partial.append(frame.contents(), frame.size());
+    }
+
+    void
+    ChanneledStream::_consumed(Channel& channel, int64_t size)
+    {
+      if (!this->_framed)
+        return;
+      channel._consumed += size;
+      // Grant by batches, not to flood the peer with credit frames.
+      if (channel._consumed >= this->_window / 4)
+      {
+        auto payload = elle::Buffer{};
+        this->uint32_put(payload, channel._consumed, this->version());
+        ELLE_DEBUG("%s: grant %s bytes on %s",
+                   this, channel._consumed, channel);
+        this->_control(channel.id(), Frame::credit, std::move(payload));
+        channel._consumed = 0;
+      }
     }
 
     /*--------.
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <deque>
 #include <unordered_map>
 
 #include <elle/protocol/Channel.hh>
@@ -20,6 +21,13 @@ namespace elle
     /// the socket to communicate through the same socket. Multiplexing and
     /// demultiplexing will be transparent for the user.
     ///
+    /// From version 0.4.0, packets are split in frames, and the frames of
+    /// Channels sending at the same time are interleaved by weighted round
+    /// robin (see Channel::weight), so small packets are not stuck behind a
+    /// large one. Each Channel is also given credit by its peer: a packet
+    /// can only start when the peer has read enough of the previous ones,
+    /// which bounds the memory a slow reader uses.
+    ///
     /// @code{.cc}
     ///
     /// // Consider two peers, connected by an arbitrary socket s.
@@ -62,6 +70,8 @@ namespace elle
       ELLE_ATTRIBUTE(Stream&, backend);
       ELLE_ATTRIBUTE(reactor::Thread::unique_ptr, thread);
       ELLE_ATTRIBUTE(std::exception_ptr, exception);
+      ELLE_ATTRIBUTE(reactor::Thread::unique_ptr, writer);
+      ELLE_ATTRIBUTE(std::exception_ptr, write_exception);
 
     /*--------.
     | Version |
@@ -104,7 +114,42 @@ namespace elle
       _write(elle::Buffer const& packet) override;
     private:
       void
-      _write(elle::Buffer const& packet, int id);
+      _write(elle::Buffer const& packet, Channel& channel);
+
+    /*--------.
+    | Framing |
+    `--------*/
+    public:
+      /// Whether packets are split in frames, from version 0.4.0.
+      ELLE_ATTRIBUTE_R(bool, framed);
+      /// The maximum size of a frame. Defaults to
+      /// ELLE_PROTOCOL_CHANNEL_FRAME, 64KiB.
+      ELLE_ATTRIBUTE_R(int64_t, frame_size);
+      /// The credit of a new Channel, and the amount of unread data a
+      /// Channel may buffer before its peer stops. Defaults to
+      /// ELLE_PROTOCOL_CHANNEL_WINDOW, 1MiB. Peers should agree on it.
+      ELLE_ATTRIBUTE_R(int64_t, window);
+    private:
+      void
+      _write_thread();
+      /// Put \a channel in line to send.
+      void
+      _activate(Channel& channel);
+      /// Send a control frame.
+      void
+      _control(Channel::Id id, unsigned char flags, elle::Buffer payload = {});
+      /// Handle a received frame.
+      void
+      _receive(Channel& channel, unsigned char flags, elle::Buffer frame);
+      /// Account for \a size bytes read from \a channel, granting credit
+      /// back to the peer.
+      void
+      _consumed(Channel& channel, int64_t size);
+      /// Channels in line to send, by turn.
+      ELLE_ATTRIBUTE(std::deque<Channel::Id>, active);
+      /// Control frames to send first.
+      ELLE_ATTRIBUTE(std::deque<elle::Buffer>, controls);
+      ELLE_ATTRIBUTE(elle::reactor::Signal, writable);
 
     /*----------.
     | Printable |
@@ -0,0 +1,436 @@
+#include <elle/protocol/Checksum.hh>
+
+#include <array>
+#include <cstring>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+
+#include <openssl/sha.h>
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+# include <arm_acle.h>
+#endif
+
+#include <elle/assert.hh>
+#include <elle/err.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+#include <elle/printf.hh>
+
+ELLE_LOG_COMPONENT("elle.protocol.Checksum");
+
+namespace elle
+{
+  namespace protocol
+  {
+    std::ostream&
+    operator <<(std::ostream& output, Checksum checksum)
+    {
+      switch (checksum)
+      {
+        case Checksum::sha1:
+          return output << "sha1";
+        case Checksum::crc32c:
+          return output << "crc32c";
+        case Checksum::xxh64:
+          return output << "xxh64";
+      }
+      elle::unreachable();
+    }
+
+    boost::optional<Checksum>
+    checksum_from_string(std::string const& name)
+    {
+      for (auto c: {Checksum::sha1, Checksum::crc32c, Checksum::xxh64})
+        if (elle::sprintf("%s", c) == name)
+          return c;
+      return boost::none;
+    }
+
+    std::vector<Checksum>
+    checksums_offered()
+    {
+      auto const env =
+        elle::os::getenv("ELLE_PROTOCOL_CHECKSUMS", std::string());
+      if (env.empty())
+        return {Checksum::crc32c, Checksum::xxh64, Checksum::sha1};
+      auto names = std::vector<std::string>{};
+      boost::split(names, env, boost::is_any_of(","));
+      auto res = std::vector<Checksum>{};
+      for (auto const& name: names)
+        if (auto c = checksum_from_string(name))
+          res.push_back(*c);
+        else
+          ELLE_WARN("ignore unknown checksum in ELLE_PROTOCOL_CHECKSUMS: %s",
+                    name);
+      return res;
+    }
+
+    namespace
+    {
+      void
+      put_big_endian(elle::Buffer& output, uint64_t value, int bytes)
+      {
+        for (int i = bytes - 1; i >= 0; --i)
+        {
+          auto const byte = static_cast<unsigned char>(value >> (i * 8));
+          output.append(&byte, 1);
+        }
+      }
+
+      /*-------.
+      | CRC32C |
+      `-------*/
+
+      std::array<uint32_t, 256>
+      crc32c_table()
+      {
+        auto res = std::array<uint32_t, 256>{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+          auto crc = i;
+          for (int bit = 0; bit < 8; ++bit)
+            crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+          res[i] = crc;
+        }
+        return res;
+      }
+
+      uint32_t
+      crc32c_software(uint32_t crc, unsigned char const* data, std::size_t size)
+      {
+        static auto const table = crc32c_table();
+        while (size--)
+          crc = table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+        return crc;
+      }
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+      __attribute__((target("sse4.2")))
+      uint32_t
+      crc32c_hardware(uint32_t crc, unsigned char const* data,
+                      std::size_t size)
+      {
+        auto wide = uint64_t(crc);
+        for (; size >= 8; size -= 8, data += 8)
+        {
+          uint64_t word;
+          std::memcpy(&word, data, 8);
+          wide = __builtin_ia32_crc32di(wide, word);
+        }
+        crc = static_cast<uint32_t>(wide);
+        while (size--)
+          crc = __builtin_ia32_crc32qi(crc, *data++);
+        return crc;
+      }
+
+      bool
+      crc32c_accelerated()
+      {
+        static bool const res = __builtin_cpu_supports("sse4.2");
+        return res;
+      }
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+      uint32_t
+      crc32c_hardware(uint32_t crc, unsigned char const* data,
+                      std::size_t size)
+      {
+        for (; size >= 8; size -= 8, data += 8)
+        {
+          uint64_t word;
+          std::memcpy(&word, data, 8);
+          crc = __crc32cd(crc, word);
+        }
+        while (size--)
+          crc = __crc32cb(crc, *data++);
+        return crc;
+      }
+
+      bool
+      crc32c_accelerated()
+      {
+        return true;
+      }
+#else
+      uint32_t
+      crc32c_hardware(uint32_t crc, unsigned char const* data,
+                      std::size_t size)
+      {
+        return crc32c_software(crc, data, size);
+      }
+
+      bool
+      crc32c_accelerated()
+      {
+        return false;
+      }
+#endif
+
+      /*---------.
+      | xxHash64 |
+      `---------*/
+
+      uint64_t const prime1 = 11400714785074694791ULL;
+      uint64_t const prime2 = 14029467366897019727ULL;
+      uint64_t const prime3 = 1609587929392839161ULL;
+      uint64_t const prime4 = 9650029242287828579ULL;
+      uint64_t const prime5 = 2870177450012600261ULL;
+
+      uint64_t
+      rotl(uint64_t x, int r)
+      {
+        return (x << r) | (x >> (64 - r));
+      }
+
+      uint64_t
+      read64(unsigned char const* p)
+      {
+        // Little endian, whatever the host.
+        auto res = uint64_t(0);
+        for (int i = 7; i >= 0; --i)
+          res = (res << 8) | p[i];
+        return res;
+      }
+
+      uint32_t
+      read32(unsigned char const* p)
+      {
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 |
+          uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+      }
+
+      uint64_t
+      xxh64_round(uint64_t acc, uint64_t input)
+      {
+        acc += input * prime2;
+        acc = rotl(acc, 31);
+        return acc * prime1;
+      }
+
+      uint64_t
+      xxh64_merge(uint64_t acc, uint64_t value)
+      {
+        acc ^= xxh64_round(0, value);
+        return acc * prime1 + prime4;
+      }
+    }
+
+    /*---------------.
+    | Implementation |
+    `---------------*/
+
+    class Hasher::Impl
+    {
+    public:
+      virtual
+      ~Impl() = default;
+      virtual
+      void
+      update(unsigned char const* data, std::size_t size) = 0;
+      virtual
+      elle::Buffer
+      digest() = 0;
+    };
+
+    namespace
+    {
+      class SHA1
+        : public Hasher::Impl
+      {
+      public:
+        SHA1()
+        {
+          ::SHA1_Init(&this->_context);
+        }
+
+        void
+        update(unsigned char const* data, std::size_t size) override
+        {
+          ::SHA1_Update(&this->_context, data, size);
+        }
+
+        elle::Buffer
+        digest() override
+        {
+          auto res = elle::Buffer(SHA_DIGEST_LENGTH);
+          ::SHA1_Final(res.mutable_contents(), &this->_context);
+          ::SHA1_Init(&this->_context);
+          return res;
+        }
+
+      private:
+        ::SHA_CTX _context;
+      };
+
+      class CRC32C
+        : public Hasher::Impl
+      {
+      public:
+        CRC32C()
+          : _crc(~uint32_t(0))
+          , _accelerated(crc32c_accelerated())
+        {}
+
+        void
+        update(unsigned char const* data, std::size_t size) override
+        {
+          this->_crc = this->_accelerated ?
+            crc32c_hardware(this->_crc, data, size) :
+            crc32c_software(this->_crc, data, size);
+        }
+
+        elle::Buffer
+        digest() override
+        {
+          auto res = elle::Buffer();
+          put_big_endian(res, ~this->_crc, 4);
+          this->_crc = ~uint32_t(0);
+          return res;
+        }
+
+      private:
+        uint32_t _crc;
+        bool _accelerated;
+      };
+
+      class XXH64
+        : public Hasher::Impl
+      {
+      public:
+        XXH64()
+        {
+          this->_reset();
+        }
+
+        void
+        update(unsigned char const* data, std::size_t size) override
+        {
+          this->_length += size;
+          if (this->_buffered + size < 32)
+          {
+            std::memcpy(this->_buffer + this->_buffered, data, size);
+            this->_buffered += size;
+            return;
+          }
+          if (this->_buffered)
+          {
+            auto const fill = 32 - this->_buffered;
+            std::memcpy(this->_buffer + this->_buffered, data, fill);
+            this->_stripe(this->_buffer);
+            data += fill;
+            size -= fill;
+            this->_buffered = 0;
+          }
+          for (; size >= 32; size -= 32, data += 32)
+            this->_stripe(data);
+          std::memcpy(this->_buffer, data, size);
+          this->_buffered = size;
+        }
+
+        elle::Buffer
+        digest() override
+        {
+          auto h = uint64_t(0);
+          if (this->_length >= 32)
+          {
+            h = rotl(this->_acc[0], 1) + rotl(this->_acc[1], 7) +
+              rotl(this->_acc[2], 12) + rotl(this->_acc[3], 18);
+            for (auto acc: this->_acc)
+              h = xxh64_merge(h, acc);
+          }
+          else
+            h = prime5;
+          h += this->_length;
+          auto p = this->_buffer;
+          auto const end = this->_buffer + this->_buffered;
+          for (; p + 8 <= end; p += 8)
+          {
+            h ^= xxh64_round(0, read64(p));
+            h = rotl(h, 27) * prime1 + prime4;
+          }
+          if (p + 4 <= end)
+          {
+            h ^= uint64_t(read32(p)) * prime1;
+            h = rotl(h, 23) * prime2 + prime3;
+            p += 4;
+          }
+          for (; p < end; ++p)
+          {
+            h ^= *p * prime5;
+            h = rotl(h, 11) * prime1;
+          }
+          h ^= h >> 33;
+          h *= prime2;
+          h ^= h >> 29;
+          h *= prime3;
+          h ^= h >> 32;
+          auto res = elle::Buffer();
+          put_big_endian(res, h, 8);
+          this->_reset();
+          return res;
+        }
+
+      private:
+        void
+        _reset()
+        {
+          this->_acc[0] = prime1 + prime2;
+          this->_acc[1] = prime2;
+          this->_acc[2] = 0;
+          this->_acc[3] = -prime1;
+          this->_length = 0;
+          this->_buffered = 0;
+        }
+
+        void
+        _stripe(unsigned char const* data)
+        {
+          for (int i = 0; i < 4; ++i)
+            this->_acc[i] = xxh64_round(this->_acc[i], read64(data + i * 8));
+        }
+
+        uint64_t _acc[4];
+        uint64_t _length;
+        unsigned char _buffer[32];
+        std::size_t _buffered;
+      };
+    }
+
+    /*-------.
+    | Hasher |
+    `-------*/
+
+    Hasher::Hasher(Checksum algorithm)
+      : _algorithm(algorithm)
+      , _impl([&] () -> std::unique_ptr<Impl>
+              {
+                switch (algorithm)
+                {
+                  case Checksum::sha1:
+                    return std::make_unique<SHA1>();
+                  case Checksum::crc32c:
+                    return std::make_unique<CRC32C>();
+                  case Checksum::xxh64:
+                    return std::make_unique<XXH64>();
+                }
+                elle::unreachable();
+              }())
+    {}
+
+    Hasher::~Hasher()
+    {}
+
+    void
+    Hasher::update(elle::ConstWeakBuffer data)
+    {
+      this->_impl->update(data.contents(), data.size());
+    }
+
+    elle::Buffer
+    Hasher::digest()
+    {
+      return this->_impl->digest();
+    }
+  }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <iosfwd>
+#include <memory>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include <elle/Buffer.hh>
+#include <elle/attribute.hh>
+#include <elle/compiler.hh>
+
+namespace elle
+{
+  namespace protocol
+  {
+    /// Packet checksum algorithms.
+    ///
+    /// Since version 0.4.0, Serializers negotiate the algorithm during their
+    /// handshake. Older peers only know SHA-1.
+    enum class Checksum
+    {
+      /// SHA-1, 20 bytes. Slow, kept for older peers.
+      sha1,
+      /// CRC32C, 4 bytes. Hardware accelerated on x86-64 and ARMv8.
+      crc32c,
+      /// xxHash64, 8 bytes.
+      xxh64,
+    };
+
+    ELLE_API
+    std::ostream&
+    operator <<(std::ostream& output, Checksum checksum);
+
+    /// Parse the name of a checksum algorithm, as printed.
+    ///
+    /// @returns The algorithm, or boost::none if unknown.
+    ELLE_API
+    boost::optional<Checksum>
+    checksum_from_string(std::string const& name);
+
+    /// The algorithms offered during negotiation, by order of preference.
+    ///
+    /// Defaults to crc32c, xxh64 and sha1, and can be restricted with a comma
+    /// separated list in ELLE_PROTOCOL_CHECKSUMS.
+    ELLE_API
+    std::vector<Checksum>
+    checksums_offered();
+
+    /// Incremental checksum computation.
+    ///
+    /// @code{.cc}
+    ///
+    /// elle::protocol::Hasher hasher(elle::protocol::Checksum::crc32c);
+    /// hasher.update(first_chunk);
+    /// hasher.update(second_chunk);
+    /// auto const digest = hasher.digest();
+    ///
+    /// @endcode
+    class ELLE_API Hasher
+    {
+    public:
+      Hasher(Checksum algorithm);
+      ~Hasher();
+      /// Account for \a data.
+      void
+      update(elle::ConstWeakBuffer data);
+      /// The checksum of all data so far, resetting the computation.
+      elle::Buffer
+      digest();
+      ELLE_ATTRIBUTE_R(Checksum, algorithm);
+    public:
+      class Impl;
+    private:
+      ELLE_ATTRIBUTE(std::unique_ptr<Impl>, impl);
+    };
+  }
+}
@@ -0,0 +1,268 @@
+#include <elle/protocol/Compression.hh>
+
+#include <zlib.h>
+
+#include <chrono>
+
+#include <elle/err.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+#include <elle/printf.hh>
+
+#include <elle/protocol/Checksum.hh>
+#include <elle/protocol/exceptions.hh>
+
+ELLE_LOG_COMPONENT("elle.protocol.Compression");
+
+namespace elle
+{
+  namespace protocol
+  {
+    namespace
+    {
+      // Packets at least this big are probed before being compressed.
+      auto const probe_threshold = elle::Buffer::Size(1 << 16);
+      auto const probe_size = elle::Buffer::Size(1 << 12);
+
+      // The size a packet must compress to for it to be worth it.
+      elle::Buffer::Size
+      budget(elle::Buffer::Size size)
+      {
+        return size - size / 16;
+      }
+
+      /// Count the time spent in a scope.
+      class Timer
+      {
+      public:
+        Timer(Duration& total)
+          : _total(total)
+          , _start(std::chrono::steady_clock::now())
+        {}
+
+        ~Timer()
+        {
+          this->_total += std::chrono::duration_cast<Duration>(
+            std::chrono::steady_clock::now() - this->_start);
+        }
+
+      private:
+        ELLE_ATTRIBUTE(Duration&, total);
+        ELLE_ATTRIBUTE(std::chrono::steady_clock::time_point, start);
+      };
+    }
+
+    /*-----------.
+    | Statistics |
+    `-----------*/
+
+    double
+    Compressor::Statistics::ratio() const
+    {
+      return this->compressed_out ?
+        double(this->raw_out) / this->compressed_out : 1;
+    }
+
+    void
+    Compressor::Statistics::print(std::ostream& stream) const
+    {
+      elle::fprintf(
+        stream,
+        "compressed: %s (%s -> %s bytes, ratio %.2f, %s), skipped: %s, "
+        "decompressed: %s (%s -> %s bytes, %s)",
+        this->compressed, this->raw_out, this->compressed_out, this->ratio(),
+        this->compression_time, this->skipped,
+        this->decompressed, this->compressed_in, this->raw_in,
+        this->decompression_time);
+    }
+
+    /*---------------.
+    | Implementation |
+    `---------------*/
+
+    class Compressor::Impl
+    {
+    public:
+      Impl(int level)
+        : _deflate()
+        , _inflate()
+      {
+        auto const check = [] (int err, char const* what)
+          {
+            if (err == Z_MEM_ERROR)
+              throw std::bad_alloc();
+            else if (err != Z_OK)
+              elle::err("ZLIB %s error: %s", what, err);
+          };
+        // Negative window bits: raw deflate, no header nor checksum, the
+        // Serializer takes care of integrity.
+        check(deflateInit2(&this->_deflate, level, Z_DEFLATED, -15, 8,
+                           Z_DEFAULT_STRATEGY),
+              "deflateInit");
+        check(inflateInit2(&this->_inflate, -15), "inflateInit");
+      }
+
+      ~Impl()
+      {
+        deflateEnd(&this->_deflate);
+        inflateEnd(&this->_inflate);
+      }
+
+      /// Deflate \a input into \a output, at most \a size bytes.
+      ///
+      /// @returns Whether the compressed data fit.
+      bool
+      deflate(elle::ConstWeakBuffer input,
+              unsigned char* output,
+              elle::Buffer::Size size,
+              elle::Buffer::Size& compressed,
+              elle::Buffer const& dictionary)
+      {
+        deflateReset(&this->_deflate);
+        if (!dictionary.empty())
+          deflateSetDictionary(
+            &this->_deflate, dictionary.contents(), dictionary.size());
+        this->_deflate.next_in = const_cast<unsigned char*>(input.contents());
+        this->_deflate.avail_in = input.size();
+        this->_deflate.next_out = output;
+        this->_deflate.avail_out = size;
+        auto const ret = ::deflate(&this->_deflate, Z_FINISH);
+        compressed = size - this->_deflate.avail_out;
+        return ret == Z_STREAM_END;
+      }
+
+      void
+      inflate(elle::ConstWeakBuffer input,
+              elle::Buffer& output,
+              elle::Buffer const& dictionary)
+      {
+        inflateReset(&this->_inflate);
+        if (!dictionary.empty())
+          inflateSetDictionary(
+            &this->_inflate, dictionary.contents(), dictionary.size());
+        this->_inflate.next_in = const_cast<unsigned char*>(input.contents());
+        this->_inflate.avail_in = input.size();
+        this->_inflate.next_out = output.mutable_contents();
+        this->_inflate.avail_out = output.size();
+        auto const ret = ::inflate(&this->_inflate, Z_FINISH);
+        if (ret != Z_STREAM_END)
+          elle::err<protocol::Error>(
+            "unable to decompress packet: %s",
+            this->_inflate.msg ? this->_inflate.msg : "truncated data");
+        if (this->_inflate.avail_out != 0 || this->_inflate.avail_in != 0)
+          elle::err<protocol::Error>(
+            "decompressed packet does not match announced size");
+      }
+
+    private:
+      ELLE_ATTRIBUTE(z_stream, deflate);
+      ELLE_ATTRIBUTE(z_stream, inflate);
+    };
+
+    /*-------------.
+    | Construction |
+    `-------------*/
+
+    Compressor::Compressor(elle::Buffer dictionary,
+                           int level,
+                           elle::Buffer::Size threshold)
+      : _dictionary(std::move(dictionary))
+      , _level(level ? level :
+               elle::os::getenv("ELLE_PROTOCOL_COMPRESSION_LEVEL", 1))
+      , _threshold(threshold ? threshold :
+                   elle::os::getenv("ELLE_PROTOCOL_COMPRESSION_THRESHOLD",
+                                    256))
+      , _statistics()
+      , _impl(std::make_unique<Impl>(this->_level))
+    {}
+
+    Compressor::~Compressor()
+    {}
+
+    /*------------.
+    | Compression |
+    `------------*/
+
+    // A compressed packet is its original size, 4 bytes big endian, followed
+    // by the raw deflate stream.
+    boost::optional<elle::Buffer>
+    Compressor::compress(elle::ConstWeakBuffer packet)
+    {
+      auto const skip = [&] (char const* reason)
+        {
+          ELLE_DEBUG("%s: skip %s bytes packet: %s",
+                     this, packet.size(), reason);
+          ++this->_statistics.skipped;
+          return boost::none;
+        };
+      if (packet.size() < this->_threshold)
+        return skip("too small");
+      Timer timer(this->_statistics.compression_time);
+      auto res = elle::Buffer(4 + budget(packet.size()));
+      auto compressed = elle::Buffer::Size(0);
+      // Probe a sample of large packets, so incompressible data such as
+      // encrypted blocks costs little.
+      if (packet.size() >= probe_threshold &&
+          !this->_impl->deflate(packet.range(0, probe_size),
+                                res.mutable_contents() + 4,
+                                budget(probe_size), compressed,
+                                this->_dictionary))
+        return skip("sample is incompressible");
+      if (!this->_impl->deflate(packet, res.mutable_contents() + 4,
+                                res.size() - 4, compressed, this->_dictionary))
+        return skip("incompressible");
+      auto const size = uint32_t(packet.size());
+      for (int i = 0; i < 4; ++i)
+        res.mutable_contents()[i] = (size >> (8 * (3 - i))) & 0xff;
+      res.size(4 + compressed);
+      ++this->_statistics.compressed;
+      this->_statistics.raw_out += packet.size();
+      this->_statistics.compressed_out += res.size();
+      ELLE_DEBUG("%s: compressed %s bytes to %s", this, packet.size(),
+                 res.size());
+      return res;
+    }
+
+    elle::Buffer
+    Compressor::decompress(elle::ConstWeakBuffer data)
+    {
+      if (data.size() < 4)
+        elle::err<protocol::Error>("compressed packet too short: %s bytes",
+                                   data.size());
+      auto size = uint32_t(0);
+      for (int i = 0; i < 4; ++i)
+        size = (size << 8) | data.contents()[i];
+      static auto const max =
+        elle::os::getenv("ELLE_PROTOCOL_COMPRESSION_MAX_SIZE", 1 << 30);
+      if (size > unsigned(max))
+        elle::err<protocol::Error>(
+          "compressed packet too large: %s bytes", size);
+      Timer timer(this->_statistics.decompression_time);
+      auto res = elle::Buffer(size);
+      this->_impl->inflate(data.range(4), res, this->_dictionary);
+      ++this->_statistics.decompressed;
+      this->_statistics.compressed_in += data.size();
+      this->_statistics.raw_in += size;
+      ELLE_DEBUG("%s: decompressed %s bytes to %s", this, data.size(), size);
+      return res;
+    }
+
+    std::string
+    Compressor::dictionary_id(elle::ConstWeakBuffer dictionary)
+    {
+      Hasher hasher(Checksum::crc32c);
+      hasher.update(dictionary);
+      return elle::sprintf("%s-%x", dictionary.size(), hasher.digest());
+    }
+
+    /*----------.
+    | Printable |
+    `----------*/
+
+    void
+    Compressor::print(std::ostream& stream) const
+    {
+      elle::fprintf(stream, "Compressor(%s)", static_cast<void const*>(this));
+    }
+  }
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <iosfwd>
+#include <memory>
+
+#include <boost/optional.hpp>
+
+#include <elle/Buffer.hh>
+#include <elle/Duration.hh>
+#include <elle/Printable.hh>
+#include <elle/attribute.hh>
+#include <elle/compiler.hh>
+
+namespace elle
+{
+  namespace protocol
+  {
+    /// Packet compression, negotiated by Serializers since version 0.4.0.
+    ///
+    /// Packets are deflated independently of each other, so an interrupted
+    /// packet does not desynchronize peers. Packets smaller than the threshold
+    /// are sent as is, and so are packets that do not shrink enough: large
+    /// packets are first probed by compressing a sample, and compression of
+    /// the whole packet is abandoned as soon as it would not save anything.
+    ///
+    /// Both peers may share a preset dictionary, which greatly helps small,
+    /// repetitive messages such as RPC calls.
+    ///
+    /// @code{.cc}
+    ///
+    /// elle::protocol::Compressor compressor;
+    /// if (auto compressed = compressor.compress(packet))
+    ///   assert(compressor.decompress(*compressed) == packet);
+    ///
+    /// @endcode
+    class ELLE_API Compressor
+      : public elle::Printable
+    {
+    /*------.
+    | Types |
+    `------*/
+    public:
+      using Self = Compressor;
+      /// Compression counters.
+      struct Statistics
+        : public elle::Printable
+      {
+        /// Packets sent compressed.
+        int64_t compressed;
+        /// Packets sent as is because they were too small or incompressible.
+        int64_t skipped;
+        /// Packets received compressed.
+        int64_t decompressed;
+        /// Size of the packets sent compressed, before compression.
+        int64_t raw_out;
+        /// Size of the packets sent compressed, after compression.
+        int64_t compressed_out;
+        /// Size of the packets received compressed, before decompression.
+        int64_t compressed_in;
+        /// Size of the packets received compressed, after decompression.
+        int64_t raw_in;
+        /// Time spent compressing, including abandoned attempts.
+        Duration compression_time;
+        /// Time spent decompressing.
+        Duration decompression_time;
+        /// Compression ratio of the packets sent compressed.
+        double
+        ratio() const;
+        void
+        print(std::ostream& stream) const override;
+      };
+
+    /*-------------.
+    | Construction |
+    `-------------*/
+    public:
+      /// Create a compressor.
+      ///
+      /// @param dictionary A preset dictionary, which the peer must share.
+      /// @param level The deflate level, from 1 to 9. Defaults to
+      ///              ELLE_PROTOCOL_COMPRESSION_LEVEL, 1.
+      /// @param threshold The size under which packets are not compressed.
+      ///                  Defaults to ELLE_PROTOCOL_COMPRESSION_THRESHOLD,
+      ///                  256 bytes.
+      Compressor(elle::Buffer dictionary = {},
+                 int level = 0,
+                 elle::Buffer::Size threshold = 0);
+      ~Compressor();
+
+    /*------------.
+    | Compression |
+    `------------*/
+    public:
+      /// Compress \a packet.
+      ///
+      /// @returns The compressed packet, or boost::none if it is not worth
+      ///          compressing.
+      boost::optional<elle::Buffer>
+      compress(elle::ConstWeakBuffer packet);
+      /// Decompress \a data.
+      ///
+      /// @throws protocol::Error if \a data is corrupted or larger than
+      ///         ELLE_PROTOCOL_COMPRESSION_MAX_SIZE, 1GiB, once decompressed.
+      elle::Buffer
+      decompress(elle::ConstWeakBuffer data);
+      /// An identifier of \a dictionary, for peers to check they share it.
+      static
+      std::string
+      dictionary_id(elle::ConstWeakBuffer dictionary);
+      ELLE_ATTRIBUTE_R(elle::Buffer, dictionary);
+      ELLE_ATTRIBUTE_R(int, level);
+      ELLE_ATTRIBUTE_R(elle::Buffer::Size, threshold);
+      ELLE_ATTRIBUTE_R(Statistics, statistics);
+    public:
+      class Impl;
+    private:
+      ELLE_ATTRIBUTE(std::unique_ptr<Impl>, impl);
+
+    /*----------.
+    | Printable |
+    `----------*/
+    public:
+      void
+      print(std::ostream& stream) const override;
+    };
+  }
+}
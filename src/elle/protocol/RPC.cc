@@ -1,14 +1,883 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+
+#include <boost/optional.hpp>
+
+#include <elle/With.hh>
+#include <elle/find.hh>
+#include <elle/finally.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+
+#include <elle/reactor/Barrier.hh>
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/TimeoutGuard.hh>
 #include <elle/reactor/exception.hh>
+#include <elle/reactor/network/Error.hh>
+#include <elle/reactor/scheduler.hh>
+#include <elle/reactor/signal.hh>
 
+#include <elle/protocol/Channel.hh>
+#include <elle/protocol/ChanneledStream.hh>
 #include <elle/protocol/RPC.hh>
+#include <elle/protocol/exceptions.hh>
+
+ELLE_LOG_COMPONENT("elle.protocol.RPC");
 
 namespace elle
 {
   namespace protocol
   {
+    namespace
+    {
+      /*--------.
+      | Batches |
+      `--------*/
+
+      // A session packet is a batch of messages. Each is made of its kind,
+      // a request id, the deadline of calls in milliseconds, 0 for none,
+      // and a payload size, followed by the payload.
+
+      enum class Kind
+      {
+        /// A call, expecting an answer.
+        call = 0,
+        /// The answer to a call, last of its results if it streams.
+        answer = 1,
+        /// The caller gave up.
+        cancel = 2,
+        /// A call expecting no answer.
+        post = 3,
+        /// A result of a streaming call.
+        item = 4,
+        /// More results of a streaming call may be sent.
+        credit = 5,
+      };
+
+      bool
+      is_call(Kind kind)
+      {
+        return kind == Kind::call || kind == Kind::post;
+      }
+
+      struct Message
+      {
+        Kind kind;
+        uint32_t id;
+        uint32_t deadline;
+        elle::Buffer payload;
+      };
+
+      elle::Buffer
+      message_header(Kind kind,
+                     uint32_t id,
+                     uint32_t deadline,
+                     elle::Buffer::Size size,
+                     elle::Version const& version)
+      {
+        auto res = elle::Buffer{};
+        Stream::uint32_put(res, uint32_t(kind), version);
+        Stream::uint32_put(res, id, version);
+        if (is_call(kind))
+          Stream::uint32_put(res, deadline, version);
+        Stream::uint32_put(res, size, version);
+        return res;
+      }
+
+      template <typename F>
+      void
+      read_batch(elle::Buffer const& packet,
+                 elle::Version const& version,
+                 F const& f)
+      {
+        elle::IOStream input(packet.istreambuf());
+        while (input.peek() != std::char_traits<char>::eof())
+        {
+          auto m = Message{};
+          auto const kind = Stream::uint32_get(input, version);
+          if (kind > uint32_t(Kind::credit))
+            elle::err<protocol::Error>("unknown RPC message kind: %s", kind);
+          m.kind = Kind(kind);
+          m.id = Stream::uint32_get(input, version);
+          m.deadline = is_call(m.kind) ?
+            Stream::uint32_get(input, version) : 0;
+          auto const size = Stream::uint32_get(input, version);
+          m.payload.size(size);
+          input.read(reinterpret_cast<char*>(m.payload.mutable_contents()),
+                     size);
+          if (input.gcount() != signed(size))
+            elle::err<protocol::Error>(
+              "truncated RPC message %s: %s bytes out of %s",
+              m.id, input.gcount(), size);
+          f(std::move(m));
+        }
+      }
+
+      /// The deadline sent along a call expiring after \a timeout.
+      uint32_t
+      deadline(DurationOpt const& timeout)
+      {
+        if (!timeout)
+          return 0;
+        auto const ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(*timeout);
+        return uint32_t(std::min<int64_t>(
+          std::max<int64_t>(ms.count(), 1),
+          std::numeric_limits<uint32_t>::max()));
+      }
+
+      elle::Buffer
+      credit_payload(uint32_t credit, elle::Version const& version)
+      {
+        auto res = elle::Buffer{};
+        Stream::uint32_put(res, credit, version);
+        return res;
+      }
+
+      Duration
+      since(std::chrono::steady_clock::time_point start)
+      {
+        return std::chrono::duration_cast<Duration>(
+          std::chrono::steady_clock::now() - start);
+      }
+
+      /// Messages waiting to be sent on a session.
+      ///
+      /// A writer thread sends them in batches: messages pushed while a
+      /// packet is being written are gathered in the next one.
+      class Outbox
+      {
+      public:
+        using OnError = std::function<void (std::exception_ptr)>;
+
+        Outbox(Channel& channel,
+               int64_t batch_size,
+               OnError on_error = {})
+          : _channel(channel)
+          , _batch_size(batch_size)
+          , _on_error(std::move(on_error))
+          , _messages()
+          , _pushed(0)
+          , _written(0)
+          , _available()
+          , _sent()
+          , _exception()
+          , _thread(new reactor::Thread(
+                      elle::sprintf("%s outbox", channel),
+                      [this] { this->_write_thread(); }))
+        {}
+
+        ~Outbox()
+        {
+          this->_thread->terminate_now();
+        }
+
+        /// Queue a message.
+        ///
+        /// @returns Its sequence number, to wait until it is written.
+        int64_t
+        push(Kind kind,
+             uint32_t id,
+             elle::Buffer payload = {},
+             uint32_t deadline = 0)
+        {
+          if (this->_exception)
+            std::rethrow_exception(this->_exception);
+          ELLE_DUMP("%s: queue message %s (%s bytes)",
+                    this->_channel, id, payload.size());
+          this->_messages.emplace_back(
+            message_header(kind, id, deadline, payload.size(),
+                           this->_channel.version()),
+            std::move(payload));
+          this->_available.signal();
+          return ++this->_pushed;
+        }
+
+        /// Wait until message \a sequence is written.
+        void
+        wait(int64_t sequence)
+        {
+          while (this->_written < sequence && !this->_exception)
+            reactor::wait(this->_sent);
+          if (this->_exception)
+            std::rethrow_exception(this->_exception);
+        }
+
+        /// Wait until all queued messages are written.
+        void
+        flush()
+        {
+          this->wait(this->_pushed);
+        }
+
+      private:
+        using Message = std::pair<elle::Buffer, elle::Buffer>;
+
+        void
+        _write_thread()
+        {
+          try
+          {
+            while (true)
+            {
+              if (this->_messages.empty())
+              {
+                reactor::wait(this->_available);
+                continue;
+              }
+              // Always send at least one message, however large.
+              auto batch = std::vector<Message>{};
+              auto size = int64_t(0);
+              do
+              {
+                auto& m = this->_messages.front();
+                size += m.first.size() + m.second.size();
+                batch.emplace_back(std::move(m));
+                this->_messages.pop_front();
+              }
+              while (!this->_messages.empty() &&
+                     size + this->_messages.front().second.size() <=
+                     this->_batch_size);
+              auto buffers = Stream::Buffers{};
+              for (auto const& m: batch)
+              {
+                buffers.emplace_back(m.first);
+                buffers.emplace_back(m.second);
+              }
+              ELLE_DEBUG("%s: send %s messages (%s bytes)",
+                         this->_channel, batch.size(), size);
+              this->_channel.write(buffers);
+              this->_written += batch.size();
+              this->_sent.signal();
+            }
+          }
+          catch (elle::Error const&)
+          {
+            ELLE_TRACE("%s: write failed: %s",
+                       this->_channel, elle::exception_string());
+            this->_exception = std::current_exception();
+            this->_sent.signal();
+            if (this->_on_error)
+              this->_on_error(this->_exception);
+          }
+        }
+
+        ELLE_ATTRIBUTE(Channel&, channel);
+        ELLE_ATTRIBUTE(int64_t, batch_size);
+        ELLE_ATTRIBUTE(OnError, on_error);
+        ELLE_ATTRIBUTE(std::deque<Message>, messages);
+        ELLE_ATTRIBUTE(int64_t, pushed);
+        ELLE_ATTRIBUTE(int64_t, written);
+        ELLE_ATTRIBUTE(reactor::Signal, available);
+        ELLE_ATTRIBUTE(reactor::Signal, sent);
+        ELLE_ATTRIBUTE(std::exception_ptr, exception);
+        ELLE_ATTRIBUTE(reactor::Thread::unique_ptr, thread);
+      };
+    }
+
+    /*----------.
+    | Histogram |
+    `----------*/
+
+    Histogram::Histogram()
+      : _count(0)
+      , _total(Duration::zero())
+      , _buckets()
+    {}
+
+    void
+    Histogram::add(Duration duration)
+    {
+      auto const us = std::chrono::duration_cast<std::chrono::microseconds>(
+        duration).count();
+      auto i = std::size_t(0);
+      while (i + 1 < this->_buckets.size() && (int64_t(2) << i) <= us)
+        ++i;
+      ++this->_buckets[i];
+      ++this->_count;
+      this->_total += duration;
+    }
+
+    Duration
+    Histogram::percentile(double p) const
+    {
+      if (!this->_count)
+        return Duration::zero();
+      auto const rank = int64_t(std::ceil(p * this->_count));
+      auto seen = int64_t(0);
+      for (auto i = std::size_t(0); i < this->_buckets.size(); ++i)
+        if ((seen += this->_buckets[i]) >= rank)
+          return std::chrono::microseconds(int64_t(2) << i);
+      return std::chrono::microseconds(
+        int64_t(2) << (this->_buckets.size() - 1));
+    }
+
+    void
+    Histogram::print(std::ostream& stream) const
+    {
+      elle::fprintf(stream, "Histogram(%s, p50: %s, p99: %s)",
+                    this->_count, this->percentile(0.5),
+                    this->percentile(0.99));
+    }
+
+    /*----------.
+    | Admission |
+    `----------*/
+
+    Admission::Admission()
+      : _concurrency(elle::os::getenv("ELLE_PROTOCOL_RPC_CONCURRENCY", 0))
+      , _queue(elle::os::getenv("ELLE_PROTOCOL_RPC_QUEUE", 1024))
+      , _running(0)
+      , _queued(0)
+      , _rejected(0)
+      , _queue_time()
+      , _latency()
+      , _released()
+    {}
+
+    void
+    Admission::operator ()(std::function<void ()> const& f)
+    {
+      auto const arrival = std::chrono::steady_clock::now();
+      // Queue behind others even if a slot was just released, so waiters
+      // are served first.
+      if (this->_concurrency &&
+          (this->_running >= this->_concurrency || this->_queued))
+      {
+        if (this->_queued >= this->_queue)
+        {
+          ++this->_rejected;
+          ELLE_TRACE("%s: reject call", this);
+          elle::err<RPCError>("too many pending calls: %s running, %s queued",
+                              this->_running, this->_queued);
+        }
+        ++this->_queued;
+        elle::SafeFinally dequeue([&] { --this->_queued; });
+        while (this->_running >= this->_concurrency)
+          reactor::wait(this->_released);
+      }
+      ++this->_running;
+      this->_queue_time.add(since(arrival));
+      auto const start = std::chrono::steady_clock::now();
+      elle::SafeFinally release([&]
+        {
+          --this->_running;
+          this->_latency.add(since(start));
+          this->_released.signal_one();
+        });
+      f();
+    }
+
+    void
+    Admission::print(std::ostream& stream) const
+    {
+      elle::fprintf(stream, "Admission(%s/%s running, %s/%s queued)",
+                    this->_running, this->_concurrency,
+                    this->_queued, this->_queue);
+    }
+
+    /*--------.
+    | Session |
+    `--------*/
+
+    /// The caller side of a multiplexed session.
+    class BaseRPC::Session
+    {
+    public:
+      Session(BaseRPC& owner)
+        : _channel(owner._channels)
+        , _next(0)
+        , _calls()
+        , _exception()
+        , _outbox(this->_channel, owner.batch_size(),
+                  [this] (std::exception_ptr e) { this->_fail(e); })
+        , _receiver(new reactor::Thread(
+                      elle::sprintf("%s receiver", this->_channel),
+                      [this] { this->_receive(); }))
+      {
+        ELLE_TRACE("%s: open session", this->_channel);
+      }
+
+      ~Session()
+      {
+        this->_receiver->terminate_now();
+      }
+
+      /// Call and wait for the answer, passing results to \a yield if
+      /// streaming.
+      elle::Buffer
+      call(elle::Buffer question,
+           DurationOpt timeout,
+           Yield const& yield = {},
+           int window = 0)
+      {
+        if (this->_exception)
+          std::rethrow_exception(this->_exception);
+        auto const id = this->_next++;
+        auto call = Call{};
+        call.streaming = bool(yield);
+        this->_calls.emplace(id, &call);
+        elle::SafeFinally forget([&]
+          {
+            this->_calls.erase(id);
+            // Let the peer know we gave up, so it stops working for nothing.
+            if (!call.done && !this->_exception)
+            {
+              ELLE_DEBUG("%s: cancel request %s", this->_channel, id);
+              this->_outbox.push(Kind::cancel, id);
+            }
+          });
+        ELLE_DEBUG("%s: send request %s", this->_channel, id);
+        this->_outbox.push(
+          Kind::call, id, std::move(question), deadline(timeout));
+        if (call.streaming)
+          this->_outbox.push(
+            Kind::credit, id,
+            credit_payload(window, this->_channel.version()));
+        // The timeout covers the whole call, results included.
+        auto guard = std::unique_ptr<reactor::TimeoutGuard>(
+          timeout ? new reactor::TimeoutGuard(*timeout) : nullptr);
+        auto consumed = 0;
+        while (true)
+          if (!call.items.empty())
+          {
+            auto item = std::move(call.items.front());
+            call.items.pop_front();
+            yield(std::move(item));
+            // Grant credit back by batches.
+            if (++consumed >= std::max(1, window / 4))
+            {
+              this->_outbox.push(
+                Kind::credit, id,
+                credit_payload(consumed, this->_channel.version()));
+              consumed = 0;
+            }
+          }
+          else if (call.done)
+            break;
+          else
+            reactor::wait(call.changed);
+        if (!call.answer)
+          std::rethrow_exception(this->_exception);
+        return std::move(call.answer.get());
+      }
+
+      /// Call without expecting an answer, once written.
+      void
+      post(elle::Buffer question)
+      {
+        if (this->_exception)
+          std::rethrow_exception(this->_exception);
+        auto const id = this->_next++;
+        ELLE_DEBUG("%s: post request %s", this->_channel, id);
+        this->_outbox.wait(
+          this->_outbox.push(Kind::post, id, std::move(question)));
+      }
+
+    private:
+      struct Call
+      {
+        Call()
+          : streaming(false)
+          , done(false)
+          , changed()
+          , items()
+          , answer()
+        {}
+
+        bool streaming;
+        bool done;
+        reactor::Signal changed;
+        /// Results not consumed yet.
+        std::deque<elle::Buffer> items;
+        boost::optional<elle::Buffer> answer;
+      };
+
+      void
+      _receive()
+      {
+        try
+        {
+          while (true)
+          {
+            auto packet = this->_channel.read();
+            read_batch(
+              packet, this->_channel.version(),
+              [this] (Message m)
+              {
+                if (m.kind != Kind::answer && m.kind != Kind::item)
+                  elle::err<protocol::Error>(
+                    "unexpected RPC message on session: %s",
+                    uint32_t(m.kind));
+                auto it = elle::find(this->_calls, m.id);
+                if (!it)
+                  ELLE_TRACE("%s: discard answer to abandoned request %s",
+                             this->_channel, m.id);
+                else if (m.kind == Kind::item)
+                {
+                  ELLE_DUMP("%s: receive result of request %s",
+                            this->_channel, m.id);
+                  if (!it->second->streaming)
+                    elle::err<protocol::Error>(
+                      "unexpected result of request %s", m.id);
+                  it->second->items.emplace_back(std::move(m.payload));
+                  it->second->changed.signal();
+                }
+                else
+                {
+                  ELLE_DEBUG("%s: receive answer %s",
+                             this->_channel, m.id);
+                  it->second->answer = std::move(m.payload);
+                  it->second->done = true;
+                  it->second->changed.signal();
+                }
+              });
+          }
+        }
+        catch (elle::Error const&)
+        {
+          ELLE_TRACE("%s: read failed: %s",
+                     this->_channel, elle::exception_string());
+          this->_fail(std::current_exception());
+        }
+      }
+
+      void
+      _fail(std::exception_ptr e)
+      {
+        if (!this->_exception)
+          this->_exception = e;
+        for (auto& call: this->_calls)
+        {
+          call.second->done = true;
+          call.second->changed.signal();
+        }
+      }
+
+      ELLE_ATTRIBUTE(Channel, channel);
+      ELLE_ATTRIBUTE(uint32_t, next);
+      ELLE_ATTRIBUTE((std::unordered_map<uint32_t, Call*>), calls);
+      ELLE_ATTRIBUTE(std::exception_ptr, exception);
+      ELLE_ATTRIBUTE(Outbox, outbox);
+      ELLE_ATTRIBUTE(reactor::Thread::unique_ptr, receiver);
+    };
+
+    /*-------------.
+    | Construction |
+    `-------------*/
+
     BaseRPC::BaseRPC(ChanneledStream& channels)
       : _channels(channels)
       , _id(0)
+      , _admissions()
+      , _batch_size(elle::os::getenv("ELLE_PROTOCOL_RPC_BATCH", 1 << 16))
+      , _stream_window(
+        elle::os::getenv("ELLE_PROTOCOL_RPC_STREAM_WINDOW", 64))
+      , _session()
     {}
+
+    BaseRPC::~BaseRPC()
+    {}
+
+    /*----------.
+    | Admission |
+    `----------*/
+
+    Admission&
+    BaseRPC::admission(uint32_t id)
+    {
+      while (this->_admissions.size() <= id)
+        this->_admissions.emplace_back();
+      return this->_admissions[id];
+    }
+
+    /*-------------.
+    | Multiplexing |
+    `-------------*/
+
+    bool
+    BaseRPC::multiplexed() const
+    {
+      return this->_channels.version() >= elle::Version(0, 4, 0);
+    }
+
+    elle::Buffer
+    BaseRPC::_call(elle::Buffer question, DurationOpt timeout)
+    {
+      if (!this->_session)
+        this->_session = std::make_unique<Session>(*this);
+      return this->_session->call(std::move(question), timeout);
+    }
+
+    elle::Buffer
+    BaseRPC::_stream(elle::Buffer question,
+                     DurationOpt timeout,
+                     Yield const& yield)
+    {
+      if (!this->_session)
+        this->_session = std::make_unique<Session>(*this);
+      return this->_session->call(
+        std::move(question), timeout, yield, this->_stream_window);
+    }
+
+    void
+    BaseRPC::_post(elle::Buffer question)
+    {
+      if (this->multiplexed())
+      {
+        if (!this->_session)
+          this->_session = std::make_unique<Session>(*this);
+        this->_session->post(std::move(question));
+      }
+      else
+      {
+        // Older peers answer anyway, on a channel nobody reads anymore.
+        Channel channel(this->_channels);
+        channel.write(question);
+      }
+    }
+
+    elle::Buffer
+    BaseRPC::_ask(elle::Buffer question, DurationOpt timeout)
+    {
+      if (this->multiplexed())
+        return this->_call(std::move(question), timeout);
+      // Older peers know nothing of deadlines: only stop waiting.
+      auto guard = std::unique_ptr<reactor::TimeoutGuard>(
+        timeout ? new reactor::TimeoutGuard(*timeout) : nullptr);
+      Channel channel(this->_channels);
+      channel.write(question);
+      return channel.read();
+    }
+
+    void
+    BaseRPC::_serve(Answer const& answer, bool parallel)
+    {
+      auto stopped = reactor::Barrier{};
+      auto const serve = [&] (Channel& session)
+        {
+          ELLE_TRACE_SCOPE("%s: serve session", session);
+          Outbox outbox(session, this->_batch_size);
+          // Running calls, to cancel them.
+          auto calls = std::unordered_map<uint32_t, reactor::Thread*>{};
+          // Calls waiting for their turn, when answering in order.
+          auto line = std::deque<uint32_t>{};
+          auto turn = reactor::Signal{};
+          // Results streaming calls may still send.
+          struct Credit
+          {
+            int64_t available = 0;
+            reactor::Signal granted;
+          };
+          auto credits = std::unordered_map<uint32_t, Credit>{};
+          auto const respond = [&] (Message const& m)
+            {
+              elle::SafeFinally done([&]
+                {
+                  calls.erase(m.id);
+                  credits.erase(m.id);
+                  if (!parallel)
+                  {
+                    line.erase(std::find(line.begin(), line.end(), m.id));
+                    turn.signal();
+                  }
+                });
+              try
+              {
+                // The deadline covers waiting in line too. Expiring while
+                // answering yields an error answer.
+                auto guard = std::unique_ptr<reactor::TimeoutGuard>(
+                  m.deadline ?
+                  new reactor::TimeoutGuard(
+                    std::chrono::milliseconds(m.deadline)) :
+                  nullptr);
+                while (!parallel && line.front() != m.id)
+                  reactor::wait(turn);
+                auto res = elle::Buffer{};
+                auto const post = m.kind == Kind::post;
+                auto const stop = answer(
+                  m.payload, res,
+                  [&] (elle::Buffer item)
+                  {
+                    if (post)
+                      return;
+                    auto& credit = credits[m.id];
+                    while (credit.available <= 0)
+                      reactor::wait(credit.granted);
+                    --credit.available;
+                    outbox.push(Kind::item, m.id, std::move(item));
+                  });
+                guard.reset();
+                if (!post)
+                  outbox.push(Kind::answer, m.id, std::move(res));
+                if (stop)
+                {
+                  outbox.flush();
+                  stopped.open();
+                }
+              }
+              catch (reactor::Timeout const&)
+              {
+                ELLE_TRACE("%s: request %s expired", session, m.id);
+              }
+            };
+          elle::With<reactor::Scope>() << [&] (reactor::Scope& scope)
+          {
+            while (true)
+            {
+              auto packet = session.read();
+              read_batch(
+                packet, session.version(),
+                [&] (Message m)
+                {
+                  switch (m.kind)
+                  {
+                    case Kind::call:
+                    case Kind::post:
+                    {
+                      ELLE_DEBUG("%s: receive request %s", session, m.id);
+                      if (!parallel)
+                        line.push_back(m.id);
+                      auto const id = m.id;
+                      calls[id] = &scope.run_background(
+                        elle::sprintf("RPC %s", id),
+                        [&respond, m = std::move(m)] { respond(m); });
+                      break;
+                    }
+                    case Kind::cancel:
+                      if (auto it = elle::find(calls, m.id))
+                      {
+                        ELLE_TRACE("%s: cancel request %s", session, m.id);
+                        it->second->terminate();
+                      }
+                      else
+                        ELLE_DEBUG("%s: ignore cancellation of request %s",
+                                   session, m.id);
+                      break;
+                    case Kind::credit:
+                    {
+                      if (!elle::find(calls, m.id))
+                        break;
+                      elle::IOStream input(m.payload.istreambuf());
+                      auto& credit = credits[m.id];
+                      credit.available +=
+                        Stream::uint32_get(input, session.version());
+                      credit.granted.signal();
+                      break;
+                    }
+                    case Kind::answer:
+                    case Kind::item:
+                      elle::err<protocol::Error>(
+                        "unexpected RPC answer on session: %s", m.id);
+                  }
+                });
+            }
+          };
+        };
+      elle::With<reactor::Scope>() << [&] (reactor::Scope& scope)
+      {
+        scope.run_background(
+          "RPC sessions",
+          [&]
+          {
+            while (true)
+            {
+              auto session =
+                std::make_shared<Channel>(this->_channels.accept());
+              scope.run_background(
+                elle::sprintf("RPC session %s", session->id()),
+                [&serve, session] { serve(*session); });
+            }
+          });
+        reactor::wait(stopped);
+        ELLE_TRACE("%s: stop serving as requested", this->_channels);
+      };
+    }
+
+    /*--------.
+    | Serving |
+    `--------*/
+
+    void
+    BaseRPC::_run(Answer const& answer)
+    {
+      try
+      {
+        if (this->multiplexed())
+          this->_serve(answer, false);
+        else
+        {
+          bool stop_request = false;
+          while (!stop_request)
+          {
+            ELLE_TRACE_SCOPE("%s: Accepting new request...", this->_channels);
+            Channel c(this->_channels.accept());
+            elle::Buffer res;
+            stop_request = answer(c.read(), res, {});
+            c.write(res);
+          }
+        }
+      }
+      catch (reactor::network::ConnectionClosed const& e)
+      {
+        ELLE_TRACE("%s: end of RPCs: connection closed", this->_channels);
+        return;
+      }
+      ELLE_TRACE("%s: end of RPCs: normal exit", this->_channels);
+    }
+
+    void
+    BaseRPC::_parallel_run(Answer const& answer)
+    {
+      try
+      {
+        if (this->multiplexed())
+          this->_serve(answer, true);
+        else
+          elle::With<reactor::Scope>("RPC // run") <<
+            [&] (reactor::Scope& scope)
+            {
+              int i = 0;
+              while (true)
+              {
+                auto chan =
+                  std::make_shared<Channel>(this->_channels.accept());
+                ++i;
+                scope.run_background(
+                  elle::sprintf("RPC %s", i),
+                  [&answer, chan]
+                  {
+                    elle::Buffer res;
+                    answer(chan->read(), res, {});
+                    chan->write(res);
+                  });
+              }
+            };
+      }
+      catch (reactor::network::ConnectionClosed const& e)
+      {
+        ELLE_TRACE("%s: end of RPCs: connection closed", this->_channels);
+        return;
+      }
+      catch (elle::Exception& e)
+      {
+        ELLE_WARN("%s: end of RPCs: %s", this->_channels, e);
+        throw;
+      }
+      catch (std::exception& e)
+      {
+        ELLE_WARN("%s: end of RPCs: %s", this->_channels, e.what());
+        throw;
+      }
+      catch (...)
+      {
+        ELLE_WARN("%s: end of RPCs: unkown error", this->_channels);
+        throw;
+      }
+    }
   }
 }
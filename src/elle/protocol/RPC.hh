@@ -1,14 +1,20 @@
 #pragma once
 
+#include <array>
+#include <deque>
 #include <ostream>
 #include <memory>
-#include <unordered_map>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
 
+#include <elle/Buffer.hh>
+#include <elle/Duration.hh>
 #include <elle/Printable.hh>
 
+#include <elle/reactor/Generator.hh>
 #include <elle/reactor/Thread.hh>
+#include <elle/reactor/signal.hh>
 
 #include <elle/protocol/fwd.hh>
 
@@ -25,6 +31,8 @@ namespace elle
     };
 
     using ExceptionHandler = std::function<void(std::exception_ptr)>;
+    /// Send one result of a streaming procedure.
+    using Yield = std::function<void (elle::Buffer item)>;
 
     template <typename ISerializer, typename OSerializer>
     class BaseProcedure
@@ -39,9 +47,13 @@ namespace elle
       template <typename I, typename O>
       friend class RPC;
 
+      /// Call the procedure.
+      ///
+      /// @param yield Send each result, for procedures returning a
+      ///              reactor::Generator.
       virtual
       void
-      _call(ISerializer& in, OSerializer& out) = 0;
+      _call(ISerializer& in, OSerializer& out, Yield const& yield) = 0;
 
     private:
       ELLE_ATTRIBUTE(std::string, name);
@@ -64,7 +76,7 @@ namespace elle
 
     protected:
       void
-      _call(ISerializer& in, OSerializer& out) override;
+      _call(ISerializer& in, OSerializer& out, Yield const& yield) override;
 
     private:
       template <typename I, typename O>
@@ -81,10 +93,81 @@ namespace elle
       ELLE_ATTRIBUTE(Function, function);
     };
 
+    /// A latency distribution, by power of two buckets of microseconds.
+    class ELLE_API Histogram
+      : public elle::Printable
+    {
+    public:
+      Histogram();
+      /// Account for \a duration.
+      void
+      add(Duration duration);
+      /// An upper bound of the \a p quantile, with 0 < p <= 1.
+      Duration
+      percentile(double p) const;
+      ELLE_ATTRIBUTE_R(int64_t, count);
+      ELLE_ATTRIBUTE_R(Duration, total);
+      /// Bucket i counts durations under 2^(i + 1) microseconds.
+      ELLE_ATTRIBUTE_R((std::array<int64_t, 40>), buckets);
+    public:
+      void
+      print(std::ostream& stream) const override;
+    };
+
+    /// Admission control and statistics of a local procedure.
+    ///
+    /// Calls beyond the concurrency limit wait in line, and calls beyond the
+    /// queue limit are rejected right away, so an overloaded server sheds
+    /// load instead of piling up coroutines.
+    class ELLE_API Admission
+      : public elle::Printable
+    {
+    public:
+      Admission();
+      /// Run \a f once a slot is available, accounting for its latency.
+      ///
+      /// @throws RPCError if the queue is full.
+      void
+      operator ()(std::function<void ()> const& f);
+      /// The maximum number of concurrent calls, or 0 for no limit.
+      ELLE_ATTRIBUTE_RW(int, concurrency);
+      /// The maximum number of calls waiting for a slot.
+      ELLE_ATTRIBUTE_RW(int, queue);
+      ELLE_ATTRIBUTE_R(int, running);
+      ELLE_ATTRIBUTE_R(int, queued);
+      /// Calls rejected because the queue was full.
+      ELLE_ATTRIBUTE_R(int64_t, rejected);
+      /// Time spent waiting for a slot.
+      ELLE_ATTRIBUTE_R(Histogram, queue_time);
+      /// Time spent running.
+      ELLE_ATTRIBUTE_R(Histogram, latency);
+    private:
+      ELLE_ATTRIBUTE(reactor::Signal, released);
+    public:
+      void
+      print(std::ostream& stream) const override;
+    };
+
+    /// The untyped part of RPCs.
+    ///
+    /// Before version 0.4.0, each call opens its own Channel, carrying the
+    /// question and the answer. From version 0.4.0, calls are multiplexed:
+    /// each RPC opens a single session Channel on first call, and every call
+    /// is a message tagged with a request id. Calls are pipelined, answers
+    /// may come back in any order, and messages sent while the previous
+    /// packet is being written are batched in the next one. Calls also carry
+    /// their deadline, and callers giving up cancel them, terminating the
+    /// procedure on the server.
+    ///
+    /// Procedures may also be posted, without waiting for an answer, and
+    /// procedures returning a reactor::Generator stream their results, the
+    /// caller granting credit as it consumes them.
     class BaseRPC
     {
     public:
       BaseRPC(ChanneledStream& channels);
+      virtual
+      ~BaseRPC();
       /// Run forever until one of the following:
       /// - Connection gets closed
       /// - Thread gets terminated
@@ -107,6 +190,100 @@ namespace elle
 
       ELLE_ATTRIBUTE(ChanneledStream&, channels, protected);
       ELLE_ATTRIBUTE(uint32_t, id, protected);
+
+    /*----------.
+    | Admission |
+    `----------*/
+    public:
+      /// Admission control of local procedures, indexed by id.
+      using Admissions = std::deque<Admission>;
+      ELLE_ATTRIBUTE_RX(Admissions, admissions);
+      /// The admission control of procedure \a id.
+      Admission&
+      admission(uint32_t id);
+
+    /*-------------.
+    | Multiplexing |
+    `-------------*/
+    public:
+      /// Whether calls are multiplexed on a session Channel, from version
+      /// 0.4.0.
+      bool
+      multiplexed() const;
+      /// The size above which messages are not batched anymore. Defaults to
+      /// ELLE_PROTOCOL_RPC_BATCH, 64KiB.
+      ELLE_ATTRIBUTE_R(int64_t, batch_size);
+      /// How many results of a streaming call may be sent before the caller
+      /// consumes them. Defaults to ELLE_PROTOCOL_RPC_STREAM_WINDOW, 64.
+      ELLE_ATTRIBUTE_R(int, stream_window);
+    protected:
+      /// Answer a question, returning whether to stop serving.
+      using Answer = std::function<bool (elle::Buffer const& question,
+                                         elle::Buffer& answer,
+                                         Yield const& yield)>;
+      /// Send \a question on the session and wait for its answer.
+      ///
+      /// @param timeout How long to wait, also sent as the deadline of the
+      ///                call.
+      /// @throws reactor::Timeout if \a timeout expires, in which case the
+      ///         call is cancelled.
+      elle::Buffer
+      _call(elle::Buffer question, DurationOpt timeout = {});
+      /// Send \a question on the session, pass results to \a yield as they
+      /// come and return the final answer.
+      ///
+      /// @param timeout How long the whole call may last, also sent as its
+      ///                deadline.
+      elle::Buffer
+      _stream(elle::Buffer question,
+              DurationOpt timeout,
+              Yield const& yield);
+      /// Send \a question without expecting an answer.
+      ///
+      /// Return once it is written.
+      void
+      _post(elle::Buffer question);
+      /// Send \a question, on the session or on a Channel of its own before
+      /// version 0.4.0, and wait for the answer.
+      elle::Buffer
+      _ask(elle::Buffer question, DurationOpt timeout);
+      template <typename T>
+      struct Tag
+      {};
+      /// Send \a question and decode the result of procedure \a name.
+      template <typename IS, typename T>
+      T
+      _result(elle::Buffer question,
+              std::string const& name,
+              DurationOpt const& timeout,
+              Tag<T>);
+      /// Send \a question and decode the results streamed by procedure \a
+      /// name as they come.
+      template <typename IS, typename T>
+      reactor::Generator<T>
+      _result(elle::Buffer question,
+              std::string const& name,
+              DurationOpt const& timeout,
+              Tag<reactor::Generator<T>>);
+      /// Serve the sessions opened by the peer until the connection closes
+      /// or \a answer asks to stop.
+      ///
+      /// @param answer Answer each question.
+      /// @param parallel Whether to answer the questions of a session
+      ///                 concurrently, or one after the other.
+      void
+      _serve(Answer const& answer, bool parallel);
+      /// Answer calls one after the other until the connection closes or \a
+      /// answer asks to stop.
+      void
+      _run(Answer const& answer);
+      /// Answer calls concurrently until the connection closes.
+      void
+      _parallel_run(Answer const& answer);
+    public:
+      class Session;
+    private:
+      ELLE_ATTRIBUTE(std::unique_ptr<Session>, session);
     };
 
     template <typename ISerializer, typename OSerializer>
@@ -128,12 +305,27 @@ namespace elle
                         RPC<ISerializer, OSerializer>& owner);
         R operator() (Args ...);
         void operator = (std::function<R (Args...)> const& implem);
+        /// Call the remote procedure without waiting for it to run.
+        ///
+        /// Return as soon as the call is written. Errors are only reported
+        /// to the peer's exception handler.
+        void
+        post(Args ...);
+        /// The admission control of the local implementation.
+        Admission&
+        admission();
+        /// How long to wait for the answer, from version 0.4.0. The
+        /// deadline is sent along, and the call is cancelled when it
+        /// expires.
+        ELLE_ATTRIBUTE_RW(DurationOpt, timeout);
         template <typename I, typename O>
         friend class RPC;
         RemoteProcedure(std::string const& name,
                         RPC<ISerializer, OSerializer>& owner,
                         uint32_t id);
       private:
+        elle::Buffer
+        _question(Args ... args);
         ELLE_ATTRIBUTE(uint32_t, id);
         ELLE_ATTRIBUTE(std::string, name);
         ELLE_ATTRIBUTE(Owner&, owner);
@@ -156,15 +348,30 @@ namespace elle
       void
       run(ExceptionHandler = {}) override;
 
+      /// Run forever, calling procedures concurrently.
+      ///
+      /// Before version 0.4.0, answers may be mismatched if they do not
+      /// complete in order.
       virtual
       void
       parallel_run();
 
+    private:
+      /// Call the procedure \a question asks for and fill \a answer.
+      ///
+      /// @returns Whether \a handler asked to stop.
+      bool
+      _answer(elle::Buffer const& question,
+              elle::Buffer& answer,
+              ExceptionHandler handler = {},
+              Yield const& yield = {});
+
     protected:
       using LocalProcedure = BaseProcedure<ISerializer, OSerializer>;
       using NamedProcedure = std::pair<std::string,
                         std::unique_ptr<LocalProcedure>>;
-      using Procedures = std::unordered_map<uint32_t, NamedProcedure>;
+      /// Procedures indexed by their dense id.
+      using Procedures = std::vector<NamedProcedure>;
 
       ELLE_ATTRIBUTE(Procedures, procedures, protected);
       ELLE_ATTRIBUTE(std::vector<BaseRPC*>, rpcs, protected);
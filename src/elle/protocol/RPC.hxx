@@ -5,8 +5,6 @@
 #include <elle/printf.hh>
 #include <elle/memory.hh>
 
-#include <elle/reactor/network/Error.hh>
-#include <elle/reactor/Scope.hh>
 #include <elle/reactor/scheduler.hh>
 #include <elle/reactor/Thread.hh>
 
@@ -67,6 +65,69 @@ namespace elle
     | RemoteProcedure helpers |
     `------------------------*/
 
+    // FIXME: move closer to elle::Error.
+    namespace
+    {
+      template <typename OStream>
+      void
+      output_error(OStream& os, elle::Exception const& e)
+      {
+        os << std::string(e.what());
+        os << uint16_t(e.backtrace().frames().size());
+        for (auto const& frame: e.backtrace().frames())
+          os << frame.symbol
+             << frame.symbol_mangled
+             << frame.symbol_demangled
+             << frame.address
+             << frame.offset;
+      }
+
+      template <typename IStream>
+      elle::Error
+      input_error(IStream& is)
+      {
+        std::string err;
+        is >> err;
+        uint16_t size;
+        is >> size;
+        auto frames = std::vector<StackFrame>{};
+        for (int i = 0; i < size; ++i)
+        {
+          frames.emplace_back();
+          auto& frame = frames.back();
+          is >> frame.symbol
+             >> frame.symbol_mangled
+             >> frame.symbol_demangled
+             >> frame.address
+             >> frame.offset;
+        }
+        return {std::move(frames), std::move(err)};
+      }
+    }
+
+    /// Read the status of an answer, throwing the remote error if any.
+    template <typename IS, typename Owner>
+    void
+    check_answer(IS& input, Owner const& owner, std::string const& name)
+    {
+      ELLE_LOG_COMPONENT("elle.protocol.RPC");
+      bool res;
+      input >> res;
+      if (!res)
+      {
+        auto error = input_error(input);
+        ELLE_TRACE_SCOPE("%s: remote procedure call failed: %s",
+                         owner, error.what());
+        // FIXME: only protocol error should throw this, not remote
+        // exceptions.
+        auto e =
+          RPCError(elle::sprintf("remote procedure '%s' failed with '%s'",
+                                 name, error.what()));
+        e.inner_exception(std::make_exception_ptr(error));
+        throw e;
+      }
+    }
+
     template <typename OS>
     static
     void
@@ -133,6 +194,7 @@ namespace elle
       : _id(id)
       , _name(name)
       , _owner(owner)
+      , _timeout()
     {}
 
     template <typename IS,
@@ -143,14 +205,41 @@ namespace elle
     RPC<IS, OS>::RemoteProcedure<R, Args ...>::
     operator = (std::function<R (Args...)> const& f)
     {
-      auto proc = this->_owner._procedures.find(this->_id);
-      assert(proc != this->_owner._procedures.end());
-      assert(proc->second.second == nullptr);
-      proc->second.second =
-        std::make_unique<Procedure<IS, OS, R, Args...>>(
-          this->_name, this->_owner, this->_id, f);
+      assert(this->_id < this->_owner._procedures.size());
+      auto& proc = this->_owner._procedures[this->_id];
+      assert(proc.second == nullptr);
+      // Not make_unique: only RPC may construct procedures.
+      proc.second.reset(new Procedure<IS, OS, R, Args...>(
+          this->_name, this->_owner, this->_id, f));
+    }
+
+
+    template <typename IS,
+              typename OS>
+    template <typename R,
+              typename ... Args>
+    Admission&
+    RPC<IS, OS>::RemoteProcedure<R, Args ...>::admission()
+    {
+      return this->_owner.admission(this->_id);
     }
 
+    template <typename IS,
+              typename OS>
+    template <typename R,
+              typename ... Args>
+    elle::Buffer
+    RPC<IS, OS>::RemoteProcedure<R, Args...>::_question(Args ... args)
+    {
+      elle::Buffer question;
+      {
+        elle::IOStream outs(question.ostreambuf());
+        OS output(outs);
+        output << this->_id;
+        put_args<OS, Args...>(output, args...);
+      }
+      return question;
+    }
 
     template <typename IS,
               typename OS>
@@ -164,40 +253,71 @@ namespace elle
 
       ELLE_TRACE_SCOPE("%s: call remote procedure: %s",
                        this->_owner, this->_name);
+      return this->_owner.template _result<IS>(
+        this->_question(args...), this->_name, this->_timeout,
+        BaseRPC::Tag<R>{});
+    }
 
-      Channel channel(this->_owner._channels);
-      {
-        elle::Buffer question;
-        {
-          elle::IOStream outs(question.ostreambuf());
-          OS output(outs);
-          output << this->_id;
-          put_args<OS, Args...>(output, args...);
-        }
-        channel.write(question);
-      }
-      {
-        elle::Buffer response(channel.read());
-        elle::IOStream ins(response.istreambuf());
-        IS input(ins);
-        bool res;
-        input >> res;
-        if (res)
-          return GetRes<IS, R>::get_res(input);
-        else
+    template <typename IS,
+              typename OS>
+    template <typename R,
+              typename ... Args>
+    void
+    RPC<IS, OS>::RemoteProcedure<R, Args...>::post(Args ... args)
+    {
+      ELLE_LOG_COMPONENT("elle.protocol.RPC");
+
+      ELLE_TRACE_SCOPE("%s: post remote procedure: %s",
+                       this->_owner, this->_name);
+      this->_owner._post(this->_question(args...));
+    }
+
+    /*--------.
+    | BaseRPC |
+    `--------*/
+
+    template <typename IS, typename T>
+    T
+    BaseRPC::_result(elle::Buffer question,
+                     std::string const& name,
+                     DurationOpt const& timeout,
+                     Tag<T>)
+    {
+      elle::Buffer response(this->_ask(std::move(question), timeout));
+      elle::IOStream ins(response.istreambuf());
+      IS input(ins);
+      check_answer(input, this->_channels, name);
+      return GetRes<IS, T>::get_res(input);
+    }
+
+    template <typename IS, typename T>
+    reactor::Generator<T>
+    BaseRPC::_result(elle::Buffer question,
+                     std::string const& name,
+                     DurationOpt const& timeout,
+                     Tag<reactor::Generator<T>>)
+    {
+      if (!this->multiplexed())
+        elle::err<RPCError>(
+          "remote procedure '%s' streams its results, "
+          "which requires version 0.4.0", name);
+      return reactor::Generator<T>(
+        [this, name, question = std::move(question), timeout]
+        (typename reactor::Generator<T>::yielder const& yield)
         {
-          auto error = input_error(input);
-          ELLE_TRACE_SCOPE("%s: remote procedure call failed: %s",
-                           this->_owner, error.what());
-          // FIXME: only protocol error should throw this, not remote
-          // exceptions.
-          auto e =
-            RPCError(sprintf("remote procedure '%s' failed with '%s'",
-                             this->_name, error.what()));
-          e.inner_exception(std::make_exception_ptr(error));
-          throw e;
-        }
-      }
+          auto answer = this->_stream(
+            question, timeout,
+            [&] (elle::Buffer item)
+            {
+              elle::IOStream ins(item.istreambuf());
+              IS input(ins);
+              yield(GetRes<IS, T>::get_res(input));
+            });
+          elle::IOStream ins(answer.istreambuf());
+          IS input(ins);
+          check_answer(input, this->_channels, name);
+        },
+        this->_stream_window);
     }
 
     /*------------------.
@@ -253,11 +373,13 @@ namespace elle
                 typename ... Args>
       struct VoidSwitch
       {
+        template <typename F>
         static
         void
         call(IS& in,
              OS& out,
-             std::function<R (Args...)> const& f)
+             F const& f,
+             Yield const&)
         {
           R res(Call<IS, R, Args...>::template call<>(in, f));
           out << true;
@@ -270,11 +392,13 @@ namespace elle
                 typename ... Args>
       struct VoidSwitch<IS, OS, void, Args ...>
       {
+        template <typename F>
         static
         void
         call(IS& in,
              OS& out,
-             std::function<void (Args...)> const& f)
+             F const& f,
+             Yield const&)
         {
           Call<IS, void, Args...>::template call<>(in, f);
           out << true;
@@ -282,6 +406,42 @@ namespace elle
           out << c;
         }
       };
+
+      // Stream the results, then answer like void procedures.
+      template <typename IS,
+                typename OS,
+                typename T,
+                typename ... Args>
+      struct VoidSwitch<IS, OS, reactor::Generator<T>, Args ...>
+      {
+        template <typename F>
+        static
+        void
+        call(IS& in,
+             OS& out,
+             F const& f,
+             Yield const& yield)
+        {
+          if (!yield)
+            elle::err<RPCError>(
+              "streaming results requires version 0.4.0");
+          for (auto&& value:
+                 Call<IS, reactor::Generator<T>, Args...>::template call<>(
+                   in, f))
+          {
+            elle::Buffer item;
+            {
+              elle::IOStream outs(item.ostreambuf());
+              OS output(outs);
+              output << value;
+            }
+            yield(std::move(item));
+          }
+          out << true;
+          unsigned char c(42);
+          out << c;
+        }
+      };
     }
 
     /*----------.
@@ -293,11 +453,12 @@ namespace elle
               typename R,
               typename ... Args>
     void
-    Procedure<IS, OS, R, Args...>::_call(IS& in, OS& out)
+    Procedure<IS, OS, R, Args...>::_call(IS& in,
+                                         OS& out,
+                                         Yield const& yield)
     {
-      std::string err;
       VoidSwitch<IS, OS, R, Args ...>::call(
-        in, out, this->_function);
+        in, out, this->_function, yield);
     }
 
     /*----.
@@ -313,7 +474,9 @@ namespace elle
     {
       uint32_t id = this->_id++;
       using Proc = Procedure<IS, OS, R, Args...>;
-      this->_procedures[id] = std::make_unique<Proc>(*this, id, f);
+      assert(id == this->_procedures.size());
+      this->_procedures.emplace_back(
+        std::string(), std::make_unique<Proc>(*this, id, f));
       return {*this, id};
     }
 
@@ -325,7 +488,8 @@ namespace elle
     RPC<IS, OS>::add(std::string const& name)
     {
       uint32_t id = this->_id++;
-      this->_procedures[id] = NamedProcedure(name, nullptr);
+      assert(id == this->_procedures.size());
+      this->_procedures.emplace_back(name, nullptr);
       return {name, *this, id};
     }
 
@@ -335,46 +499,6 @@ namespace elle
       : BaseRPC(channels)
     {}
 
-    // FIXME: move closer to elle::Error.
-    namespace
-    {
-      template <typename OStream>
-      void
-      output_error(OStream& os, elle::Error const& e)
-      {
-        os << std::string(e.what());
-        os << uint16_t(e.backtrace().frames().size());
-        for (auto const& frame: e.backtrace().frames())
-          os << frame.symbol
-             << frame.symbol_mangled
-             << frame.symbol_demangled
-             << frame.address
-             << frame.offset;
-      }
-
-      template <typename IStream>
-      elle::Error
-      input_error(IStream& is)
-      {
-        std::string err;
-        is >> err;
-        uint16_t size;
-        is >> size;
-        auto frames = std::vector<StackFrame>{};
-        for (int i = 0; i < size; ++i)
-        {
-          frames.emplace_back();
-          auto& frame = frames.back();
-          is >> frame.symbol
-             >> frame.symbol_mangled
-             >> frame.symbol_demangled
-             >> frame.address
-             >> frame.offset;
-        }
-        return {std::move(frames), std::move(err)};
-      }
-    }
-
     template<typename T>
     bool
     handle_exception(ExceptionHandler & handler,
@@ -418,172 +542,91 @@ namespace elle
 
     template <typename IS,
               typename OS>
-    void
-    RPC<IS, OS>::run(ExceptionHandler handler)
+    bool
+    RPC<IS, OS>::_answer(elle::Buffer const& question,
+                         elle::Buffer& answer,
+                         ExceptionHandler handler,
+                         Yield const& yield)
     {
       ELLE_LOG_COMPONENT("elle.protocol.RPC");
 
       using elle::sprintf;
       using elle::Exception;
+      elle::IOStream ins(question.istreambuf());
+      IS input(ins);
+      uint32_t id;
+      input >> id;
+      ELLE_TRACE_SCOPE("%s: Processing request for %s...", *this, id);
+      elle::IOStream outs(answer.ostreambuf());
+      OS output(outs);
       bool stop_request = false;
       try
       {
-        while (!stop_request)
+        // Ids are dense: procedures are a jump table.
+        if (id >= this->_procedures.size())
+          throw Exception(sprintf("call to unknown procedure: %s", id));
+        auto& proc = this->_procedures[id];
+        if (proc.second == nullptr)
         {
-          ELLE_TRACE_SCOPE("%s: Accepting new request...", *this);
-          Channel c(this->_channels.accept());
-          elle::Buffer question(c.read());
-          elle::IOStream ins(question.istreambuf());
-          IS input(ins);
-          uint32_t id;
-          input >> id;
-          ELLE_TRACE_SCOPE("%s: Processing request for %s...", *this, id);
-          auto proc = this->_procedures.find(id);
-
-          elle::Buffer answer;
-          elle::IOStream outs(answer.ostreambuf());
-          OS output(outs);
-          try
-          {
-            if (proc == this->_procedures.end())
-              throw Exception(sprintf("call to unknown procedure: %s", id));
-            else if (proc->second.second == nullptr)
-            {
-              throw Exception(sprintf("remote call to non-local procedure: %s",
-                                      proc->second.first));
-            }
-            else
-            {
-              auto const &name = proc->second.first;
+          throw Exception(sprintf("remote call to non-local procedure: %s",
+                                  proc.first));
+        }
+        else
+        {
+          auto const &name = proc.first;
 
-              ELLE_TRACE("%s: remote procedure called: %s", *this, name)
-                proc->second.second->_call(input, output);
-              ELLE_TRACE("%s: procedure %s succeeded", *this, name);
-            }
-          }
-          catch (elle::reactor::Terminate const&)
-          {
-            ELLE_TRACE("%s: terminating as requested", *this);
-            throw;
-          }
-          catch (...)
-          { // Pass exception through handler if present, reply with an error
-            stop_request = handle_exception(handler, output, std::current_exception());
-          }
-          outs.flush();
-          c.write(answer);
+          ELLE_TRACE("%s: remote procedure called: %s", *this, name)
+            this->admission(id)([&]
+              {
+                proc.second->_call(input, output, yield);
+              });
+          ELLE_TRACE("%s: procedure %s succeeded", *this, name);
         }
       }
-      catch (elle::reactor::network::ConnectionClosed const& e)
+      catch (elle::reactor::Terminate const&)
       {
-        ELLE_TRACE("%s: end of RPCs: connection closed", *this);
-        return;
+        ELLE_TRACE("%s: terminating as requested", *this);
+        throw;
+      }
+      catch (...)
+      { // Pass exception through handler if present, reply with an error
+        stop_request =
+          handle_exception(handler, output, std::current_exception());
       }
-      ELLE_TRACE("%s: end of RPCs: normal exit", *this);
+      outs.flush();
+      return stop_request;
     }
 
-    // XXX: factor with run().
-    // XXX: unsafe, rpc calls must finish in the order they were started,
-    // there is no mechanism to match a rpc call with associated return
     template <typename IS,
               typename OS>
     void
-    RPC<IS, OS>::parallel_run()
+    RPC<IS, OS>::run(ExceptionHandler handler)
     {
-      ELLE_LOG_COMPONENT("elle.protocol.RPC");
-
-      using elle::sprintf;
-      using elle::Exception;
-      try
-      {
-        elle::With<elle::reactor::Scope>("RPC // run") << [&] (elle::reactor::Scope& scope)
+      this->_run(
+        [&] (elle::Buffer const& question,
+             elle::Buffer& answer,
+             Yield const& yield)
         {
-          int i = 0;
-          while (true)
-          {
-            auto chan = std::make_shared<Channel>(this->_channels.accept());
-            ++i;
-
-            auto call_procedure = [&, chan] {
-              ELLE_LOG_COMPONENT("elle.protocol.RPC");
-
-              elle::Buffer question(chan->read());
-              elle::IOStream ins(question.istreambuf());
-              IS input(ins);
-              uint32_t id;
-              input >> id;
-              auto proc = this->_procedures.find(id);
+          return this->_answer(question, answer, handler, yield);
+        });
+    }
 
-              elle::Buffer answer;
-              elle::IOStream outs(answer.ostreambuf());
-              OS output(outs);
-              try
-              {
-                if (proc == _procedures.end())
-                  throw Exception(sprintf("call to unknown procedure: %s", id));
-                else if (proc->second.second == nullptr)
-                  throw Exception(sprintf("remote call to non-local procedure: %s",
-                                          proc->second.first));
-                else
-                {
-                  auto const &name = proc->second.first;
-                  ELLE_TRACE("%s: remote procedure called: %s", *this, name)
-                    proc->second.second->_call(input, output);
-                  ELLE_TRACE("%s: procedure %s succeeded", *this, name);
-                }
-              }
-              catch (elle::Error const& e)
-              {
-                ELLE_TRACE("%s: procedure failed: %s", *this, e.what());
-                output << false;
-                output_error(output, e);
-              }
-              catch (elle::reactor::Terminate const&)
-              {
-                ELLE_TRACE("%s: terminating as requested", *this);
-                throw;
-              }
-              catch (std::exception& e)
-              {
-                ELLE_TRACE("%s: procedure failed: %s", *this, e.what());
-                output << false
-                       << std::string(e.what())
-                       << uint16_t(0);
-              }
-              catch (...)
-              {
-                ELLE_TRACE("%s: procedure failed: unknown error", *this);
-                output << false
-                       << std::string("unknown error")
-                       << uint16_t(0);
-              }
-              outs.flush();
-              chan->write(answer);
-            };
-            scope.run_background(elle::sprintf("RPC %s", i), call_procedure);
-          }
-        };
-      }
-      catch (elle::reactor::network::ConnectionClosed const& e)
-      {
-        ELLE_TRACE("%s: end of RPCs: connection closed", *this);
-        return;
-      }
-      catch (elle::Exception& e)
-      {
-        ELLE_WARN("%s: end of RPCs: %s", *this, e);
-        throw;
-      }
-      catch (std::exception& e)
-      {
-        ELLE_WARN("%s: end of RPCs: %s", *this, e.what());
-        throw;
-      }
-      catch (...)
-      {
-        ELLE_WARN("%s: end of RPCs: unkown error", *this);
-        throw;
-      }
+    // XXX: before version 0.4.0, rpc calls must finish in the order they were
+    // started, there is no mechanism to match a rpc call with associated
+    // return.
+    template <typename IS,
+              typename OS>
+    void
+    RPC<IS, OS>::parallel_run()
+    {
+      this->_parallel_run(
+        [this] (elle::Buffer const& question,
+                elle::Buffer& answer,
+                Yield const& yield)
+        {
+          this->_answer(question, answer, {}, yield);
+          return false;
+        });
     }
 
     template <typename IS,
@@ -4,11 +4,11 @@
 # include <arpa/inet.h>
 #endif
 
+#include <algorithm>
+
 #include <elle/Buffer.hh>
 #include <elle/log.hh>
 
-#include <elle/cryptography/hash.hh>
-
 #include <elle/serialization/binary.hh>
 #include <elle/serialization/json.hh>
 
@@ -18,6 +18,7 @@
 #include <elle/reactor/network/socket.hh>
 #include <elle/reactor/network/utp-socket.hh>
 
+#include <elle/protocol/Compression.hh>
 #include <elle/protocol/Serializer.hh>
 #include <elle/protocol/exceptions.hh>
 
@@ -38,16 +39,14 @@ namespace elle
     static
     void
     read(std::istream& stream,
-         elle::Buffer& content,
-         uint32_t size,
-         uint32_t offset = 0)
+         elle::WeakBuffer content)
     {
-      ELLE_DEBUG_SCOPE("read %s bytes from %s at offset %s",
-                       size, stream, offset);
+      auto const size = content.size();
+      ELLE_DEBUG_SCOPE("read %s bytes from %s", size, stream);
       // read the full packet even if terminated to keep the stream
       // in a consistent state
       int nread = 0;
-      auto* beginning = (char*) content.mutable_contents() + offset;
+      auto* beginning = (char*) content.mutable_contents();
       while (nread < signed(size))
       {
         char* where = beginning + nread;
@@ -70,34 +69,19 @@ namespace elle
         size = Serializer::Super::uint32_get(stream, version);
       ELLE_DUMP("expected size: %s", *size);
       elle::Buffer content(*size);
-      read(stream, content, *size);
+      read(stream, elle::WeakBuffer(content));
       return content;
     }
 
-    // Return the sha1 of a given buffer.
-    static
-    elle::Buffer
-    compute_checksum(elle::Buffer const& content)
-    {
-      ELLE_DUMP("compute checksum of '%x'", content);
-      auto hash = elle::cryptography::hash(
-        elle::ConstWeakBuffer(content.contents(),
-                              content.size()),
-        elle::cryptography::Oneway::sha1);
-      ELLE_DUMP("checksum: '%x'", hash);
-      return hash;
-    }
-
-    // Make sure the given buffer checksum match the given checksum.
+    // Make sure the computed checksum matches the one sent by the peer.
     static
     void
-    enforce_checksums_equal(elle::Buffer const& content,
+    enforce_checksums_equal(Hasher& hasher,
                             elle::Buffer const& expected_checksum)
     {
-      ELLE_DUMP_SCOPE("compare '%x' checksum with expected '%x'",
-                       content, expected_checksum);
-      auto checksum = compute_checksum(content);
-      ELLE_DUMP("checksum: '%x'", checksum);
+      auto checksum = hasher.digest();
+      ELLE_DUMP("compare %s checksum '%x' with expected '%x'",
+                hasher.algorithm(), checksum, expected_checksum);
       if (checksum != expected_checksum)
       {
         ELLE_ERR("wrong packet checksum")
@@ -105,6 +89,44 @@ namespace elle
       }
     }
 
+    // Since 0.4.0, peers exchange the features they support after their
+    // versions, as "feature:value" tokens. Unknown tokens are ignored.
+    static
+    void
+    write_features(std::ostream& stream,
+                   std::vector<std::string> const& features,
+                   elle::Version const& version)
+    {
+      Serializer::Super::uint32_put(stream, features.size(), version);
+      for (auto const& feature: features)
+      {
+        Serializer::Super::uint32_put(stream, feature.size(), version);
+        stream.write(feature.data(), feature.size());
+      }
+    }
+
+    static
+    std::vector<std::string>
+    read_features(std::istream& stream, elle::Version const& version)
+    {
+      auto const count = Serializer::Super::uint32_get(stream, version);
+      if (count > 256)
+        elle::err<protocol::Error>("too many features offered: %s", count);
+      auto res = std::vector<std::string>{};
+      for (auto i = 0u; i < count; ++i)
+      {
+        auto const size = Serializer::Super::uint32_get(stream, version);
+        if (size > 256)
+          elle::err<protocol::Error>("feature name too long: %s", size);
+        auto feature = std::string(size, '\0');
+        stream.read(&feature[0], size);
+        if (stream.gcount() != signed(size))
+          throw Serializer::EOF();
+        res.emplace_back(std::move(feature));
+      }
+      return res;
+    }
+
     static
     void
     write(std::ostream& stream,
@@ -129,7 +151,9 @@ namespace elle
       message = 2,
       ping = 3,
       pong = 4,
-      max = pong,
+      // Like keep_going, at the start of a compressed packet.
+      compressed = 5,
+      max = compressed,
     };
 
     static
@@ -141,12 +165,136 @@ namespace elle
       ELLE_WARN("%f was ignored", res);
     }
 
+    using Buffers = Serializer::Buffers;
+
+    static
+    elle::Buffer::Size
+    size(Buffers const& buffers)
+    {
+      auto res = elle::Buffer::Size(0);
+      for (auto const& b: buffers)
+        res += b.size();
+      return res;
+    }
+
+    // The \a size bytes at \a offset of \a buffers, without copying.
+    static
+    Buffers
+    slice(Buffers const& buffers,
+          elle::Buffer::Size offset,
+          elle::Buffer::Size size)
+    {
+      auto res = Buffers{};
+      for (auto const& b: buffers)
+      {
+        if (size == 0)
+          break;
+        if (offset >= b.size())
+        {
+          offset -= b.size();
+          continue;
+        }
+        auto const n = std::min(b.size() - offset, size);
+        res.emplace_back(b.contents() + offset, n);
+        offset = 0;
+        size -= n;
+      }
+      return res;
+    }
+
+    // Where received packets go: either a buffer holding the whole packet,
+    // or a reusable buffer whose content is handed over chunk by chunk.
+    class Sink
+    {
+    public:
+      virtual
+      ~Sink() = default;
+      /// The size of the packet was received.
+      virtual
+      void
+      size(elle::Buffer::Size size) = 0;
+      /// Where to read the chunk of \a size bytes at \a offset.
+      virtual
+      elle::WeakBuffer
+      chunk(elle::Buffer::Size offset, elle::Buffer::Size size) = 0;
+      /// The chunk was received.
+      virtual
+      void
+      received(elle::ConstWeakBuffer chunk)
+      {}
+      /// Whether the packet is compressed.
+      bool compressed = false;
+    };
+
+    class PacketSink
+      : public Sink
+    {
+    public:
+      void
+      size(elle::Buffer::Size size) override
+      {
+        this->packet.size(size);
+      }
+
+      elle::WeakBuffer
+      chunk(elle::Buffer::Size offset, elle::Buffer::Size size) override
+      {
+        return elle::WeakBuffer(this->packet.mutable_contents() + offset, size);
+      }
+
+      elle::Buffer packet;
+    };
+
+    class ChunkSink
+      : public Sink
+    {
+    public:
+      ChunkSink(Serializer::ChunkHandler handler,
+                Serializer::SizeHandler size_handler)
+        : _handler(std::move(handler))
+        , _size_handler(std::move(size_handler))
+      {}
+
+      // Compressed packets are gathered and handed over once decompressed.
+      void
+      size(elle::Buffer::Size size) override
+      {
+        if (this->compressed)
+          this->_buffer.size(size);
+        else if (this->_size_handler)
+          this->_size_handler(size);
+      }
+
+      elle::WeakBuffer
+      chunk(elle::Buffer::Size offset, elle::Buffer::Size size) override
+      {
+        if (this->compressed)
+          return elle::WeakBuffer(this->_buffer.mutable_contents() + offset,
+                                  size);
+        if (this->_buffer.size() < size)
+          this->_buffer.size(size);
+        return elle::WeakBuffer(this->_buffer.mutable_contents(), size);
+      }
+
+      void
+      received(elle::ConstWeakBuffer chunk) override
+      {
+        if (!this->compressed)
+          this->_handler(chunk);
+      }
+
+      ELLE_ATTRIBUTE_R(Serializer::ChunkHandler, handler);
+      ELLE_ATTRIBUTE_R(Serializer::SizeHandler, size_handler);
+      ELLE_ATTRIBUTE_R(elle::Buffer, buffer);
+    };
+
     class Serializer::Impl
     {
     public:
       Impl(std::iostream& stream,
            elle::Buffer::Size chunk_size,
            bool checksum,
+           Checksum checksum_algorithm,
            elle::Version const& version,
            elle::DurationOpt ping_period,
            elle::DurationOpt ping_timeout)
@@ -174,6 +322,7 @@ namespace elle
         , _stream(stream)
         , _chunk_size(chunk_size)
         , _checksum(checksum)
+        , _checksum_algorithm(checksum_algorithm)
         , _version(version)
         , _lock_write()
         , _lock_read()
@@ -188,81 +337,112 @@ namespace elle
       ~Impl() = default;
 
     public:
-      elle::Buffer
-      read()
+      void
+      read(PacketSink& sink)
       {
         while (true)
         {
-          if (this->_broken)
-            elle::err("stream is broken by a previous interrupted read");
           try
           {
-            elle::reactor::Lock lock(this->_lock_read);
-            if (this->_broken)
-              elle::err("stream is broken by a previous interrupted read");
-            elle::IOStreamClear clearer(this->_stream);
-            return this->_read();
+            this->read(static_cast<Sink&>(sink));
+            return;
           }
           catch (InterruptionError const&)
           {}
         }
       }
 
+      void
+      read(Sink& sink)
+      {
+        if (this->_broken)
+          elle::err("stream is broken by a previous interrupted read");
+        elle::reactor::Lock lock(this->_lock_read);
+        if (this->_broken)
+          elle::err("stream is broken by a previous interrupted read");
+        elle::IOStreamClear clearer(this->_stream);
+        this->_read(sink);
+      }
+
       /// Whether the stream is broken by a previous interrupted read.
       ELLE_ATTRIBUTE_R(bool, broken);
 
-      elle::Buffer
-      _read()
+      void
+      _read(Sink& sink)
       {
+        sink.compressed = false;
         if (this->version() >= elle::Version(0, 3, 0))
-          while (!this->read_control())
+          while (!this->read_control(&sink.compressed))
             ;
         try
         {
         // return elle::With<elle::reactor::Thread::NonInterruptible>() << [&]
         // {
+          // From 0.4.0, the checksum follows the data.
+          auto const trailer = this->version() >= elle::Version(0, 4, 0);
+          boost::optional<Hasher> hasher;
           elle::Buffer hash;
           if (this->_checksum)
           {
-            ELLE_DEBUG("read checksum")
-              if (this->version() >= elle::Version(0, 2, 0))
-                hash = elle::protocol::read(this->_stream, this->version(), {});
-              else
-                hash = elle::protocol::read(this->_stream, {});
+            hasher.emplace(this->_checksum_algorithm);
+            if (!trailer)
+            {
+              ELLE_DEBUG("read checksum")
+                if (this->version() >= elle::Version(0, 2, 0))
+                  hash = elle::protocol::read(this->_stream, this->version(), {});
+                else
+                  hash = elle::protocol::read(this->_stream, elle::Version());
+            }
           }
-          auto packet = [&]
+          auto const receive = [&] (elle::Buffer::Size offset, uint32_t size)
+            {
+              ELLE_DEBUG("read chunk of size %s", size);
+              auto const chunk = sink.chunk(offset, size);
+              elle::protocol::read(this->_stream, chunk);
+              ELLE_DUMP("chunk content: %s", chunk);
+              if (hasher)
+                hasher->update(chunk);
+              sink.received(chunk);
+            };
+          if (this->version() >= elle::Version(0, 2, 0))
           {
-            if (this->version() >= elle::Version(0, 2, 0))
+            // Get the total size.
+            uint32_t total_size =
+              Serializer::Super::uint32_get(this->_stream, this->version());
+            ELLE_DEBUG("packet size: %s", total_size);
+            sink.size(total_size);
+            elle::Buffer::Size offset = 0;
+            while (true)
             {
-              // Get the total size.
-              uint32_t total_size =
-                Serializer::Super::uint32_get(this->_stream, this->version());
-              ELLE_DEBUG("packet size: %s", total_size);
-              elle::Buffer packet(static_cast<std::size_t>(total_size));
-              elle::Buffer::Size offset = 0;
-              while (true)
-              {
-                uint32_t size =
-                  std::min(total_size - offset, this->_chunk_size);
-                ELLE_DEBUG("read chunk of size %s", size);
-                elle::protocol::read(this->_stream, packet, size, offset);
-                offset += size;
-                ELLE_ASSERT_LTE(offset, total_size);
-                if (offset >= total_size)
-                  break;
-                if (!this->read_control())
-                  throw InterruptionError();
-              }
-              return packet;
+              uint32_t size = std::min(total_size - offset, this->_chunk_size);
+              receive(offset, size);
+              offset += size;
+              ELLE_ASSERT_LTE(offset, total_size);
+              if (offset >= total_size)
+                break;
+              if (!this->read_control())
+                throw InterruptionError();
             }
-            else
-              return elle::protocol::read(this->_stream, {});
-          }();
-          ELLE_DUMP("packet content: %s", packet);
+          }
+          else
+          {
+            // Version 0.1.0 has no chunks.
+            auto const size =
+              Serializer::Super::uint32_get(this->_stream, elle::Version());
+            ELLE_DEBUG("packet size: %s", size);
+            sink.size(size);
+            receive(0, size);
+          }
           // Check checksums match.
           if (this->_checksum)
-            enforce_checksums_equal(packet, hash);
-          return packet;
+          {
+            if (trailer)
+            {
+              ELLE_DEBUG("read checksum")
+                hash = elle::protocol::read(this->_stream, this->version(), {});
+            }
+            enforce_checksums_equal(*hasher, hash);
+          }
         }
         catch (InterruptionError const&)
         {
@@ -278,11 +458,57 @@ namespace elle
       }
 
       void
-      write(elle::Buffer const& packet)
+      write(elle::Buffer const& packet, bool compressed = false)
+      {
+        this->write(Buffers{packet}, compressed);
+      }
+
+      void
+      write(Buffers const& packet, bool compressed = false)
       {
         elle::reactor::Lock lock(this->_lock_write);
         elle::IOStreamClear clearer(this->_stream);
-        this->_write(packet);
+        this->_write(
+          size(packet),
+          [&] (elle::Buffer::Size offset, elle::Buffer::Size size)
+          {
+            return slice(packet, offset, size);
+          },
+          compressed);
+      }
+
+      void
+      write(elle::Buffer::Size size, Serializer::ChunkProvider const& provider)
+      {
+        // Before 0.2.0 packets are not chunked, and before 0.4.0 their
+        // checksum is sent before the data: gather the whole packet.
+        if (this->version() < elle::Version(0, 2, 0) ||
+            this->_checksum && this->version() < elle::Version(0, 4, 0))
+        {
+          ELLE_DEBUG("version %s cannot stream, gather packet",
+                     this->version());
+          auto packet = elle::Buffer(size);
+          for (elle::Buffer::Size offset = 0; offset < size;)
+          {
+            auto const n = std::min(this->_chunk_size, size - offset);
+            provider(elle::WeakBuffer(packet.mutable_contents() + offset, n));
+            offset += n;
+          }
+          this->write(packet);
+          return;
+        }
+        elle::reactor::Lock lock(this->_lock_write);
+        elle::IOStreamClear clearer(this->_stream);
+        auto buffer = elle::Buffer(std::min(this->_chunk_size, size));
+        this->_write(
+          size,
+          [&] (elle::Buffer::Size, elle::Buffer::Size size)
+          {
+            auto const chunk =
+              elle::WeakBuffer(buffer.mutable_contents(), size);
+            provider(chunk);
+            return Buffers{chunk};
+          });
       }
 
       void
@@ -315,8 +541,13 @@ namespace elle
         }
       }
 
+      /// Read control bytes until the next chunk.
+      ///
+      /// @param compressed Where to report the start of a compressed packet,
+      ///                   which is otherwise unexpected.
+      /// @returns Whether the packet goes on.
       bool
-      read_control()
+      read_control(bool* compressed = nullptr)
       {
         while (true)
         {
@@ -338,6 +569,11 @@ namespace elle
           {
             case Control::keep_going:
               return true;
+            case Control::compressed:
+              if (!compressed)
+                elle::err<protocol::Error>("unexpected compressed chunk");
+              *compressed = true;
+              return true;
             case Control::interrupt:
               return false;
             case Control::message:
@@ -399,15 +635,55 @@ namespace elle
       ELLE_ATTRIBUTE(std::list<Timer>, ping_timers);
       ELLE_ATTRIBUTE_RX(boost::signals2::signal<void ()>, ping_timeout);
 
+      /// The next chunk of a packet being sent, given its offset and size,
+      /// possibly in several pieces.
+      using Source = std::function<
+        Buffers (elle::Buffer::Size, elle::Buffer::Size)>;
+
+      void
+      _write_chunk(Buffers const& chunk, Hasher* hasher = nullptr)
+      {
+        for (auto const& piece: chunk)
+        {
+          this->_stream.write(
+            reinterpret_cast<char const*>(piece.contents()), piece.size());
+          if (hasher)
+            hasher->update(piece);
+        }
+      }
+
       void
-      _write(elle::Buffer const& packet)
+      _write(elle::Buffer::Size const packet_size,
+             Source const& source,
+             bool compressed = false)
       {
+        // Chunks are fetched outside of non interruptible sections, so
+        // streamed packets can be produced as they are sent.
+        elle::Buffer::Size offset = 0;
+        auto const next = [&]
+          {
+            return source(
+              offset, std::min(this->_chunk_size, packet_size - offset));
+          };
+        auto chunk = this->version() >= elle::Version(0, 2, 0) ?
+          next() : source(0, packet_size);
+        ELLE_ASSERT(!compressed || this->version() >= elle::Version(0, 4, 0));
         if (this->version() >= elle::Version(0, 3, 0))
-          this->write_control(Control::keep_going);
+          this->write_control(
+            compressed ? Control::compressed : Control::keep_going);
+        // From 0.4.0, the checksum is computed as chunks are sent and
+        // follows the data.
+        auto const trailer = this->version() >= elle::Version(0, 4, 0);
+        boost::optional<Hasher> hasher;
         if (this->_checksum)
+          hasher.emplace(this->_checksum_algorithm);
+        if (hasher && !trailer)
         {
           // Compute and send checksum.
-          auto hash = compute_checksum(packet);
+          ELLE_ASSERT_EQ(size(chunk), packet_size);
+          for (auto const& piece: chunk)
+            hasher->update(piece);
+          auto hash = hasher->digest();
           elle::With<elle::reactor::Thread::NonInterruptible>() << [&]
           {
             ELLE_DEBUG("send checksum: 0x%x", hash)
@@ -416,35 +692,61 @@ namespace elle
         }
         if (this->version() >= elle::Version(0, 2, 0))
         {
-          elle::Buffer::Size offset = 0;
+          auto interrupted = false;
+          auto const interrupt = [&]
+            {
+              if (!interrupted && offset < packet_size)
+              {
+                interrupted = true;
+                ELLE_DEBUG("interrupted after sending %s bytes over %s",
+                           offset, packet_size);
+                this->write_control(Control::interrupt);
+                this->write_pings_pongs(true);
+              }
+            };
           try
           {
             auto send = [&]
               {
-                auto to_send = std::min(this->_chunk_size, packet.size() - offset);
+                auto const chunk_size = size(chunk);
                 ELLE_DEBUG_SCOPE("send %s bytes of data at offset %s",
-                                 to_send, offset);
-                elle::protocol::write(
-                  this->_stream,
-                  this->version(), packet, false, offset, to_send);
-                offset += to_send;
+                                 chunk_size, offset);
+                this->_write_chunk(
+                  chunk, hasher && trailer ? hasher.get_ptr() : nullptr);
+                offset += chunk_size;
+                // Send the checksum along with the last chunk so it cannot be
+                // interrupted in between.
+                if (hasher && trailer && offset == packet_size)
+                {
+                  auto hash = hasher->digest();
+                  ELLE_DEBUG("send checksum: 0x%x", hash)
+                    elle::protocol::write(this->_stream, this->version(), hash);
+                }
                 this->_stream.flush();
               };
             {
               elle::With<elle::reactor::Thread::NonInterruptible>() << [&]
               {
                 // Send the size.
-                {
-                  auto size = packet.size();
-                  ELLE_DEBUG("send packet size %s", size)
-                    Serializer::Super::uint32_put(this->_stream, size, this->version());
-                }
+                ELLE_DEBUG("send packet size %s", packet_size)
+                  Serializer::Super::uint32_put(
+                    this->_stream, packet_size, this->version());
                 // Send first chunk
                 send();
               };
             }
-            while (offset < packet.size())
+            while (offset < packet_size)
             {
+              try
+              {
+                chunk = next();
+              }
+              catch (...)
+              {
+                // Let the peer drop what it received so far.
+                interrupt();
+                throw;
+              }
               elle::With<elle::reactor::Thread::NonInterruptible>() << [&]
               {
                 this->write_control(Control::keep_going);
@@ -455,13 +757,7 @@ namespace elle
           }
           catch (elle::reactor::Terminate const&)
           {
-            if (offset < packet.size())
-            {
-              ELLE_DEBUG("interrupted after sending %s bytes over %s",
-                         offset, packet.size());
-              this->write_control(Control::interrupt);
-              this->write_pings_pongs(true);
-            }
+            interrupt();
             throw;
           }
         }
@@ -471,7 +767,11 @@ namespace elle
           elle::With<elle::reactor::Thread::NonInterruptible>() << [&]
           {
             ELLE_DEBUG("send actual data")
-              elle::protocol::write(this->_stream, this->version(), packet);
+            {
+              Serializer::Super::uint32_put(
+                this->_stream, size(chunk), this->version());
+              this->_write_chunk(chunk);
+            }
             this->_stream.flush();
           };
       }
@@ -479,6 +779,7 @@ namespace elle
       ELLE_ATTRIBUTE_RX(std::iostream&, stream, protected);
       ELLE_ATTRIBUTE(elle::Buffer::Size, chunk_size, protected);
       ELLE_ATTRIBUTE(bool, checksum, protected);
+      ELLE_ATTRIBUTE(Checksum, checksum_algorithm, protected);
       ELLE_ATTRIBUTE_R(elle::Version, version);
       ELLE_ATTRIBUTE(elle::reactor::Mutex, lock_write, protected);
       ELLE_ATTRIBUTE(elle::reactor::Mutex, lock_read, protected);
@@ -502,13 +803,18 @@ namespace elle
       bool checksum,
       elle::DurationOpt ping_period,
       elle::DurationOpt ping_timeout,
-      elle::Buffer::Size chunk_size)
+      elle::Buffer::Size chunk_size,
+      bool compress,
+      elle::Buffer dictionary)
       : Super(*elle::reactor::Scheduler::scheduler())
       , _stream(stream)
       , _version(version)
       , _chunk_size(chunk_size)
       , _checksum(checksum)
+      , _checksum_algorithm(Checksum::sha1)
     {
+      auto const offered =
+        checksum ? checksums_offered() : std::vector<Checksum>{};
       if (this->version() >= elle::Version(0, 2, 0))
       {
         ELLE_TRACE("%s: send local version '%s'", *this, this->version())
@@ -524,8 +830,63 @@ namespace elle
         }
       }
       ELLE_TRACE("using version: '%s'", this->version());
+      if (this->version() >= elle::Version(0, 4, 0))
+        ELLE_TRACE("%s: negotiate features", *this)
+        {
+          auto features = std::vector<std::string>{};
+          for (auto c: offered)
+            features.emplace_back(elle::sprintf("checksum:%s", c));
+          if (compress)
+          {
+            features.emplace_back("compression:deflate");
+            if (!dictionary.empty())
+              features.emplace_back(
+                elle::sprintf("dictionary:%s",
+                              Compressor::dictionary_id(dictionary)));
+          }
+          write_features(stream, features, this->version());
+          stream.flush();
+          auto const peer = read_features(stream, this->version());
+          ELLE_DEBUG("peer features: %s", peer);
+          auto const peer_offers = [&] (Checksum c)
+            {
+              return std::find(peer.begin(), peer.end(),
+                               elle::sprintf("checksum:%s", c)) != peer.end();
+            };
+          // Both peers must pick the same algorithm: take the first we both
+          // support in a fixed order, fastest first.
+          this->_checksum = false;
+          for (auto c: {Checksum::crc32c, Checksum::xxh64, Checksum::sha1})
+            if (peer_offers(c) &&
+                std::find(offered.begin(), offered.end(), c) != offered.end())
+            {
+              this->_checksum = true;
+              this->_checksum_algorithm = c;
+              break;
+            }
+          if (this->_checksum)
+            ELLE_TRACE("using checksum: %s", this->_checksum_algorithm);
+          else
+            ELLE_TRACE("checksums disabled");
+          auto const peer_has = [&] (std::string const& feature)
+            {
+              return std::find(peer.begin(), peer.end(), feature) != peer.end();
+            };
+          if (compress && peer_has("compression:deflate"))
+          {
+            // Use the dictionary only if the peer has the same.
+            auto const shared = !dictionary.empty() &&
+              peer_has(elle::sprintf("dictionary:%s",
+                                     Compressor::dictionary_id(dictionary)));
+            ELLE_TRACE("using compression %s dictionary",
+                       shared ? "with" : "without");
+            this->_compressor.reset(
+              new Compressor(shared ? std::move(dictionary) : elle::Buffer()));
+          }
+        }
       this->_impl.reset(
-        new Impl(stream, this->_chunk_size, checksum, version,
+        new Impl(stream, this->_chunk_size, this->_checksum,
+                 this->_checksum_algorithm, this->version(),
                  std::move(ping_period), std::move(ping_timeout)));
       this->_impl->ping_timeout().connect(this->_ping_timeout);
     }
@@ -540,7 +901,40 @@ namespace elle
     elle::Buffer
     Serializer::_read()
     {
-      return this->_impl->read();
+      PacketSink sink;
+      this->_impl->read(sink);
+      if (sink.compressed)
+        return this->_decompress(sink.packet);
+      return std::move(sink.packet);
+    }
+
+    elle::Buffer::Size
+    Serializer::read(ChunkHandler const& chunk, SizeHandler const& size)
+    {
+      ELLE_TRACE_SCOPE("%s: read packet by chunks", this);
+      auto res = elle::Buffer::Size(0);
+      ChunkSink sink(
+        [&] (elle::ConstWeakBuffer c)
+        {
+          res += c.size();
+          chunk(c);
+        },
+        size);
+      this->_impl->read(sink);
+      if (sink.compressed)
+      {
+        auto const packet = this->_decompress(sink.buffer());
+        if (sink.size_handler())
+          sink.size_handler()(packet.size());
+        for (auto offset = elle::Buffer::Size(0); offset < packet.size();)
+        {
+          auto const n = std::min(this->_chunk_size, packet.size() - offset);
+          sink.handler()(
+            elle::ConstWeakBuffer(packet.contents() + offset, n));
+          offset += n;
+        }
+      }
+      return res;
     }
 
     /*--------.
@@ -550,9 +944,47 @@ namespace elle
     void
     Serializer::_write(elle::Buffer const& packet)
     {
+      if (this->_compressor)
+        if (auto compressed = this->_compressor->compress(packet))
+        {
+          ELLE_DEBUG("%s: send compressed packet (%s bytes)",
+                     this, compressed->size())
+            this->_impl->write(*compressed, true);
+          return;
+        }
       this->_impl->write(packet);
     }
 
+    void
+    Serializer::_write(Buffers const& buffers)
+    {
+      // Compression needs the packet in one piece.
+      if (this->_compressor)
+        Super::_write(buffers);
+      else
+        this->_impl->write(buffers);
+    }
+
+    void
+    Serializer::write(elle::Buffer::Size size, ChunkProvider const& chunk)
+    {
+      ELLE_TRACE_SCOPE("%s: write packet by chunks (%s bytes)", this, size);
+      this->_impl->write(size, chunk);
+    }
+
+    /*------------.
+    | Compression |
+    `------------*/
+
+    elle::Buffer
+    Serializer::_decompress(elle::ConstWeakBuffer data)
+    {
+      if (!this->_compressor)
+        elle::err<protocol::Error>(
+          "received compressed packet without negotiating compression");
+      return this->_compressor->decompress(data);
+    }
+
     /*----------.
     | Printable |
     `----------*/
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <iostream>
 
 #include <elle/reactor/mutex.hh>
@@ -8,6 +9,8 @@
 #include <elle/attribute.hh>
 #include <elle/compiler.hh>
 
+#include <elle/protocol/Checksum.hh>
+#include <elle/protocol/Compression.hh>
 #include <elle/protocol/Stream.hh>
 
 #ifdef EOF
@@ -30,6 +33,16 @@ namespace elle
     /// its version and read the peer version in order to agree what version to
     /// use (the smallest).
     ///
+    /// From version 0.4.0, peers then exchange the features they support and
+    /// agree on a checksum algorithm (see Checksum). Checksums are then
+    /// computed as chunks are sent or received, and sent after the data.
+    /// Checksums are disabled if either peer disables them. If both peers ask
+    /// for it, packets are also compressed (see Compressor).
+    ///
+    /// Large packets can be streamed chunk by chunk in both directions, see
+    /// read(ChunkHandler const&, SizeHandler const&) and
+    /// write(elle::Buffer::Size, ChunkProvider const&).
+    ///
     /// @code{.cc}
     ///
     /// elle::reactor::network::TCPSocket socket("127.0.0.1", 8182);
@@ -47,6 +60,12 @@ namespace elle
     `------*/
     public:
       using Super = Stream;
+      /// Handle a received chunk. It is only valid during the call.
+      using ChunkHandler = std::function<void (elle::ConstWeakBuffer chunk)>;
+      /// Handle the size of a packet about to be received.
+      using SizeHandler = std::function<void (elle::Buffer::Size size)>;
+      /// Fill \a chunk entirely with the next bytes of the packet being sent.
+      using ChunkProvider = std::function<void (elle::WeakBuffer chunk)>;
       class EOF
         : public elle::Error
       {
@@ -63,18 +82,40 @@ namespace elle
       /// @param stream The underlying std::iostream.
       /// @param version The version of the protocol.
       /// @param checksum Whether it should read and write the checksum of
-      ///                 packets sent.
+      ///                 packets sent. From version 0.4.0, the algorithm is
+      ///                 chosen among checksums_offered().
+      /// @param compress Whether to compress packets, from version 0.4.0 and
+      ///                 if the peer agrees.
+      /// @param dictionary A preset compression dictionary, used only if the
+      ///                   peer has the same.
       Serializer(std::iostream& stream,
                  elle::Version const& version = elle::Version(0, 1, 0),
                  bool checksum = true,
                  elle::DurationOpt ping_period = {},
                  elle::DurationOpt ping_timeout = {},
-                 elle::Buffer::Size chunk_size = 2 << 16);
+                 elle::Buffer::Size chunk_size = 2 << 16,
+                 bool compress = false,
+                 elle::Buffer dictionary = {});
       ~Serializer();
 
     /*----------.
     | Receiving |
     `----------*/
+    public:
+      using Super::read;
+      /// Read a packet chunk by chunk, without holding it in memory.
+      ///
+      /// Chunks are at most chunk_size() bytes. The checksum, if any, is
+      /// verified once the last chunk was handed over: on error, the caller
+      /// must discard what it received.
+      ///
+      /// @param chunk Called with each chunk as it arrives.
+      /// @param size Called with the packet size before the first chunk.
+      /// @returns The size of the packet.
+      /// @throws ChecksumError if the packet is corrupted.
+      /// @throws InterruptionError if the peer interrupted the packet.
+      elle::Buffer::Size
+      read(ChunkHandler const& chunk, SizeHandler const& size = {});
     protected:
       /// Read a complete packet from the underlying stream.
       ///
@@ -85,12 +126,37 @@ namespace elle
     /*--------.
     | Sending |
     `--------*/
+    public:
+      using Super::write;
+      /// Write a packet chunk by chunk, without holding it in memory.
+      ///
+      /// \a chunk is called with buffers of at most chunk_size() bytes, each
+      /// to be filled with the next bytes of the packet. If it throws, the
+      /// peer is told to drop the packet. Versions before 0.2.0, and before
+      /// 0.4.0 with checksums, still gather the whole packet before sending.
+      /// Streamed packets are never compressed.
+      ///
+      /// @param size The size of the packet.
+      /// @param chunk Called to fill each chunk before it is sent.
+      void
+      write(elle::Buffer::Size size, ChunkProvider const& chunk);
     protected:
       /// Write data to the stream.
       ///
       /// @param packet The packet to write.
       void
       _write(elle::Buffer const& packet) override;
+      /// Write buffers as one packet, without gathering them unless
+      /// compressing.
+      void
+      _write(Buffers const& buffers) override;
+
+    /*------------.
+    | Compression |
+    `------------*/
+    private:
+      elle::Buffer
+      _decompress(elle::ConstWeakBuffer data);
 
     /*----------.
     | Printable |
@@ -106,6 +172,10 @@ namespace elle
       ELLE_ATTRIBUTE_R(elle::Version, version, override);
       ELLE_ATTRIBUTE_R(elle::Buffer::Size, chunk_size);
       ELLE_ATTRIBUTE_R(bool, checksum);
+      /// The checksum algorithm agreed upon with the peer.
+      ELLE_ATTRIBUTE_R(Checksum, checksum_algorithm);
+      /// The compressor, if compression was agreed upon with the peer.
+      ELLE_ATTRIBUTE_R(std::unique_ptr<Compressor>, compressor);
       ELLE_ATTRIBUTE_RX(boost::signals2::signal<void ()>, ping_timeout);
     public:
       class Impl;
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <type_traits>
+
+#include <boost/noncopyable.hpp>
+
+#include <elle/Printable.hh>
+#include <elle/attribute.hh>
+#include <elle/das/Symbol.hh>
+
+#include <elle/protocol/RPC.hh>
+
+namespace elle
+{
+  namespace protocol
+  {
+    namespace details
+    {
+      /// The rank and declaration of the procedure named by symbol S, void
+      /// if there is none.
+      template <typename S, typename ... Procedures>
+      struct static_procedure
+      {
+        static constexpr uint32_t index = 0;
+        using type = void;
+      };
+
+      template <typename S, typename P, typename ... Tail>
+      struct static_procedure<S, P, Tail...>
+      {
+        using next = static_procedure<S, Tail...>;
+        static constexpr bool found =
+          std::is_same<S, typename P::Symbol>::value;
+        static constexpr uint32_t index = found ? 0 : 1 + next::index;
+        using type = std::conditional_t<found, P, typename next::type>;
+      };
+
+      template <typename Signature>
+      struct static_signature;
+
+      template <typename R, typename ... Args>
+      struct static_signature<R (Args...)>
+      {
+        using result = R;
+        /// Encode the arguments as declared.
+        template <typename OS>
+        static
+        void
+        put(OS& output, Args ... args);
+      };
+    }
+
+    /// RPCs with an interface known at compile time.
+    ///
+    /// Procedures are das symbols along with their signature, declared as
+    /// Symbol::Formal<R (Args...)>. A procedure id is its rank in the list,
+    /// calls are dispatched through a table of functions indexed by id, and
+    /// arguments are decoded right into the call of the implementation's
+    /// method named after the symbol: no lookup, std::function nor virtual
+    /// call stands between the session and the implementation.
+    ///
+    /// The wire format is the one of RPC: peers only need to declare the
+    /// same procedures, in the same order.
+    ///
+    /// @code{.cc}
+    ///
+    /// ELLE_DAS_SYMBOL(square);
+    /// ELLE_DAS_SYMBOL(reset);
+    ///
+    /// struct Calculator
+    /// {
+    ///   int square(int x) { return x * x; }
+    ///   void reset() {}
+    /// };
+    ///
+    /// using CalculatorRPC = elle::protocol::StaticRPC<
+    ///   Input, Output,
+    ///   Symbol_square::Formal<int (int)>,
+    ///   Symbol_reset::Formal<void ()>>;
+    ///
+    /// // Server side.
+    /// Calculator calculator;
+    /// CalculatorRPC server(channels, calculator);
+    /// server.parallel_run();
+    ///
+    /// // Client side.
+    /// CalculatorRPC client(channels);
+    /// assert(client.call(square, 3) == 9);
+    ///
+    /// @endcode
+    template <typename ISerializer,
+              typename OSerializer,
+              typename ... Procedures>
+    class StaticRPC
+      : public BaseRPC
+      , public elle::Printable
+      , public boost::noncopyable
+    {
+    public:
+      static_assert(sizeof ... (Procedures) > 0, "no procedure declared");
+      /// The declaration of the procedure named by symbol S.
+      template <typename S>
+      using Procedure =
+        typename details::static_procedure<S, Procedures...>::type;
+      /// The result of the procedure named by symbol S.
+      template <typename S>
+      using Result = typename details::static_signature<
+        typename Procedure<S>::Type>::result;
+
+    /*-------------.
+    | Construction |
+    `-------------*/
+    public:
+      /// A client, with no local implementation.
+      StaticRPC(ChanneledStream& channels);
+      /// Serve procedures with the methods of \a impl named after their
+      /// symbols.
+      template <typename Impl>
+      StaticRPC(ChanneledStream& channels, Impl& impl);
+
+    /*-------.
+    | Client |
+    `-------*/
+    public:
+      /// Call procedure \a S remotely.
+      template <typename S, typename ... Args>
+      Result<S>
+      call(S const&, Args&& ... args);
+      /// Call procedure \a S without waiting for it to run.
+      ///
+      /// Return as soon as the call is written.
+      template <typename S, typename ... Args>
+      void
+      post(S const&, Args&& ... args);
+      /// How long to wait for answers, from version 0.4.0. The deadline is
+      /// sent along, and calls are cancelled when it expires.
+      ELLE_ATTRIBUTE_RW(DurationOpt, timeout);
+    private:
+      template <typename S, typename ... Args>
+      elle::Buffer
+      _question(Args&& ... args);
+
+    /*-------.
+    | Server |
+    `-------*/
+    public:
+      using BaseRPC::admission;
+      /// The admission control of procedure \a S.
+      template <typename S>
+      Admission&
+      admission(S const&);
+      void
+      run(ExceptionHandler handler = {}) override;
+      /// Run forever, calling procedures concurrently.
+      void
+      parallel_run();
+    private:
+      bool
+      _answer(elle::Buffer const& question,
+              elle::Buffer& answer,
+              ExceptionHandler handler,
+              Yield const& yield);
+      /// Decode arguments, call the implementation and encode the answer.
+      using Dispatch = void (*)(void* impl,
+                                ISerializer& input,
+                                OSerializer& output,
+                                Yield const& yield);
+      ELLE_ATTRIBUTE(void*, impl);
+      /// The jump table, indexed by procedure id.
+      ELLE_ATTRIBUTE(Dispatch const*, dispatch);
+
+    /*----------.
+    | Printable |
+    `----------*/
+    public:
+      void
+      print(std::ostream& stream) const override;
+    };
+  }
+}
+
+#include <elle/protocol/StaticRPC.hxx>
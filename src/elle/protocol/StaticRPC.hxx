@@ -0,0 +1,242 @@
+#include <array>
+
+#include <elle/err.hh>
+#include <elle/log.hh>
+#include <elle/printf.hh>
+
+namespace elle
+{
+  namespace protocol
+  {
+    namespace details
+    {
+      template <typename R, typename ... Args>
+      template <typename OS>
+      void
+      static_signature<R (Args...)>::put(OS& output, Args ... args)
+      {
+        put_args<OS, Args...>(output, args...);
+      }
+
+      template <typename IS,
+                typename OS,
+                typename Impl,
+                typename P,
+                typename Signature = typename P::Type>
+      struct static_dispatch;
+
+      template <typename IS,
+                typename OS,
+                typename Impl,
+                typename P,
+                typename R,
+                typename ... Args>
+      struct static_dispatch<IS, OS, Impl, P, R (Args...)>
+      {
+        static
+        void
+        call(void* impl, IS& input, OS& output, Yield const& yield)
+        {
+          auto& self = *static_cast<Impl*>(impl);
+          VoidSwitch<IS, OS, R, Args...>::call(
+            input, output,
+            [&self] (Args ... args) -> R
+            {
+              return P::Symbol::method_call(
+                self, std::forward<Args>(args)...);
+            },
+            yield);
+        }
+      };
+
+      template <typename IS,
+                typename OS,
+                typename Impl,
+                typename ... Procedures>
+      struct static_table
+      {
+        using Dispatch = void (*)(void*, IS&, OS&, Yield const&);
+        static Dispatch const table[sizeof ... (Procedures)];
+      };
+
+      template <typename IS,
+                typename OS,
+                typename Impl,
+                typename ... Procedures>
+      typename static_table<IS, OS, Impl, Procedures...>::Dispatch const
+      static_table<IS, OS, Impl, Procedures...>::table[] = {
+        &static_dispatch<IS, OS, Impl, Procedures>::call...
+      };
+    }
+
+    /*-------------.
+    | Construction |
+    `-------------*/
+
+    template <typename IS, typename OS, typename ... Procedures>
+    StaticRPC<IS, OS, Procedures...>::StaticRPC(ChanneledStream& channels)
+      : BaseRPC(channels)
+      , _timeout()
+      , _impl(nullptr)
+      , _dispatch(nullptr)
+    {}
+
+    template <typename IS, typename OS, typename ... Procedures>
+    template <typename Impl>
+    StaticRPC<IS, OS, Procedures...>::StaticRPC(ChanneledStream& channels,
+                                                Impl& impl)
+      : BaseRPC(channels)
+      , _timeout()
+      , _impl(&impl)
+      , _dispatch(details::static_table<IS, OS, Impl, Procedures...>::table)
+    {}
+
+    /*-------.
+    | Client |
+    `-------*/
+
+    template <typename IS, typename OS, typename ... Procedures>
+    template <typename S, typename ... Args>
+    elle::Buffer
+    StaticRPC<IS, OS, Procedures...>::_question(Args&& ... args)
+    {
+      using P = details::static_procedure<S, Procedures...>;
+      static_assert(!std::is_void<typename P::type>::value,
+                    "unknown procedure");
+      elle::Buffer question;
+      {
+        elle::IOStream outs(question.ostreambuf());
+        OS output(outs);
+        output << uint32_t(P::index);
+        details::static_signature<typename P::type::Type>::put(
+          output, std::forward<Args>(args)...);
+      }
+      return question;
+    }
+
+    template <typename IS, typename OS, typename ... Procedures>
+    template <typename S, typename ... Args>
+    auto
+    StaticRPC<IS, OS, Procedures...>::call(S const&, Args&& ... args)
+      -> Result<S>
+    {
+      ELLE_LOG_COMPONENT("elle.protocol.RPC");
+
+      ELLE_TRACE_SCOPE("%s: call remote procedure: %s", *this, S::name());
+      return this->template _result<IS>(
+        this->_question<S>(std::forward<Args>(args)...),
+        S::name(), this->_timeout, Tag<Result<S>>{});
+    }
+
+    template <typename IS, typename OS, typename ... Procedures>
+    template <typename S, typename ... Args>
+    void
+    StaticRPC<IS, OS, Procedures...>::post(S const&, Args&& ... args)
+    {
+      ELLE_LOG_COMPONENT("elle.protocol.RPC");
+
+      ELLE_TRACE_SCOPE("%s: post remote procedure: %s", *this, S::name());
+      this->_post(this->_question<S>(std::forward<Args>(args)...));
+    }
+
+    /*-------.
+    | Server |
+    `-------*/
+
+    template <typename IS, typename OS, typename ... Procedures>
+    template <typename S>
+    Admission&
+    StaticRPC<IS, OS, Procedures...>::admission(S const&)
+    {
+      using P = details::static_procedure<S, Procedures...>;
+      static_assert(!std::is_void<typename P::type>::value,
+                    "unknown procedure");
+      return this->admission(P::index);
+    }
+
+    template <typename IS, typename OS, typename ... Procedures>
+    bool
+    StaticRPC<IS, OS, Procedures...>::_answer(elle::Buffer const& question,
+                                              elle::Buffer& answer,
+                                              ExceptionHandler handler,
+                                              Yield const& yield)
+    {
+      ELLE_LOG_COMPONENT("elle.protocol.RPC");
+
+      static auto const names = std::array<std::string,
+                                           sizeof ... (Procedures)>{{
+        Procedures::Symbol::name()...
+      }};
+      elle::IOStream ins(question.istreambuf());
+      IS input(ins);
+      uint32_t id;
+      input >> id;
+      elle::IOStream outs(answer.ostreambuf());
+      OS output(outs);
+      bool stop_request = false;
+      try
+      {
+        if (id >= sizeof ... (Procedures))
+          elle::err("call to unknown procedure: %s", id);
+        if (!this->_impl)
+          elle::err("remote call to non-local procedure: %s", names[id]);
+        ELLE_TRACE_SCOPE("%s: remote procedure called: %s",
+                         *this, names[id]);
+        this->admission(id)([&]
+          {
+            this->_dispatch[id](this->_impl, input, output, yield);
+          });
+      }
+      catch (elle::reactor::Terminate const&)
+      {
+        ELLE_TRACE("%s: terminating as requested", *this);
+        throw;
+      }
+      catch (...)
+      {
+        stop_request =
+          handle_exception(handler, output, std::current_exception());
+      }
+      outs.flush();
+      return stop_request;
+    }
+
+    template <typename IS, typename OS, typename ... Procedures>
+    void
+    StaticRPC<IS, OS, Procedures...>::run(ExceptionHandler handler)
+    {
+      this->_run(
+        [&] (elle::Buffer const& question,
+             elle::Buffer& answer,
+             Yield const& yield)
+        {
+          return this->_answer(question, answer, handler, yield);
+        });
+    }
+
+    template <typename IS, typename OS, typename ... Procedures>
+    void
+    StaticRPC<IS, OS, Procedures...>::parallel_run()
+    {
+      this->_parallel_run(
+        [this] (elle::Buffer const& question,
+                elle::Buffer& answer,
+                Yield const& yield)
+        {
+          this->_answer(question, answer, {}, yield);
+          return false;
+        });
+    }
+
+    /*----------.
+    | Printable |
+    `----------*/
+
+    template <typename IS, typename OS, typename ... Procedures>
+    void
+    StaticRPC<IS, OS, Procedures...>::print(std::ostream& stream) const
+    {
+      elle::fprintf(stream, "StaticRPC(%s)", static_cast<void const*>(this));
+    }
+  }
+}
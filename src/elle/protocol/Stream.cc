@@ -59,6 +59,22 @@ namespace elle
       this->_write(packet);
     }
 
+    void
+    Stream::write(Buffers const& buffers)
+    {
+      ELLE_TRACE_SCOPE("%s: write packet (%s buffers)", this, buffers.size());
+      this->_write(buffers);
+    }
+
+    void
+    Stream::_write(Buffers const& buffers)
+    {
+      auto packet = elle::Buffer{};
+      for (auto const& b: buffers)
+        packet.append(b.contents(), b.size());
+      this->_write(packet);
+    }
+
     /*------------------.
     | Int serialization |
     `------------------*/
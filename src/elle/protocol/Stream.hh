@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iosfwd>
+#include <vector>
 
 #include <elle/Buffer.hh>
 #include <elle/Printable.hh>
@@ -16,6 +17,13 @@ namespace elle
     class Stream
       : public elle::Printable
     {
+    /*------.
+    | Types |
+    `------*/
+    public:
+      /// Pieces of a packet.
+      using Buffers = std::vector<elle::ConstWeakBuffer>;
+
     /*-------------.
     | Construction |
     `-------------*/
@@ -63,10 +71,22 @@ namespace elle
       /// @param packet The buffer to write.
       void
       write(elle::Buffer const& packet);
+      /// Write a packet made of several buffers.
+      ///
+      /// Backends may send the buffers one after the other instead of
+      /// gathering them first.
+      ///
+      /// @param buffers The pieces of the packet, in order.
+      void
+      write(Buffers const& buffers);
     protected:
       virtual
       void
       _write(elle::Buffer const& packet) = 0;
+      /// Gather \a buffers and _write them, by default.
+      virtual
+      void
+      _write(Buffers const& buffers);
 
     /*------------------.
     | Int serialization |
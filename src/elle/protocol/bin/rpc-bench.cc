@@ -0,0 +1,592 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+#include <boost/algorithm/string/split.hpp>
+
+#include <elle/IOStream.hh>
+#include <elle/With.hh>
+#include <elle/das/Symbol.hh>
+#include <elle/json/json.hh>
+
+#include <elle/reactor/network/TCPServer.hh>
+#include <elle/reactor/network/TCPSocket.hh>
+#ifdef REACTOR_NETWORK_UNIX_DOMAIN_SOCKET
+# include <elle/reactor/network/unix-domain-server.hh>
+# include <elle/reactor/network/unix-domain-socket.hh>
+#endif
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/scheduler.hh>
+#include <elle/reactor/signal.hh>
+
+#include <elle/protocol/ChanneledStream.hh>
+#include <elle/protocol/RPC.hh>
+#include <elle/protocol/Serializer.hh>
+#include <elle/protocol/StaticRPC.hh>
+
+ELLE_LOG_COMPONENT("rpc.bench");
+
+using namespace std::literals;
+using namespace elle::reactor::network;
+
+/*---------.
+| Archives |
+`---------*/
+
+/// Arguments in host byte order: both peers run in this process.
+class Output
+{
+public:
+  Output(std::ostream& stream)
+    : _stream(stream)
+  {}
+
+  template <typename T>
+  std::enable_if_t<std::is_arithmetic<T>::value, Output&>
+  operator <<(T const& value)
+  {
+    this->_stream.write(reinterpret_cast<char const*>(&value), sizeof value);
+    return *this;
+  }
+
+  Output&
+  operator <<(std::string const& value)
+  {
+    *this << uint32_t(value.size());
+    this->_stream.write(value.data(), value.size());
+    return *this;
+  }
+
+  Output&
+  operator <<(elle::Buffer const& value)
+  {
+    *this << uint32_t(value.size());
+    this->_stream.write(reinterpret_cast<char const*>(value.contents()),
+                        value.size());
+    return *this;
+  }
+
+private:
+  std::ostream& _stream;
+};
+
+class Input
+{
+public:
+  Input(std::istream& stream)
+    : _stream(stream)
+  {}
+
+  template <typename T>
+  std::enable_if_t<std::is_arithmetic<T>::value, Input&>
+  operator >>(T& value)
+  {
+    this->_read(&value, sizeof value);
+    return *this;
+  }
+
+  Input&
+  operator >>(std::string& value)
+  {
+    auto size = uint32_t(0);
+    *this >> size;
+    value.resize(size);
+    this->_read(&value[0], size);
+    return *this;
+  }
+
+  Input&
+  operator >>(elle::Buffer& value)
+  {
+    auto size = uint32_t(0);
+    *this >> size;
+    value.size(size);
+    this->_read(value.mutable_contents(), size);
+    return *this;
+  }
+
+private:
+  void
+  _read(void* data, std::size_t size)
+  {
+    this->_stream.read(static_cast<char*>(data), size);
+    if (this->_stream.gcount() != std::streamsize(size))
+      elle::err("truncated RPC message");
+  }
+
+  std::istream& _stream;
+};
+
+/*--------.
+| Streams |
+`--------*/
+
+/// One direction of an in-memory connection.
+struct Pipe
+{
+  elle::Buffer data;
+  elle::Buffer::Size offset = 0;
+  elle::reactor::Signal readable;
+};
+
+class PipeBuffer
+  : public elle::DynamicStreamBuffer
+{
+public:
+  PipeBuffer(std::shared_ptr<Pipe> in, std::shared_ptr<Pipe> out)
+    : elle::DynamicStreamBuffer(1 << 16)
+    , _in(std::move(in))
+    , _out(std::move(out))
+  {}
+
+protected:
+  Size
+  read(char* buffer, Size size) override
+  {
+    auto& in = *this->_in;
+    while (in.offset == in.data.size())
+      elle::reactor::wait(in.readable);
+    auto const read = std::min<Size>(size, in.data.size() - in.offset);
+    std::memcpy(buffer, in.data.contents() + in.offset, read);
+    in.offset += read;
+    if (in.offset == in.data.size())
+    {
+      in.data.size(0);
+      in.offset = 0;
+    }
+    return read;
+  }
+
+  void
+  write(char* buffer, Size size) override
+  {
+    this->_out->data.append(buffer, size);
+    this->_out->readable.signal();
+  }
+
+private:
+  std::shared_ptr<Pipe> _in;
+  std::shared_ptr<Pipe> _out;
+};
+
+class PipeStream
+  : public elle::IOStream
+{
+public:
+  PipeStream(std::shared_ptr<Pipe> in, std::shared_ptr<Pipe> out)
+    : elle::IOStream(new PipeBuffer(std::move(in), std::move(out)))
+  {}
+};
+
+/*-----------.
+| Transports |
+`-----------*/
+
+/// The client and server ends of a connection.
+using Connection = std::pair<std::unique_ptr<std::iostream>,
+                             std::unique_ptr<std::iostream>>;
+
+struct Transport
+{
+  std::string name;
+  std::function<Connection ()> connect;
+};
+
+static
+std::vector<Transport>
+transports(std::vector<std::string> const& names)
+{
+  auto const localhost = boost::asio::ip::address::from_string("127.0.0.1");
+  auto res = std::vector<Transport>{};
+  for (auto const& name: names)
+    if (name == "memory")
+      res.push_back(Transport{
+          name,
+          []
+          {
+            auto up = std::make_shared<Pipe>();
+            auto down = std::make_shared<Pipe>();
+            return Connection(std::make_unique<PipeStream>(down, up),
+                              std::make_unique<PipeStream>(up, down));
+          }});
+    else if (name == "tcp")
+    {
+      auto server = std::make_shared<TCPServer>();
+      server->listen(TCPServer::EndPoint(localhost, 0));
+      res.push_back(Transport{
+          name,
+          [server]
+          {
+            auto client =
+              std::make_unique<TCPSocket>("127.0.0.1", server->port());
+            return Connection(std::move(client), server->accept());
+          }});
+    }
+#ifdef REACTOR_NETWORK_UNIX_DOMAIN_SOCKET
+    else if (name == "unix")
+    {
+      auto server = std::make_shared<UnixDomainServer>();
+      server->listen();
+      res.push_back(Transport{
+          name,
+          [server]
+          {
+            auto client =
+              std::make_unique<UnixDomainSocket>(server->local_endpoint());
+            return Connection(std::move(client), server->accept());
+          }});
+    }
+#endif
+    else
+      std::cerr << "skip unknown transport: " << name << std::endl;
+  return res;
+}
+
+/*-----------.
+| Interfaces |
+`-----------*/
+
+namespace symbols
+{
+  ELLE_DAS_SYMBOL(echo);
+}
+
+/// The dynamic RPC front end.
+struct EchoRPC
+  : public elle::protocol::RPC<Input, Output>
+{
+  EchoRPC(elle::protocol::ChanneledStream& channels)
+    : elle::protocol::RPC<Input, Output>(channels)
+    , echo("echo", *this)
+  {}
+
+  RemoteProcedure<elle::Buffer, elle::Buffer const&> echo;
+};
+
+/// The implementation of the static RPC front end.
+struct Echo
+{
+  elle::Buffer
+  echo(elle::Buffer const& payload)
+  {
+    return payload;
+  }
+};
+
+using StaticEchoRPC = elle::protocol::StaticRPC<
+  Input, Output,
+  symbols::Symbol_echo::Formal<elle::Buffer (elle::Buffer const&)>>;
+
+using Call = std::function<elle::Buffer (elle::Buffer const&)>;
+
+/// An RPC front end to benchmark.
+struct Interface
+{
+  std::string name;
+  /// Serve echo on \a channels until terminated.
+  std::function<void (elle::protocol::ChanneledStream& channels)> serve;
+  /// Hand \a body a client calling echo on \a channels.
+  std::function<void (elle::protocol::ChanneledStream& channels,
+                      std::function<void (Call const&)> const& body)> client;
+};
+
+static
+std::vector<Interface>
+interfaces(std::vector<std::string> const& names)
+{
+  auto res = std::vector<Interface>{};
+  for (auto const& name: names)
+    if (name == "dynamic")
+      res.push_back(Interface{
+          name,
+          [] (elle::protocol::ChanneledStream& channels)
+          {
+            EchoRPC rpc(channels);
+            rpc.echo = [] (elle::Buffer const& payload) { return payload; };
+            rpc.parallel_run();
+          },
+          [] (elle::protocol::ChanneledStream& channels,
+              std::function<void (Call const&)> const& body)
+          {
+            EchoRPC rpc(channels);
+            body([&] (elle::Buffer const& payload)
+                 {
+                   return rpc.echo(payload);
+                 });
+          }});
+    else if (name == "static")
+      res.push_back(Interface{
+          name,
+          [] (elle::protocol::ChanneledStream& channels)
+          {
+            Echo echo;
+            StaticEchoRPC rpc(channels, echo);
+            rpc.parallel_run();
+          },
+          [] (elle::protocol::ChanneledStream& channels,
+              std::function<void (Call const&)> const& body)
+          {
+            StaticEchoRPC rpc(channels);
+            body([&] (elle::Buffer const& payload)
+                 {
+                   return rpc.call(symbols::echo, payload);
+                 });
+          }});
+    else
+      std::cerr << "skip unknown interface: " << name << std::endl;
+  return res;
+}
+
+/*-------------.
+| Measurements |
+`-------------*/
+
+struct Options
+{
+  std::vector<std::string> transports;
+  std::vector<std::string> interfaces;
+  std::vector<elle::Version> versions;
+  std::vector<bool> checksums;
+  std::vector<int> sizes;
+  std::vector<int> concurrency;
+  std::chrono::seconds duration;
+};
+
+/// A point of the benchmark matrix.
+struct Run
+{
+  Transport const& transport;
+  Interface const& interface;
+  elle::Version version;
+  bool checksum;
+  int size;
+  int concurrency;
+};
+
+static
+double
+seconds(elle::Duration d)
+{
+  return std::chrono::duration_cast<std::chrono::duration<double>>(d).count();
+}
+
+/// Call echo from \a run.concurrency clients for \a duration: calls per
+/// second and call latency percentiles, in microseconds.
+static
+elle::json::OrderedObject
+measure(Run const& run, std::chrono::seconds duration)
+{
+  auto connection = run.transport.connect();
+  auto samples = std::vector<double>{};
+  auto elapsed = 0.;
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "server",
+      [&]
+      {
+        elle::protocol::Serializer s(
+          *connection.second, run.version, run.checksum);
+        elle::protocol::ChanneledStream channels(s);
+        run.interface.serve(channels);
+      });
+    elle::protocol::Serializer s(
+      *connection.first, run.version, run.checksum);
+    elle::protocol::ChanneledStream channels(s);
+    run.interface.client(
+      channels,
+      [&] (Call const& echo)
+      {
+        auto const payload = elle::Buffer(std::string(run.size, 'x'));
+        for (int i = 0; i < 10; ++i)
+          echo(payload);
+        auto const start = elle::Clock::now();
+        elle::With<elle::reactor::Scope>() <<
+          [&] (elle::reactor::Scope& clients)
+          {
+            for (int c = 0; c < run.concurrency; ++c)
+              clients.run_background(
+                elle::sprintf("client %s", c),
+                [&]
+                {
+                  while (elle::Clock::now() - start < duration)
+                  {
+                    auto const call = elle::Clock::now();
+                    auto const reply = echo(payload);
+                    samples.push_back(
+                      seconds(elle::Clock::now() - call) * 1e6);
+                    if (reply.size() != payload.size())
+                      elle::err("echo returned %s bytes out of %s",
+                                reply.size(), payload.size());
+                  }
+                });
+            elle::reactor::wait(clients);
+          };
+        elapsed = seconds(elle::Clock::now() - start);
+      });
+    scope.terminate_now();
+  };
+  if (samples.empty())
+    elle::err("no call completed in %s", duration);
+  std::sort(samples.begin(), samples.end());
+  auto const percentile = [&] (double p)
+    {
+      return samples[std::min<std::size_t>(samples.size() * p,
+                                           samples.size() - 1)];
+    };
+  auto latency = elle::json::OrderedObject{};
+  latency["mean"] =
+    std::accumulate(samples.begin(), samples.end(), 0.) / samples.size();
+  latency["p50"] = percentile(0.5);
+  latency["p90"] = percentile(0.9);
+  latency["p99"] = percentile(0.99);
+  latency["p999"] = percentile(0.999);
+  latency["max"] = samples.back();
+  auto res = elle::json::OrderedObject{};
+  res["transport"] = run.transport.name;
+  res["interface"] = run.interface.name;
+  res["version"] = elle::sprintf("%s", run.version);
+  res["checksum"] = run.checksum;
+  res["size"] = run.size;
+  res["concurrency"] = run.concurrency;
+  res["calls"] = int64_t(samples.size());
+  res["calls_per_second"] = samples.size() / elapsed;
+  res["latency_us"] = latency;
+  return res;
+}
+
+/*-----.
+| Main |
+`-----*/
+
+static
+std::vector<std::string>
+split(std::string const& list)
+{
+  auto res = std::vector<std::string>{};
+  boost::algorithm::split(res, list, [] (char c) { return c == ','; });
+  return res;
+}
+
+/// Benchmark of RPCs over a Serializer and a ChanneledStream: calls per
+/// second and latency percentiles of an echo procedure, for every transport,
+/// front end, protocol version, checksum setting, payload size and number
+/// of concurrent calls. Results are printed as JSON, one entry per run.
+static
+void
+run(int argc, char** argv)
+{
+  auto options = Options{
+    {"memory", "unix", "tcp"},
+    {"dynamic", "static"},
+    {
+      elle::Version(0, 1, 0),
+      elle::Version(0, 2, 0),
+      elle::Version(0, 3, 0),
+      elle::Version(0, 4, 0),
+    },
+    {true, false},
+    {64, 4096, 65536},
+    {1, 16, 64},
+    1s,
+  };
+  for (int i = 1; i < argc; i += 2)
+  {
+    auto const arg = std::string(argv[i]);
+    if (arg == "--help" || i + 1 >= argc)
+    {
+      std::cerr
+        << "usage: " << argv[0]
+        << " [--transports memory,unix,tcp] [--interfaces dynamic,static]"
+        << " [--versions 0.1.0,...] [--checksums on,off]"
+        << " [--sizes 64,4096,...] [--concurrency 1,16,...] [--seconds N]"
+        << std::endl;
+      return;
+    }
+    auto const value = std::string(argv[i + 1]);
+    if (arg == "--transports")
+      options.transports = split(value);
+    else if (arg == "--interfaces")
+      options.interfaces = split(value);
+    else if (arg == "--versions")
+    {
+      options.versions.clear();
+      for (auto const& version: split(value))
+        options.versions.push_back(elle::Version::from_string(version));
+    }
+    else if (arg == "--checksums")
+    {
+      options.checksums.clear();
+      for (auto const& checksum: split(value))
+        if (checksum == "on" || checksum == "off")
+          options.checksums.push_back(checksum == "on");
+        else
+          elle::err("invalid checksum setting: %s", checksum);
+    }
+    else if (arg == "--sizes")
+    {
+      options.sizes.clear();
+      for (auto const& size: split(value))
+        options.sizes.push_back(std::stoi(size));
+    }
+    else if (arg == "--concurrency")
+    {
+      options.concurrency.clear();
+      for (auto const& c: split(value))
+        options.concurrency.push_back(std::stoi(c));
+    }
+    else if (arg == "--seconds")
+      options.duration = std::chrono::seconds(std::stoi(value));
+    else
+      elle::err("unknown option: %s", arg);
+  }
+  auto runs = elle::json::Array{};
+  auto const fronts = interfaces(options.interfaces);
+  for (auto const& transport: transports(options.transports))
+    for (auto const& interface: fronts)
+      for (auto const& version: options.versions)
+        for (auto checksum: options.checksums)
+          for (auto size: options.sizes)
+            for (auto concurrency: options.concurrency)
+            {
+              auto const r = Run{
+                transport, interface, version, checksum, size, concurrency};
+              std::cerr << elle::sprintf(
+                "%s %s %s, checksum %s: %s bytes, %s concurrent calls",
+                transport.name, interface.name, version, checksum, size,
+                concurrency) << std::endl;
+              try
+              {
+                runs.emplace_back(measure(r, options.duration));
+              }
+              catch (elle::Error const& e)
+              {
+                std::cerr << elle::sprintf("%s: %s", transport.name, e)
+                          << std::endl;
+                auto failure = elle::json::OrderedObject{};
+                failure["transport"] = transport.name;
+                failure["interface"] = interface.name;
+                failure["version"] = elle::sprintf("%s", version);
+                failure["checksum"] = checksum;
+                failure["size"] = size;
+                failure["concurrency"] = concurrency;
+                failure["error"] = std::string(e.what());
+                runs.emplace_back(failure);
+              }
+            }
+  auto output = elle::json::OrderedObject{};
+  output["seconds"] = int(options.duration.count());
+  output["runs"] = runs;
+  elle::json::write(std::cout, output, true, true);
+}
+
+int main(int argc, char** argv)
+{
+  elle::reactor::Scheduler sched;
+  elle::reactor::Thread t(sched, "main", [&]
+    {
+      run(argc, argv);
+    });
+  sched.run();
+}
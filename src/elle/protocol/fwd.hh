@@ -6,6 +6,8 @@ namespace elle
   {
     class Channel;
     class ChanneledStream;
+    class Compressor;
+    class Hasher;
     class BaseRPC;
     template <typename ISerializer, typename OSerializer>
     class RPC;
@@ -69,8 +69,11 @@ namespace elle
       /// Create a generator on a driver.
       ///
       /// The signature of the Driver must be auto `(yielder const&) -> void`.
+      ///
+      /// @param max_size How many values may wait to be consumed before the
+      ///                 driver blocks. Unlimited by default.
       template <typename Driver>
-      Generator(Driver driver);
+      Generator(Driver driver, boost::optional<int> max_size = boost::none);
       Generator(Generator&& b);
       ~Generator();
 
@@ -19,11 +19,13 @@ namespace elle
 
     template <typename T>
     template <typename Driver>
-    Generator<T>::Generator(Driver driver)
+    Generator<T>::Generator(Driver driver, boost::optional<int> max_size)
     {
       using Signature = std::function<auto (yielder const&) -> void>;
       static_assert(std::is_constructible<Signature, Driver>::value, "");
       ELLE_LOG_COMPONENT("elle.reactor.Generator");
+      if (max_size)
+        this->_results.max_size(*max_size);
       auto yield = [this] (T elt) { this->_results.put(std::move(elt)); };
       this->_thread.reset(
         new Thread("generator",
@@ -0,0 +1,91 @@
+#include <iostream>
+
+#include <elle/With.hh>
+
+#include <elle/reactor/network/Error.hh>
+#include <elle/reactor/network/http-server.hh>
+#include <elle/reactor/network/TCPSocket.hh>
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/scheduler.hh>
+
+ELLE_LOG_COMPONENT("http.bench");
+
+using namespace elle::reactor::network;
+
+/// Throughput benchmark for HttpServer: local clients issue GET requests
+/// over keep-alive connections, with up to `pipeline` requests in flight
+/// each, and the request rate is reported at the end of the run.
+static void run(int argc, char** argv)
+{
+  if (argc > 1 && std::string(argv[1]) == "--help")
+  {
+    std::cerr << "usage: " << argv[0]
+              << " [connections] [pipeline] [seconds] [size]"
+              << std::endl;
+    return;
+  }
+  auto const connections = argc > 1 ? std::stoi(argv[1]) : 16;
+  auto const pipeline = argc > 2 ? std::stoi(argv[2]) : 1;
+  auto const duration =
+    std::chrono::seconds(argc > 3 ? std::stoi(argv[3]) : 5);
+  auto const size = argc > 4 ? std::stoi(argv[4]) : 64;
+  auto const body = std::string(size, 'x');
+  HttpServer server;
+  server.max_pipelined(pipeline);
+  server.register_route(
+    "/bench", elle::reactor::http::Method::GET,
+    [&] (HttpServer::Headers const&,
+         HttpServer::Cookies const&,
+         HttpServer::Parameters const&,
+         elle::Buffer const&) -> std::string
+    {
+      return body;
+    });
+  auto requests = std::string();
+  for (int i = 0; i < pipeline; ++i)
+    requests += "GET /bench HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  auto done = int64_t(0);
+  auto const start = elle::Clock::now();
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    for (int c = 0; c < connections; ++c)
+      scope.run_background(
+        elle::sprintf("client %s", c),
+        [&]
+        {
+          TCPSocket socket("127.0.0.1", server.port());
+          while (elle::Clock::now() - start < duration)
+          {
+            socket.write(elle::ConstWeakBuffer(requests));
+            for (int i = 0; i < pipeline; ++i)
+            {
+              auto const head = socket.read_until("\r\n\r\n").string();
+              auto const length = head.find("Content-Length: ");
+              if (length == std::string::npos)
+                elle::err("response without length: %s", head);
+              socket.read(std::stoi(head.substr(length + 16)));
+              ++done;
+            }
+          }
+        });
+    elle::reactor::wait(scope);
+  };
+  auto const elapsed =
+    std::chrono::duration_cast<std::chrono::duration<double>>(
+      elle::Clock::now() - start);
+  std::cout << elle::sprintf(
+    "%s connections, %s pipelined, %s bytes: %s requests, "
+    "%.0f requests/s, %.2f MB/s",
+    connections, pipeline, size, done, done / elapsed.count(),
+    done * size / elapsed.count() / 1e6) << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  elle::reactor::Scheduler sched;
+  elle::reactor::Thread t(sched, "main", [&]
+    {
+      run(argc, argv);
+    });
+  sched.run();
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+
+#include <curl/curl.h>
+
+#include <elle/With.hh>
+
+#include <elle/reactor/http/exceptions.hh>
+#include <elle/reactor/http/Request.hh>
+#include <elle/reactor/http/Service.hh>
+#include <elle/reactor/network/http-server.hh>
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/scheduler.hh>
+
+ELLE_LOG_COMPONENT("http.client-bench");
+
+using namespace std::literals;
+using namespace elle::reactor;
+
+/// Request rate benchmark for reactor::http: `concurrency` threads issue GET
+/// requests back to back against a URL, by default served by a local
+/// HttpServer, and the request rate is reported at the end of the run.
+///
+/// With HTTP/2, concurrent requests to an origin are multiplexed over one
+/// connection, up to `streams` at once.
+static void run(int argc, char** argv)
+{
+  if (argc > 1 && std::string(argv[1]) == "--help")
+  {
+    std::cerr << "usage: " << argv[0]
+              << " [url|local] [concurrency] [seconds] [1.0|1.1|2.0] [streams]"
+              << std::endl;
+    return;
+  }
+  auto const target = argc > 1 ? std::string(argv[1]) : "local";
+  auto const concurrency = argc > 2 ? std::stoi(argv[2]) : 16;
+  auto const duration =
+    std::chrono::seconds(argc > 3 ? std::stoi(argv[3]) : 5);
+  auto const version = argc > 4
+    ? http::version::from_string(elle::sprintf("HTTP/%s", argv[4]))
+    : http::Version::v11;
+  if (argc > 5)
+    boost::asio::use_service<http::Service>(scheduler().io_service())
+      .max_streams(std::stoi(argv[5]));
+  auto server = std::unique_ptr<network::HttpServer>();
+  auto url = target;
+  if (target == "local")
+  {
+    server = std::make_unique<network::HttpServer>();
+    server->register_route(
+      "/bench", http::Method::GET,
+      [] (network::HttpServer::Headers const&,
+          network::HttpServer::Cookies const&,
+          network::HttpServer::Parameters const&,
+          elle::Buffer const&) -> std::string
+      {
+        return "bench";
+      });
+    url = server->url("bench");
+  }
+  auto const conf = http::Request::Configuration(30s, {}, version);
+  auto done = int64_t(0);
+  auto failed = int64_t(0);
+  auto const start = elle::Clock::now();
+  elle::With<Scope>() << [&] (Scope& scope)
+  {
+    for (int c = 0; c < concurrency; ++c)
+      scope.run_background(
+        elle::sprintf("client %s", c),
+        [&]
+        {
+          while (elle::Clock::now() - start < duration)
+            try
+            {
+              http::get(url, conf);
+              ++done;
+            }
+            catch (http::RequestError const& e)
+            {
+              ELLE_TRACE("request failed: %s", e);
+              ++failed;
+            }
+        });
+    elle::reactor::wait(scope);
+  };
+  auto const elapsed =
+    std::chrono::duration_cast<std::chrono::duration<double>>(
+      elle::Clock::now() - start);
+  std::cout << elle::sprintf(
+    "%s, %s concurrent requests: %s requests, %s failed, %.0f requests/s",
+    version, concurrency, done, failed, done / elapsed.count()) << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  elle::reactor::Scheduler sched;
+  elle::reactor::Thread t(sched, "main", [&]
+    {
+      run(argc, argv);
+    });
+  sched.run();
+}
@@ -0,0 +1,114 @@
+#include <iostream>
+
+#include <elle/reactor/network/Error.hh>
+#include <elle/reactor/network/rdv.hh>
+#include <elle/reactor/network/resolve.hh>
+#include <elle/reactor/network/udp-socket.hh>
+#include <elle/reactor/scheduler.hh>
+#include <elle/reactor/semaphore.hh>
+
+ELLE_LOG_COMPONENT("rdv.load");
+
+using namespace std::literals;
+using namespace elle::reactor::network;
+
+/// Load generator for rdv-server: simulated peers ping the server as fast as
+/// a window of outstanding requests allows, and the reply rate is reported
+/// every second, then averaged over the run.
+static void run(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::cerr << "usage: " << argv[0]
+              << " host [port] [peers] [seconds] [window] [json|binary]"
+              << std::endl;
+    return;
+  }
+  auto const host = std::string(argv[1]);
+  auto const port = argc > 2 ? std::stoi(argv[2]) : 7890;
+  auto const peers = argc > 3 ? std::stoi(argv[3]) : 1000;
+  auto const duration =
+    std::chrono::seconds(argc > 4 ? std::stoi(argv[4]) : 10);
+  auto const window_size = argc > 5 ? std::stoi(argv[5]) : 256;
+  auto const binary = !(argc > 6 && std::string(argv[6]) == "json");
+  auto const server = resolve_udp(host, std::to_string(port))[0];
+  UDPSocket socket;
+  socket.close();
+  socket.bind(
+    boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), 0));
+  // Encode beforehand so we measure the server, not ourselves.
+  auto pings = std::vector<elle::Buffer>{};
+  for (int i = 0; i < peers; ++i)
+  {
+    rdv::Message ping;
+    ping.command = rdv::Command::ping;
+    ping.id = elle::sprintf("rdv-load-%s", i);
+    pings.emplace_back(rdv::encode(ping, binary));
+  }
+  elle::reactor::Semaphore window(window_size);
+  auto sent = int64_t(0);
+  auto received = int64_t(0);
+  auto lost = int64_t(0);
+  elle::reactor::Thread receiver("receiver", [&]
+    {
+      auto buffer = elle::Buffer(5000);
+      while (true)
+      {
+        rdv::Endpoint source;
+        socket.receive_from(elle::WeakBuffer(buffer), source);
+        ++received;
+        window.release();
+      }
+    });
+  elle::reactor::Thread reporter("reporter", [&]
+    {
+      auto last = received;
+      while (true)
+      {
+        elle::reactor::sleep(1s);
+        std::cout << received - last << " packets/s" << std::endl;
+        last = received;
+      }
+    });
+  auto const start = elle::Clock::now();
+  for (auto i = 0u; elle::Clock::now() - start < duration;
+       i = (i + 1) % pings.size())
+  {
+    while (!window.acquire())
+      if (!elle::reactor::wait(window, 100ms))
+      {
+        // Consider the oldest request lost and reclaim its slot.
+        ++lost;
+        break;
+      }
+    try
+    {
+      socket.send_to(elle::ConstWeakBuffer(pings[i]), server);
+      ++sent;
+    }
+    catch (Error const& e)
+    {
+      ELLE_TRACE("send failed: %s", e);
+    }
+  }
+  auto const elapsed =
+    std::chrono::duration_cast<std::chrono::duration<double>>(
+      elle::Clock::now() - start);
+  receiver.terminate_now();
+  reporter.terminate_now();
+  std::cout << elle::sprintf(
+    "%s encoding, %s peers: sent %s, received %s, timed out %s, "
+    "%.0f packets/s",
+    binary ? "binary" : "json", peers, sent, received, lost,
+    received / elapsed.count()) << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  elle::reactor::Scheduler sched;
+  elle::reactor::Thread t(sched, "main", [&]
+    {
+      run(argc, argv);
+    });
+  sched.run();
+}
@@ -1,7 +1,16 @@
+#ifdef ELLE_LINUX
+# include <sys/socket.h>
+#endif
+
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
 #include <boost/optional.hpp>
 
-#include <elle/serialization/json.hh>
+#include <elle/os/environ.hh>
 
+#include <elle/reactor/network/Error.hh>
 #include <elle/reactor/network/rdv.hh>
 #include <elle/reactor/network/udp-socket.hh>
 #include <elle/reactor/scheduler.hh>
@@ -10,96 +19,323 @@
 ELLE_LOG_COMPONENT("rdv.server");
 
 using namespace elle::reactor::network;
+namespace bmi = boost::multi_index;
 
-std::unordered_map<std::string, rdv::Endpoint> peers;
-elle::reactor::network::UDPSocket* server = nullptr;
-
-static void send_with_magik(elle::Buffer const& b, rdv::Endpoint peer)
+namespace
 {
-  elle::Buffer data(elle::reactor::network::rdv::rdv_magic, 8);
-  data.append(b.contents(), b.size());
-  server->send_to(elle::ConstWeakBuffer(data), peer);
-}
+  /// Maximum size of a datagram we handle.
+  auto constexpr packet_size = 5000;
 
-static void run(int argc, char** argv)
-{
-  int port = 7890;
-  if (argc >1)
-    port = std::stoi(argv[1]);
-  elle::reactor::network::UDPSocket srv;
-  server = &srv;
-  srv.close();
-  srv.bind(
-    boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), port));
-  elle::Buffer buf;
-  while (true)
+  /// Peers known to the server.
+  ///
+  /// Peers refresh their entry with keep-alive pings, entries not refreshed
+  /// for longer than the TTL expire. When full, the least recently seen peer
+  /// is evicted so memory stays bounded.
+  class Peers
+  {
+  public:
+    struct Peer
+    {
+      std::string id;
+      rdv::Endpoint endpoint;
+      elle::Time seen;
+      /// Whether the peer speaks the binary encoding.
+      bool binary;
+    };
+
+    Peers(elle::Duration ttl, std::size_t max)
+      : _ttl(ttl)
+      , _max(max)
+    {}
+
+    /// Record that \a id was seen at \a endpoint.
+    void
+    touch(std::string const& id, rdv::Endpoint const& endpoint, bool binary)
+    {
+      auto const now = elle::Clock::now();
+      auto& ids = this->_peers.get<0>();
+      auto it = ids.find(id);
+      if (it == ids.end())
+      {
+        if (this->_peers.size() >= this->_max)
+        {
+          ELLE_DEBUG("peer table full, evict %s",
+                     this->_peers.get<1>().front().id);
+          this->_peers.get<1>().pop_front();
+        }
+        this->_peers.get<1>().push_back(Peer{id, endpoint, now, binary});
+      }
+      else
+      {
+        ids.modify(it, [&] (Peer& p)
+                   {
+                     p.endpoint = endpoint;
+                     p.seen = now;
+                     p.binary = binary;
+                   });
+        // Keep the sequence ordered by last contact.
+        auto& order = this->_peers.get<1>();
+        order.relocate(order.end(), this->_peers.project<1>(it));
+      }
+    }
+
+    /// The live entry for \a id, if any.
+    Peer const*
+    find(std::string const& id) const
+    {
+      auto it = this->_peers.get<0>().find(id);
+      if (it == this->_peers.get<0>().end() ||
+          elle::Clock::now() - it->seen > this->_ttl)
+        return nullptr;
+      return &*it;
+    }
+
+    /// Drop expired entries, oldest first.
+    void
+    expire()
+    {
+      auto const deadline = elle::Clock::now() - this->_ttl;
+      auto& order = this->_peers.get<1>();
+      while (!order.empty() && order.front().seen < deadline)
+      {
+        ELLE_DEBUG("expire %s", order.front().id);
+        order.pop_front();
+      }
+    }
+
+    std::size_t
+    size() const
+    {
+      return this->_peers.size();
+    }
+
+  private:
+    using Container = bmi::multi_index_container<
+      Peer,
+      bmi::indexed_by<
+        bmi::hashed_unique<bmi::member<Peer, std::string, &Peer::id>>,
+        bmi::sequenced<>>>;
+    ELLE_ATTRIBUTE(Container, peers);
+    ELLE_ATTRIBUTE(elle::Duration, ttl);
+    ELLE_ATTRIBUTE(std::size_t, max);
+  };
+
+  struct Packet
+  {
+    elle::Buffer data;
+    rdv::Endpoint endpoint;
+  };
+
+  class RDVServer
   {
-    buf.size(5000);
-    rdv::Endpoint source;
-    int sz = srv.receive_from(elle::WeakBuffer(buf), source);
-    buf.size(sz);
-    if (memcmp(buf.contents(), rdv::rdv_magic, 8) == 0)
+  public:
+    RDVServer(int port, int batch, Peers peers)
+      : _peers(std::move(peers))
+      , _batch(batch)
     {
-      memmove(buf.mutable_contents(), buf.contents()+8, buf.size()-8);
-      buf.size(sz - 8);
+      this->_socket.close();
+      this->_socket.bind(
+        boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), port));
+      for (auto& p: this->_batch)
+        p.data.capacity(packet_size);
     }
-    rdv::Message req;
-    try
+
+    void
+    run()
+    {
+      while (true)
+      {
+        auto& first = this->_batch.front();
+        first.data.size(packet_size);
+        first.data.size(
+          this->_socket.receive_from(elle::WeakBuffer(first.data),
+                                     first.endpoint));
+        auto const count = 1 + this->_receive_more(1);
+        ELLE_TRACE("handle %s packets, %s known peers",
+                   count, this->_peers.size());
+        this->_peers.expire();
+        for (auto i = 0u; i < count; ++i)
+          this->_handle(this->_batch[i]);
+        this->_flush();
+      }
+    }
+
+  private:
+    /// Read datagrams already queued on the socket, without blocking.
+    ///
+    /// \param from The first batch slot to fill.
+    /// \returns The number of datagrams read.
+    unsigned
+    _receive_more(unsigned from)
+    {
+      auto& socket = *this->_socket.socket();
+#ifdef ELLE_LINUX
+      auto const count = this->_batch.size() - from;
+      auto headers = std::vector<mmsghdr>(count);
+      auto iovecs = std::vector<iovec>(count);
+      for (auto i = 0u; i < count; ++i)
+      {
+        auto& p = this->_batch[from + i];
+        p.data.size(packet_size);
+        iovecs[i] = {p.data.mutable_contents(), p.data.size()};
+        headers[i].msg_hdr = msghdr{};
+        headers[i].msg_hdr.msg_iov = &iovecs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+        headers[i].msg_hdr.msg_name = p.endpoint.data();
+        headers[i].msg_hdr.msg_namelen = p.endpoint.capacity();
+      }
+      auto const res = ::recvmmsg(socket.native_handle(),
+                                  headers.data(), count, MSG_DONTWAIT, nullptr);
+      if (res < 0)
+        return 0;
+      for (auto i = 0; i < res; ++i)
+      {
+        auto& p = this->_batch[from + i];
+        p.data.size(headers[i].msg_len);
+        p.endpoint.resize(headers[i].msg_hdr.msg_namelen);
+      }
+      return res;
+#else
+      auto res = 0u;
+      for (auto i = from; i < this->_batch.size() && socket.available(); ++i)
+      {
+        auto& p = this->_batch[i];
+        p.data.size(packet_size);
+        boost::system::error_code e;
+        auto const size = socket.receive_from(
+          boost::asio::buffer(p.data.mutable_contents(), p.data.size()),
+          p.endpoint, 0, e);
+        if (e)
+          break;
+        p.data.size(size);
+        ++res;
+      }
+      return res;
+#endif
+    }
+
+    void
+    _reply(rdv::Message const& message, rdv::Endpoint const& peer, bool binary)
+    {
+      this->_replies.push_back(Packet{rdv::encode(message, binary), peer});
+    }
+
+    void
+    _handle(Packet const& packet)
     {
-      req = elle::serialization::json::deserialize<rdv::Message>(buf, false);
-
-      peers[req.id] = source;
-      rdv::Message reply;
-      reply.id = req.id;
-      reply.source_endpoint = source;
-      ELLE_TRACE("Got %s packet from %s", (int)req.command, source);
-      switch(req.command)
+      auto const& source = packet.endpoint;
+      bool binary = false;
+      rdv::Message req;
+      try
       {
-      case rdv::Command::ping:
-        reply.command = rdv::Command::pong;
-        break;
-      case rdv::Command::pong:
-        break;
-      case rdv::Command::connect:
+        req = rdv::decode(packet.data, binary);
+        this->_peers.touch(req.id, source, binary);
+        rdv::Message reply;
+        reply.id = req.id;
+        reply.source_endpoint = source;
+        ELLE_TRACE("Got %s packet from %s", (int)req.command, source);
+        switch(req.command)
         {
-          reply.command = rdv::Command::connect;
-          ELLE_ASSERT(req.target_address);
-          reply.target_address = req.target_address;
-          auto peer = peers.find(*req.target_address);
-          if (peer != peers.end())
+        case rdv::Command::ping:
+          reply.command = rdv::Command::pong;
+          break;
+        case rdv::Command::pong:
+          return;
+        case rdv::Command::connect:
           {
-            ELLE_TRACE("Found peer at %s", peer->second);
-            reply.target_endpoint = peer->second;
-            rdv::Message other;
-            other.command = rdv::Command::connect_requested;
-            other.id = *req.target_address;
-            other.source_endpoint = peer->second;
-            other.target_address = req.id;
-            other.target_endpoint = source;
-            elle::Buffer b = elle::serialization::json::serialize(other, false);
-            send_with_magik(b, peer->second);
+            reply.command = rdv::Command::connect;
+            ELLE_ASSERT(req.target_address);
+            reply.target_address = req.target_address;
+            if (auto peer = this->_peers.find(*req.target_address))
+            {
+              ELLE_TRACE("Found peer at %s", peer->endpoint);
+              reply.target_endpoint = peer->endpoint;
+              rdv::Message other;
+              other.command = rdv::Command::connect_requested;
+              other.id = *req.target_address;
+              other.source_endpoint = peer->endpoint;
+              other.target_address = req.id;
+              other.target_endpoint = source;
+              this->_reply(other, peer->endpoint, peer->binary);
+            }
           }
+          break;
+        case rdv::Command::connect_requested:
+        case rdv::Command::error:
+          ELLE_LOG("unexpected connect_requested");
+          break;
         }
-        break;
-      case rdv::Command::connect_requested:
-      case rdv::Command::error:
-        ELLE_LOG("unexpected connect_requested");
-        break;
+        this->_reply(reply, source, binary);
+      }
+      catch (elle::Error const& e)
+      {
+        ELLE_LOG("Exception handling packet: %s", e);
+        rdv::Message reply;
+        reply.id = req.id;
+        reply.command = rdv::Command::error;
+        reply.target_address = e.what();
+        this->_reply(reply, source, binary);
       }
-      elle::Buffer b = elle::serialization::json::serialize(reply, false);
-      send_with_magik(b, source);
     }
-    catch (elle::Error const& e)
+
+    /// Send the replies of the current batch.
+    void
+    _flush()
     {
-      ELLE_LOG("Exception handling packet: %s", e);
-      rdv::Message reply;
-      reply.id = req.id;
-      reply.command = rdv::Command::error;
-      reply.target_address = e.what();
-      elle::Buffer b = elle::serialization::json::serialize(reply, false);
-      send_with_magik(b, source);
+      auto sent = 0u;
+#ifdef ELLE_LINUX
+      auto const count = this->_replies.size();
+      auto headers = std::vector<mmsghdr>(count);
+      auto iovecs = std::vector<iovec>(count);
+      for (auto i = 0u; i < count; ++i)
+      {
+        auto& p = this->_replies[i];
+        iovecs[i] = {p.data.mutable_contents(), p.data.size()};
+        headers[i].msg_hdr = msghdr{};
+        headers[i].msg_hdr.msg_iov = &iovecs[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+        headers[i].msg_hdr.msg_name = p.endpoint.data();
+        headers[i].msg_hdr.msg_namelen = p.endpoint.size();
+      }
+      auto const res = ::sendmmsg(this->_socket.socket()->native_handle(),
+                                  headers.data(), count, MSG_DONTWAIT);
+      if (res > 0)
+        sent = res;
+#endif
+      // Whatever the kernel could not take right away goes through the
+      // reactor.
+      for (auto i = sent; i < this->_replies.size(); ++i)
+        try
+        {
+          auto const& p = this->_replies[i];
+          this->_socket.send_to(elle::ConstWeakBuffer(p.data), p.endpoint);
+        }
+        catch (Error const& e)
+        {
+          ELLE_DEBUG("send_to failed with %s", e);
+        }
+      this->_replies.clear();
     }
-  }
+
+    ELLE_ATTRIBUTE(UDPSocket, socket);
+    ELLE_ATTRIBUTE(Peers, peers);
+    ELLE_ATTRIBUTE(std::vector<Packet>, batch);
+    ELLE_ATTRIBUTE(std::vector<Packet>, replies);
+  };
+}
+
+static void run(int argc, char** argv)
+{
+  int port = 7890;
+  if (argc >1)
+    port = std::stoi(argv[1]);
+  auto const ttl =
+    std::chrono::seconds(elle::os::getenv("RDV_PEER_TTL", 120));
+  auto const max_peers = elle::os::getenv("RDV_MAX_PEERS", 1000000);
+  auto const batch = elle::os::getenv("RDV_BATCH", 64);
+  ELLE_LOG("listen on %s, peer TTL %s, at most %s peers",
+           port, ttl, max_peers);
+  RDVServer(port, batch, Peers(ttl, max_peers)).run();
 }
 
 int main(int argc, char** argv)
@@ -0,0 +1,118 @@
+#include <iostream>
+
+#include <elle/With.hh>
+
+#include <elle/reactor/network/Error.hh>
+#include <elle/reactor/network/shm-server.hh>
+#include <elle/reactor/network/shm-socket.hh>
+#include <elle/reactor/network/unix-domain-server.hh>
+#include <elle/reactor/network/unix-domain-socket.hh>
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/scheduler.hh>
+#include <elle/reactor/semaphore.hh>
+
+ELLE_LOG_COMPONENT("shm.bench");
+
+using namespace elle::reactor::network;
+
+/// Echo `messages` messages of `size` bytes over `socket`, with up to
+/// `window` of them in flight, and return the elapsed time in seconds.
+static double echo(Socket& socket, int messages, int size, int window)
+{
+  auto const payload = elle::Buffer(std::string(size, 'x'));
+  auto const start = elle::Clock::now();
+  elle::reactor::Semaphore slots(window);
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "reader",
+      [&]
+      {
+        auto reply = elle::Buffer(size);
+        for (int i = 0; i < messages; ++i)
+        {
+          socket.read(elle::WeakBuffer(reply));
+          slots.release();
+        }
+      });
+    for (int i = 0; i < messages; ++i)
+    {
+      while (!slots.acquire())
+        elle::reactor::wait(slots);
+      socket.write(payload);
+    }
+    elle::reactor::wait(scope);
+  };
+  return std::chrono::duration_cast<std::chrono::duration<double>>(
+    elle::Clock::now() - start).count();
+}
+
+template <typename Server, typename Client>
+static void bench(std::string const& name,
+                  int messages, int size, int window)
+{
+  Server server;
+  server.listen();
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "server",
+      [&]
+      {
+        auto socket = server.accept();
+        auto buffer = elle::Buffer(1 << 16);
+        try
+        {
+          while (true)
+          {
+            auto const read = socket->read_some(elle::WeakBuffer(buffer));
+            socket->write(elle::ConstWeakBuffer(buffer.contents(), read));
+          }
+        }
+        catch (ConnectionClosed const&)
+        {}
+      });
+    auto elapsed = 0.;
+    {
+      Client client(server.local_endpoint());
+      elapsed = echo(client, messages, size, window);
+    }
+    elle::reactor::wait(scope);
+    std::cout << elle::sprintf(
+      "%s, %s bytes, window %s: %.2f us per message, %.0f messages/s, "
+      "%.2f MB/s",
+      name, size, window, elapsed / messages * 1e6, messages / elapsed,
+      2. * messages * size / elapsed / 1e6) << std::endl;
+  };
+}
+
+/// Echo benchmark comparing ShmSocket with UnixDomainSocket: a client sends
+/// messages to an echo server and reads them back, one at a time to measure
+/// latency, then with a window of messages in flight to measure throughput.
+static void run(int argc, char** argv)
+{
+  if (argc > 1 && std::string(argv[1]) == "--help")
+  {
+    std::cerr << "usage: " << argv[0]
+              << " [messages] [size] [window]" << std::endl;
+    return;
+  }
+  auto const messages = argc > 1 ? std::stoi(argv[1]) : 100000;
+  auto const size = argc > 2 ? std::stoi(argv[2]) : 64;
+  auto const window = argc > 3 ? std::stoi(argv[3]) : 16;
+  for (auto w: {1, window})
+  {
+    bench<UnixDomainServer, UnixDomainSocket>("unix", messages, size, w);
+    bench<ShmServer, ShmSocket>("shm", messages, size, w);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  elle::reactor::Scheduler sched;
+  elle::reactor::Thread t(sched, "main", [&]
+    {
+      run(argc, argv);
+    });
+  sched.run();
+}
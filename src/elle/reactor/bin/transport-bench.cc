@@ -0,0 +1,641 @@
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+#include <boost/algorithm/string/split.hpp>
+
+#include <elle/With.hh>
+#include <elle/json/json.hh>
+
+#include <elle/reactor/network/Error.hh>
+#include <elle/reactor/network/ssl-server.hh>
+#include <elle/reactor/network/ssl-socket.hh>
+#include <elle/reactor/network/TCPServer.hh>
+#include <elle/reactor/network/TCPSocket.hh>
+#include <elle/reactor/network/udp-socket.hh>
+#include <elle/reactor/network/utp-server.hh>
+#include <elle/reactor/network/utp-socket.hh>
+#ifdef REACTOR_NETWORK_UNIX_DOMAIN_SOCKET
+# include <elle/reactor/network/unix-domain-server.hh>
+# include <elle/reactor/network/unix-domain-socket.hh>
+# ifdef ELLE_LINUX
+#  include <elle/reactor/network/shm-server.hh>
+#  include <elle/reactor/network/shm-socket.hh>
+# endif
+#endif
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/scheduler.hh>
+#include <elle/reactor/semaphore.hh>
+
+ELLE_LOG_COMPONENT("transport.bench");
+
+using namespace std::literals;
+using namespace elle::reactor::network;
+
+/*--------.
+| Streams |
+`--------*/
+
+/// The common ground of the benchmarked transports.
+class Stream
+{
+public:
+  virtual
+  ~Stream() = default;
+  virtual
+  void
+  write(elle::ConstWeakBuffer buffer) = 0;
+  virtual
+  Size
+  read_some(elle::WeakBuffer buffer) = 0;
+  /// Fill \a buffer.
+  void
+  read(elle::WeakBuffer buffer)
+  {
+    for (auto offset = Size(0); offset < buffer.size();)
+      offset += this->read_some(buffer.range(offset));
+  }
+};
+
+template <typename S>
+class SocketStream
+  : public Stream
+{
+public:
+  SocketStream(std::unique_ptr<S> socket)
+    : _socket(std::move(socket))
+  {}
+
+  void
+  write(elle::ConstWeakBuffer buffer) override
+  {
+    this->_socket->write(buffer);
+  }
+
+  Size
+  read_some(elle::WeakBuffer buffer) override
+  {
+    return this->_socket->read_some(buffer);
+  }
+
+private:
+  std::unique_ptr<S> _socket;
+};
+
+template <typename S>
+std::unique_ptr<Stream>
+stream(std::unique_ptr<S> socket)
+{
+  return std::make_unique<SocketStream<S>>(std::move(socket));
+}
+
+class UTPStream
+  : public Stream
+{
+public:
+  UTPStream(std::unique_ptr<UTPSocket> socket,
+            std::shared_ptr<UTPServer> server = nullptr)
+    : _server(std::move(server))
+    , _socket(std::move(socket))
+  {}
+
+  void
+  write(elle::ConstWeakBuffer buffer) override
+  {
+    this->_socket->write(buffer);
+  }
+
+  Size
+  read_some(elle::WeakBuffer buffer) override
+  {
+    auto const data = this->_socket->read_some(buffer.size());
+    std::copy(data.begin(), data.end(), buffer.mutable_contents());
+    return data.size();
+  }
+
+private:
+  /// The server client sockets are bound to.
+  std::shared_ptr<UTPServer> _server;
+  std::unique_ptr<UTPSocket> _socket;
+};
+
+/// Datagrams to a fixed peer. Losses surface as TimeOut.
+class UDPStream
+  : public Stream
+{
+public:
+  UDPStream(UDPSocket::EndPoint peer)
+    : _socket()
+    , _peer(std::move(peer))
+  {
+    this->_socket.close();
+    this->_socket.bind(UDPSocket::EndPoint(this->_peer.address(), 0));
+  }
+
+  void
+  write(elle::ConstWeakBuffer buffer) override
+  {
+    this->_socket.send_to(buffer, this->_peer);
+  }
+
+  Size
+  read_some(elle::WeakBuffer buffer) override
+  {
+    auto source = UDPSocket::EndPoint();
+    return this->_socket.receive_from(buffer, source, 1s);
+  }
+
+private:
+  UDPSocket _socket;
+  UDPSocket::EndPoint _peer;
+};
+
+/*-----------.
+| Transports |
+`-----------*/
+
+/// A transport to benchmark: connect to a local echo server.
+struct Transport
+{
+  std::string name;
+  /// Serve echo connections until terminated.
+  std::function<void (elle::reactor::Scope&)> serve;
+  std::function<std::unique_ptr<Stream> ()> connect;
+  /// Whether the transport is connection oriented and reliable.
+  bool connected;
+};
+
+static
+void
+echo(Stream& stream)
+{
+  auto buffer = elle::Buffer(1 << 16);
+  try
+  {
+    while (true)
+    {
+      auto const read = stream.read_some(elle::WeakBuffer(buffer));
+      stream.write(elle::ConstWeakBuffer(buffer.contents(), read));
+    }
+  }
+  catch (Error const& e)
+  {
+    ELLE_DEBUG("echo connection ended: %s", e);
+  }
+}
+
+/// Accept connections on \a server and echo them.
+template <typename Server>
+static
+std::function<void (elle::reactor::Scope&)>
+serve(std::shared_ptr<Server> server,
+      std::function<std::unique_ptr<Stream> (Server&)> accept)
+{
+  return [server, accept] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "accept",
+      [server, accept, &scope]
+      {
+        while (true)
+        {
+          auto s = std::shared_ptr<Stream>(accept(*server));
+          scope.run_background("echo", [s] { echo(*s); });
+        }
+      });
+  };
+}
+
+template <typename Server>
+static
+std::function<void (elle::reactor::Scope&)>
+serve(std::shared_ptr<Server> server)
+{
+  return serve<Server>(
+    server,
+    [] (Server& server)
+    {
+      return stream(server.accept());
+    });
+}
+
+struct Options
+{
+  std::vector<std::string> transports;
+  std::vector<int> sizes;
+  int round_trips;
+  std::chrono::seconds duration;
+  int window;
+  int connections;
+  std::string certificate;
+  std::string key;
+  std::string dh;
+};
+
+static
+std::vector<Transport>
+transports(Options const& options)
+{
+  auto const localhost = boost::asio::ip::address::from_string("127.0.0.1");
+  auto res = std::vector<Transport>{};
+  for (auto const& name: options.transports)
+    if (name == "tcp")
+    {
+      auto server = std::make_shared<TCPServer>();
+      server->listen(TCPServer::EndPoint(localhost, 0));
+      res.push_back(Transport{
+          name, serve(server),
+          [server]
+          {
+            return stream(std::make_unique<TCPSocket>(
+                            "127.0.0.1", server->port()));
+          },
+          true});
+    }
+    else if (name == "ssl")
+    {
+      if (options.certificate.empty())
+      {
+        std::cerr << "skip ssl: no --certificate, --key and --dh given"
+                  << std::endl;
+        continue;
+      }
+      auto server = std::make_shared<SSLServer>(
+        std::make_unique<SSLCertificate>(
+          options.certificate, options.key, options.dh));
+      server->listen(SSLServer::EndPoint(localhost, 0));
+      res.push_back(Transport{
+          name, serve(server),
+          [server]
+          {
+            return stream(std::make_unique<SSLSocket>(
+                            "127.0.0.1", std::to_string(server->port())));
+          },
+          true});
+    }
+    else if (name == "utp")
+    {
+      auto server = std::make_shared<UTPServer>();
+      server->listen(localhost, 0);
+      // Client sockets need a server of their own to be bound to.
+      auto client = std::make_shared<UTPServer>();
+      client->listen(localhost, 0);
+      res.push_back(Transport{
+          name,
+          serve<UTPServer>(
+            server,
+            [] (UTPServer& server) -> std::unique_ptr<Stream>
+            {
+              return std::make_unique<UTPStream>(server.accept());
+            }),
+          [server, client] () -> std::unique_ptr<Stream>
+          {
+            return std::make_unique<UTPStream>(
+              std::make_unique<UTPSocket>(
+                *client, "127.0.0.1", server->local_endpoint().port()),
+              client);
+          },
+          true});
+    }
+    else if (name == "udp")
+    {
+      auto server = std::make_shared<UDPSocket>();
+      server->close();
+      server->bind(UDPSocket::EndPoint(localhost, 0));
+      res.push_back(Transport{
+          name,
+          [server] (elle::reactor::Scope& scope)
+          {
+            scope.run_background(
+              "echo",
+              [server]
+              {
+                auto buffer = elle::Buffer(1 << 16);
+                while (true)
+                {
+                  auto peer = UDPSocket::EndPoint();
+                  auto const read =
+                    server->receive_from(elle::WeakBuffer(buffer), peer);
+                  server->send_to(
+                    elle::ConstWeakBuffer(buffer.contents(), read), peer);
+                }
+              });
+          },
+          [server] () -> std::unique_ptr<Stream>
+          {
+            return std::make_unique<UDPStream>(server->local_endpoint());
+          },
+          false});
+    }
+#ifdef REACTOR_NETWORK_UNIX_DOMAIN_SOCKET
+    else if (name == "unix")
+    {
+      auto server = std::make_shared<UnixDomainServer>();
+      server->listen();
+      res.push_back(Transport{
+          name, serve(server),
+          [server]
+          {
+            return stream(std::make_unique<UnixDomainSocket>(
+                            server->local_endpoint()));
+          },
+          true});
+    }
+# ifdef ELLE_LINUX
+    else if (name == "shm")
+    {
+      auto server = std::make_shared<ShmServer>();
+      server->listen();
+      res.push_back(Transport{
+          name, serve(server),
+          [server]
+          {
+            return stream(std::make_unique<ShmSocket>(
+                            server->local_endpoint()));
+          },
+          true});
+    }
+# endif
+#endif
+    else
+      std::cerr << "skip unknown transport: " << name << std::endl;
+  return res;
+}
+
+/*-------------.
+| Measurements |
+`-------------*/
+
+static
+double
+seconds(elle::Duration d)
+{
+  return std::chrono::duration_cast<std::chrono::duration<double>>(d).count();
+}
+
+/// Round trip time percentiles, in microseconds.
+static
+elle::json::OrderedObject
+latency(Transport const& transport, int size, int round_trips)
+{
+  auto s = transport.connect();
+  auto const payload = elle::Buffer(std::string(size, 'x'));
+  auto reply = elle::Buffer(size);
+  auto samples = std::vector<double>{};
+  samples.reserve(round_trips);
+  for (int i = -std::min(round_trips / 10, 100); i < round_trips; ++i)
+  {
+    auto const start = elle::Clock::now();
+    s->write(payload);
+    s->read(elle::WeakBuffer(reply));
+    // Negative rounds warm up.
+    if (i >= 0)
+      samples.push_back(seconds(elle::Clock::now() - start) * 1e6);
+  }
+  std::sort(samples.begin(), samples.end());
+  auto const percentile = [&] (double p)
+    {
+      return samples[std::min<std::size_t>(samples.size() * p,
+                                           samples.size() - 1)];
+    };
+  auto res = elle::json::OrderedObject{};
+  res["mean"] =
+    std::accumulate(samples.begin(), samples.end(), 0.) / samples.size();
+  res["p50"] = percentile(0.5);
+  res["p90"] = percentile(0.9);
+  res["p99"] = percentile(0.99);
+  res["p999"] = percentile(0.999);
+  res["max"] = samples.back();
+  return res;
+}
+
+/// Echo as many messages as possible, with up to \a window in flight.
+static
+elle::json::OrderedObject
+throughput(Transport const& transport,
+           int size,
+           std::chrono::seconds duration,
+           int window)
+{
+  auto s = transport.connect();
+  auto const payload = elle::Buffer(std::string(size, 'x'));
+  auto messages = int64_t(0);
+  auto lost = int64_t(0);
+  auto const start = elle::Clock::now();
+  elle::reactor::Semaphore slots(window);
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "reader",
+      [&]
+      {
+        auto reply = elle::Buffer(size);
+        while (true)
+        {
+          try
+          {
+            s->read(elle::WeakBuffer(reply));
+            ++messages;
+          }
+          catch (TimeOut const&)
+          {
+            ++lost;
+          }
+          slots.release();
+        }
+      });
+    while (elle::Clock::now() - start < duration)
+    {
+      while (!slots.acquire())
+        elle::reactor::wait(slots);
+      s->write(payload);
+    }
+    // Wait for the messages in flight.
+    for (int i = 0; i < window; ++i)
+      while (!slots.acquire())
+        elle::reactor::wait(slots);
+    scope.terminate_now();
+  };
+  auto const elapsed = seconds(elle::Clock::now() - start);
+  auto res = elle::json::OrderedObject{};
+  res["messages_per_second"] = messages / elapsed;
+  res["megabytes_per_second"] = 2. * messages * size / elapsed / 1e6;
+  res["window"] = window;
+  if (lost)
+    res["lost"] = lost;
+  return res;
+}
+
+/// Connect, echo a byte and disconnect from \a connections clients at once.
+static
+double
+connections_per_second(Transport const& transport,
+                       std::chrono::seconds duration,
+                       int connections)
+{
+  auto done = int64_t(0);
+  auto failed = int64_t(0);
+  auto const start = elle::Clock::now();
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    for (int c = 0; c < connections; ++c)
+      scope.run_background(
+        elle::sprintf("client %s", c),
+        [&]
+        {
+          char byte = 'x';
+          while (elle::Clock::now() - start < duration)
+            try
+            {
+              auto s = transport.connect();
+              s->write(elle::ConstWeakBuffer(&byte, 1));
+              s->read(elle::WeakBuffer(&byte, 1));
+              ++done;
+            }
+            catch (Error const& e)
+            {
+              ELLE_TRACE("connection failed: %s", e);
+              ++failed;
+            }
+        });
+    elle::reactor::wait(scope);
+  };
+  if (failed)
+    std::cerr << elle::sprintf("%s: %s failed connections",
+                               transport.name, failed) << std::endl;
+  return done / seconds(elle::Clock::now() - start);
+}
+
+/*-----.
+| Main |
+`-----*/
+
+static
+elle::json::OrderedObject
+bench(Transport const& transport, Options const& options)
+{
+  auto res = elle::json::OrderedObject{};
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    transport.serve(scope);
+    auto latencies = elle::json::OrderedObject{};
+    auto throughputs = elle::json::OrderedObject{};
+    for (auto size: options.sizes)
+    {
+      // Datagrams beyond that do not fit in a single UDP packet.
+      if (!transport.connected && size > 65000)
+        continue;
+      std::cerr << elle::sprintf("%s: %s bytes", transport.name, size)
+                << std::endl;
+      latencies[std::to_string(size)] =
+        latency(transport, size, options.round_trips);
+      throughputs[std::to_string(size)] = throughput(
+        transport, size, options.duration,
+        transport.connected ? options.window : 1);
+    }
+    res["latency_us"] = latencies;
+    res["throughput"] = throughputs;
+    if (transport.connected)
+      res["connections_per_second"] = connections_per_second(
+        transport, options.duration, options.connections);
+    scope.terminate_now();
+  };
+  return res;
+}
+
+static
+std::vector<std::string>
+split(std::string const& list)
+{
+  auto res = std::vector<std::string>{};
+  boost::algorithm::split(res, list, [] (char c) { return c == ','; });
+  return res;
+}
+
+/// Benchmark of reactor::network transports over loopback: echo round trip
+/// latency percentiles and throughput for every message size, and the rate
+/// of connect-echo-disconnect cycles. Results are printed as JSON.
+static
+void
+run(int argc, char** argv)
+{
+  auto options = Options{
+    {"tcp", "ssl", "unix", "shm", "utp", "udp"},
+    {64, 4096, 65536, 1 << 20},
+    10000,
+    3s,
+    16,
+    16,
+  };
+  for (int i = 1; i < argc; i += 2)
+  {
+    auto const arg = std::string(argv[i]);
+    if (arg == "--help" || i + 1 >= argc)
+    {
+      std::cerr
+        << "usage: " << argv[0]
+        << " [--transports tcp,ssl,unix,shm,utp,udp] [--sizes 64,4096,...]"
+        << " [--round-trips N] [--seconds N] [--window N]"
+        << " [--connections N]"
+        << " [--certificate PEM --key PEM --dh PEM]" << std::endl;
+      return;
+    }
+    auto const value = std::string(argv[i + 1]);
+    if (arg == "--transports")
+      options.transports = split(value);
+    else if (arg == "--sizes")
+    {
+      options.sizes.clear();
+      for (auto const& size: split(value))
+        options.sizes.push_back(std::stoi(size));
+    }
+    else if (arg == "--round-trips")
+      options.round_trips = std::stoi(value);
+    else if (arg == "--seconds")
+      options.duration = std::chrono::seconds(std::stoi(value));
+    else if (arg == "--window")
+      options.window = std::stoi(value);
+    else if (arg == "--connections")
+      options.connections = std::stoi(value);
+    else if (arg == "--certificate")
+      options.certificate = value;
+    else if (arg == "--key")
+      options.key = value;
+    else if (arg == "--dh")
+      options.dh = value;
+    else
+      elle::err("unknown option: %s", arg);
+  }
+  auto results = elle::json::OrderedObject{};
+  for (auto const& transport: transports(options))
+    try
+    {
+      results[transport.name] = bench(transport, options);
+    }
+    catch (elle::Error const& e)
+    {
+      std::cerr << elle::sprintf("%s: %s", transport.name, e) << std::endl;
+      auto failure = elle::json::OrderedObject{};
+      failure["error"] = std::string(e.what());
+      results[transport.name] = failure;
+    }
+  auto sizes = elle::json::Array{};
+  for (auto size: options.sizes)
+    sizes.emplace_back(size);
+  auto output = elle::json::OrderedObject{};
+  output["round_trips"] = options.round_trips;
+  output["seconds"] = int(options.duration.count());
+  output["sizes"] = sizes;
+  output["transports"] = results;
+  elle::json::write(std::cout, output, true, true);
+}
+
+int main(int argc, char** argv)
+{
+  elle::reactor::Scheduler sched;
+  elle::reactor::Thread t(sched, "main", [&]
+    {
+      run(argc, argv);
+    });
+  sched.run();
+}
@@ -32,5 +32,10 @@ namespace elle
     {
       class FileSystem;
     }
+
+    namespace network
+    {
+      class Resolver;
+    }
   }
 }
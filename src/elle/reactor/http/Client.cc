@@ -35,6 +35,9 @@ namespace elle
             throw std::bad_alloc();
           curl_share_setopt(this->_share.get(),
                             CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
+          // Requests use this share instead of the Service's one, keep the
+          // same caches.
+          Service::share(this->_share.get());
         }
 
         ~Impl()
@@ -1,10 +1,15 @@
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <curl/curl.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/find_iterator.hpp>
 
 #include <elle/Exception.hh>
+#include <elle/err.hh>
 #include <elle/log.hh>
+#include <elle/os/environ.hh>
 #include <elle/print.hh>
 #include <elle/reactor/http/RequestImpl.hh>
 #include <elle/reactor/http/Service.hh>
@@ -90,16 +95,28 @@ namespace elle
         , _input()
         , _input_current()
         , _input_available("input available")
+        , _input_size(0)
+        , _input_max(
+          elle::os::getenv("ELLE_REACTOR_HTTP_INPUT_BUFFER", 4 << 20))
+        , _input_paused(false)
+        , _sink()
+        , _sink_error()
         , _output_done(false)
         , _output(0)
         , _output_available(false)
         , _output_offset(0)
+        , _sourced(false)
+        , _source()
+        , _source_index(0)
+        , _source_offset(0)
+        , _source_fd(-1)
+        , _source_left(0)
         , _curl(boost::asio::use_service<Service>(
                   reactor::scheduler().io_service()))
         , _url(url)
         , _method(method)
         , _query_string()
-        , _handle(curl_easy_init())
+        , _handle(this->_curl._acquire())
         , _pause_count(0)
         , _debug(0)
         , _debug2(0)
@@ -117,11 +134,31 @@ namespace elle
         memset(&this->_error[0], 0, CURL_ERROR_SIZE);
         setopt(this->_handle, CURLOPT_ERRORBUFFER, this->_error);
         // Set version.
-        auto version = this->_conf.version() == Version::v11
-          ? CURL_HTTP_VERSION_1_1 : CURL_HTTP_VERSION_1_0;
+        auto version = [&] () -> long
+          {
+            switch (this->_conf.version())
+            {
+              case Version::v10:
+                return CURL_HTTP_VERSION_1_0;
+              case Version::v11:
+                return CURL_HTTP_VERSION_1_1;
+              case Version::v20:
+                // HTTP/2 where ALPN negotiates it, HTTP/1.1 otherwise.
+#if LIBCURL_VERSION_NUM >= 0x072f00
+                return CURL_HTTP_VERSION_2TLS;
+#else
+                return CURL_HTTP_VERSION_2_0;
+#endif
+            }
+            elle::unreachable();
+          }();
         setopt(this->_handle, CURLOPT_HTTP_VERSION, version);
-        // Set IPv4 only.
-        setopt(this->_handle, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
+        // Rather wait for a connection to the origin to be established and
+        // multiplex over it than open a new one.
+        if (this->_conf.version() == Version::v20)
+          setopt(this->_handle, CURLOPT_PIPEWAIT, 1L);
+        // Resolve both IPv4 and IPv6, and race connections to them.
+        setopt(this->_handle, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_WHATEVER);
         // Set proxy.
         using ProxyType = reactor::network::ProxyType;
         if (this->_conf.proxy()
@@ -236,7 +273,7 @@ namespace elle
         if (this->_curl._requests.find(this->_handle) !=
             this->_curl._requests.end())
           this->_curl.remove(*this->_request);
-        curl_easy_cleanup(this->_handle);
+        this->_curl._release(this->_handle);
       }
 
       std::unordered_map<std::string, std::string>
@@ -449,6 +486,13 @@ namespace elle
                            *this->_request, this->_input_current);
           ELLE_DUMP("%s", this->_input_current);
           this->_input.pop();
+          this->_input_size -= this->_input_current.size();
+          if (this->_input_paused && this->_input_size < this->_input_max / 2)
+          {
+            ELLE_DEBUG("%s: input: resume", *this->_request);
+            this->_input_paused = false;
+            curl_easy_pause(this->_handle, CURLPAUSE_CONT);
+          }
           if (this->_input.empty() && !this->_input_done)
             this->_input_available.close();
           return this->_input_current;
@@ -468,6 +512,33 @@ namespace elle
       {
         auto& self = *reinterpret_cast<Request::Impl*>(userdata);
         auto size = chunk * count;
+        if (self._sink)
+        {
+          try
+          {
+            if (!self._sink(elle::ConstWeakBuffer(ptr, size)))
+            {
+              ELLE_DEBUG("%s: input: sink is full, pause", *self._request);
+              self._input_paused = true;
+              return CURL_WRITEFUNC_PAUSE;
+            }
+          }
+          catch (...)
+          {
+            // Do not unwind through curl, abort the transfer instead.
+            self._sink_error = std::current_exception();
+            return 0;
+          }
+          return size;
+        }
+        // Bound what the input stream buffers: wait for it to be read.
+        if (self._input_size >= self._input_max)
+        {
+          ELLE_DEBUG("%s: input: %s bytes queued, pause",
+                     *self._request, self._input_size);
+          self._input_paused = true;
+          return CURL_WRITEFUNC_PAUSE;
+        }
         self.enqueue_data(elle::Buffer(ptr, size));
         return size;
       }
@@ -476,6 +547,7 @@ namespace elle
       Request::Impl::enqueue_data(elle::Buffer buffer)
       {
         ELLE_DEBUG_SCOPE("%s: input: got data: %f", *this->_request, buffer);
+        this->_input_size += buffer.size();
         this->_input.push(std::move(buffer));
         this->_input_available.open();
       }
@@ -504,6 +576,8 @@ namespace elle
       size_t
       Request::Impl::read_data(elle::WeakBuffer buffer)
       {
+        if (this->_sourced)
+          return this->read_source(buffer);
         if (this->_conf.chunked_transfers())
         {
           ELLE_ASSERT_GTE(buffer.size(), this->_output.size());
@@ -546,6 +620,50 @@ namespace elle
         }
       }
 
+      size_t
+      Request::Impl::read_source(elle::WeakBuffer buffer)
+      {
+        if (this->_source_fd != -1)
+        {
+          auto const size = static_cast<size_t>(
+            std::min<int64_t>(buffer.size(), this->_source_left));
+          if (size == 0)
+            return 0;
+          auto const res =
+            ::read(this->_source_fd, buffer.mutable_contents(), size);
+          if (res <= 0)
+          {
+            ELLE_WARN("%s: output: unable to read body: %s",
+                      *this->_request,
+                      res ? strerror(errno) : "unexpected end of file");
+            return CURL_READFUNC_ABORT;
+          }
+          this->_source_left -= res;
+          ELLE_DEBUG("%s: output: get %s bytes from file",
+                     *this->_request, res);
+          return res;
+        }
+        auto effective = size_t(0);
+        while (effective < buffer.size() &&
+               this->_source_index < this->_source.size())
+        {
+          auto const& source = this->_source[this->_source_index];
+          auto const size = std::min(buffer.size() - effective,
+                                     source.size() - this->_source_offset);
+          memcpy(buffer.mutable_contents() + effective,
+                 source.contents() + this->_source_offset, size);
+          effective += size;
+          this->_source_offset += size;
+          if (this->_source_offset == source.size())
+          {
+            ++this->_source_index;
+            this->_source_offset = 0;
+          }
+        }
+        ELLE_DEBUG("%s: output: get %s bytes", *this->_request, effective);
+        return effective;
+      }
+
       /*---------.
       | Progress |
       `---------*/
@@ -708,6 +826,70 @@ namespace elle
         }
       }
 
+      /*-----.
+      | Body |
+      `-----*/
+
+      void
+      Request::body_sink(Sink sink)
+      {
+        this->_impl->_sink = std::move(sink);
+      }
+
+      void
+      Request::resume()
+      {
+        if (this->_impl->_input_paused)
+        {
+          ELLE_DEBUG("%s: input: resume", *this);
+          this->_impl->_input_paused = false;
+          curl_easy_pause(this->_impl->_handle, CURLPAUSE_CONT);
+        }
+      }
+
+      void
+      Request::body_source(std::vector<elle::ConstWeakBuffer> buffers)
+      {
+        auto size = int64_t(0);
+        for (auto const& b: buffers)
+          size += b.size();
+        this->_impl->_source = std::move(buffers);
+        this->_body_source(size);
+      }
+
+      void
+      Request::body_source(int fd, boost::optional<int64_t> size)
+      {
+        if (!size)
+        {
+          struct stat st;
+          if (::fstat(fd, &st) || !S_ISREG(st.st_mode))
+            elle::err("%s: unable to determine the size of the body", *this);
+          auto const offset = ::lseek(fd, 0, SEEK_CUR);
+          size = st.st_size - std::max<int64_t>(offset, 0);
+        }
+        this->_impl->_source_fd = fd;
+        this->_impl->_source_left = *size;
+        this->_body_source(*size);
+      }
+
+      void
+      Request::_body_source(int64_t size)
+      {
+        ELLE_ASSERT(!this->_impl->_output_done);
+        ELLE_TRACE_SCOPE("%s: output: send %s bytes from source", *this, size);
+        this->_impl->_sourced = true;
+        this->_impl->_output_done = true;
+        if (this->_impl->_conf.chunked_transfers())
+          // Already started, in wait for data.
+          curl_easy_pause(this->_impl->_handle, CURLPAUSE_CONT);
+        else
+        {
+          this->_impl->header_add("Content-Length", std::to_string(size));
+          this->_impl->start();
+        }
+      }
+
       void
       Request::_complete(int code)
       {
@@ -739,7 +921,12 @@ namespace elle
               this->_raise<RequestError>(this->_url, msg);
           };
         bool exception = false;
-        if (code != CURLE_OK)
+        if (this->_impl->_sink_error)
+        {
+          exception = true;
+          this->_raise(this->_impl->_sink_error);
+        }
+        else if (code != CURLE_OK)
         {
           exception = true;
           auto const msg
@@ -770,7 +957,10 @@ namespace elle
         if (exception)
         {
           this->_impl->_debug2 = 3;
-          set_exception();
+          if (this->_impl->_sink_error)
+            this->_raise(this->_impl->_sink_error);
+          else
+            set_exception();
         }
         this->_impl->_complete();
       }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/signals2.hpp>
 
@@ -245,6 +247,50 @@ namespace elle
         bool
         _wait(Thread* thread, Waker const& waker) override;
 
+      /*------.
+      | Body |
+      `------*/
+      public:
+        /// Consumer of the response body.
+        ///
+        /// Returning false pauses the transfer: the same chunk is handed over
+        /// again once resume() is called.
+        using Sink = std::function<bool (elle::ConstWeakBuffer)>;
+        /// Hand the response body to \a sink as it is received, instead of
+        /// queuing it for the input stream.
+        ///
+        /// Chunks point into curl's receive buffer: they are only valid
+        /// during the call, which must not yield. Set the sink before the
+        /// response starts arriving, e.g. right after construction.
+        ///
+        /// @param sink The body consumer.
+        void
+        body_sink(Sink sink);
+        /// Resume a transfer paused by the body sink.
+        void
+        resume();
+        /// Send \a buffers as the body and finalize() the request.
+        ///
+        /// The buffers are copied straight into curl's send buffer, they must
+        /// stay valid until the request completes.
+        ///
+        /// @param buffers The body, in order.
+        void
+        body_source(std::vector<elle::ConstWeakBuffer> buffers);
+        /// Send the content of \a fd as the body and finalize() the request.
+        ///
+        /// The file is read straight into curl's send buffer, from its current
+        /// offset. It must stay open until the request completes.
+        ///
+        /// @param fd   The file to send.
+        /// @param size How many bytes to send, by default the rest of the
+        ///             file.
+        void
+        body_source(int fd, boost::optional<int64_t> size = boost::none);
+      private:
+        void
+        _body_source(int64_t size);
+
       /*-------.
       | Status |
       `-------*/
@@ -85,6 +85,17 @@ namespace elle
         std::queue<elle::Buffer> _input;
         elle::Buffer _input_current;
         reactor::Barrier _input_available;
+        /// Size of the data queued in _input.
+        std::size_t _input_size;
+        /// Size of queued data above which the download is paused until the
+        /// input stream is read.
+        std::size_t _input_max;
+        /// Whether the download is paused because of a full queue or the
+        /// body sink.
+        bool _input_paused;
+        Sink _sink;
+        /// Exception thrown by the body sink, to be rethrown upon waiting.
+        std::exception_ptr _sink_error;
         bool _output_done;
         elle::Buffer _output;
         bool _output_available;
@@ -115,6 +126,16 @@ namespace elle
         read_data(elle::WeakBuffer buffer);
         /// XXX: For HTTP 1.0 servers. See comment in Request constructor.
         std::unique_ptr<std::stringstream> _input_buffer;
+        /// Send the body from the source buffers or file.
+        size_t
+        read_source(elle::WeakBuffer buffer);
+        /// Whether the body comes from body_source.
+        bool _sourced;
+        std::vector<elle::ConstWeakBuffer> _source;
+        std::size_t _source_index;
+        std::size_t _source_offset;
+        int _source_fd;
+        int64_t _source_left;
 
       /*---------.
       | Progress |
@@ -3,6 +3,7 @@
 #include <elle/Exception.hh>
 #include <elle/assert.hh>
 #include <elle/log.hh>
+#include <elle/os/environ.hh>
 #include <elle/reactor/duration.hh>
 #include <elle/reactor/http/RequestImpl.hh>
 #include <elle/reactor/http/Service.hh>
@@ -62,6 +63,10 @@ namespace elle
       Service::Service(boost::asio::io_service& service)
         : boost::asio::io_service::service(service)
         , _curl(nullptr)
+        , _share(nullptr)
+        , _max_streams(elle::os::getenv("ELLE_REACTOR_HTTP_MAX_STREAMS", 100))
+        , _handles()
+        , _handles_max(elle::os::getenv("ELLE_REACTOR_HTTP_HANDLES", 16))
         , _requests()
         , _timer(service)
       {
@@ -77,8 +82,14 @@ namespace elle
                           &socket_callback);
         curl_multi_setopt(this->_curl,
                           CURLMOPT_TIMERFUNCTION, &Service::timeout_callback);
-        // Pipelining causes issues with S3, requests end up being stuck.
-        // curl_multi_setopt(this->_curl, CURLMOPT_PIPELINING, 1L);
+        // HTTP/1.1 pipelining causes issues with S3, requests end up being
+        // stuck. Only multiplex HTTP/2 connections, which requests opt in to.
+        curl_multi_setopt(this->_curl, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        this->max_streams(this->_max_streams);
+        this->_share = curl_share_init();
+        if (!this->_share)
+          throw std::bad_alloc();
+        Service::share(this->_share);
       }
 
       Service::~Service()
@@ -90,8 +101,83 @@ namespace elle
       void
       Service::shutdown_service()
       {
+        for (auto handle: this->_handles)
+          curl_easy_cleanup(handle);
+        this->_handles.clear();
         auto res = curl_multi_cleanup(this->_curl);
         assert(res == CURLM_OK);
+        auto share_res = curl_share_cleanup(this->_share);
+        if (share_res != CURLSHE_OK)
+          ELLE_WARN("%s: unable to release shared caches: %s",
+                    *this, curl_share_strerror(share_res));
+      }
+
+      /*-------.
+      | HTTP/2 |
+      `-------*/
+
+      int
+      Service::max_streams() const
+      {
+        return this->_max_streams;
+      }
+
+      void
+      Service::max_streams(int streams)
+      {
+        this->_max_streams = streams;
+#if LIBCURL_VERSION_NUM >= 0x074300
+        curl_multi_setopt(this->_curl, CURLMOPT_MAX_CONCURRENT_STREAMS,
+                          static_cast<long>(streams));
+#endif
+      }
+
+      /*--------.
+      | Handles |
+      `--------*/
+
+      void
+      Service::share(CURLSH* share)
+      {
+        // Everything runs in the scheduler thread: no locking required.
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+        curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+      }
+
+      CURL*
+      Service::_acquire()
+      {
+        if (!this->_handles.empty())
+        {
+          auto handle = this->_handles.back();
+          this->_handles.pop_back();
+          ELLE_DEBUG("%s: reuse handle %s", *this, handle);
+          return handle;
+        }
+        auto handle = curl_easy_init();
+        if (handle)
+          curl_easy_setopt(handle, CURLOPT_SHARE, this->_share);
+        return handle;
+      }
+
+      void
+      Service::_release(CURL* handle)
+      {
+        if (static_cast<int>(this->_handles.size()) >= this->_handles_max)
+        {
+          curl_easy_cleanup(handle);
+          return;
+        }
+        // Detach from a Client's share, if any, before dropping private
+        // cookies so the Client's jar is left alone. Resetting keeps the
+        // share.
+        curl_easy_setopt(handle, CURLOPT_SHARE, this->_share);
+        curl_easy_setopt(handle, CURLOPT_COOKIELIST, "ALL");
+        curl_easy_reset(handle);
+        this->_handles.push_back(handle);
       }
 
       /*--------.
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <unordered_map>
+#include <vector>
 
 #include <elle/reactor/asio.hh>
 
@@ -28,6 +29,42 @@ namespace elle
         friend class Client;
         friend class Request::Impl;
         CURLM* _curl;
+        /// DNS cache, TLS sessions and connections shared by requests.
+        CURLSH* _share;
+
+      /*-------.
+      | HTTP/2 |
+      `-------*/
+      public:
+        /// Maximum number of concurrent HTTP/2 streams over a connection.
+        int
+        max_streams() const;
+        /// Set the maximum number of concurrent HTTP/2 streams over a
+        /// connection. Requests beyond it open another connection.
+        void
+        max_streams(int streams);
+      private:
+        int _max_streams;
+
+      /*--------.
+      | Handles |
+      `--------*/
+      public:
+        /// Share DNS cache, TLS sessions and connections through \a share.
+        static
+        void
+        share(CURLSH* share);
+      private:
+        /// Get an easy handle, recycled if possible.
+        CURL*
+        _acquire();
+        /// Give back an easy handle once its request is over.
+        void
+        _release(CURL* handle);
+        /// Easy handles ready to be reused.
+        std::vector<CURL*> _handles;
+        /// Maximum number of idle easy handles kept.
+        int _handles_max;
 
       /*---------.
       | Requests |
@@ -77,6 +77,7 @@ namespace elle
           res->socket()->lowest_layer().set_option(
             boost::asio::ip::tcp::no_delay(true));
         }
+        this->_instrument(*res);
         ELLE_TRACE("%s: got connection: %s", *this, *res);
         return res;
       }
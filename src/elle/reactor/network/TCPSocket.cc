@@ -1,18 +1,88 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/optional.hpp>
 
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+
 #include <elle/reactor/network/Error.hh>
 #include <elle/reactor/network/resolve.hh>
 #include <elle/reactor/network/TCPSocket.hh>
+#include <elle/reactor/Scope.hh>
 #include <elle/reactor/scheduler.hh>
+#include <elle/reactor/signal.hh>
 #include <elle/reactor/Thread.hh>
 
+ELLE_LOG_COMPONENT("elle.reactor.network.TCPSocket");
+
 namespace elle
 {
   namespace reactor
   {
     namespace network
     {
+      namespace
+      {
+        /// Delay before trying the next address while an attempt is pending,
+        /// the Connection Attempt Delay of RFC 8305.
+        auto const attempt_delay = std::chrono::milliseconds(
+          elle::os::getenv("ELLE_REACTOR_CONNECTION_ATTEMPT_DELAY", 250));
+
+        /// Connect to the first address of \a hostname that accepts.
+        ///
+        /// Addresses are tried in the resolver order, starting the next one
+        /// when the previous attempt failed or has been pending for the
+        /// attempt delay. The first connection established wins, other
+        /// attempts are canceled.
+        TCPSocket
+        happy_eyeballs(std::string const& hostname,
+                       std::string const& port,
+                       DurationOpt timeout)
+        {
+          auto const endpoints = resolve_tcp(hostname, port, ResolveOptions(false));
+          if (endpoints.size() == 1)
+            return TCPSocket(endpoints.front(), timeout);
+          auto winner = boost::optional<TCPSocket>{};
+          auto error = std::exception_ptr{};
+          elle::With<Scope>() << [&] (Scope& scope)
+          {
+            auto pending = 0;
+            Signal progress;
+            for (auto const& endpoint: endpoints)
+            {
+              ++pending;
+              scope.run_background(
+                elle::sprintf("connect to %s", endpoint),
+                [&, endpoint]
+                {
+                  try
+                  {
+                    auto socket = TCPSocket(endpoint, timeout);
+                    if (!winner)
+                      winner.emplace(std::move(socket));
+                  }
+                  catch (Error const& e)
+                  {
+                    ELLE_DEBUG("connection to %s failed: %s", endpoint, e);
+                    error = std::current_exception();
+                  }
+                  --pending;
+                  progress.signal();
+                });
+              reactor::wait(progress, attempt_delay);
+              if (winner)
+                break;
+            }
+            while (!winner && pending)
+              reactor::wait(progress);
+            scope.terminate_now();
+          };
+          if (!winner)
+            std::rethrow_exception(error);
+          ELLE_TRACE("connected to %s through %s", hostname, winner->peer());
+          return std::move(*winner);
+        }
+      }
+
       /*-------------.
       | Construction |
       `-------------*/
@@ -36,7 +106,7 @@ namespace elle
       TCPSocket::TCPSocket(const std::string& hostname,
                            const std::string& port,
                            DurationOpt timeout)
-        : TCPSocket(resolve_tcp(hostname, port)[0], timeout)
+        : TCPSocket(happy_eyeballs(hostname, port, timeout))
       {}
 
       TCPSocket::TCPSocket(const std::string& hostname,
@@ -0,0 +1,57 @@
+#include <elle/reactor/network/connection-pool.hh>
+
+#include <elle/reactor/network/ssl-socket.hh>
+#include <elle/reactor/network/TCPSocket.hh>
+#include <elle/reactor/network/utp-socket.hh>
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      namespace
+      {
+        /// Peek at the socket without blocking: a live idle connection has
+        /// nothing to read, a closed one reads end of file.
+        bool
+        healthy(boost::asio::ip::tcp::socket& socket)
+        {
+          if (!socket.is_open())
+            return false;
+          auto error = boost::system::error_code{};
+          auto const non_blocking = socket.non_blocking();
+          socket.non_blocking(true, error);
+          if (error)
+            return false;
+          char c;
+          auto const size = socket.receive(
+            boost::asio::buffer(&c, 1),
+            boost::asio::socket_base::message_peek, error);
+          auto ignored = boost::system::error_code{};
+          socket.non_blocking(non_blocking, ignored);
+          return size == 0 && error == boost::asio::error::would_block;
+        }
+      }
+
+      bool
+      healthy(TCPSocket& socket)
+      {
+        return healthy(*socket.socket());
+      }
+
+      bool
+      healthy(SSLSocket& socket)
+      {
+        return SSL_pending(socket.socket()->native_handle()) == 0 &&
+          healthy(socket.socket()->next_layer());
+      }
+
+      bool
+      healthy(UTPSocket& socket)
+      {
+        return socket.connected() && socket.available() == 0;
+      }
+    }
+  }
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+
+#include <elle/attribute.hh>
+#include <elle/reactor/duration.hh>
+#include <elle/reactor/network/fwd.hh>
+#include <elle/reactor/signal.hh>
+#include <elle/reactor/Thread.hh>
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      /// Whether an idle connection can be handed out again: still connected,
+      /// with no unsolicited data pending.
+      bool
+      healthy(TCPSocket& socket);
+      /// @see healthy(TCPSocket&).
+      bool
+      healthy(SSLSocket& socket);
+      /// @see healthy(TCPSocket&).
+      bool
+      healthy(UTPSocket& socket);
+
+      /// Pool of established connections, keyed by peer endpoint.
+      ///
+      /// The transport is given by the Socket type: TCPSocket, SSLSocket or
+      /// UTPSocket. Connections are checked out for an interaction and given
+      /// back to the pool afterwards, sparing the connection setup, and the
+      /// TLS handshake, to the next interaction with the same peer.
+      ///
+      /// Idle connections are health-checked upon checkout and closed after
+      /// idle_timeout. The number of connections per peer and overall is
+      /// bounded: when the limit is reached, idle connections to other peers
+      /// are closed, or checkout waits for a connection to be given back.
+      ///
+      /// @code{.cc}
+      ///
+      /// ConnectionPool<TCPSocket> pool;
+      /// {
+      ///   auto connection = pool.checkout("example.com", 80);
+      ///   connection->write(request);
+      ///   auto response = connection->read_until("\r\n\r\n");
+      /// } // The connection is given back to the pool.
+      ///
+      /// @endcode
+      template <typename Socket>
+      class ConnectionPool
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = ConnectionPool;
+        /// Host name and port of a peer.
+        using Key = std::pair<std::string, int>;
+        /// Establish a new connection.
+        using Connector = std::function<
+          std::unique_ptr<Socket> (std::string const& host, int port)>;
+
+        /// A connection checked out of the pool, given back upon destruction.
+        class Connection
+        {
+        public:
+          Connection(Connection&& source);
+          ~Connection();
+          Socket&
+          operator *() const;
+          Socket*
+          operator ->() const;
+          /// Close the connection instead of giving it back to the pool, e.g.
+          /// after an error left it in an unknown state.
+          void
+          discard();
+
+        private:
+          friend class ConnectionPool;
+          Connection(ConnectionPool& pool,
+                     Key key,
+                     std::unique_ptr<Socket> socket,
+                     bool reused);
+          ELLE_ATTRIBUTE(ConnectionPool*, pool);
+          ELLE_ATTRIBUTE(Key, key);
+          ELLE_ATTRIBUTE(std::unique_ptr<Socket>, socket);
+          /// Whether the connection was already established.
+          ELLE_ATTRIBUTE_R(bool, reused);
+        };
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        /// Create a pool.
+        ///
+        /// All Connections must be given back before the pool is destroyed.
+        ///
+        /// @param connector How to establish connections. TCPSocket and
+        ///                  SSLSocket are connected by host name and port by
+        ///                  default, UTPSocket requires a connector.
+        ConnectionPool(Connector connector = {});
+        ~ConnectionPool();
+
+      /*------------.
+      | Connections |
+      `------------*/
+      public:
+        /// Get a connection to \a host, reusing an idle one if possible.
+        ///
+        /// @param host The name of the host.
+        /// @param port The port the host is listening to.
+        /// @throw TimeOut if no connection is available before
+        ///                checkout_timeout.
+        Connection
+        checkout(std::string const& host, int port);
+        /// Establish connections to \a host ahead of time so that up to
+        /// \a count of them are ready.
+        ///
+        /// @param host The name of the host.
+        /// @param port The port the host is listening to.
+        /// @param count The number of connections to have to the host.
+        void
+        warm_up(std::string const& host, int port, int count);
+        /// Close all idle connections.
+        void
+        clear();
+        /// Number of idle connections.
+        int
+        idle() const;
+        /// Number of connections, idle or checked out.
+        ELLE_ATTRIBUTE_R(int, size);
+        /// Maximum number of connections to a peer.
+        ELLE_ATTRIBUTE_RW(int, max_per_endpoint);
+        /// Maximum number of connections.
+        ELLE_ATTRIBUTE_RW(int, max);
+        /// How long a connection may stay idle before it is closed.
+        ELLE_ATTRIBUTE_RW(Duration, idle_timeout);
+        /// The maximum duration of a connection attempt.
+        ELLE_ATTRIBUTE_RW(DurationOpt, connect_timeout);
+        /// The maximum duration to wait for a connection when at capacity.
+        ELLE_ATTRIBUTE_RW(DurationOpt, checkout_timeout);
+        /// Checkouts served by an idle connection.
+        ELLE_ATTRIBUTE_R(int, hits);
+        /// Checkouts that established a new connection.
+        ELLE_ATTRIBUTE_R(int, misses);
+        /// Connections closed because idle, unhealthy or to make room.
+        ELLE_ATTRIBUTE_R(int, evictions);
+
+      private:
+        struct Idle
+        {
+          std::unique_ptr<Socket> socket;
+          Time since;
+        };
+        struct Peer
+        {
+          /// Idle connections, most recently used last.
+          std::deque<Idle> idle;
+          /// Connections, idle or checked out.
+          int count = 0;
+        };
+        std::unique_ptr<Socket>
+        _connect(Key const& key);
+        void
+        _release(Key const& key, std::unique_ptr<Socket> socket);
+        void
+        _forget(Key const& key);
+        /// Close the least recently used idle connection, if any.
+        bool
+        _evict();
+        /// Close connections idle for too long.
+        void
+        _reap();
+        ELLE_ATTRIBUTE(Connector, connector);
+        ELLE_ATTRIBUTE((std::map<Key, Peer>), peers);
+        ELLE_ATTRIBUTE(Signal, released);
+        ELLE_ATTRIBUTE(Thread::unique_ptr, reaper);
+      };
+    }
+  }
+}
+
+#include <elle/reactor/network/connection-pool.hxx>
@@ -0,0 +1,345 @@
+#include <type_traits>
+
+#include <elle/err.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+#include <elle/printf.hh>
+#include <elle/TypeInfo.hh>
+#include <elle/With.hh>
+
+#include <elle/reactor/network/Error.hh>
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/scheduler.hh>
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      namespace details
+      {
+        template <typename Socket>
+        std::enable_if_t<
+          std::is_constructible<
+            Socket, std::string, std::string, DurationOpt>::value,
+          std::unique_ptr<Socket>>
+        pool_connect(std::string const& host, int port, DurationOpt timeout)
+        {
+          return std::make_unique<Socket>(host, std::to_string(port), timeout);
+        }
+
+        template <typename Socket>
+        std::enable_if_t<
+          !std::is_constructible<
+            Socket, std::string, std::string, DurationOpt>::value,
+          std::unique_ptr<Socket>>
+        pool_connect(std::string const&, int, DurationOpt)
+        {
+          elle::err("no default connector for %s, provide one",
+                    elle::type_info<Socket>());
+        }
+      }
+
+      /*-----------.
+      | Connection |
+      `-----------*/
+
+      template <typename Socket>
+      ConnectionPool<Socket>::Connection::Connection(
+        ConnectionPool& pool,
+        Key key,
+        std::unique_ptr<Socket> socket,
+        bool reused)
+        : _pool(&pool)
+        , _key(std::move(key))
+        , _socket(std::move(socket))
+        , _reused(reused)
+      {}
+
+      template <typename Socket>
+      ConnectionPool<Socket>::Connection::Connection(Connection&& source)
+        : _pool(source._pool)
+        , _key(std::move(source._key))
+        , _socket(std::move(source._socket))
+        , _reused(source._reused)
+      {
+        source._pool = nullptr;
+      }
+
+      template <typename Socket>
+      ConnectionPool<Socket>::Connection::~Connection()
+      {
+        if (this->_pool)
+          this->_pool->_release(this->_key, std::move(this->_socket));
+      }
+
+      template <typename Socket>
+      Socket&
+      ConnectionPool<Socket>::Connection::operator *() const
+      {
+        return *this->_socket;
+      }
+
+      template <typename Socket>
+      Socket*
+      ConnectionPool<Socket>::Connection::operator ->() const
+      {
+        return this->_socket.get();
+      }
+
+      template <typename Socket>
+      void
+      ConnectionPool<Socket>::Connection::discard()
+      {
+        if (this->_pool)
+        {
+          auto pool = this->_pool;
+          this->_pool = nullptr;
+          this->_socket.reset();
+          pool->_forget(this->_key);
+        }
+      }
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      template <typename Socket>
+      ConnectionPool<Socket>::ConnectionPool(Connector connector)
+        : _size(0)
+        , _max_per_endpoint(
+          elle::os::getenv("ELLE_REACTOR_POOL_MAX_PER_ENDPOINT", 8))
+        , _max(elle::os::getenv("ELLE_REACTOR_POOL_MAX", 256))
+        , _idle_timeout(std::chrono::seconds(
+                          elle::os::getenv("ELLE_REACTOR_POOL_IDLE_TIMEOUT",
+                                           60)))
+        , _connect_timeout()
+        , _checkout_timeout()
+        , _hits(0)
+        , _misses(0)
+        , _evictions(0)
+        , _connector(std::move(connector))
+        , _peers()
+        , _released()
+        , _reaper(new Thread("connection pool reaper",
+                             [this] { this->_reap(); }))
+      {
+        if (!this->_connector)
+          this->_connector = [this] (std::string const& host, int port)
+            {
+              return details::pool_connect<Socket>(
+                host, port, this->_connect_timeout);
+            };
+      }
+
+      template <typename Socket>
+      ConnectionPool<Socket>::~ConnectionPool()
+      {
+        this->_reaper.reset();
+      }
+
+      /*------------.
+      | Connections |
+      `------------*/
+
+      template <typename Socket>
+      typename ConnectionPool<Socket>::Connection
+      ConnectionPool<Socket>::checkout(std::string const& host, int port)
+      {
+        ELLE_LOG_COMPONENT("elle.reactor.network.ConnectionPool");
+        auto const key = Key(host, port);
+        auto const deadline = this->_checkout_timeout
+          ? boost::make_optional(Clock::now() + *this->_checkout_timeout)
+          : boost::none;
+        while (true)
+        {
+          // Sockets may yield on destruction, so look the peer up again on
+          // every iteration.
+          auto& peer = this->_peers[key];
+          if (!peer.idle.empty())
+          {
+            auto idle = std::move(peer.idle.back());
+            peer.idle.pop_back();
+            if (Clock::now() - idle.since < this->_idle_timeout &&
+                healthy(*idle.socket))
+            {
+              ELLE_DEBUG("reuse connection to %s:%s", host, port);
+              ++this->_hits;
+              return Connection(*this, key, std::move(idle.socket), true);
+            }
+            ELLE_DEBUG("drop stale connection to %s:%s", host, port);
+            ++this->_evictions;
+            this->_forget(key);
+            continue;
+          }
+          if (peer.count < this->_max_per_endpoint)
+          {
+            if (this->_size < this->_max)
+            {
+              ELLE_TRACE("connect to %s:%s", host, port);
+              ++this->_misses;
+              ++peer.count;
+              ++this->_size;
+              return Connection(*this, key, this->_connect(key), false);
+            }
+            else if (this->_evict())
+              continue;
+          }
+          ELLE_DEBUG("wait for a connection to %s:%s", host, port);
+          auto const timeout = deadline
+            ? DurationOpt(std::max(Duration(0), *deadline - Clock::now()))
+            : DurationOpt();
+          if (!reactor::wait(this->_released, timeout))
+            throw TimeOut();
+        }
+      }
+
+      template <typename Socket>
+      void
+      ConnectionPool<Socket>::warm_up(std::string const& host,
+                                      int port,
+                                      int count)
+      {
+        ELLE_LOG_COMPONENT("elle.reactor.network.ConnectionPool");
+        auto const key = Key(host, port);
+        elle::With<Scope>() << [&] (Scope& scope)
+        {
+          auto& peer = this->_peers[key];
+          count = std::min(count, this->_max_per_endpoint);
+          ELLE_TRACE_SCOPE("warm up %s connections to %s:%s",
+                           count - peer.count, host, port);
+          while (peer.count < count && this->_size < this->_max)
+          {
+            ++peer.count;
+            ++this->_size;
+            scope.run_background(
+              elle::sprintf("warm up %s:%s", host, port),
+              [this, key]
+              {
+                this->_release(key, this->_connect(key));
+              });
+          }
+          reactor::wait(scope);
+        };
+      }
+
+      template <typename Socket>
+      void
+      ConnectionPool<Socket>::clear()
+      {
+        auto closed = std::vector<std::unique_ptr<Socket>>{};
+        for (auto& peer: this->_peers)
+        {
+          for (auto& idle: peer.second.idle)
+            closed.emplace_back(std::move(idle.socket));
+          peer.second.count -= peer.second.idle.size();
+          this->_size -= peer.second.idle.size();
+          peer.second.idle.clear();
+        }
+        this->_evictions += closed.size();
+        this->_released.signal();
+      }
+
+      template <typename Socket>
+      int
+      ConnectionPool<Socket>::idle() const
+      {
+        auto res = 0;
+        for (auto const& peer: this->_peers)
+          res += peer.second.idle.size();
+        return res;
+      }
+
+      template <typename Socket>
+      std::unique_ptr<Socket>
+      ConnectionPool<Socket>::_connect(Key const& key)
+      {
+        try
+        {
+          return this->_connector(key.first, key.second);
+        }
+        catch (...)
+        {
+          this->_forget(key);
+          throw;
+        }
+      }
+
+      template <typename Socket>
+      void
+      ConnectionPool<Socket>::_release(Key const& key,
+                                       std::unique_ptr<Socket> socket)
+      {
+        this->_peers[key].idle.push_back(Idle{std::move(socket), Clock::now()});
+        this->_released.signal();
+      }
+
+      template <typename Socket>
+      void
+      ConnectionPool<Socket>::_forget(Key const& key)
+      {
+        --this->_peers[key].count;
+        --this->_size;
+        this->_released.signal();
+      }
+
+      template <typename Socket>
+      bool
+      ConnectionPool<Socket>::_evict()
+      {
+        ELLE_LOG_COMPONENT("elle.reactor.network.ConnectionPool");
+        auto oldest = this->_peers.end();
+        for (auto it = this->_peers.begin(); it != this->_peers.end(); ++it)
+          if (!it->second.idle.empty() &&
+              (oldest == this->_peers.end() ||
+               it->second.idle.front().since < oldest->second.idle.front().since))
+            oldest = it;
+        if (oldest == this->_peers.end())
+          return false;
+        ELLE_DEBUG("evict connection to %s:%s",
+                   oldest->first.first, oldest->first.second);
+        auto closed = std::move(oldest->second.idle.front().socket);
+        oldest->second.idle.pop_front();
+        --oldest->second.count;
+        --this->_size;
+        ++this->_evictions;
+        return true;
+      }
+
+      template <typename Socket>
+      void
+      ConnectionPool<Socket>::_reap()
+      {
+        ELLE_LOG_COMPONENT("elle.reactor.network.ConnectionPool");
+        while (true)
+        {
+          reactor::sleep(this->_idle_timeout / 2);
+          auto const limit = Clock::now() - this->_idle_timeout;
+          auto closed = std::vector<std::unique_ptr<Socket>>{};
+          for (auto it = this->_peers.begin(); it != this->_peers.end();)
+          {
+            auto& peer = it->second;
+            while (!peer.idle.empty() && peer.idle.front().since <= limit)
+            {
+              closed.emplace_back(std::move(peer.idle.front().socket));
+              peer.idle.pop_front();
+              --peer.count;
+              --this->_size;
+            }
+            if (peer.count == 0)
+              it = this->_peers.erase(it);
+            else
+              ++it;
+          }
+          if (!closed.empty())
+          {
+            ELLE_DEBUG("close %s idle connections", closed.size());
+            this->_evictions += closed.size();
+            this->_released.signal();
+          }
+        }
+      }
+    }
+  }
+}
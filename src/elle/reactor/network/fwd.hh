@@ -13,11 +13,14 @@ namespace elle
     namespace network
     {
       class Buffer;
+      class Metrics;
       template <typename AsioSocket, typename EndPoint>
       class PlainSocket;
+      class Relay;
       class Server;
       class SSLServer;
       class SSLSocket;
+      class Shaper;
       class Socket;
       class TCPServer;
       class TCPSocket;
@@ -27,6 +30,10 @@ namespace elle
       class UTPSocket;
       class UTPServer;
 # ifdef REACTOR_NETWORK_UNIX_DOMAIN_SOCKET
+#  ifdef ELLE_LINUX
+      class ShmServer;
+      class ShmSocket;
+#  endif
       class UnixDomainServer;
       class UnixDomainSocket;
 # endif
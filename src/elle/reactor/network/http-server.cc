@@ -1,10 +1,16 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/join.hpp>
-#include <boost/lexical_cast.hpp>
 
+#include <elle/finally.hh>
 #include <elle/os/environ.hh>
 #include <elle/reactor/network/Error.hh>
 #include <elle/reactor/network/http-server.hh>
+#include <elle/reactor/semaphore.hh>
+#include <elle/reactor/signal.hh>
 
 ELLE_LOG_COMPONENT("elle.reactor.network.http");
 
@@ -21,6 +27,46 @@ namespace
                             boost::algorithm::is_any_of(sep));
     return res;
   }
+
+  /// How much to read from a connection at once.
+  auto constexpr read_size = std::size_t(8192);
+  /// Up to which size streamed chunks are copied to be sent in one write.
+  auto constexpr coalesce_size = std::size_t(16384);
+
+  /// Offset of the first \a needle in \a buffer, or its size if absent.
+  std::size_t
+  find(elle::ConstWeakBuffer buffer, char const* needle)
+  {
+    auto const end = needle + std::strlen(needle);
+    return std::search(buffer.begin(), buffer.end(), needle, end)
+      - buffer.begin();
+  }
+
+  /// \a buffer without surrounding spaces.
+  elle::ConstWeakBuffer
+  trim(elle::ConstWeakBuffer buffer)
+  {
+    auto begin = buffer.begin();
+    auto end = buffer.end();
+    while (begin != end && std::isspace(*begin))
+      ++begin;
+    while (end != begin && std::isspace(*(end - 1)))
+      --end;
+    return elle::ConstWeakBuffer(begin, end - begin);
+  }
+
+  /// Case insensitive comparison, as header names and most values are.
+  bool
+  iequals(elle::ConstWeakBuffer buffer, char const* s)
+  {
+    auto const size = std::strlen(s);
+    return buffer.size() == size &&
+      std::equal(buffer.begin(), buffer.end(), s,
+                 [] (unsigned char a, char b)
+                 {
+                   return std::tolower(a) == std::tolower(b);
+                 });
+  }
 }
 
 namespace elle
@@ -33,6 +79,12 @@ namespace elle
         : _server(std::move(server))
         , _port(0)
         , _accepter()
+        , _max_pipelined(
+          elle::os::getenv("ELLE_REACTOR_HTTP_MAX_PIPELINED", 16))
+        , _max_header_size(
+          elle::os::getenv("ELLE_REACTOR_HTTP_MAX_HEADER_SIZE", 65536))
+        , _keep_alive_timeout(std::chrono::seconds(
+          elle::os::getenv("ELLE_REACTOR_HTTP_KEEP_ALIVE_TIMEOUT", 30)))
       {
         if (!this->_server)
         {
@@ -49,6 +101,12 @@ namespace elle
       }
 
       HttpServer::HttpServer(int port)
+        : _max_pipelined(
+          elle::os::getenv("ELLE_REACTOR_HTTP_MAX_PIPELINED", 16))
+        , _max_header_size(
+          elle::os::getenv("ELLE_REACTOR_HTTP_MAX_HEADER_SIZE", 65536))
+        , _keep_alive_timeout(std::chrono::seconds(
+          elle::os::getenv("ELLE_REACTOR_HTTP_KEEP_ALIVE_TIMEOUT", 30)))
       {
         auto server = std::make_unique<TCPServer>();
         server->listen(port);
@@ -79,7 +137,7 @@ namespace elle
         return elle::sprintf("http://127.0.0.1:%s/%s", this->port(), path);
       }
 
-      HttpServer::CommandLine::CommandLine(elle::Buffer const& buffer)
+      HttpServer::CommandLine::CommandLine(elle::ConstWeakBuffer buffer)
         : _path()
         , _method()
         , _version()
@@ -182,118 +240,279 @@ namespace elle
         };
       }
 
+      /*------------.
+      | Connections |
+      `------------*/
+
+      struct HttpServer::Connection
+      {
+        Connection(std::unique_ptr<reactor::network::Socket> socket,
+                   int slots)
+          : socket(std::move(socket))
+          , buffer()
+          , offset(0)
+          , sequence(0)
+          , sent(0)
+          , turn()
+          , slots(slots)
+          , closing(false)
+          , reader(nullptr)
+        {}
+
+        std::unique_ptr<reactor::network::Socket> socket;
+        /// Data received and not parsed yet, starting at offset.
+        elle::Buffer buffer;
+        std::size_t offset;
+        /// Sequence number of the next request.
+        int sequence;
+        /// Number of responses sent.
+        int sent;
+        /// Signaled every time a response is sent.
+        reactor::Signal turn;
+        /// Requests that can still be handled concurrently.
+        reactor::Semaphore slots;
+        /// Whether the connection is to be closed after pending responses.
+        bool closing;
+        reactor::Thread* reader;
+      };
+
+      struct HttpServer::Request
+      {
+        int sequence;
+        boost::optional<CommandLine> command;
+        Headers headers;
+        Cookies cookies;
+        elle::Buffer content;
+        /// Whether the client wants the connection to be kept alive.
+        bool keep_alive;
+        /// Error to answer with instead of running a handler.
+        std::exception_ptr error;
+      };
+
       void
       HttpServer::_serve(std::unique_ptr<reactor::network::Socket> socket)
       {
-        auto headers = this->_headers;
-        auto cookies = Cookies{};
+        Connection connection(std::move(socket),
+                              std::max(this->_max_pipelined, 1));
+        elle::SafeFinally forget(
+          [&] { this->_persistent.erase(connection.socket.get()); });
+        elle::With<reactor::Scope>() << [&] (reactor::Scope& scope)
+        {
+          connection.reader = &scope.run_background(
+            elle::sprintf("%s: read", *connection.socket),
+            [&] { this->_read(connection, scope); });
+          reactor::wait(scope);
+        };
+        ELLE_TRACE("%s: close connection with %s", *this, connection.socket);
+      }
+
+      void
+      HttpServer::_read(Connection& connection, reactor::Scope& scope)
+      {
+        elle::SafeFinally done([&] { connection.reader = nullptr; });
+        while (!connection.closing)
+        {
+          while (!connection.slots.acquire())
+            reactor::wait(connection.slots);
+          auto request = std::make_shared<Request>();
+          request->sequence = connection.sequence++;
+          if (!this->_read_request(connection, *request))
+            return;
+          auto const keep_alive = request->keep_alive;
+          scope.run_background(
+            elle::sprintf("%s: request %s",
+                          *connection.socket, request->sequence),
+            [this, &connection, request]
+            {
+              this->_handle(connection, *request);
+            });
+          if (!keep_alive)
+            return;
+        }
+      }
+
+      bool
+      HttpServer::_read_request(Connection& connection, Request& request)
+      {
+        auto& headers = request.headers;
+        headers = this->_headers;
+        request.keep_alive = false;
         try
         {
-          CommandLine cmd(socket->read_until("\r\n"));
-          ELLE_LOG_SCOPE("%s: handle request from %s: %s",
-                         *this, socket, cmd);
-          auto route = this->_routes.find(cmd.path());
-          if (route == this->_routes.end())
+          auto head = elle::ConstWeakBuffer();
+          try
           {
-            ELLE_TRACE("%s: not found", *this);
-            throw Exception(cmd.path(), reactor::http::StatusCode::Not_Found);
+            head = this->_read_until(
+              connection, elle::ConstWeakBuffer("\r\n\r\n"),
+              this->_keep_alive_timeout);
           }
-          if (route->second.find(cmd.method()) == route->second.end())
+          catch (reactor::network::ConnectionClosed const&)
           {
-            ELLE_TRACE("%s: method not allowed", *this);
-            throw Exception(cmd.path(),
-                            reactor::http::StatusCode::Method_Not_Allowed);
+            // Closing between two requests is the normal way to end.
+            if (connection.offset != connection.buffer.size())
+              throw;
+            return false;
           }
-          while (true)
+          catch (reactor::network::TimeOut const&)
           {
-            auto buffer = socket->read_until("\r\n");
-            if (buffer == "\r\n")
-              break;
-            buffer.size(buffer.size() - 2);
-            ELLE_TRACE("%s: get header: %s", *this, buffer.string());
-            auto const words = split(buffer, " ");
-            auto expected_length = [&] (unsigned int length) {
-              if (words.size() != length)
-                throw Exception(cmd.path(),
-                                reactor::http::StatusCode::Bad_Request,
-                                elle::sprintf("%s: ill-formed", words));
-              };
-            if (words[0] == "Expect:")
+            ELLE_TRACE("%s: close idle connection with %s",
+                       *this, connection.socket);
+            return false;
+          }
+          auto const line_end = find(head, "\r\n");
+          request.command.emplace(head.range(0, line_end + 2));
+          auto const& cmd = *request.command;
+          ELLE_TRACE_SCOPE("%s: handle request from %s: %s",
+                           *this, connection.socket, cmd);
+          for (auto pos = line_end + 2; pos < head.size() - 2;)
+          {
+            auto const end = pos + find(head.range(pos), "\r\n");
+            auto const line = head.range(pos, end);
+            pos = end + 2;
+            ELLE_DUMP("%s: get header: %s", *this, line.string());
+            auto const colon = find(line, ":");
+            if (colon == line.size())
+              throw Exception(cmd.path(),
+                              reactor::http::StatusCode::Bad_Request,
+                              elle::sprintf("%s: ill-formed", line.string()));
+            auto const name = line.range(0, colon);
+            auto const value = trim(line.range(colon + 1));
+            if (iequals(name, "Expect"))
             {
-              expected_length(2);
-              if (words[1] == "100-continue")
+              if (iequals(value, "100-continue"))
                 headers["Expect"] = "1";
             }
-            else if (words[0] == "Content-Length:")
+            else if (iequals(name, "Content-Length"))
+              headers["Content-Length"] = value.string();
+            else if (iequals(name, "Content-Type"))
+              headers["Content-Type"] = value.string();
+            else if (iequals(name, "Transfer-Encoding"))
             {
-              expected_length(2);
-              headers["Content-Length"] = words[1];
-            }
-            else if (words[0] == "Content-Type:")
-            {
-              expected_length(2);
-              headers["Content-Type"] = words[1];
-            }
-            else if (words[0] == "Transfer-Encoding:")
-            {
-              expected_length(2);
-              if (words[1] == "chunked")
+              if (iequals(value, "chunked"))
                 headers["chunked"] = "1";
             }
-            else if (words[0] == "Set-Cookie:" || words[0] == "Cookie:")
+            else if (iequals(name, "Set-Cookie") || iequals(name, "Cookie"))
+              for (auto const& cookie: split(value.string(), ";"))
+              {
+                auto const equal = cookie.find('=');
+                if (equal == std::string::npos)
+                  throw Exception(cmd.path(),
+                                  reactor::http::StatusCode::Bad_Request,
+                                  elle::sprintf("%s: ill-formed",
+                                                line.string()));
+                auto const first = cookie.find_first_not_of(' ');
+                request.cookies[cookie.substr(first, equal - first)] =
+                  cookie.substr(equal + 1);
+              }
+            else if (iequals(name, "Connection"))
+              headers["Connection"] = value.string();
+          }
+          ELLE_TRACE("%s: cookies: %s", *this, request.cookies);
+          ELLE_TRACE("%s: parameters: %s", *this, cmd.params());
+          {
+            auto const it = headers.find("Connection");
+            auto const token = it == headers.end()
+              ? elle::ConstWeakBuffer()
+              : elle::ConstWeakBuffer(it->second);
+            request.keep_alive = cmd.version() == http::Version::v10
+              ? iequals(token, "keep-alive")
+              : !iequals(token, "close");
+          }
+          // Look the handler up before reading the body, so the client is
+          // not asked to send it in vain.
+          {
+            auto const routes = this->_routes.find(cmd.path());
+            auto const streams = this->_streaming_routes.find(cmd.path());
+            if (routes == this->_routes.end() &&
+                streams == this->_streaming_routes.end())
             {
-              auto const chunks = split(words[1], "=");
-              if (chunks.size() != 2)
-                throw Exception(cmd.path(),
-                                reactor::http::StatusCode::Bad_Request,
-                                elle::sprintf("%s: ill-formed", words));
-              cookies[chunks[0]] = chunks[1];
+              ELLE_TRACE("%s: not found", *this);
+              request.error = std::make_exception_ptr(
+                Exception(cmd.path(), reactor::http::StatusCode::Not_Found));
             }
-            else if (words[0] == "Connection:")
+            else if (!(routes != this->_routes.end() &&
+                       routes->second.count(cmd.method())) &&
+                     !(streams != this->_streaming_routes.end() &&
+                       streams->second.count(cmd.method())))
             {
-              expected_length(2);
-              headers["Connection"] = words[1];
+              ELLE_TRACE("%s: method not allowed", *this);
+              request.error = std::make_exception_ptr(
+                Exception(cmd.path(),
+                          reactor::http::StatusCode::Method_Not_Allowed));
             }
           }
-
-          ELLE_TRACE("%s: cookies: %s", *this, cookies);
-          ELLE_TRACE("%s: parameters: %s", *this, cmd.params());
-          elle::Buffer content;
           if (cmd.version() == http::Version::v11 &&
               headers.find("Expect") != headers.end())
           {
+            if (request.error)
+            {
+              // The body will not be sent, we cannot find the next request.
+              request.keep_alive = false;
+              return true;
+            }
+            // Interim responses must not overtake pipelined responses.
+            this->_wait_turn(connection, request);
             ELLE_TRACE("%s: send Continue header", *this)
             {
               std::string answer(
                 "HTTP/1.1 100 Continue\r\n"
                 "\r\n");
-              socket->write(elle::ConstWeakBuffer(answer));
+              connection.socket->write(elle::ConstWeakBuffer(answer));
             }
           }
+          auto& content = request.content;
           if (headers.find("chunked") != headers.end())
             ELLE_TRACE("%s: read chunked content", *this)
               while (true)
               {
-                socket->read_until("\r\n"); // Ignore the chunked header.
-                auto buffer = socket->read_until("\r\n");
-                if (buffer == "\r\n")
+                auto const line = this->_read_until(
+                  connection, elle::ConstWeakBuffer("\r\n"));
+                if (!std::isxdigit(line[0]))
+                  throw Exception(cmd.path(),
+                                  reactor::http::StatusCode::Bad_Request,
+                                  "ill-formed chunk size");
+                auto const size = std::strtoul(
+                  reinterpret_cast<char const*>(line.contents()), nullptr, 16);
+                if (size == 0)
+                {
+                  // Skip trailers.
+                  while (this->_read_until(
+                           connection, elle::ConstWeakBuffer("\r\n")).size()
+                         != 2)
+                    ;
                   break;
-                ELLE_DEBUG("%s: got content chunk from %s: %s",
-                           *this, socket, buffer.string());
-                content.append(buffer.contents(), buffer.size() - 2);
+                }
+                ELLE_DEBUG("%s: got content chunk of size %s from %s",
+                           *this, size, connection.socket);
+                this->_read_content(connection, content, size);
+                if (this->_read_until(
+                      connection, elle::ConstWeakBuffer("\r\n")).size() != 2)
+                  throw Exception(cmd.path(),
+                                  reactor::http::StatusCode::Bad_Request,
+                                  "ill-formed chunk");
               }
           else
           {
-            auto content_length =
-              boost::lexical_cast<unsigned int>(headers.at("Content-Length"));
-            ELLE_TRACE("%s: read sized content", *this)
-              content = this->read_sized_content(*socket, content_length);
+            auto const length = headers.find("Content-Length");
+            if (length != headers.end())
+            {
+              auto const& value = length->second;
+              if (value.empty() ||
+                  value.find_first_not_of("0123456789") != std::string::npos)
+                throw Exception(cmd.path(),
+                                reactor::http::StatusCode::Bad_Request,
+                                elle::sprintf("invalid Content-Length: %s",
+                                              value));
+              auto const size = std::stoull(value);
+              ELLE_TRACE("%s: read sized content of size %s", *this, size)
+                this->_read_content(connection, content, size);
+            }
           }
           ELLE_DUMP("%s: content: %s", *this, content);
           // Check JSON is valid. When getting meta_data on S3, we send a JSON
           // mimetype but an empty body, skip this case (and fix it later
           // cautiously).
-          if (this->is_json(headers) && content.size() > 0)
+          if (!request.error && this->is_json(headers) && content.size() > 0)
           {
             try
             {
@@ -302,33 +521,270 @@ namespace elle
             }
             catch (elle::json::ParseError)
             {
-              throw Exception(cmd.path(),
-                              reactor::http::StatusCode::Bad_Request,
-                              "invalid JSON");
+              request.error = std::make_exception_ptr(
+                Exception(cmd.path(),
+                          reactor::http::StatusCode::Bad_Request,
+                          "invalid JSON"));
+            }
+          }
+        }
+        catch (Exception const&)
+        {
+          // We may have lost track of the request boundaries: answer and
+          // close.
+          request.error = std::current_exception();
+          request.keep_alive = false;
+        }
+        return true;
+      }
 
+      elle::ConstWeakBuffer
+      HttpServer::_read_until(Connection& connection,
+                              elle::ConstWeakBuffer delimiter,
+                              DurationOpt timeout)
+      {
+        auto& buffer = connection.buffer;
+        auto scanned = std::size_t(0);
+        while (true)
+        {
+          auto const available = elle::ConstWeakBuffer(
+            buffer.contents() + connection.offset,
+            buffer.size() - connection.offset);
+          // Only scan what was received since last time.
+          auto const from =
+            scanned >= delimiter.size() ? scanned - delimiter.size() + 1 : 0;
+          auto const it = std::search(available.begin() + from,
+                                      available.end(),
+                                      delimiter.begin(),
+                                      delimiter.end());
+          if (it != available.end())
+          {
+            auto const size = (it - available.begin()) + delimiter.size();
+            connection.offset += size;
+            return available.range(0, size);
+          }
+          scanned = available.size();
+          if (scanned > static_cast<std::size_t>(this->_max_header_size))
+            throw Exception("", reactor::http::StatusCode::Bad_Request,
+                            "request header too large");
+          // Reclaim consumed space before receiving more.
+          if (connection.offset == buffer.size())
+            buffer.size(0);
+          else if (buffer.capacity() - buffer.size() < read_size)
+          {
+            std::memmove(buffer.mutable_contents(),
+                         buffer.contents() + connection.offset,
+                         scanned);
+            buffer.size(scanned);
+          }
+          connection.offset = 0;
+          auto const size = buffer.size();
+          buffer.size(size + read_size);
+          buffer.size(
+            size + connection.socket->read_some(
+              elle::WeakBuffer(buffer.mutable_contents() + size, read_size),
+              timeout));
+        }
+      }
+
+      void
+      HttpServer::_read_content(Connection& connection,
+                                elle::Buffer& content,
+                                std::size_t size)
+      {
+        auto const buffered =
+          std::min(size, connection.buffer.size() - connection.offset);
+        content.append(connection.buffer.contents() + connection.offset,
+                       buffered);
+        connection.offset += buffered;
+        if (auto const missing = size - buffered)
+        {
+          auto const current = content.size();
+          content.size(current + missing);
+          connection.socket->read(
+            elle::WeakBuffer(content.mutable_contents() + current, missing));
+        }
+      }
+
+      void
+      HttpServer::_handle(Connection& connection, Request& request)
+      {
+        auto& socket = *connection.socket;
+        elle::SafeFinally done(
+          [&]
+          {
+            ++connection.sent;
+            connection.turn.signal();
+            connection.slots.release();
+          });
+        auto const respond =
+          [&] (http::StatusCode code, elle::ConstWeakBuffer content)
+          {
+            this->_wait_turn(connection, request);
+            if (connection.closing)
+              return;
+            if (request.keep_alive)
+              this->_persistent[&socket] = false;
+            else
+              this->_persistent.erase(&socket);
+            this->_response(socket, code, content, request.cookies);
+            auto const it = this->_persistent.find(&socket);
+            if (it == this->_persistent.end() || !it->second)
+              this->_close(connection);
+          };
+        try
+        {
+          if (request.error)
+            std::rethrow_exception(request.error);
+          auto const& cmd = *request.command;
+          auto const routes = this->_routes.find(cmd.path());
+          if (routes != this->_routes.end() &&
+              routes->second.count(cmd.method()))
+          {
+            auto const response = routes->second.at(cmd.method())
+              (request.headers, request.cookies, cmd.params(),
+               request.content);
+            respond(http::StatusCode::OK, response);
+          }
+          else
+          {
+            auto const function =
+              this->_streaming_routes.at(cmd.path()).at(cmd.method());
+            // The response is sent as it is produced.
+            this->_wait_turn(connection, request);
+            if (connection.closing)
+              return;
+            ResponseWriter writer(*this, socket,
+                                  cmd.version() != http::Version::v10,
+                                  request.keep_alive);
+            try
+            {
+              function(request.headers, request.cookies, cmd.params(),
+                       request.content, writer);
+            }
+            catch (reactor::Terminate const&)
+            {
+              throw;
             }
+            catch (...)
+            {
+              if (!writer._started)
+                throw;
+              ELLE_WARN("%s: error streaming response: %s",
+                        *this, elle::exception_string());
+              // Headers are gone, truncating is all we can do.
+              this->_close(connection);
+              return;
+            }
+            writer._finish();
+            if (!writer._keep_alive)
+              this->_close(connection);
           }
-          this->_response(
-            *socket,
-            http::StatusCode::OK,
-            route->second.at(cmd.method())
-              (headers, cookies, cmd.params(), content),
-            cookies);
+        }
+        catch (reactor::Terminate const&)
+        {
+          throw;
         }
         catch (Exception const& e)
         {
           ELLE_WARN("%s: http exception: %s", *this, e.what());
-          this->_response(*socket, e.code(),
-                          this->is_json(headers) ? e.body() : e.what(), cookies);
+          respond(e.code(),
+                  this->is_json(request.headers) ? e.body() : e.what());
         }
         catch (elle::Exception const& e)
         {
           ELLE_WARN("%s: internal error: %s", *this, e.what());
-          this->_response(*socket,
-                          reactor::http::StatusCode::Internal_Server_Error,
-                          e.what(), cookies);
+          respond(reactor::http::StatusCode::Internal_Server_Error, e.what());
         }
-        ELLE_TRACE("%s: close connection with %s", *this, socket);
+      }
+
+      void
+      HttpServer::_wait_turn(Connection& connection, Request const& request)
+      {
+        while (connection.sent != request.sequence)
+          reactor::wait(connection.turn);
+      }
+
+      void
+      HttpServer::_close(Connection& connection)
+      {
+        ELLE_TRACE("%s: stop reading from %s", *this, connection.socket);
+        connection.closing = true;
+        if (connection.reader)
+          connection.reader->terminate();
+      }
+
+      /*----------------.
+      | Response writer |
+      `----------------*/
+
+      HttpServer::ResponseWriter::ResponseWriter(
+        HttpServer& server,
+        reactor::network::Socket& socket,
+        bool chunked,
+        bool keep_alive)
+        : _server(server)
+        , _socket(socket)
+        , _chunked(chunked)
+        , _keep_alive(keep_alive && chunked)
+        , _started(false)
+      {}
+
+      void
+      HttpServer::ResponseWriter::write(elle::ConstWeakBuffer data)
+      {
+        this->_start();
+        // An empty chunk would end the body.
+        if (data.size() == 0)
+          return;
+        if (!this->_chunked)
+          this->_socket.write(data);
+        else if (data.size() <= coalesce_size)
+        {
+          auto chunk = elle::Buffer(data.size() + 16);
+          chunk.size(0);
+          auto const header = elle::sprintf("%x\r\n", data.size());
+          chunk.append(header.data(), header.size());
+          chunk.append(data.contents(), data.size());
+          chunk.append("\r\n", 2);
+          this->_socket.write(chunk);
+        }
+        else
+        {
+          // Large chunks are not worth a copy.
+          this->_socket.write(elle::sprintf("%x\r\n", data.size()));
+          this->_socket.write(data);
+          this->_socket.write(elle::ConstWeakBuffer("\r\n"));
+        }
+      }
+
+      void
+      HttpServer::ResponseWriter::_start()
+      {
+        if (this->_started)
+          return;
+        this->_started = true;
+        auto answer = std::string(
+          "HTTP/1.1 200 OK\r\n"
+          "Server: Custom HTTP of doom\r\n");
+        for (auto const& value: this->_server._headers)
+          if (value.first != "Content-Length" && value.first != "Connection")
+            answer += elle::sprintf("%s: %s\r\n", value.first, value.second);
+        if (this->_chunked)
+          answer += "Transfer-Encoding: chunked\r\n";
+        answer += elle::sprintf("Connection: %s\r\n\r\n",
+                                this->_keep_alive ? "keep-alive" : "close");
+        ELLE_TRACE("%s: start streaming response to %s",
+                   this->_server, this->_socket)
+          this->_socket.write(elle::ConstWeakBuffer(answer));
+      }
+
+      void
+      HttpServer::ResponseWriter::_finish()
+      {
+        this->_start();
+        if (this->_chunked)
+          this->_socket.write(elle::ConstWeakBuffer("0\r\n\r\n"));
       }
 
       void
@@ -340,6 +796,15 @@ namespace elle
         this->_routes[route][method] = function;
       }
 
+      void
+      HttpServer::register_streaming_route(std::string const& route,
+                                           http::Method method,
+                                           StreamFunction const& function)
+      {
+        ELLE_TRACE("%s: register streaming %s on %s", *this, route, method);
+        this->_streaming_routes[route][method] = function;
+      }
+
       bool
       HttpServer::is_json(Headers const& headers) const
       {
@@ -354,25 +819,27 @@ namespace elle
                     Cookies const& cookies)
       {
         Headers headers = this->_headers;
+        auto const persistent = this->_persistent.find(&socket);
+        auto const keep_alive = persistent != this->_persistent.end();
+        std::string answer = elle::sprintf(
+          "HTTP/1.1 %s %s\r\n"
+          "Server: Custom HTTP of doom\r\n",
+          (int) code, code);
+        headers["Content-Length"] = std::to_string(content.size());
+        headers["Connection"] = keep_alive ? "keep-alive" : "close";
+        for (auto const& value: headers)
+          answer += elle::sprintf("%s: %s\r\n", value.first, value.second);
+        answer += "\r\n";
+        answer.append(reinterpret_cast<char const*>(content.contents()),
+                      content.size());
+        ELLE_TRACE("%s: send response to %s: %s %s",
+                   *this, socket, static_cast<int>(code), code)
         {
-          std::string response;
-          response += content.string();
-          std::string answer = elle::sprintf(
-            "HTTP/1.1 %s %s\r\n"
-            "Server: Custom HTTP of doom\r\n",
-            (int) code, code);
-          headers["Content-Length"] = std::to_string(response.size());
-          headers["Connection"] = "close";
-          for (auto const& value: headers)
-            answer += elle::sprintf("%s: %s\r\n", value.first, value.second);
-          answer += "\r\n" + response;
-          ELLE_TRACE("%s: send response to %s: %s %s",
-                     *this, socket, static_cast<int>(code), code)
-          {
-            ELLE_DUMP("%s", answer);
-            socket.write(elle::ConstWeakBuffer(answer));
-          }
+          ELLE_DUMP("%s", answer);
+          socket.write(elle::ConstWeakBuffer(answer));
         }
+        if (keep_alive)
+          persistent->second = true;
       }
 
       elle::Buffer
@@ -14,6 +14,7 @@
 #include <elle/json/json.hh>
 #include <elle/log.hh>
 #include <elle/reactor/Scope.hh>
+#include <elle/reactor/duration.hh>
 #include <elle/reactor/exception.hh>
 #include <elle/reactor/http/Method.hh>
 #include <elle/reactor/http/StatusCode.hh>
@@ -34,6 +35,12 @@ namespace elle
       ///
       /// N.B. This is not a fully compliant HTTP Server.
       ///
+      /// Connections are kept alive between requests unless the client asks
+      /// otherwise, and pipelined requests are handled concurrently, up to
+      /// max_pipelined per connection, while responses are sent in request
+      /// order. Routes registered with register_streaming_route send their
+      /// response incrementally, with the chunked transfer encoding.
+      ///
       /// \code{.cc}
       ///
       /// HTTPServer server;
@@ -144,6 +151,47 @@ namespace elle
         // e.g.: {"/foo" -> {GET -> get_function, POST -> post_function, ...}}
         using Routes = std::unordered_map<std::string, MethodFunctions>;
         ELLE_ATTRIBUTE_X(Routes, routes);
+
+        /// Body of a streamed response, sent chunk by chunk.
+        class ResponseWriter
+        {
+        public:
+          /// Send \a data to the client right away.
+          ///
+          /// \param data The next part of the body.
+          void
+          write(elle::ConstWeakBuffer data);
+
+        private:
+          friend class HttpServer;
+          ResponseWriter(HttpServer& server,
+                         reactor::network::Socket& socket,
+                         bool chunked,
+                         bool keep_alive);
+          /// Send the status line and headers, if not done yet.
+          void
+          _start();
+          /// Terminate the body.
+          void
+          _finish();
+          ELLE_ATTRIBUTE(HttpServer&, server);
+          ELLE_ATTRIBUTE(reactor::network::Socket&, socket);
+          /// Whether the client understands the chunked encoding. If not, the
+          /// body is sent as is and the connection closed afterwards.
+          ELLE_ATTRIBUTE(bool, chunked);
+          ELLE_ATTRIBUTE(bool, keep_alive);
+          ELLE_ATTRIBUTE(bool, started);
+        };
+        using StreamFunction = std::function<void (Headers const&,
+                                                   Cookies const&,
+                                                   Parameters const&,
+                                                   elle::Buffer const&,
+                                                   ResponseWriter&)>;
+        using MethodStreamFunctions =
+          std::unordered_map<reactor::http::Method, StreamFunction, enum_hash>;
+        using StreamingRoutes =
+          std::unordered_map<std::string, MethodStreamFunctions>;
+        ELLE_ATTRIBUTE_X(StreamingRoutes, streaming_routes);
         ELLE_ATTRIBUTE(std::unique_ptr<reactor::network::Server>, server);
         ELLE_ATTRIBUTE_R(int, port);
         ELLE_ATTRIBUTE(std::unique_ptr<reactor::Thread>, accepter);
@@ -153,13 +201,19 @@ namespace elle
                           check_method);
         ELLE_ATTRIBUTE_RW(std::function<void (bool)>, check_expect_continue);
         ELLE_ATTRIBUTE_RW(std::function<void (bool)>, check_chunked);
+        /// Maximum number of requests of a connection handled concurrently.
+        ELLE_ATTRIBUTE_RW(int, max_pipelined);
+        /// Maximum size of a request line and headers.
+        ELLE_ATTRIBUTE_RW(int, max_header_size);
+        /// How long an idle connection is kept open.
+        ELLE_ATTRIBUTE_RW(DurationOpt, keep_alive_timeout);
 
       private:
         /// Extract method, path and version for the HTTP headers.
         struct CommandLine
           : public elle::Printable
         {
-          CommandLine(elle::Buffer const& buffer);
+          CommandLine(elle::ConstWeakBuffer buffer);
           /// Path requested.
           ELLE_ATTRIBUTE_R(std::string, path);
           /// Method used.
@@ -177,11 +231,47 @@ namespace elle
           void
           print(std::ostream& output) const;
         };
+        /// A client connection and its receive buffer.
+        struct Connection;
+        /// A parsed request.
+        struct Request;
         void
         _accept();
-        virtual
+        /// Read requests from \a connection and dispatch them until it is
+        /// closed.
         void
-        _serve(std::unique_ptr<reactor::network::Socket> socket);
+        _read(Connection& connection, reactor::Scope& scope);
+        /// Parse the request line and headers of the next request, and read
+        /// its body.
+        ///
+        /// \returns Whether a request was read, false if the connection was
+        ///          closed or idle for too long.
+        bool
+        _read_request(Connection& connection, Request& request);
+        /// Read up to and including \a delimiter.
+        ///
+        /// \returns A view of the connection buffer, valid until the next
+        ///          read.
+        elle::ConstWeakBuffer
+        _read_until(Connection& connection,
+                    elle::ConstWeakBuffer delimiter,
+                    DurationOpt timeout = {});
+        /// Read \a size bytes of body in \a content.
+        void
+        _read_content(Connection& connection,
+                      elle::Buffer& content,
+                      std::size_t size);
+        /// Run the handler of \a request and send the response, in request
+        /// order.
+        void
+        _handle(Connection& connection, Request& request);
+        /// Wait until responses to all requests before \a request are sent.
+        void
+        _wait_turn(Connection& connection, Request const& request);
+        /// Stop reading from \a connection, closing it once pending responses
+        /// are sent.
+        void
+        _close(Connection& connection);
       public:
         /// Register a function to a pair (route / method).
         ///
@@ -193,6 +283,16 @@ namespace elle
         register_route(std::string const& route,
                        http::Method method,
                        Function const& function);
+        /// Register a function streaming its response to a pair
+        /// (route / method).
+        ///
+        /// \param route The route.
+        /// \param method The Method.
+        /// \param function The StreamFunction to call.
+        void
+        register_streaming_route(std::string const& route,
+                                 http::Method method,
+                                 StreamFunction const& function);
         /// Check if content-type is application/json.
         ///
         /// \param headers The headers of the Request.
@@ -200,6 +300,10 @@ namespace elle
         bool
         is_json(Headers const& headers) const;
       protected:
+        /// Serve requests from a client until the connection is closed.
+        virtual
+        void
+        _serve(std::unique_ptr<reactor::network::Socket> socket);
         virtual
         void
         _response(reactor::network::Socket& socket,
@@ -210,6 +314,10 @@ namespace elle
         read_sized_content(reactor::network::Socket& socket,
                            unsigned int length);
         ELLE_ATTRIBUTE_RX(Headers, headers);
+        /// Whether the response to the request being answered on a socket
+        /// may keep the connection alive, and whether it did.
+        ELLE_ATTRIBUTE((std::unordered_map<reactor::network::Socket const*,
+                                           bool>), persistent);
       public:
         virtual
         void
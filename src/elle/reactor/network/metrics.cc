@@ -0,0 +1,210 @@
+#include <elle/reactor/network/metrics.hh>
+
+#include <atomic>
+#include <mutex>
+
+#include <elle/printf.hh>
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      struct Metrics::Counters
+      {
+        Counters()
+          : bytes_in(0)
+          , bytes_out(0)
+          , reads(0)
+          , writes(0)
+          , read_time(0)
+          , write_time(0)
+          , timeouts(0)
+          , queued(0)
+          , connections(0)
+        {}
+
+        Snapshot
+        snapshot() const
+        {
+          auto const load = [] (std::atomic<int64_t> const& v)
+            {
+              return v.load(std::memory_order_relaxed);
+            };
+          auto res = Snapshot();
+          res.bytes_in = load(this->bytes_in);
+          res.bytes_out = load(this->bytes_out);
+          res.reads = load(this->reads);
+          res.writes = load(this->writes);
+          res.read_time = Duration(load(this->read_time));
+          res.write_time = Duration(load(this->write_time));
+          res.timeouts = load(this->timeouts);
+          res.queued = load(this->queued);
+          res.connections = load(this->connections);
+          return res;
+        }
+
+        std::atomic<int64_t> bytes_in;
+        std::atomic<int64_t> bytes_out;
+        std::atomic<int64_t> reads;
+        std::atomic<int64_t> writes;
+        /// In Duration ticks.
+        std::atomic<int64_t> read_time;
+        std::atomic<int64_t> write_time;
+        std::atomic<int64_t> timeouts;
+        std::atomic<int64_t> queued;
+        std::atomic<int64_t> connections;
+      };
+
+      namespace
+      {
+        /// Aggregated counters by label. Labels are never forgotten so totals
+        /// outlive sockets.
+        struct Registry
+        {
+          std::mutex mutex;
+          std::map<std::string, std::shared_ptr<Metrics::Counters>> groups;
+        };
+
+        Registry&
+        registry()
+        {
+          static auto res = new Registry;
+          return *res;
+        }
+
+        void
+        add(std::atomic<int64_t>& counter, int64_t value)
+        {
+          counter.fetch_add(value, std::memory_order_relaxed);
+        }
+      }
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      Metrics::Metrics(std::string label)
+        : _label(std::move(label))
+        , _own(std::make_unique<Counters>())
+        , _group()
+      {
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto& group = r.groups[this->_label];
+        if (!group)
+          group = std::make_shared<Counters>();
+        this->_group = group;
+      }
+
+      Metrics::~Metrics()
+      {
+        // What was still queued will never be written.
+        add(this->_group->queued,
+            -this->_own->queued.load(std::memory_order_relaxed));
+      }
+
+      /*---------.
+      | Counting |
+      `---------*/
+
+      void
+      Metrics::read(Size size, Duration blocked)
+      {
+        for (auto c: {this->_own.get(), this->_group.get()})
+        {
+          add(c->bytes_in, size);
+          add(c->reads, 1);
+          add(c->read_time, blocked.count());
+        }
+      }
+
+      void
+      Metrics::write(Size size, Duration blocked)
+      {
+        for (auto c: {this->_own.get(), this->_group.get()})
+        {
+          add(c->bytes_out, size);
+          add(c->writes, 1);
+          add(c->write_time, blocked.count());
+        }
+      }
+
+      void
+      Metrics::timeout()
+      {
+        add(this->_own->timeouts, 1);
+        add(this->_group->timeouts, 1);
+      }
+
+      void
+      Metrics::queue(int64_t size)
+      {
+        add(this->_own->queued, size);
+        add(this->_group->queued, size);
+      }
+
+      void
+      Metrics::connection()
+      {
+        add(this->_own->connections, 1);
+        add(this->_group->connections, 1);
+      }
+
+      /*---------.
+      | Snapshot |
+      `---------*/
+
+      Metrics::Snapshot
+      Metrics::snapshot() const
+      {
+        return this->_own->snapshot();
+      }
+
+      Metrics::Snapshot
+      Metrics::snapshot(std::string const& label)
+      {
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto it = r.groups.find(label);
+        if (it == r.groups.end())
+          return Counters().snapshot();
+        return it->second->snapshot();
+      }
+
+      std::map<std::string, Metrics::Snapshot>
+      Metrics::snapshots()
+      {
+        auto res = std::map<std::string, Snapshot>{};
+        auto& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (auto const& group: r.groups)
+          res.emplace(group.first, group.second->snapshot());
+        return res;
+      }
+
+      /*----------.
+      | Printable |
+      `----------*/
+
+      void
+      Metrics::print(std::ostream& stream) const
+      {
+        elle::fprintf(stream, "Metrics(%s)", this->_label);
+      }
+
+      void
+      Metrics::Snapshot::print(std::ostream& stream) const
+      {
+        elle::fprintf(
+          stream,
+          "%s bytes in %s reads (%s), %s bytes out in %s writes (%s), "
+          "%s timeouts, %s bytes queued, %s connections",
+          this->bytes_in, this->reads, this->read_time,
+          this->bytes_out, this->writes, this->write_time,
+          this->timeouts, this->queued, this->connections);
+      }
+    }
+  }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <map>
+#include <memory>
+
+#include <elle/Printable.hh>
+#include <elle/attribute.hh>
+#include <elle/reactor/duration.hh>
+#include <elle/reactor/network/fwd.hh>
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      /// I/O counters of a Socket or Server.
+      ///
+      /// Metrics are opt-in: attach them to a socket or server, and its
+      /// activity is counted both on its own and in the aggregate of every
+      /// socket and server sharing its label. Sockets accepted by a server
+      /// with metrics get metrics with the same label.
+      ///
+      /// Counters are relaxed atomics so they can be left enabled in
+      /// production, and snapshots can be taken from any thread.
+      ///
+      /// @code{.cc}
+      ///
+      /// server.metrics(std::make_shared<Metrics>("api"));
+      /// // ...
+      /// auto const api = Metrics::snapshot("api");
+      /// ELLE_LOG("%s bytes in, %s bytes out", api.bytes_in, api.bytes_out);
+      ///
+      /// @endcode
+      class Metrics
+        : public elle::Printable
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = Metrics;
+        /// Values of the counters at some point.
+        struct Snapshot
+          : public elle::Printable
+        {
+          /// Bytes read.
+          int64_t bytes_in;
+          /// Bytes written.
+          int64_t bytes_out;
+          /// Read operations.
+          int64_t reads;
+          /// Write operations.
+          int64_t writes;
+          /// Time spent waiting for reads to complete.
+          Duration read_time;
+          /// Time spent waiting for writes to complete.
+          Duration write_time;
+          /// Operations that timed out.
+          int64_t timeouts;
+          /// Bytes queued for asynchronous writes.
+          int64_t queued;
+          /// Connections accepted.
+          int64_t connections;
+          void
+          print(std::ostream& stream) const override;
+        };
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        /// Create counters aggregated under \a label.
+        Metrics(std::string label);
+        ~Metrics();
+
+      /*---------.
+      | Counting |
+      `---------*/
+      public:
+        /// Count a read of \a size bytes that waited \a blocked.
+        void
+        read(Size size, Duration blocked);
+        /// Count a write of \a size bytes that waited \a blocked.
+        void
+        write(Size size, Duration blocked);
+        /// Count an operation that timed out.
+        void
+        timeout();
+        /// Count \a size bytes queued, or flushed if negative.
+        void
+        queue(int64_t size);
+        /// Count an accepted connection.
+        void
+        connection();
+        ELLE_ATTRIBUTE_R(std::string, label);
+        /// Atomic counters.
+        struct Counters;
+      private:
+        ELLE_ATTRIBUTE(std::unique_ptr<Counters>, own);
+        ELLE_ATTRIBUTE(std::shared_ptr<Counters>, group);
+
+      /*---------.
+      | Snapshot |
+      `---------*/
+      public:
+        /// The counters of this socket or server alone.
+        Snapshot
+        snapshot() const;
+        /// The aggregated counters of a label.
+        static
+        Snapshot
+        snapshot(std::string const& label);
+        /// The aggregated counters of every label.
+        static
+        std::map<std::string, Snapshot>
+        snapshots();
+
+      /*----------.
+      | Printable |
+      `----------*/
+      public:
+        void
+        print(std::ostream& stream) const override;
+      };
+    }
+  }
+}
@@ -1,6 +1,7 @@
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/uuid_io.hpp>
 
+#include <elle/os/environ.hh>
 #include <elle/reactor/network/rdv-socket.hh>
 #include <elle/reactor/network/resolve.hh>
 #include <elle/reactor/network/rdv.hh>
@@ -17,11 +18,26 @@ namespace elle
     {
       using Endpoint = boost::asio::ip::udp::endpoint;
 
+      namespace
+      {
+        /// The period of requests to the RDV server, and the longest delay
+        /// between probe bursts.
+        auto const max_rto = Duration(500ms);
+        auto const min_rto = Duration(10ms);
+      }
+
       RDVSocket::RDVSocket()
-        : _server_reached(elle::sprintf("%s: server reached", *this))
+        : _server_binary(true)
+        , _server_reached(elle::sprintf("%s: server reached", *this))
         , _breacher("breacher", [this] { this->_loop_breach(); })
         , _keep_alive("keep-alive", [this]  { this->_loop_keep_alive(); })
         , _tasks(elle::sprintf("%s tasks barrier", this))
+        , _probes()
+        , _rtt_variance(0)
+        , _pacing(std::chrono::milliseconds(
+          elle::os::getenv("ELLE_REACTOR_RDV_PACING", 5)))
+        , _initial_rto(std::chrono::milliseconds(
+          elle::os::getenv("ELLE_REACTOR_RDV_INITIAL_RTO", 100)))
       {}
 
       RDVSocket::~RDVSocket()
@@ -56,13 +72,11 @@ namespace elle
         rdv::Message req;
         req.command = rdv::Command::ping;
         req.id = id;
-        elle::Buffer buf = elle::serialization::json::serialize(req, false);
         auto now = Clock::now();
         while (true)
         {
-          this->_send_to_failsafe(
-            elle::ConstWeakBuffer(buf.contents(), buf.size()),
-            ep);
+          // Encode every time, we may have fallen back to JSON.
+          this->_send_message(req, ep, this->_server_binary);
           if (reactor::wait(_server_reached, 500ms))
             return;
           else if (timeout && Clock::now() - now > *timeout)
@@ -77,125 +91,148 @@ namespace elle
       {
         while (true)
         {
-          bool set_endpoint = false;
           Size sz = UDPSocket::receive_from(buffer, endpoint, timeout);
-          if (sz < 8)
+          if (!this->process(elle::WeakBuffer(buffer.mutable_contents(), sz),
+                             endpoint))
             return sz;
-          bool server_hit = (endpoint == _server);
-          auto addr = endpoint.address();
-          if (endpoint.port() == _server.port()
-              && addr.is_v6()
-              && addr.to_v6().is_v4_mapped()
-              && addr.to_v6().to_v4() == _server.address())
-            server_hit = true;
-          if (!this->_server_reached.opened() &&  server_hit)
-          {
-            ELLE_TRACE("message from server, open reached");
-            this->_server_reached.open();
-            set_endpoint = true;
-          }
-          auto magic = std::string(buffer.contents(), buffer.contents() + 8);
-          auto it = this->_readers.find(magic);
-          if (it != this->_readers.end())
+        }
+      }
+
+      bool
+      RDVSocket::process(elle::WeakBuffer buffer, Endpoint const& endpoint)
+      {
+        auto const sz = buffer.size();
+        bool set_endpoint = false;
+        if (sz < 8)
+          return false;
+        bool server_hit = (endpoint == _server);
+        auto addr = endpoint.address();
+        if (endpoint.port() == _server.port()
+            && addr.is_v6()
+            && addr.to_v6().is_v4_mapped()
+            && addr.to_v6().to_v4() == _server.address())
+          server_hit = true;
+        auto magic = std::string(buffer.contents(), buffer.contents() + 8);
+        if (server_hit && this->_server_binary && magic == rdv::rdv_magic)
+        {
+          // Legacy servers answer our binary messages with a JSON error.
+          ELLE_TRACE("server does not support binary messages, use JSON");
+          this->_server_binary = false;
+          return true;
+        }
+        if (!this->_server_reached.opened() &&  server_hit)
+        {
+          ELLE_TRACE("message from server, open reached");
+          this->_server_reached.open();
+          set_endpoint = true;
+        }
+        auto it = this->_readers.find(magic);
+        if (it != this->_readers.end())
+        {
+          it->second(elle::WeakBuffer(buffer.mutable_contents(), sz),
+                     endpoint);
+        }
+        else if (magic == rdv::rdv_magic || magic == rdv::rdv_magic_binary)
+        {
+          bool binary = false;
+          rdv::Message repl = rdv::decode(buffer, binary);
+          if (set_endpoint && repl.source_endpoint)
           {
-            it->second(elle::WeakBuffer(buffer.mutable_contents(), sz),
-                       endpoint);
+            this->_public_endpoint = *repl.source_endpoint;
           }
-          else if (magic == rdv::rdv_magic)
+          ELLE_DEBUG("got message from %s, code %s", endpoint,
+                     (int)repl.command);
+          switch (repl.command)
           {
-            rdv::Message repl =
-              elle::serialization::json::deserialize<rdv::Message>(
-                elle::Buffer(buffer.contents() + 8, sz - 8), false);
-            if (set_endpoint && repl.source_endpoint)
+          case rdv::Command::ping:
             {
-              this->_public_endpoint = *repl.source_endpoint;
+              rdv::Message reply;
+              reply.id = this->_id;
+              reply.command = rdv::Command::pong;
+              reply.source_endpoint = endpoint;
+              reply.target_address = repl.target_address;
+              this->_send_message(reply, endpoint, binary);
             }
-            ELLE_DEBUG("got message from %s, code %s", endpoint,
-                       (int)repl.command);
-            switch (repl.command)
+            break;
+          case rdv::Command::pong:
             {
-            case rdv::Command::ping:
+              ELLE_DEBUG("pong from '%s' (%s)", repl.id, repl.target_address ?
+                *repl.target_address : "");
+              auto probe = this->_probes.find(endpoint);
+              if (probe != this->_probes.end())
               {
-                rdv::Message reply;
-                reply.id = this->_id;
-                reply.command = rdv::Command::pong;
-                reply.source_endpoint = endpoint;
-                reply.target_address = repl.target_address;
-                elle::Buffer buf = elle::serialization::json::serialize(reply,
-                                                                        false);
-                this->_send_with_magik(buf, endpoint);
+                if (!probe->second.retransmitted)
+                  this->_rtt_sample(Clock::now() - probe->second.sent);
+                this->_probes.erase(probe);
               }
-              break;
-            case rdv::Command::pong:
+              // The first endpoint to answer wins.
+              auto it = this->_contacts.find(repl.id);
+              if (it != this->_contacts.end() && !it->second.barrier.opened())
+              {
+                ELLE_TRACE("opening result barrier");
+                it->second.set_result(endpoint);
+                it->second.barrier.open();
+              }
+              if (repl.target_address)
               {
-                ELLE_DEBUG("pong from '%s' (%s)", repl.id, repl.target_address ?
-                  *repl.target_address : "");
-                auto it = this->_contacts.find(repl.id);
-                if (it != this->_contacts.end())
+                auto it = this->_contacts.find(*repl.target_address);
+                if (it != this->_contacts.end() &&
+                    !it->second.barrier.opened())
                 {
                   ELLE_TRACE("opening result barrier");
                   it->second.set_result(endpoint);
                   it->second.barrier.open();
                 }
-                if (repl.target_address)
-                {
-                  auto it = this->_contacts.find(*repl.target_address);
-                  if (it != this->_contacts.end())
-                  {
-                    ELLE_TRACE("opening result barrier");
-                    it->second.set_result(endpoint);
-                    it->second.barrier.open();
-                  }
-                }
               }
-              break;
-            case rdv::Command::connect:
+            }
+            break;
+          case rdv::Command::connect:
+            {
+              ELLE_TRACE("connect result tgt=%s, peer=%s",
+                         *repl.target_address, !!repl.target_endpoint);
+              auto it = this->_contacts.find(*repl.target_address);
+              if (it != this->_contacts.end() && !it->second.barrier.opened())
               {
-                ELLE_TRACE("connect result tgt=%s, peer=%s",
-                           *repl.target_address, !!repl.target_endpoint);
-                auto it = this->_contacts.find(*repl.target_address);
-                if (it != this->_contacts.end() && !it->second.barrier.opened())
+                if (repl.target_endpoint)
                 {
-                  if (repl.target_endpoint)
-                  {
-                    // set result but do not open barrier yet, so that
-                    // contact() can retry pinging it
-                    it->second.set_result(*repl.target_endpoint);
-                    // give it a ping
-                    this->_send_ping(*repl.target_endpoint);
-                  }
-                  else
-                  { // nothing to do, contact() will resend periodically
-                  }
+                  // set result but do not open barrier yet, so that
+                  // contact() can retry pinging it
+                  it->second.set_result(*repl.target_endpoint);
+                  // give it a ping
+                  this->_send_ping(*repl.target_endpoint);
                 }
-              }
-              break;
-            case rdv::Command::connect_requested:
-              { // add to breach requests
-                ELLE_ASSERT(repl.target_endpoint);
-                ELLE_TRACE("connect_requested, id=%s, ep=%s",
-                  repl.id, *repl.target_endpoint);
-                auto it = std::find_if(
-                  this->_breach_requests.begin(),
-                  this->_breach_requests.end(),
-                  [&](std::pair<Endpoint, int>const& b)
-                  {
-                    return b.first == *repl.target_endpoint;
-                  });
-                if (it != _breach_requests.end())
-                  it->second += 5;
                 else
-                  this->_breach_requests.push_back(
-                    std::make_pair(*repl.target_endpoint, 5));
+                { // nothing to do, contact() will resend periodically
+                }
               }
-              break;
-            case rdv::Command::error:
-              break;
             }
+            break;
+          case rdv::Command::connect_requested:
+            { // add to breach requests
+              ELLE_ASSERT(repl.target_endpoint);
+              ELLE_TRACE("connect_requested, id=%s, ep=%s",
+                repl.id, *repl.target_endpoint);
+              auto it = std::find_if(
+                this->_breach_requests.begin(),
+                this->_breach_requests.end(),
+                [&](std::pair<Endpoint, int>const& b)
+                {
+                  return b.first == *repl.target_endpoint;
+                });
+              if (it != _breach_requests.end())
+                it->second += 5;
+              else
+                this->_breach_requests.push_back(
+                  std::make_pair(*repl.target_endpoint, 5));
+            }
+            break;
+          case rdv::Command::error:
+            break;
           }
-          else
-            return sz;
         }
+        else
+          return false;
+        return true;
       }
 
       Endpoint
@@ -226,60 +263,97 @@ namespace elle
             if (--it->second.waiters <= 0)
               this->_contacts.erase(it);
           });
-        auto now = Clock::now();
-        while (true)
+        auto const start = Clock::now();
+        auto requested = Time();
+        for (int attempt = 0; ; ++attempt)
         {
-          if (!endpoints.empty())
+          auto& c = this->_contacts.at(contactid);
+          // Race every candidate, pacing the burst so it does not trip NAT
+          // and firewall rate limits.
+          auto candidates = endpoints;
+          auto const rdv_result =
+            c.result && Clock::now() - c.result_time < 10s;
+          if (rdv_result && !c.barrier.opened())
+            // RDV gave us an enpoint, but we are not connected to it yet.
+            candidates.push_back(*c.result);
+          ELLE_TRACE("probe %s candidates for id=%s, attempt %s",
+                     candidates.size(), contactid, attempt);
+          for (auto it = candidates.begin(); it != candidates.end(); ++it)
           {
-            // try known endpoints
-            ELLE_TRACE("pinging id=%s", contactid);
-            for (auto const& ep: endpoints)
-              this->_send_ping(ep, contactid);
+            if (c.barrier.opened())
+              break;
+            if (it != candidates.begin())
+              reactor::sleep(this->_pacing);
+            this->_send_ping(*it, contactid);
           }
-          // try establishing link through RDV.
-          auto const& c = this->_contacts.at(contactid);
+          // Try establishing link through RDV.
           if (!c.barrier.opened()
+              && !rdv_result
               && this->_server_reached.opened()
-              && !id.empty())
+              && !id.empty()
+              && Clock::now() - requested >= max_rto)
           {
-            if (c.result && Clock::now() - c.result_time < 10s)
-            {
-              // RDV gave us an enpoint, but we are not connected to it yet,
-              // ping it.
-              this->_send_ping(*c.result);
-            }
-            else
-            {
-              rdv::Message req;
-              req.command = rdv::Command::connect;
-              req.id = this->_id;
-              req.target_address = id;
-              auto buf = elle::serialization::json::serialize(req, false);
-              this->_send_to_failsafe(buf, _server);
-            }
+            rdv::Message req;
+            req.command = rdv::Command::connect;
+            req.id = this->_id;
+            req.target_address = id;
+            this->_send_message(req, this->_server, this->_server_binary);
+            requested = Clock::now();
           }
-          if (reactor::wait(this->_contacts.at(contactid).barrier, 500ms))
+          if (reactor::wait(c.barrier, this->_retransmission_timeout(attempt)))
           {
-            auto& c = _contacts.at(contactid);
             if (c.result)
             {
-              ELLE_TRACE("got result: %s", *c.result);
+              ELLE_TRACE("got result in %s: %s",
+                         Clock::now() - start, *c.result);
               return *c.result;
             }
             else
               throw elle::Error(elle::sprintf("contact(%s) aborted", id));
           }
-          else if (timeout && Clock::now() - now > *timeout)
+          else if (timeout && Clock::now() - start > *timeout)
             throw TimeOut();
         }
       }
 
+      Duration
+      RDVSocket::_retransmission_timeout(int attempt) const
+      {
+        auto res = this->_rtt ?
+          *this->_rtt + 4 * this->_rtt_variance :
+          this->_initial_rto;
+        res = std::max(res, min_rto);
+        for (int i = 0; i < attempt && res < max_rto; ++i)
+          res *= 2;
+        return std::min(res, max_rto);
+      }
+
+      void
+      RDVSocket::_rtt_sample(Duration sample)
+      {
+        // RFC 6298 smoothing.
+        if (!this->_rtt)
+        {
+          this->_rtt = sample;
+          this->_rtt_variance = sample / 2;
+        }
+        else
+        {
+          auto const delta = *this->_rtt > sample ?
+            *this->_rtt - sample : sample - *this->_rtt;
+          this->_rtt_variance = (this->_rtt_variance * 3 + delta) / 4;
+          this->_rtt = (*this->_rtt * 7 + sample) / 8;
+        }
+        ELLE_DEBUG("%s: round-trip time %s, smoothed %s",
+                   this, sample, *this->_rtt);
+      }
+
       void
-      RDVSocket::_send_with_magik(elle::Buffer const& b, Endpoint peer)
+      RDVSocket::_send_message(rdv::Message const& message,
+                               Endpoint peer,
+                               bool binary)
       {
-        elle::Buffer data;
-        data.append(reactor::network::rdv::rdv_magic, 8);
-        data.append(b.contents(), b.size());
+        auto const data = rdv::encode(message, binary);
         this->_send_to_failsafe(
           elle::ConstWeakBuffer(data.contents(), data.size()),
           peer);
@@ -289,13 +363,33 @@ namespace elle
       RDVSocket::_send_ping(Endpoint target, std::string const& tid)
       {
         ELLE_DEBUG("send ping to %s", target);
+        auto const now = Clock::now();
+        auto probe = this->_probes.find(target);
+        if (probe == this->_probes.end())
+        {
+          // Forget about peers that never answered.
+          if (this->_probes.size() >= 64)
+            for (auto it = this->_probes.begin(); it != this->_probes.end();)
+              if (now - it->second.sent > 10s)
+                it = this->_probes.erase(it);
+              else
+                ++it;
+          this->_probes.emplace(target, Probe{now, false});
+        }
+        else
+        {
+          probe->second.sent = now;
+          probe->second.retransmitted = true;
+        }
         rdv::Message ping;
         ping.command = rdv::Command::ping;
         ping.id = this->_id;
         ping.source_endpoint = target;
         ping.target_address = tid;
-        elle::Buffer buf = elle::serialization::json::serialize(ping, false);
-        this->_send_with_magik(buf, target);
+        // Peers may predate the binary encoding, only the server negotiated
+        // it.
+        this->_send_message(
+          ping, target, target == this->_server && this->_server_binary);
       }
 
       void
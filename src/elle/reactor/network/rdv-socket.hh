@@ -1,5 +1,8 @@
 #pragma once
 
+#include <map>
+
+#include <elle/reactor/network/rdv.hh>
 #include <elle/reactor/network/udp-socket.hh>
 #include <elle/reactor/Barrier.hh>
 #include <elle/reactor/MultiLockBarrier.hh>
@@ -59,8 +62,23 @@ namespace elle
         receive_from(elle::WeakBuffer buffer,
                      boost::asio::ip::udp::endpoint& endpoint,
                      DurationOpt timeout = {});
+        /// Handle a packet received out of band, e.g. by a sibling socket
+        /// sharing our port.
+        ///
+        /// \param buffer The received datagram.
+        /// \param endpoint The Endpoint of the peer.
+        /// \returns Whether the packet was an RDV or registered reader packet
+        ///          and has been consumed.
+        bool
+        process(elle::WeakBuffer buffer, Endpoint const& endpoint);
         /// Contact an RDV-aware peer.
         ///
+        /// Every candidate endpoint, the given ones and the one the RDV
+        /// server reports, is probed in parallel, in bursts paced by
+        /// ELLE_REACTOR_RDV_PACING milliseconds. Bursts are retransmitted after
+        /// a delay derived from the measured round-trip time, doubling up to
+        /// 500ms. The first endpoint to answer wins.
+        ///
         /// \param id ID if the peer.
         /// \param endpoints The extra EndPoints to contact.
         /// \param timeout The maximum duration before it times out.
@@ -87,8 +105,16 @@ namespace elle
         void
         unregister_reader(std::string const& magic);
         ELLE_ATTRIBUTE_R(Endpoint, public_endpoint);
+        /// Smoothed round-trip time to peers and the server, once measured.
+        ELLE_ATTRIBUTE_R(DurationOpt, rtt);
 
       private:
+        /// Delay before retransmitting the \a attempt-th probe burst.
+        Duration
+        _retransmission_timeout(int attempt) const;
+        /// Account for a measured round-trip time.
+        void
+        _rtt_sample(Duration sample);
         void
         _send_to_failsafe(elle::ConstWeakBuffer buffer, Endpoint endpoint);
         void
@@ -98,9 +124,14 @@ namespace elle
         void
         _loop_keep_alive();
         void
-        _send_with_magik(elle::Buffer const& buf, Endpoint target);
+        _send_message(rdv::Message const& message,
+                      Endpoint target,
+                      bool binary);
         ELLE_ATTRIBUTE(std::string, id);
         ELLE_ATTRIBUTE(Endpoint, server);
+        /// Whether the server supports the binary encoding. Assumed until it
+        /// answers in JSON.
+        ELLE_ATTRIBUTE(bool, server_binary);
         ELLE_ATTRIBUTE(Endpoint, self);
         ELLE_ATTRIBUTE(Barrier, server_reached);
         struct ContactInfo
@@ -122,6 +153,21 @@ namespace elle
         ELLE_ATTRIBUTE(reactor::Thread, breacher);
         ELLE_ATTRIBUTE(reactor::Thread, keep_alive);
         ELLE_ATTRIBUTE(MultiLockBarrier, tasks);
+        /// Outstanding pings, to measure round-trip times.
+        struct Probe
+        {
+          Time sent;
+          /// Whether it was sent again before being answered, making the
+          /// measure ambiguous.
+          bool retransmitted;
+        };
+        using Probes = std::map<Endpoint, Probe>;
+        ELLE_ATTRIBUTE(Probes, probes);
+        ELLE_ATTRIBUTE(Duration, rtt_variance);
+        /// Delay between probes of a burst.
+        ELLE_ATTRIBUTE(Duration, pacing);
+        /// Retransmission delay until a round-trip time is measured.
+        ELLE_ATTRIBUTE(Duration, initial_rto);
       };
     }
   }
@@ -1,6 +1,9 @@
+#pragma once
+
 #include <boost/optional.hpp>
 #include <elle/reactor/asio.hh>
 
+#include <elle/err.hh>
 #include <elle/serialization/json.hh>
 
 namespace elle
@@ -14,6 +17,8 @@ namespace elle
         using Endpoint = boost::asio::ip::udp::endpoint;
 
         constexpr char const* rdv_magic = "RDVMAGIK"; // 8 bytes
+        /// Magic announcing the compact binary encoding (see encode).
+        constexpr char const* rdv_magic_binary = "RDVMAGIB"; // 8 bytes
 
         enum class Command
         {
@@ -47,6 +52,191 @@ namespace elle
           boost::optional<std::string>  target_address;
           using serialization_tag = elle::serialization_tag;
         };
+
+        namespace details
+        {
+          enum Fields
+          {
+            field_source_endpoint = 1,
+            field_target_endpoint = 2,
+            field_target_address = 4,
+          };
+
+          inline
+          void
+          encode_endpoint(elle::Buffer& out, Endpoint const& ep)
+          {
+            if (ep.address().is_v4())
+            {
+              auto const addr = ep.address().to_v4().to_bytes();
+              out.append("\x04", 1);
+              out.append(addr.data(), addr.size());
+            }
+            else
+            {
+              auto const addr = ep.address().to_v6().to_bytes();
+              out.append("\x06", 1);
+              out.append(addr.data(), addr.size());
+            }
+            unsigned char const port[2] = {
+              static_cast<unsigned char>(ep.port() >> 8),
+              static_cast<unsigned char>(ep.port() & 0xff),
+            };
+            out.append(port, 2);
+          }
+
+          /// Cursor over a binary message, throwing on truncation.
+          struct Reader
+          {
+            unsigned char const* pos;
+            unsigned char const* end;
+
+            unsigned char const*
+            take(std::size_t size)
+            {
+              if (std::size_t(this->end - this->pos) < size)
+                elle::err("truncated binary RDV message");
+              auto res = this->pos;
+              this->pos += size;
+              return res;
+            }
+
+            int
+            byte()
+            {
+              return *this->take(1);
+            }
+
+            Endpoint
+            endpoint()
+            {
+              auto const family = this->byte();
+              boost::asio::ip::address address;
+              if (family == 4)
+              {
+                auto bytes = boost::asio::ip::address_v4::bytes_type();
+                memcpy(bytes.data(), this->take(bytes.size()), bytes.size());
+                address = boost::asio::ip::address_v4(bytes);
+              }
+              else if (family == 6)
+              {
+                auto bytes = boost::asio::ip::address_v6::bytes_type();
+                memcpy(bytes.data(), this->take(bytes.size()), bytes.size());
+                address = boost::asio::ip::address_v6(bytes);
+              }
+              else
+                elle::err("invalid binary RDV address family: %s", family);
+              auto const port = this->take(2);
+              return Endpoint(address, (port[0] << 8) | port[1]);
+            }
+          };
+        }
+
+        /// Encode a message, magic included.
+        ///
+        /// The binary encoding is: magic, command byte, field presence
+        /// bitmask, identifier length byte and bytes, then the present
+        /// fields. Endpoints are a family byte (4 or 6), the address and the
+        /// big-endian port; the target address is a big-endian 16 bits length
+        /// followed by its bytes.
+        ///
+        /// \param message The message to encode.
+        /// \param binary Whether to use the binary encoding rather than JSON.
+        /// \returns The packet to send.
+        inline
+        elle::Buffer
+        encode(Message const& message, bool binary)
+        {
+          if (!binary)
+          {
+            elle::Buffer res(rdv_magic, 8);
+            auto json = elle::serialization::json::serialize(message, false);
+            res.append(json.contents(), json.size());
+            return res;
+          }
+          if (message.id.size() > 255)
+            elle::err("RDV identifier too long: %s", message.id);
+          auto res = elle::Buffer{};
+          res.capacity(64 + message.id.size());
+          res.append(rdv_magic_binary, 8);
+          unsigned char const header[3] = {
+            static_cast<unsigned char>(message.command),
+            static_cast<unsigned char>(
+              (message.source_endpoint ? details::field_source_endpoint : 0) |
+              (message.target_endpoint ? details::field_target_endpoint : 0) |
+              (message.target_address ? details::field_target_address : 0)),
+            static_cast<unsigned char>(message.id.size()),
+          };
+          res.append(header, sizeof header);
+          res.append(message.id.data(), message.id.size());
+          if (message.source_endpoint)
+            details::encode_endpoint(res, *message.source_endpoint);
+          if (message.target_endpoint)
+            details::encode_endpoint(res, *message.target_endpoint);
+          if (auto const& address = message.target_address)
+          {
+            if (address->size() > 0xffff)
+              elle::err("RDV target address too long");
+            unsigned char const size[2] = {
+              static_cast<unsigned char>(address->size() >> 8),
+              static_cast<unsigned char>(address->size() & 0xff),
+            };
+            res.append(size, 2);
+            res.append(address->data(), address->size());
+          }
+          return res;
+        }
+
+        /// Decode a packet in either encoding.
+        ///
+        /// Packets without magic are decoded as JSON, as sent by legacy
+        /// peers.
+        ///
+        /// \param packet The received packet, magic included.
+        /// \param binary Set to whether the packet was binary encoded, so
+        ///               replies can use the same encoding.
+        /// \returns The decoded message.
+        inline
+        Message
+        decode(elle::ConstWeakBuffer packet, bool& binary)
+        {
+          binary = packet.size() >= 8 &&
+            memcmp(packet.contents(), rdv_magic_binary, 8) == 0;
+          if (!binary)
+          {
+            auto const offset = packet.size() >= 8 &&
+              memcmp(packet.contents(), rdv_magic, 8) == 0 ? 8 : 0;
+            return elle::serialization::json::deserialize<Message>(
+              elle::Buffer(packet.contents() + offset,
+                           packet.size() - offset),
+              false);
+          }
+          auto reader =
+            details::Reader{packet.contents() + 8,
+                            packet.contents() + packet.size()};
+          auto res = Message{};
+          auto const command = reader.byte();
+          if (command > static_cast<int>(Command::error))
+            elle::err("invalid binary RDV command: %s", command);
+          res.command = static_cast<Command>(command);
+          auto const fields = reader.byte();
+          auto const id_size = reader.byte();
+          auto const id = reader.take(id_size);
+          res.id.assign(reinterpret_cast<char const*>(id), id_size);
+          if (fields & details::field_source_endpoint)
+            res.source_endpoint = reader.endpoint();
+          if (fields & details::field_target_endpoint)
+            res.target_endpoint = reader.endpoint();
+          if (fields & details::field_target_address)
+          {
+            auto const size = reader.take(2);
+            auto const address_size = (size[0] << 8) | size[1];
+            res.target_address = std::string(
+              reinterpret_cast<char const*>(reader.take(address_size)),
+              address_size);
+          }
+          return res;
+        }
       }
     }
   }
@@ -0,0 +1,314 @@
+#include <elle/reactor/network/relay.hh>
+
+#ifdef ELLE_LINUX
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+#include <cstring>
+
+#include <elle/Buffer.hh>
+#include <elle/finally.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+#include <elle/With.hh>
+
+#include <elle/reactor/network/Error.hh>
+#include <elle/reactor/network/tcp-socket.hh>
+#include <elle/reactor/network/utp-socket.hh>
+#ifdef REACTOR_NETWORK_UNIX_DOMAIN_SOCKET
+# include <elle/reactor/network/unix-domain-socket.hh>
+#endif
+#include <elle/reactor/Operation.hh>
+#include <elle/reactor/Scope.hh>
+#include <elle/reactor/scheduler.hh>
+
+ELLE_LOG_COMPONENT("elle.reactor.network.Relay");
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      namespace
+      {
+#ifdef ELLE_LINUX
+        /// Wait until a TCP socket is readable or writable.
+        class Ready
+          : public Operation
+        {
+        public:
+          using AsioSocket = boost::asio::ip::tcp::socket;
+          Ready(AsioSocket& socket, bool write)
+            : Operation(*Scheduler::scheduler())
+            , _socket(socket)
+            , _write(write)
+          {}
+
+          void
+          print(std::ostream& stream) const override
+          {
+            stream << "relay wait for "
+                   << (this->_write ? "writability" : "readability");
+          }
+
+        protected:
+          void
+          _start() override
+          {
+            // Errors are reported by the next splice.
+            auto handler = [this] (boost::system::error_code const&,
+                                   std::size_t)
+              {
+                this->done();
+              };
+            if (this->_write)
+              this->_socket.async_write_some(boost::asio::null_buffers(),
+                                             handler);
+            else
+              this->_socket.async_read_some(boost::asio::null_buffers(),
+                                            handler);
+          }
+
+          void
+          _abort() override
+          {
+            boost::system::error_code ignored;
+            this->_socket.cancel(ignored);
+            reactor::wait(*this);
+          }
+
+        private:
+          ELLE_ATTRIBUTE(AsioSocket&, socket);
+          ELLE_ATTRIBUTE(bool, write);
+        };
+
+        void
+        ready(Ready::AsioSocket& socket, bool write)
+        {
+          Ready op(socket, write);
+          op.run();
+        }
+#endif
+
+        /// Shut down the sending half of \a end.
+        ///
+        /// @returns Whether \a end supports half-closing.
+        bool
+        half_close(Relay::End const& end)
+        {
+          auto const shutdown = [] (auto& socket)
+            {
+              boost::system::error_code error;
+              socket.shutdown(socket.shutdown_send, error);
+              if (error)
+                ELLE_TRACE("unable to shut down %s: %s",
+                           socket.native_handle(), error.message());
+            };
+          if (auto tcp = dynamic_cast<TCPSocket*>(end.socket()))
+          {
+            shutdown(*tcp->socket());
+            return true;
+          }
+#ifdef REACTOR_NETWORK_UNIX_DOMAIN_SOCKET
+          if (auto local = dynamic_cast<UnixDomainSocket*>(end.socket()))
+          {
+            shutdown(*local->socket());
+            return true;
+          }
+#endif
+          return false;
+        }
+      }
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      Relay::End::End(Socket& socket)
+        : _socket(&socket)
+        , _utp(nullptr)
+      {}
+
+      Relay::End::End(UTPSocket& socket)
+        : _socket(nullptr)
+        , _utp(&socket)
+      {}
+
+      Relay::Relay(End a, End b, Size buffer_size)
+        : _a(std::move(a))
+        , _b(std::move(b))
+        , _buffer_size(buffer_size ? buffer_size :
+                       elle::os::getenv("ELLE_REACTOR_RELAY_BUFFER", 65536))
+        , _forward_bytes(0)
+        , _backward_bytes(0)
+        , _spliced(false)
+      {}
+
+      /*--------.
+      | Running |
+      `--------*/
+
+      void
+      Relay::run()
+      {
+        ELLE_TRACE_SCOPE("%s: run", this);
+        elle::With<Scope>() << [&] (Scope& scope)
+        {
+          auto const direction =
+            [&] (std::string const& name,
+                 End const& source, End const& destination, int64_t& bytes)
+            {
+              scope.run_background(
+                elle::sprintf("%s %s", this, name),
+                [this, &scope, &source, &destination, &bytes, name]
+                {
+                  if (!this->_relay(source, destination, bytes))
+                  {
+                    ELLE_TRACE("%s: %s direction closed and cannot be "
+                               "half-closed, stop", this, name);
+                    scope.terminate_now();
+                  }
+                });
+            };
+          direction("forward", this->_a, this->_b, this->_forward_bytes);
+          direction("backward", this->_b, this->_a, this->_backward_bytes);
+          reactor::wait(scope);
+        };
+        ELLE_TRACE("%s: done after %s bytes forward, %s backward",
+                   this, this->_forward_bytes, this->_backward_bytes);
+      }
+
+      bool
+      Relay::_relay(End const& source, End const& destination, int64_t& bytes)
+      {
+        try
+        {
+#ifdef ELLE_LINUX
+          auto const in = dynamic_cast<TCPSocket*>(source.socket());
+          auto const out = dynamic_cast<TCPSocket*>(destination.socket());
+          if (in && out && !in->read_shaper() && !out->write_shaper())
+          {
+            this->_spliced = true;
+            this->_splice(*in, *out, bytes);
+          }
+          else
+#endif
+            this->_buffered(source, destination, bytes);
+        }
+        catch (ConnectionClosed const&)
+        {
+          ELLE_DEBUG("%s: connection closed: %s",
+                     this, elle::exception_string());
+        }
+        return half_close(destination);
+      }
+
+      void
+      Relay::_buffered(End const& source, End const& destination,
+                       int64_t& bytes)
+      {
+        ELLE_DEBUG_SCOPE("%s: relay through a buffer", this);
+        auto buffer = elle::Buffer(this->_buffer_size);
+        while (true)
+        {
+          auto data = elle::ConstWeakBuffer();
+          if (auto socket = source.socket())
+            data = elle::ConstWeakBuffer(
+              buffer.contents(), socket->read_some(elle::WeakBuffer(buffer)));
+          else
+          {
+            buffer = source.utp()->read_some(this->_buffer_size);
+            data = buffer;
+          }
+          if (auto socket = destination.socket())
+            socket->write(data);
+          else
+            destination.utp()->write(data);
+          bytes += data.size();
+        }
+      }
+
+#ifdef ELLE_LINUX
+      void
+      Relay::_splice(TCPSocket& source, TCPSocket& destination, int64_t& bytes)
+      {
+        ELLE_DEBUG_SCOPE("%s: relay with splice", this);
+        // Forward what a read_until might have buffered already.
+        if (auto const cached = source._streambuffer.size())
+        {
+          auto const data = source.read_some(cached);
+          destination.write(data);
+          bytes += data.size();
+        }
+        int pipe[2];
+        if (::pipe2(pipe, O_CLOEXEC | O_NONBLOCK) < 0)
+          throw Error(elle::sprintf("unable to create pipe: %s",
+                                    std::strerror(errno)));
+        elle::SafeFinally close_pipe([&]
+          {
+            ::close(pipe[0]);
+            ::close(pipe[1]);
+          });
+        // Best effort, the default pipe size is fine too.
+        ::fcntl(pipe[1], F_SETPIPE_SZ, this->_buffer_size);
+        auto& in = *source.socket();
+        auto& out = *destination.socket();
+        in.native_non_blocking(true);
+        out.native_non_blocking(true);
+        auto const flags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+        auto const fail = [&] (std::string const& what, int error)
+          {
+            if (error == ECONNRESET || error == EPIPE)
+              throw ConnectionClosed(std::strerror(error));
+            throw Error(elle::sprintf("unable to splice %s: %s",
+                                      what, std::strerror(error)));
+          };
+        while (true)
+        {
+          auto const n = ::splice(in.native_handle(), nullptr,
+                                  pipe[1], nullptr,
+                                  this->_buffer_size, flags);
+          if (n == 0)
+            return;
+          else if (n < 0)
+          {
+            if (errno == EAGAIN)
+              ready(in, false);
+            else
+              fail("from source", errno);
+            continue;
+          }
+          for (auto pending = n; pending > 0;)
+          {
+            auto const m = ::splice(pipe[0], nullptr,
+                                    out.native_handle(), nullptr,
+                                    pending, flags);
+            if (m < 0)
+            {
+              if (errno == EAGAIN)
+                ready(out, true);
+              else
+                fail("to destination", errno);
+              continue;
+            }
+            pending -= m;
+            bytes += m;
+          }
+        }
+      }
+#endif
+
+      /*----------.
+      | Printable |
+      `----------*/
+
+      void
+      Relay::print(std::ostream& stream) const
+      {
+        elle::fprintf(stream, "Relay(%s)", static_cast<void const*>(this));
+      }
+    }
+  }
+}
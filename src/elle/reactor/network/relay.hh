@@ -0,0 +1,115 @@
+#pragma once
+
+#include <elle/Printable.hh>
+#include <elle/attribute.hh>
+#include <elle/reactor/network/fwd.hh>
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      /// Relay data between two sockets, in both directions, until both are
+      /// closed.
+      ///
+      /// Between two plain TCP sockets on Linux, data is moved with splice(2)
+      /// through a pipe and never copied to user space. Other sockets, such as
+      /// SSL or uTP ones, or shaped sockets, fall back to reading into a
+      /// buffer and writing it.
+      ///
+      /// When one side stops sending, the relay shuts down the sending half
+      /// of the other side and keeps relaying the other direction. Sockets
+      /// that cannot be half-closed end the whole relay instead.
+      ///
+      /// The sockets must not be read from or written to by anyone else while
+      /// relaying.
+      ///
+      /// @code{.cc}
+      ///
+      /// auto client = server.accept();
+      /// TCPSocket upstream("backend", 8080);
+      /// Relay relay(*client, upstream);
+      /// relay.run();
+      /// ELLE_LOG("relayed %s bytes up, %s down",
+      ///          relay.forward_bytes(), relay.backward_bytes());
+      ///
+      /// @endcode
+      class Relay
+        : public elle::Printable
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = Relay;
+        /// One side of a relay.
+        class End
+        {
+        public:
+          End(Socket& socket);
+          End(UTPSocket& socket);
+          ELLE_ATTRIBUTE_R(Socket*, socket);
+          ELLE_ATTRIBUTE_R(UTPSocket*, utp);
+        };
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        /// Create a relay between \a a and \a b.
+        ///
+        /// @param a One side.
+        /// @param b The other side.
+        /// @param buffer_size The size of the pipe or buffer used in each
+        ///                    direction. Defaults to ELLE_REACTOR_RELAY_BUFFER,
+        ///                    64KiB.
+        Relay(End a, End b, Size buffer_size = 0);
+
+      /*--------.
+      | Running |
+      `--------*/
+      public:
+        /// Relay until both directions are closed.
+        ///
+        /// @throws network::Error if a socket fails for another reason than
+        ///         being closed by its peer.
+        void
+        run();
+      private:
+        /// Relay from \a source to \a destination until \a source closes.
+        ///
+        /// @returns Whether \a destination could be half-closed.
+        bool
+        _relay(End const& source, End const& destination, int64_t& bytes);
+        void
+        _buffered(End const& source, End const& destination, int64_t& bytes);
+#ifdef ELLE_LINUX
+        void
+        _splice(TCPSocket& source, TCPSocket& destination, int64_t& bytes);
+#endif
+
+      /*-----------.
+      | Attributes |
+      `-----------*/
+      public:
+        ELLE_ATTRIBUTE(End, a);
+        ELLE_ATTRIBUTE(End, b);
+        ELLE_ATTRIBUTE_R(Size, buffer_size);
+        /// Bytes relayed from the first side to the second.
+        ELLE_ATTRIBUTE_R(int64_t, forward_bytes);
+        /// Bytes relayed from the second side to the first.
+        ELLE_ATTRIBUTE_R(int64_t, backward_bytes);
+        /// Whether data was moved with splice(2).
+        ELLE_ATTRIBUTE_R(bool, spliced);
+
+      /*----------.
+      | Printable |
+      `----------*/
+      public:
+        void
+        print(std::ostream& stream) const override;
+      };
+    }
+  }
+}
@@ -1,13 +1,24 @@
 #include <elle/reactor/network/resolve.hh>
 
+#include <algorithm>
+#include <cctype>
 #include <utility>
 
+#ifndef ELLE_WINDOWS
+# include <netdb.h>
+#endif
+
+#include <boost/functional/hash.hpp>
+
+#include <elle/finally.hh>
 #include <elle/log.hh>
 #include <elle/os/environ.hh>
 #include <elle/printf.hh>
 
+#include <elle/reactor/Barrier.hh>
 #include <elle/reactor/network/Error.hh>
 #include <elle/reactor/Operation.hh>
+#include <elle/reactor/Scope.hh>
 #include <elle/reactor/scheduler.hh>
 
 ELLE_LOG_COMPONENT("elle.reactor.network.resolve");
@@ -20,6 +31,17 @@ namespace elle
     {
       namespace
       {
+        /// Exception thrown when DNS invited us to retry.
+        class TryAgain
+          : public Error
+        {
+        public:
+          using Super = Error;
+          TryAgain()
+            : Super{"Host not found (non-authoritative), try again later"}
+          {}
+        };
+
         /// DNS lookup implementation.
         template <typename Protocol>
         class Resolution: public Operation
@@ -29,35 +51,25 @@ namespace elle
           using Resolver = typename Protocol::resolver;
           using EndPoint = typename Protocol::resolver::endpoint_type;
           using EndPoints = std::vector<EndPoint>;
-          Resolution(std::string hostname, std::string service,
-                     bool ipv4_only)
+          Resolution(std::string hostname, std::string service, bool v6)
             : Super{*reactor::Scheduler::scheduler()}
             , _resolver{reactor::Scheduler::scheduler()->io_service()}
             , _canceled{false}
             , _hostname{std::move(hostname)}
             , _service{std::move(service)}
             , _end_points{}
-            , _ipv4_only{ipv4_only}
+            , _v6{v6}
           {}
 
           void
           print(std::ostream& stream) const override
           {
             elle::fprintf(stream,
-                          "resolution of %s: %s", this->_hostname, this->_service);
+                          "resolution of %s: %s (%s)",
+                          this->_hostname, this->_service,
+                          this->_v6 ? "IPv6" : "IPv4");
           }
 
-          /// Exception thrown when DNS invited us to retry.
-          class TryAgain
-            : public Error
-          {
-          public:
-            using Super = Error;
-            TryAgain()
-              : Super{"Host not found (non-authoritative), try again later"}
-            {}
-          };
-
         protected:
           void
           _abort() override
@@ -73,10 +85,9 @@ namespace elle
           {
             ELLE_TRACE("resolve %s:%s", this->_hostname, this->_service);
             using Query = typename Resolver::query;
-            auto const query =
-              this->ipv4_only()
-              ? Query(Protocol::v4(), this->_hostname, this->_service)
-              : Query(this->_hostname, this->_service);
+            auto const query = Query(
+              this->_v6 ? Protocol::v6() : Protocol::v4(),
+              this->_hostname, this->_service);
             this->_resolver.async_resolve(
               query,
               [this](boost::system::error_code const& error,
@@ -136,33 +147,68 @@ namespace elle
           ELLE_ATTRIBUTE(std::string, hostname);
           ELLE_ATTRIBUTE(std::string, service);
           ELLE_ATTRIBUTE_R(EndPoints, end_points);
-          ELLE_ATTRIBUTE_R(bool, ipv4_only);
+          ELLE_ATTRIBUTE_R(bool, v6);
         };
 
+        /// Look addresses up with the system resolver.
+        Resolver::Answer
+        system_lookup(std::string const& hostname, bool v6)
+        {
+          auto&& resolution =
+            Resolution<boost::asio::ip::tcp>(hostname, "0", v6);
+          resolution.run();
+          auto res = Resolver::Answer{};
+          for (auto const& endpoint: resolution.end_points())
+            res.addresses.emplace_back(endpoint.address());
+          return res;
+        }
+
+        /// The port number of \a service, numeric or as found in the system
+        /// services database. No network query is involved.
+        template <typename Protocol>
+        unsigned short
+        service_port(std::string const& hostname, std::string const& service)
+        {
+          if (!service.empty() &&
+              std::all_of(service.begin(), service.end(),
+                          [] (char c) { return std::isdigit(c); }))
+          {
+            auto const port = std::stoul(service);
+            if (port > 65535)
+              throw ResolutionError(
+                hostname, elle::sprintf("invalid port: %s", service));
+            return port;
+          }
+          auto hints = addrinfo{};
+          hints.ai_flags = AI_PASSIVE;
+          hints.ai_socktype = Protocol::v4().type();
+          addrinfo* info = nullptr;
+          if (auto const error =
+              ::getaddrinfo(nullptr, service.c_str(), &hints, &info))
+            throw ResolutionError(
+              hostname,
+              elle::sprintf("unknown service %s: %s",
+                            service, ::gai_strerror(error)));
+          elle::SafeFinally cleanup([&] { ::freeaddrinfo(info); });
+          if (info->ai_family == AF_INET6)
+            return ntohs(
+              reinterpret_cast<sockaddr_in6 const*>(info->ai_addr)->sin6_port);
+          else
+            return ntohs(
+              reinterpret_cast<sockaddr_in const*>(info->ai_addr)->sin_port);
+        }
+
         template <typename Protocol>
         std::vector<typename Protocol::resolver::endpoint_type>
         resolve(std::string const& hostname,
                 std::string const& service,
                 ResolveOptions opt)
         {
-          while (0 < opt.num_attempts)
-            try
-            {
-              auto&& resolution
-                = Resolution<Protocol>(hostname, service, opt.ipv4_only);
-              resolution.run();
-              return resolution.end_points();
-            }
-            catch (typename Resolution<Protocol>::TryAgain)
-            {
-              ELLE_DUMP("trying again to resolve %s:%s", hostname, service);
-              --opt.num_attempts;
-            }
-
-          throw ResolutionError(
-            hostname,
-            sprintf("host not found: too many attempts: %s",
-                    make_error_code(boost::asio::error::host_not_found_try_again).message()));
+          auto const port = service_port<Protocol>(hostname, service);
+          auto res = std::vector<typename Protocol::resolver::endpoint_type>{};
+          for (auto const& address: resolver().resolve(hostname, opt))
+            res.emplace_back(address, port);
+          return res;
         }
 
         /// "www.infinit.sh:80" -> pair("www.infinit.sh", "80").
@@ -177,6 +223,207 @@ namespace elle
         }
       }
 
+      /*---------.
+      | Resolver |
+      `---------*/
+
+      /// Lookup in progress, shared by all requests for the same key.
+      struct Resolver::Pending
+      {
+        Barrier done;
+        /// Failure not worth caching, for waiters to rethrow.
+        std::exception_ptr error;
+      };
+
+      std::size_t
+      Resolver::Hash::operator ()(Key const& key) const
+      {
+        auto res = std::hash<std::string>()(key.first);
+        boost::hash_combine(res, key.second);
+        return res;
+      }
+
+      Resolver::Resolver(Lookup lookup)
+        : _lookup(lookup ? std::move(lookup) : Lookup(&system_lookup))
+        , _ttl(std::chrono::seconds(
+                 os::getenv("ELLE_REACTOR_RESOLVE_TTL", 60)))
+        , _negative_ttl(std::chrono::seconds(
+                          os::getenv("ELLE_REACTOR_RESOLVE_NEGATIVE_TTL", 5)))
+        , _resolution_delay(std::chrono::milliseconds(
+                              os::getenv("ELLE_REACTOR_RESOLUTION_DELAY", 50)))
+        , _hits(0)
+        , _lookups(0)
+      {}
+
+      Resolver::~Resolver() = default;
+
+      void
+      Resolver::clear()
+      {
+        this->_cache.clear();
+      }
+
+      Resolver::Addresses
+      Resolver::resolve(std::string const& hostname, ResolveOptions const& opt)
+      {
+        {
+          auto error = boost::system::error_code{};
+          auto const address = Address::from_string(hostname, error);
+          if (!error)
+          {
+            if (opt.ipv4_only && !address.is_v4())
+              throw ResolutionError(hostname, "not an IPv4 address");
+            return {address};
+          }
+        }
+        if (opt.ipv4_only)
+          return this->_resolve(hostname, false, opt.num_attempts);
+        auto v4 = Addresses{};
+        auto v6 = Addresses{};
+        auto error = std::exception_ptr{};
+        elle::With<Scope>() << [&] (Scope& scope)
+        {
+          auto& aaaa = scope.run_background(
+            elle::sprintf("%s AAAA", hostname),
+            [&]
+            {
+              try
+              {
+                v6 = this->_resolve(hostname, true, opt.num_attempts);
+              }
+              catch (ResolutionError const&)
+              {
+                ELLE_DEBUG("no IPv6 address for %s: %s",
+                           hostname, elle::exception_string());
+              }
+            });
+          scope.run_background(
+            elle::sprintf("%s A", hostname),
+            [&]
+            {
+              try
+              {
+                v4 = this->_resolve(hostname, false, opt.num_attempts);
+              }
+              catch (ResolutionError const&)
+              {
+                error = std::current_exception();
+                return;
+              }
+              if (!reactor::wait(aaaa, this->_resolution_delay))
+              {
+                ELLE_DEBUG("no IPv6 answer for %s after %s, use IPv4",
+                           hostname, this->_resolution_delay);
+                aaaa.terminate_now();
+              }
+            });
+          reactor::wait(scope);
+        };
+        if (v4.empty() && v6.empty())
+        {
+          if (error)
+            std::rethrow_exception(error);
+          throw ResolutionError(hostname, "host not found");
+        }
+        auto res = Addresses{};
+        res.reserve(v4.size() + v6.size());
+        for (auto i = 0u; i < std::max(v4.size(), v6.size()); ++i)
+        {
+          if (i < v6.size())
+            res.emplace_back(v6[i]);
+          if (i < v4.size())
+            res.emplace_back(v4[i]);
+        }
+        return res;
+      }
+
+      Resolver::Addresses
+      Resolver::_resolve(std::string const& hostname, bool v6, int attempts)
+      {
+        auto const key = Key(hostname, v6);
+        while (true)
+        {
+          auto const now = Clock::now();
+          auto cached = this->_cache.find(key);
+          if (cached != this->_cache.end())
+          {
+            if (now < cached->second.expiration)
+            {
+              ++this->_hits;
+              if (cached->second.error)
+                std::rethrow_exception(cached->second.error);
+              return cached->second.addresses;
+            }
+            this->_cache.erase(cached);
+          }
+          auto pending = this->_pending.find(key);
+          if (pending == this->_pending.end())
+            break;
+          ELLE_DEBUG("join pending %s lookup of %s",
+                     v6 ? "IPv6" : "IPv4", hostname);
+          auto p = pending->second;
+          reactor::wait(p->done);
+          if (p->error)
+            std::rethrow_exception(p->error);
+          // Otherwise the answer is cached, or the lookup was interrupted and
+          // we take over.
+        }
+        auto p = std::make_shared<Pending>();
+        this->_pending.emplace(key, p);
+        elle::SafeFinally release([&]
+          {
+            this->_pending.erase(key);
+            p->done.open();
+          });
+        // Drop expired entries so the cache does not grow unbounded.
+        for (auto it = this->_cache.begin(); it != this->_cache.end();)
+          if (it->second.expiration <= Clock::now())
+            it = this->_cache.erase(it);
+          else
+            ++it;
+        try
+        {
+          while (0 < attempts)
+            try
+            {
+              ++this->_lookups;
+              auto answer = this->_lookup(hostname, v6);
+              if (answer.addresses.empty())
+                throw ResolutionError(
+                  hostname, "host not found: address list is empty");
+              auto const ttl = answer.ttl.value_or(this->_ttl);
+              this->_cache[key] =
+                Entry{answer.addresses, nullptr, Clock::now() + ttl};
+              return std::move(answer.addresses);
+            }
+            catch (TryAgain const&)
+            {
+              ELLE_DUMP("trying again to resolve %s", hostname);
+              --attempts;
+            }
+        }
+        catch (ResolutionError const&)
+        {
+          this->_cache[key] = Entry{
+            {}, std::current_exception(), Clock::now() + this->_negative_ttl};
+          throw;
+        }
+        // Running out of attempts is transient, share it with the pending
+        // requests but do not cache it.
+        p->error = std::make_exception_ptr(ResolutionError(
+          hostname,
+          sprintf("host not found: too many attempts: %s",
+                  make_error_code(
+                    boost::asio::error::host_not_found_try_again).message())));
+        std::rethrow_exception(p->error);
+      }
+
+      Resolver&
+      resolver()
+      {
+        return reactor::scheduler().resolver();
+      }
+
       /*------.
       | tcp.  |
       `------*/
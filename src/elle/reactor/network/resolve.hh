@@ -1,8 +1,17 @@
 #pragma once
 
+#include <exception>
+#include <functional>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
+#include <boost/optional.hpp>
+
+#include <elle/attribute.hh>
 #include <elle/reactor/asio.hh>
+#include <elle/reactor/duration.hh>
+#include <elle/reactor/fwd.hh>
 
 namespace elle
 {
@@ -23,6 +32,84 @@ namespace elle
         int num_attempts;
       };
 
+      /// Caching host name resolver.
+      ///
+      /// Every Scheduler owns one, used by the resolve_* functions below.
+      /// Answers are cached for their TTL and failures for the negative TTL.
+      /// Concurrent requests for the same host share a single lookup. IPv6 and
+      /// IPv4 are looked up in parallel and merged as RFC 8305 recommends:
+      /// families interleaved, IPv6 first, and IPv6 given a short resolution
+      /// delay when IPv4 answers first.
+      class Resolver
+      {
+      public:
+        using Address = boost::asio::ip::address;
+        using Addresses = std::vector<Address>;
+        /// Answer to a lookup of one address family.
+        struct Answer
+        {
+          Addresses addresses;
+          /// How long the answer may be cached, default TTL if unknown.
+          DurationOpt ttl;
+        };
+        /// Look up the IPv6 or IPv4 addresses of a host name, throwing
+        /// ResolutionError if there are none.
+        using Lookup =
+          std::function<Answer (std::string const& hostname, bool v6)>;
+
+        /// Construct a Resolver.
+        ///
+        /// \param lookup The lookup backend, the system resolver by default.
+        Resolver(Lookup lookup = {});
+        ~Resolver();
+        /// The addresses of \a hostname.
+        ///
+        /// \param hostname The name of the host, or an address literal.
+        /// \param opt The resolution options to use.
+        /// \returns The addresses, in the order they should be tried.
+        Addresses
+        resolve(std::string const& hostname, ResolveOptions const& opt = {});
+        /// Forget all cached answers.
+        void
+        clear();
+        ELLE_ATTRIBUTE_RW(Lookup, lookup);
+        /// Lifetime of answers without a TTL.
+        ELLE_ATTRIBUTE_RW(Duration, ttl);
+        /// Lifetime of failed lookups.
+        ELLE_ATTRIBUTE_RW(Duration, negative_ttl);
+        /// How long to wait for IPv6 once IPv4 answered.
+        ELLE_ATTRIBUTE_RW(Duration, resolution_delay);
+        /// Requests answered from the cache.
+        ELLE_ATTRIBUTE_R(int, hits);
+        /// Lookups actually performed.
+        ELLE_ATTRIBUTE_R(int, lookups);
+
+      private:
+        Addresses
+        _resolve(std::string const& hostname, bool v6, int attempts);
+        /// Cached answer, or error if the host does not exist.
+        struct Entry
+        {
+          Addresses addresses;
+          std::exception_ptr error;
+          Time expiration;
+        };
+        struct Pending;
+        using Key = std::pair<std::string, bool>;
+        struct Hash
+        {
+          std::size_t
+          operator ()(Key const& key) const;
+        };
+        ELLE_ATTRIBUTE((std::unordered_map<Key, Entry, Hash>), cache);
+        ELLE_ATTRIBUTE((std::unordered_map<Key, std::shared_ptr<Pending>, Hash>),
+                       pending);
+      };
+
+      /// The Resolver of the current Scheduler.
+      Resolver&
+      resolver();
+
       /// FIXME: fix these signatures.  They should be simple
       /// overloads, but literal strings have a tendency to be bound
       /// to Booleans rather than std::strings.
@@ -1,4 +1,5 @@
 #include <elle/reactor/network/Error.hh>
+#include <elle/reactor/network/metrics.hh>
 #include <elle/reactor/network/server.hh>
 #include <elle/reactor/network/ssl-socket.hh>
 #include <elle/reactor/network/TCPSocket.hh>
@@ -23,6 +24,7 @@ namespace elle
 
       Server::Server(Scheduler& scheduler)
         : _scheduler(scheduler)
+        , _metrics()
       {}
 
       Server::~Server()
@@ -126,6 +128,16 @@ namespace elle
         return this->_accept();
       }
 
+      void
+      Server::_instrument(Socket& socket)
+      {
+        if (this->_metrics)
+        {
+          this->_metrics->connection();
+          socket.metrics(std::make_shared<Metrics>(this->_metrics->label()));
+        }
+      }
+
       template <typename Socket, typename EndPoint, typename Acceptor>
       void
       ProtoServer<Socket, EndPoint, Acceptor>::_accept(
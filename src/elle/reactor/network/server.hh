@@ -48,7 +48,19 @@ namespace elle
         virtual
         std::unique_ptr<Socket>
         _accept() = 0;
+        /// Count an accepted connection and give \a socket metrics with the
+        /// same label as ours, if enabled.
+        void
+        _instrument(Socket& socket);
         ELLE_ATTRIBUTE(Scheduler&, scheduler, protected);
+
+      /*--------.
+      | Metrics |
+      `--------*/
+      public:
+        /// The counters of this server, if enabled. Accepted sockets are
+        /// counted under the same label.
+        ELLE_ATTRIBUTE_RW(std::shared_ptr<Metrics>, metrics);
       };
 
       /// Abstract specialization of a Server for
@@ -0,0 +1,229 @@
+#include <elle/reactor/network/shaper.hh>
+
+#include <algorithm>
+#include <tuple>
+
+#include <elle/finally.hh>
+#include <elle/log.hh>
+#include <elle/printf.hh>
+
+#include <elle/reactor/scheduler.hh>
+
+ELLE_LOG_COMPONENT("elle.reactor.network.Shaper");
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      Shaper::Shaper(std::string name,
+                     double rate,
+                     Size burst,
+                     std::shared_ptr<Shaper> parent,
+                     int weight)
+        : _rate(rate)
+        , _burst(burst ? burst : std::max<Size>(rate / 10, 1 << 16))
+        , _weight(std::max(weight, 1))
+        , _name(std::move(name))
+        , _parent(std::move(parent))
+        , _tokens(this->_burst)
+        , _refilled(Clock::now())
+        , _virtual_time(0)
+        , _virtual_clock(0)
+        , _waiters()
+        , _sequence(0)
+        , _changed()
+        , _statistics{0, 0, 0, Duration(0)}
+      {
+        ELLE_TRACE("%s: create with rate %s and burst %s",
+                   this, this->_rate, this->_burst);
+      }
+
+      Shaper::~Shaper()
+      {
+        ELLE_ASSERT(this->_waiters.empty());
+      }
+
+      /*-------.
+      | Tokens |
+      `-------*/
+
+      Size
+      Shaper::acquire(Size size)
+      {
+        if (size == 0)
+          return 0;
+        auto const granted =
+          this->_unlimited() ? size : std::min(size, this->_burst);
+        this->_take(granted, nullptr);
+        for (auto child = this; child->_parent; child = child->_parent.get())
+          try
+          {
+            child->_parent->_take(granted, child);
+          }
+          catch (...)
+          {
+            // Give back what lower levels took so counters stay consistent.
+            for (auto shaper = this; shaper != child->_parent.get();
+                 shaper = shaper->_parent.get())
+            {
+              shaper->_tokens =
+                std::min<double>(shaper->_tokens + granted, shaper->_burst);
+              shaper->_statistics.bytes -= granted;
+              --shaper->_statistics.operations;
+            }
+            throw;
+          }
+        return granted;
+      }
+
+      void
+      Shaper::refund(Size size)
+      {
+        for (auto shaper = this; shaper; shaper = shaper->_parent.get())
+        {
+          shaper->_refill();
+          shaper->_tokens =
+            std::min<double>(shaper->_tokens + size, shaper->_burst);
+          shaper->_statistics.bytes -= size;
+          shaper->_changed.signal();
+        }
+      }
+
+      void
+      Shaper::consume(Size size)
+      {
+        for (auto shaper = this; shaper; shaper = shaper->_parent.get())
+        {
+          shaper->_refill();
+          shaper->_tokens -= size;
+          shaper->_statistics.bytes += size;
+          ++shaper->_statistics.operations;
+        }
+      }
+
+      Shaper::Statistics
+      Shaper::statistics() const
+      {
+        return this->_statistics;
+      }
+
+      void
+      Shaper::rate(double rate)
+      {
+        this->_refill();
+        this->_rate = rate;
+        this->_changed.signal();
+      }
+
+      bool
+      Shaper::_take(Size size, Shaper* child)
+      {
+        auto const start = Clock::now();
+        auto waited = false;
+        if (!this->_unlimited())
+        {
+          // A child coming back from idleness does not get to catch up on the
+          // share it did not use.
+          if (child)
+            child->_virtual_time =
+              std::max(child->_virtual_time, this->_virtual_clock);
+          auto self = Waiter{child, this->_sequence++};
+          this->_waiters.push_back(&self);
+          elle::SafeFinally leave([&]
+            {
+              this->_waiters.erase(
+                std::find(this->_waiters.begin(), this->_waiters.end(), &self));
+              this->_changed.signal();
+            });
+          // Let the waiter in line reconsider, we might come first.
+          this->_changed.signal();
+          auto const key = [] (Waiter const* w)
+            {
+              return std::make_tuple(w->child ? w->child->_virtual_time : 0.,
+                                     w->sequence);
+            };
+          while (true)
+          {
+            this->_refill();
+            auto const next = *std::min_element(
+              this->_waiters.begin(), this->_waiters.end(),
+              [&] (Waiter const* a, Waiter const* b)
+              {
+                return key(a) < key(b);
+              });
+            if (next == &self && this->_tokens > 0)
+              break;
+            waited = true;
+            if (next == &self)
+            {
+              auto const delay = std::chrono::duration<double>(
+                (1 - this->_tokens) / this->_rate);
+              ELLE_DEBUG("%s: wait %s for tokens", this, delay);
+              reactor::wait(this->_changed,
+                            std::chrono::duration_cast<Duration>(delay));
+            }
+            else
+              reactor::wait(this->_changed);
+          }
+          this->_tokens -= size;
+          if (child)
+          {
+            this->_virtual_clock = child->_virtual_time;
+            child->_virtual_time += double(size) / child->_weight;
+          }
+        }
+        this->_statistics.bytes += size;
+        ++this->_statistics.operations;
+        if (waited)
+        {
+          ++this->_statistics.waits;
+          this->_statistics.waited += Clock::now() - start;
+        }
+        return waited;
+      }
+
+      void
+      Shaper::_refill()
+      {
+        auto const now = Clock::now();
+        if (!this->_unlimited())
+          this->_tokens = std::min<double>(
+            this->_burst,
+            this->_tokens + this->_rate *
+            std::chrono::duration<double>(now - this->_refilled).count());
+        this->_refilled = now;
+      }
+
+      bool
+      Shaper::_unlimited() const
+      {
+        return this->_rate <= 0;
+      }
+
+      /*----------.
+      | Printable |
+      `----------*/
+
+      void
+      Shaper::print(std::ostream& stream) const
+      {
+        elle::fprintf(stream, "Shaper(%s)", this->_name);
+      }
+
+      std::ostream&
+      operator <<(std::ostream& output, Shaper::Statistics const& statistics)
+      {
+        elle::fprintf(output, "%s bytes in %s operations, %s waits for %s",
+                      statistics.bytes, statistics.operations,
+                      statistics.waits, statistics.waited);
+        return output;
+      }
+    }
+  }
+}
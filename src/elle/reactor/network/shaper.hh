@@ -0,0 +1,160 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <elle/Printable.hh>
+#include <elle/attribute.hh>
+#include <elle/reactor/duration.hh>
+#include <elle/reactor/network/fwd.hh>
+#include <elle/reactor/signal.hh>
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      /// Token bucket limiting the bandwidth of sockets.
+      ///
+      /// A Shaper is attached to a Socket as its read_shaper or write_shaper,
+      /// and may be shared by several sockets to limit them as a group. The
+      /// bucket holds up to burst bytes and is refilled at rate bytes per
+      /// second.
+      ///
+      /// Tokens are taken once per read_some or write, for up to burst bytes,
+      /// as soon as the bucket is not empty: the bucket may go in debt, which
+      /// delays the next operation accordingly. This keeps the average rate
+      /// without shaping byte per byte.
+      ///
+      /// Shapers can be nested by giving them a parent: bytes are then taken
+      /// from both buckets, and children waiting for their parent are served
+      /// in proportion of their weight.
+      ///
+      /// @code{.cc}
+      ///
+      /// auto uplink = std::make_shared<Shaper>("uplink", 1 << 20);
+      /// auto bulk = std::make_shared<Shaper>("bulk", 0, 0, uplink, 1);
+      /// auto interactive = std::make_shared<Shaper>("interactive",
+      ///                                             0, 0, uplink, 4);
+      /// socket.write_shaper(bulk);
+      ///
+      /// @endcode
+      class Shaper
+        : public elle::Printable
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = Shaper;
+        /// Counters of a Shaper.
+        struct Statistics
+        {
+          /// Bytes that went through.
+          int64_t bytes;
+          /// Operations that took tokens.
+          int64_t operations;
+          /// Operations that had to wait for tokens.
+          int64_t waits;
+          /// Total time operations waited for tokens.
+          Duration waited;
+        };
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        /// Create a Shaper.
+        ///
+        /// @param name The name, for logging and statistics.
+        /// @param rate The rate in bytes per second, 0 for unlimited.
+        /// @param burst The capacity of the bucket in bytes, 0 for a tenth of
+        ///              the rate but at least 64KiB.
+        /// @param parent The Shaper of the enclosing group, if any.
+        /// @param weight The share of the parent's rate relative to its other
+        ///               children.
+        Shaper(std::string name,
+               double rate,
+               Size burst = 0,
+               std::shared_ptr<Shaper> parent = nullptr,
+               int weight = 1);
+        ~Shaper();
+
+      /*-------.
+      | Tokens |
+      `-------*/
+      public:
+        /// Take tokens for an operation of up to \a size bytes, waiting until
+        /// the bucket and its parents are not empty.
+        ///
+        /// @param size The size of the operation.
+        /// @returns The number of bytes the operation may transfer, at most
+        ///          burst.
+        Size
+        acquire(Size size);
+        /// Give back tokens taken but not used, e.g. by a short read.
+        ///
+        /// @param size The number of bytes not transferred.
+        void
+        refund(Size size);
+        /// Take tokens without waiting, going in debt if needed, for
+        /// transfers that cannot be delayed.
+        ///
+        /// @param size The number of bytes transferred.
+        void
+        consume(Size size);
+        /// A snapshot of the counters.
+        Statistics
+        statistics() const;
+        /// The rate in bytes per second, 0 for unlimited.
+        ELLE_ATTRIBUTE_R(double, rate);
+        void
+        rate(double rate);
+        /// The capacity of the bucket in bytes.
+        ELLE_ATTRIBUTE_RW(Size, burst);
+        /// The share of the parent's rate relative to its other children.
+        ELLE_ATTRIBUTE_RW(int, weight);
+        ELLE_ATTRIBUTE_R(std::string, name);
+        ELLE_ATTRIBUTE_R(std::shared_ptr<Shaper>, parent);
+
+      private:
+        struct Waiter
+        {
+          Shaper* child;
+          int64_t sequence;
+        };
+        /// Take \a size tokens from this bucket only.
+        ///
+        /// @param child The child on behalf of which tokens are taken.
+        /// @returns Whether the operation had to wait.
+        bool
+        _take(Size size, Shaper* child);
+        void
+        _refill();
+        bool
+        _unlimited() const;
+        ELLE_ATTRIBUTE(double, tokens);
+        ELLE_ATTRIBUTE(Time, refilled);
+        /// Tokens taken from the parent, divided by the weight.
+        ELLE_ATTRIBUTE(double, virtual_time);
+        /// Virtual time of the last child served.
+        ELLE_ATTRIBUTE(double, virtual_clock);
+        ELLE_ATTRIBUTE(std::vector<Waiter*>, waiters);
+        ELLE_ATTRIBUTE(int64_t, sequence);
+        ELLE_ATTRIBUTE(Signal, changed);
+        ELLE_ATTRIBUTE(Statistics, statistics);
+
+      /*----------.
+      | Printable |
+      `----------*/
+      public:
+        void
+        print(std::ostream& stream) const override;
+      };
+
+      std::ostream&
+      operator <<(std::ostream& output, Shaper::Statistics const& statistics);
+    }
+  }
+}
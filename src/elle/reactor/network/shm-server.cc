@@ -0,0 +1,72 @@
+#include <elle/reactor/network/shm-server.hh>
+
+#include <elle/log.hh>
+
+#include <elle/reactor/network/shm-socket.hh>
+#include <elle/reactor/network/unix-domain-socket.hh>
+
+ELLE_LOG_COMPONENT("elle.reactor.network.ShmServer");
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      ShmServer::ShmServer()
+        : Super()
+        , _server()
+      {}
+
+      ShmServer::~ShmServer()
+      = default;
+
+      std::unique_ptr<ShmSocket>
+      ShmServer::accept()
+      {
+        auto res = std::unique_ptr<ShmSocket>(
+          new ShmSocket(this->_server.accept()));
+        res->_accept();
+        this->_instrument(*res);
+        ELLE_TRACE("%s: got connection: %s", this, *res);
+        return res;
+      }
+
+      void
+      ShmServer::listen(boost::filesystem::path const& path)
+      {
+        this->_server.listen(path);
+      }
+
+      void
+      ShmServer::listen()
+      {
+        this->_server.listen();
+      }
+
+      boost::filesystem::path
+      ShmServer::path() const
+      {
+        return this->local_endpoint().path();
+      }
+
+      ShmServer::EndPoint
+      ShmServer::local_endpoint() const
+      {
+        return this->_server.local_endpoint();
+      }
+
+      std::unique_ptr<Socket>
+      ShmServer::_accept()
+      {
+        return this->accept();
+      }
+
+      void
+      ShmServer::print(std::ostream& stream) const
+      {
+        elle::fprintf(stream, "ShmServer(%s)", this->path());
+      }
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+
+#include <elle/reactor/network/server.hh>
+#include <elle/reactor/network/unix-domain-server.hh>
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      /// Server accepting ShmSocket connections from processes on the same
+      /// host.
+      ///
+      /// Connections are requested on a Unix domain socket.
+      class ShmServer
+        : public Server
+      {
+      public:
+        using Self = ShmServer;
+        using Super = Server;
+        using EndPoint = boost::asio::local::stream_protocol::endpoint;
+        ShmServer();
+        ~ShmServer() override;
+        /// @see Server::accept.
+        std::unique_ptr<ShmSocket>
+        accept();
+        /// Listen on the Unix domain socket at \a path.
+        void
+        listen(boost::filesystem::path const& path);
+        /// Listen on a Unix domain socket in a temporary directory.
+        void
+        listen();
+        /// The path of the Unix domain socket.
+        boost::filesystem::path
+        path() const;
+        /// The endpoint of the Unix domain socket.
+        EndPoint
+        local_endpoint() const;
+
+      protected:
+        std::unique_ptr<Socket>
+        _accept() override;
+        ELLE_ATTRIBUTE(UnixDomainServer, server);
+
+      /*----------.
+      | Printable |
+      `----------*/
+      public:
+        void
+        print(std::ostream& stream) const override;
+      };
+    }
+  }
+}
@@ -0,0 +1,590 @@
+#include <elle/reactor/network/shm-socket.hh>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+
+#include <elle/finally.hh>
+#include <elle/log.hh>
+#include <elle/os/environ.hh>
+
+#include <elle/reactor/lockable.hh>
+#include <elle/reactor/network/Error.hh>
+#include <elle/reactor/Operation.hh>
+#include <elle/reactor/scheduler.hh>
+
+ELLE_LOG_COMPONENT("elle.reactor.network.ShmSocket");
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      namespace details
+      {
+        /// Single-producer, single-consumer ring, followed in memory by its
+        /// data. Positions grow forever and are taken modulo the capacity.
+        struct ShmRing
+        {
+          ShmRing()
+            : head(0)
+            , tail(0)
+            , reader_waiting(false)
+            , writer_waiting(false)
+            , closed(false)
+            , abandoned(false)
+          {}
+
+          unsigned char*
+          data()
+          {
+            return reinterpret_cast<unsigned char*>(this + 1);
+          }
+
+          /// Bytes written by the producer.
+          alignas(64) std::atomic<uint64_t> head;
+          /// Bytes read by the consumer.
+          alignas(64) std::atomic<uint64_t> tail;
+          /// The consumer sleeps until data is available.
+          alignas(64) std::atomic<bool> reader_waiting;
+          /// The producer sleeps until space is available.
+          std::atomic<bool> writer_waiting;
+          /// The producer closed its side.
+          std::atomic<bool> closed;
+          /// The consumer closed its side.
+          std::atomic<bool> abandoned;
+        };
+      }
+
+      using details::ShmRing;
+
+      namespace
+      {
+        /// Number of eventfds passed along the memory file.
+        int const events_count = 4;
+
+        void
+        check(int res, char const* operation)
+        {
+          if (res < 0)
+            throw Error(elle::sprintf("%s failed: %s",
+                                      operation, std::strerror(errno)));
+        }
+
+        std::size_t
+        ring_capacity(Size requested)
+        {
+          auto const wanted = std::max<std::size_t>(
+            requested
+            ? requested
+            : elle::os::getenv("ELLE_REACTOR_SHM_CAPACITY", 1 << 20),
+            4096);
+          auto res = std::size_t(1);
+          while (res < wanted)
+            res <<= 1;
+          return res;
+        }
+
+        /// Wait until an eventfd is signaled or the control socket becomes
+        /// readable, which only happens when the peer goes away.
+        class Wait
+          : public Operation
+        {
+        public:
+          using Control = boost::asio::local::stream_protocol::socket;
+          Wait(boost::asio::posix::stream_descriptor* event, Control& control)
+            : Operation(*Scheduler::scheduler())
+            , _event(event)
+            , _control(control)
+            , _pending(0)
+            , _control_ready(false)
+          {}
+
+          void
+          print(std::ostream& stream) const override
+          {
+            stream << "shared memory wait";
+          }
+
+        protected:
+          void
+          _start() override
+          {
+            if (this->_event)
+            {
+              ++this->_pending;
+              this->_event->async_read_some(
+                boost::asio::null_buffers(),
+                [this] (boost::system::error_code const&, std::size_t)
+                {
+                  this->_wakeup();
+                });
+            }
+            ++this->_pending;
+            this->_control.async_read_some(
+              boost::asio::null_buffers(),
+              [this] (boost::system::error_code const& error, std::size_t)
+              {
+                if (error != boost::asio::error::operation_aborted)
+                  this->_control_ready = true;
+                this->_wakeup();
+              });
+          }
+
+          void
+          _abort() override
+          {
+            this->_cancel();
+            reactor::wait(*this);
+          }
+
+        private:
+          void
+          _wakeup()
+          {
+            if (--this->_pending == 0)
+              this->done();
+            else
+              this->_cancel();
+          }
+
+          void
+          _cancel()
+          {
+            boost::system::error_code ignored;
+            if (this->_event)
+              this->_event->cancel(ignored);
+            this->_control.cancel(ignored);
+          }
+
+          ELLE_ATTRIBUTE(boost::asio::posix::stream_descriptor*, event);
+          ELLE_ATTRIBUTE(Control&, control);
+          ELLE_ATTRIBUTE(int, pending);
+          ELLE_ATTRIBUTE_R(bool, control_ready);
+        };
+      }
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+
+      ShmSocket::ShmSocket(std::unique_ptr<UnixDomainSocket> control)
+        : Super()
+        , _control(std::move(control))
+        , _memory(nullptr)
+        , _memory_size(0)
+        , _capacity(0)
+        , _in(nullptr)
+        , _out(nullptr)
+        , _readable(reactor::scheduler().io_service())
+        , _writable(reactor::scheduler().io_service())
+        , _peer_readable(reactor::scheduler().io_service())
+        , _peer_writable(reactor::scheduler().io_service())
+        , _pending()
+        , _write_mutex()
+        , _closed(false)
+        , _peer_gone(false)
+      {}
+
+      ShmSocket::ShmSocket(boost::filesystem::path const& path,
+                           DurationOpt timeout,
+                           Size requested)
+        : ShmSocket(std::make_unique<UnixDomainSocket>(path, timeout))
+      {
+        this->_connect(requested);
+      }
+
+      ShmSocket::ShmSocket(EndPoint const& endpoint,
+                           DurationOpt timeout,
+                           Size requested)
+        : ShmSocket(std::make_unique<UnixDomainSocket>(endpoint, timeout))
+      {
+        this->_connect(requested);
+      }
+
+      ShmSocket::~ShmSocket()
+      {
+        try
+        {
+          this->close();
+        }
+        catch (...)
+        {
+          ELLE_TRACE("%s: error while closing: %s",
+                     this, elle::exception_string());
+        }
+        if (this->_memory)
+          ::munmap(this->_memory, this->_memory_size);
+      }
+
+      void
+      ShmSocket::_connect(Size requested)
+      {
+        auto const capacity = ring_capacity(requested);
+        ELLE_TRACE_SCOPE("%s: connect with %s bytes rings", this, capacity);
+        int fds[1 + events_count];
+        std::fill(std::begin(fds), std::end(fds), -1);
+        elle::SafeFinally close_fds([&]
+          {
+            // The memory file stays mapped and eventfds are owned by
+            // descriptors once assigned.
+            if (fds[0] >= 0)
+              ::close(fds[0]);
+            for (int i = 1; i <= events_count; ++i)
+              if (fds[i] >= 0)
+                ::close(fds[i]);
+          });
+        fds[0] = ::memfd_create("elle-shm", MFD_CLOEXEC);
+        check(fds[0], "memfd_create");
+        check(::ftruncate(fds[0], 2 * (sizeof(ShmRing) + capacity)),
+              "ftruncate");
+        for (int i = 1; i <= events_count; ++i)
+        {
+          fds[i] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+          check(fds[i], "eventfd");
+        }
+        // Pass the memory file and eventfds along with the ring capacity.
+        auto header = uint64_t(capacity);
+        auto iov = iovec{&header, sizeof(header)};
+        char control[CMSG_SPACE(sizeof(fds))];
+        std::memset(control, 0, sizeof(control));
+        auto message = msghdr{};
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        auto cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+        check(::sendmsg(this->_control->socket()->native_handle(),
+                        &message, MSG_NOSIGNAL),
+              "sendmsg");
+        this->_map(fds[0], capacity, fds + 1, false);
+        for (int i = 1; i <= events_count; ++i)
+          fds[i] = -1;
+      }
+
+      void
+      ShmSocket::_accept()
+      {
+        ELLE_TRACE_SCOPE("%s: accept", this);
+        auto& control = *this->_control->socket();
+        int fds[1 + events_count];
+        std::fill(std::begin(fds), std::end(fds), -1);
+        elle::SafeFinally close_fds([&]
+          {
+            if (fds[0] >= 0)
+              ::close(fds[0]);
+            for (int i = 1; i <= events_count; ++i)
+              if (fds[i] >= 0)
+                ::close(fds[i]);
+          });
+        auto capacity = uint64_t(0);
+        auto iov = iovec{&capacity, sizeof(capacity)};
+        char buffer[CMSG_SPACE(sizeof(fds))];
+        auto message = msghdr{};
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = buffer;
+        message.msg_controllen = sizeof(buffer);
+        while (true)
+        {
+          auto const res = ::recvmsg(control.native_handle(), &message,
+                                     MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+          if (res > 0)
+            break;
+          else if (res == 0)
+            throw ConnectionClosed();
+          else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            check(-1, "recvmsg");
+          Wait(nullptr, control).run();
+        }
+        auto const cmsg = CMSG_FIRSTHDR(&message);
+        if (!cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+            cmsg->cmsg_type != SCM_RIGHTS ||
+            cmsg->cmsg_len != CMSG_LEN(sizeof(fds)) ||
+            capacity < 4096 || (capacity & (capacity - 1)))
+          throw Error("invalid shared memory connection request");
+        std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+        this->_map(fds[0], capacity, fds + 1, true);
+        for (int i = 1; i <= events_count; ++i)
+          fds[i] = -1;
+      }
+
+      void
+      ShmSocket::_map(int memory,
+                      std::size_t capacity,
+                      int const* events,
+                      bool server)
+      {
+        this->_capacity = capacity;
+        this->_memory_size = 2 * (sizeof(ShmRing) + capacity);
+        auto const mapped = ::mmap(nullptr, this->_memory_size,
+                                   PROT_READ | PROT_WRITE, MAP_SHARED,
+                                   memory, 0);
+        if (mapped == MAP_FAILED)
+          check(-1, "mmap");
+        this->_memory = mapped;
+        auto const first = static_cast<ShmRing*>(mapped);
+        auto const second = reinterpret_cast<ShmRing*>(
+          static_cast<char*>(mapped) + sizeof(ShmRing) + capacity);
+        if (!server)
+        {
+          new (first) ShmRing;
+          new (second) ShmRing;
+        }
+        // The first ring goes from the client to the server, the second one
+        // back. Events are, in order: data and space in the first ring, data
+        // and space in the second one.
+        this->_out = server ? second : first;
+        this->_in = server ? first : second;
+        this->_readable.assign(events[server ? 0 : 2]);
+        this->_writable.assign(events[server ? 3 : 1]);
+        this->_peer_readable.assign(events[server ? 2 : 0]);
+        this->_peer_writable.assign(events[server ? 1 : 3]);
+      }
+
+      /*------.
+      | Close |
+      `------*/
+
+      void
+      ShmSocket::close()
+      {
+        if (this->_closed)
+          return;
+        ELLE_TRACE_SCOPE("%s: close", this);
+        this->_closed = true;
+        if (this->_out)
+        {
+          this->_out->closed.store(true);
+          this->_in->abandoned.store(true);
+          this->_notify(this->_peer_readable);
+          this->_notify(this->_peer_writable);
+        }
+        boost::system::error_code ignored;
+        this->_readable.cancel(ignored);
+        this->_writable.cancel(ignored);
+        this->_control->close();
+      }
+
+      /*------.
+      | Write |
+      `------*/
+
+      void
+      ShmSocket::write(elle::ConstWeakBuffer buffer)
+      {
+        Lock lock(this->_write_mutex);
+        ELLE_TRACE_SCOPE("%s: write %s bytes", this, buffer.size());
+        auto& ring = *this->_out;
+        auto const mask = this->_capacity - 1;
+        auto offset = std::size_t(0);
+        while (offset < buffer.size())
+        {
+          if (this->_closed)
+            throw SocketClosed();
+          if (ring.abandoned.load() || this->_peer_gone)
+            throw ConnectionClosed();
+          auto const head = ring.head.load(std::memory_order_relaxed);
+          auto const space = this->_capacity -
+            (head - ring.tail.load(std::memory_order_acquire));
+          if (space == 0)
+          {
+            ring.writer_waiting.store(true);
+            // Check again now that the reader is sure to see us waiting.
+            if (ring.tail.load() + this->_capacity == head &&
+                !ring.abandoned.load())
+            {
+              ELLE_DEBUG("%s: wait for space", this);
+              this->_wait(this->_writable, {});
+            }
+            continue;
+          }
+          auto const size =
+            std::min<std::size_t>(space, buffer.size() - offset);
+          auto const start = head & mask;
+          auto const first = std::min(size, this->_capacity - start);
+          std::memcpy(ring.data() + start, buffer.contents() + offset, first);
+          std::memcpy(ring.data(), buffer.contents() + offset + first,
+                      size - first);
+          ring.head.store(head + size);
+          if (ring.reader_waiting.exchange(false))
+            this->_notify(this->_peer_readable);
+          offset += size;
+        }
+      }
+
+      /*-----.
+      | Read |
+      `-----*/
+
+      void
+      ShmSocket::read(elle::WeakBuffer buffer,
+                      DurationOpt timeout,
+                      int* bytes_read)
+      {
+        auto total = 0;
+        elle::SafeFinally report([&]
+          {
+            if (bytes_read)
+              *bytes_read = total;
+          });
+        while (total < signed(buffer.size()))
+          total += this->read_some(buffer.range(total), timeout);
+      }
+
+      Size
+      ShmSocket::read_some(elle::WeakBuffer buffer,
+                           DurationOpt timeout,
+                           int* bytes_read)
+      {
+        ELLE_TRACE_SCOPE("%s: read up to %s bytes", this, buffer.size());
+        auto res = Size(0);
+        if (!this->_pending.empty())
+        {
+          res = std::min<Size>(buffer.size(), this->_pending.size());
+          std::memcpy(buffer.mutable_contents(), this->_pending.contents(), res);
+          this->_pending.pop_front(res);
+        }
+        else
+          res = this->_receive(buffer, timeout);
+        if (bytes_read)
+          *bytes_read = res;
+        return res;
+      }
+
+      elle::Buffer
+      ShmSocket::read_until(std::string const& delimiter, DurationOpt timeout)
+      {
+        ELLE_TRACE_SCOPE("%s: read until %s", this, delimiter);
+        auto const deadline = timeout
+          ? boost::make_optional(Clock::now() + *timeout)
+          : boost::none;
+        auto searched = std::size_t(0);
+        while (true)
+        {
+          auto const begin = this->_pending.contents();
+          auto const end = begin + this->_pending.size();
+          auto const found = std::search(
+            begin + searched, end, delimiter.begin(), delimiter.end());
+          if (found != end)
+          {
+            auto const size = found - begin + delimiter.size();
+            auto res = elle::Buffer(begin, size);
+            this->_pending.pop_front(size);
+            return res;
+          }
+          if (this->_pending.size() >= delimiter.size())
+            searched = this->_pending.size() - delimiter.size() + 1;
+          auto const size = this->_pending.size();
+          this->_pending.size(size + buffer_size);
+          try
+          {
+            auto const read = this->_receive(
+              elle::WeakBuffer(this->_pending.mutable_contents() + size,
+                               buffer_size),
+              deadline
+              ? DurationOpt(std::max(Duration(0), *deadline - Clock::now()))
+              : DurationOpt());
+            this->_pending.size(size + read);
+          }
+          catch (...)
+          {
+            this->_pending.size(size);
+            throw;
+          }
+        }
+      }
+
+      Size
+      ShmSocket::_receive(elle::WeakBuffer buffer, DurationOpt timeout)
+      {
+        auto& ring = *this->_in;
+        auto const mask = this->_capacity - 1;
+        auto const deadline = timeout
+          ? boost::make_optional(Clock::now() + *timeout)
+          : boost::none;
+        while (true)
+        {
+          if (this->_closed)
+            throw SocketClosed();
+          auto const tail = ring.tail.load(std::memory_order_relaxed);
+          auto const available =
+            ring.head.load(std::memory_order_acquire) - tail;
+          if (available)
+          {
+            auto const size = std::min<std::size_t>(available, buffer.size());
+            auto const start = tail & mask;
+            auto const first = std::min(size, this->_capacity - start);
+            std::memcpy(buffer.mutable_contents(), ring.data() + start, first);
+            std::memcpy(buffer.mutable_contents() + first, ring.data(),
+                        size - first);
+            ring.tail.store(tail + size);
+            if (ring.writer_waiting.exchange(false))
+              this->_notify(this->_peer_writable);
+            ELLE_DEBUG("%s: read %s bytes", this, size);
+            return size;
+          }
+          if (ring.closed.load() || this->_peer_gone)
+            throw ConnectionClosed();
+          ring.reader_waiting.store(true);
+          // Check again now that the writer is sure to see us waiting.
+          if (ring.head.load() != tail || ring.closed.load())
+            continue;
+          ELLE_DEBUG("%s: wait for data", this);
+          auto const left = deadline
+            ? DurationOpt(std::max(Duration(0), *deadline - Clock::now()))
+            : DurationOpt();
+          if (!this->_wait(this->_readable, left))
+            throw TimeOut();
+        }
+      }
+
+      bool
+      ShmSocket::_wait(boost::asio::posix::stream_descriptor& event,
+                       DurationOpt timeout)
+      {
+        Wait wait(&event, *this->_control->socket());
+        auto const res = wait.run(timeout);
+        if (wait.control_ready())
+        {
+          ELLE_TRACE("%s: peer went away", this);
+          this->_peer_gone = true;
+        }
+        // Reset the eventfd counter, it is level triggered.
+        auto value = uint64_t(0);
+        while (::read(event.native_handle(), &value, sizeof(value)) > 0)
+          ;
+        return res;
+      }
+
+      void
+      ShmSocket::_notify(boost::asio::posix::stream_descriptor& event)
+      {
+        auto const one = uint64_t(1);
+        if (::write(event.native_handle(), &one, sizeof(one)) < 0 &&
+            errno != EAGAIN)
+          ELLE_WARN("%s: unable to notify peer: %s",
+                    this, std::strerror(errno));
+      }
+
+      /*----------------.
+      | Pretty printing |
+      `----------------*/
+
+      void
+      ShmSocket::print(std::ostream& s) const
+      {
+        elle::fprintf(s, "ShmSocket(%s)", this->_control->peer());
+      }
+    }
+  }
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+
+#include <elle/Buffer.hh>
+#include <elle/Printable.hh>
+#include <elle/reactor/network/socket.hh>
+#include <elle/reactor/network/unix-domain-socket.hh>
+
+namespace elle
+{
+  namespace reactor
+  {
+    namespace network
+    {
+      namespace details
+      {
+        struct ShmRing;
+      }
+
+      /// Socket to a peer on the same host through shared memory.
+      ///
+      /// Data goes through two single-producer, single-consumer ring buffers
+      /// in a memory file shared by both peers, one per direction, sparing
+      /// the copies and system calls of a Unix domain socket. Peers sleep on
+      /// eventfds when a ring is empty or full, and are only woken up when
+      /// the other side notices they are waiting.
+      ///
+      /// The connection is set up through a Unix domain socket, over which
+      /// the memory file and eventfds are passed, and which is kept to notice
+      /// the peer going away.
+      ///
+      /// @code{.cc}
+      ///
+      /// ShmServer server;
+      /// server.listen("/run/service.sock");
+      /// // In another process.
+      /// ShmSocket socket(boost::filesystem::path("/run/service.sock"));
+      /// socket.write(elle::ConstWeakBuffer("hello"));
+      ///
+      /// @endcode
+      class ShmSocket
+        : public Socket
+        , public elle::Printable
+      {
+      /*------.
+      | Types |
+      `------*/
+      public:
+        using Self = ShmSocket;
+        using Super = Socket;
+        /// The endpoint of the server's Unix domain socket.
+        using EndPoint = boost::asio::local::stream_protocol::endpoint;
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+      public:
+        /// Connect to a ShmServer.
+        ///
+        /// @param path The path of the server's Unix domain socket.
+        /// @param timeout The maximum duration before the connection attempt
+        ///                times out.
+        /// @param capacity The size of each ring, rounded up to a power of
+        ///                 two. Defaults to ELLE_REACTOR_SHM_CAPACITY, 1MiB.
+        ShmSocket(boost::filesystem::path const& path,
+                  DurationOpt timeout = {},
+                  Size capacity = 0);
+        /// Connect to a ShmServer.
+        ///
+        /// @see ShmSocket(boost::filesystem::path const&, DurationOpt, Size).
+        ShmSocket(EndPoint const& endpoint,
+                  DurationOpt timeout = {},
+                  Size capacity = 0);
+        ~ShmSocket() override;
+      private:
+        friend class ShmServer;
+        ShmSocket(std::unique_ptr<UnixDomainSocket> control);
+        /// Create the memory file and eventfds and pass them to the server.
+        void
+        _connect(Size capacity);
+        /// Receive the memory file and eventfds from the client.
+        void
+        _accept();
+        /// Map the memory file and take the rings and eventfds for our side.
+        void
+        _map(int memory, std::size_t capacity, int const* events, bool server);
+
+      /*------.
+      | Close |
+      `------*/
+      public:
+        void
+        close() override;
+
+      /*------.
+      | Write |
+      `------*/
+      public:
+        void
+        write(elle::ConstWeakBuffer buffer) override;
+
+      /*-----.
+      | Read |
+      `-----*/
+      public:
+        void
+        read(elle::WeakBuffer buffer,
+             DurationOpt timeout = {},
+             int* bytes_read = nullptr) override;
+        Size
+        read_some(elle::WeakBuffer buffer,
+                  DurationOpt timeout = {},
+                  int* bytes_read = nullptr) override;
+        elle::Buffer
+        read_until(std::string const& delimiter,
+                   DurationOpt timeout = {}) override;
+        using Super::read;
+        using Super::read_some;
+      private:
+        /// Copy up to buffer.size() bytes out of the incoming ring, waiting
+        /// for data if it is empty.
+        Size
+        _receive(elle::WeakBuffer buffer, DurationOpt timeout);
+        /// Wait until \a event is signaled or the peer goes away.
+        ///
+        /// @returns Whether it did not time out.
+        bool
+        _wait(boost::asio::posix::stream_descriptor& event,
+              DurationOpt timeout);
+        /// Wake the peer up through \a event.
+        void
+        _notify(boost::asio::posix::stream_descriptor& event);
+
+      /*-------.
+      | Memory |
+      `-------*/
+      private:
+        ELLE_ATTRIBUTE(std::unique_ptr<UnixDomainSocket>, control);
+        ELLE_ATTRIBUTE(void*, memory);
+        ELLE_ATTRIBUTE(std::size_t, memory_size);
+        /// The size of each ring.
+        ELLE_ATTRIBUTE_R(std::size_t, capacity);
+        ELLE_ATTRIBUTE(details::ShmRing*, in);
+        ELLE_ATTRIBUTE(details::ShmRing*, out);
+        /// Signaled by the peer when data is available in the incoming ring.
+        ELLE_ATTRIBUTE(boost::asio::posix::stream_descriptor, readable);
+        /// Signaled by the peer when space is freed in the outgoing ring.
+        ELLE_ATTRIBUTE(boost::asio::posix::stream_descriptor, writable);
+        /// Signaled to the peer when data is available in the outgoing ring.
+        ELLE_ATTRIBUTE(boost::asio::posix::stream_descriptor, peer_readable);
+        /// Signaled to the peer when space is freed in the incoming ring.
+        ELLE_ATTRIBUTE(boost::asio::posix::stream_descriptor, peer_writable);
+        /// Data read past a read_until delimiter.
+        ELLE_ATTRIBUTE(elle::Buffer, pending);
+        ELLE_ATTRIBUTE(Mutex, write_mutex);
+        ELLE_ATTRIBUTE(bool, closed);
+        /// Whether the control socket was closed by the peer.
+        ELLE_ATTRIBUTE(bool, peer_gone);
+
+      /*----------------.
+      | Pretty printing |
+      `----------------*/
+      public:
+        void
+        print(std::ostream& s) const override;
+      };
+    }
+  }
+}
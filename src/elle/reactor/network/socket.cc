@@ -125,6 +125,9 @@ namespace elle
 
       Socket::Socket()
         : elle::IOStream(new StreamBuffer(this))
+        , _read_shaper()
+        , _write_shaper()
+        , _metrics()
       {}
 
       Socket::~Socket()
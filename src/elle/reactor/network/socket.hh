@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 #include <elle/Buffer.hh>
 #include <elle/IOStream.hh>
 #include <elle/attribute.hh>
@@ -142,6 +144,22 @@ namespace elle
         read_until(std::string const& delimiter,
                    DurationOpt opt = {}) = 0;
 
+      /*--------.
+      | Shaping |
+      `--------*/
+      public:
+        /// The Shaper limiting the reading bandwidth, if any.
+        ELLE_ATTRIBUTE_RW(std::shared_ptr<Shaper>, read_shaper);
+        /// The Shaper limiting the writing bandwidth, if any.
+        ELLE_ATTRIBUTE_RW(std::shared_ptr<Shaper>, write_shaper);
+
+      /*--------.
+      | Metrics |
+      `--------*/
+      public:
+        /// The I/O counters of this socket, if enabled.
+        ELLE_ATTRIBUTE_RW(std::shared_ptr<Metrics>, metrics);
+
      /*----------------.
      | Pretty printing |
      `----------------*/
@@ -255,6 +273,8 @@ namespace elle
       `------------*/
       protected:
         friend class FingerprintedSocket;
+        friend class ShmServer;
+        friend class ShmSocket;
         friend class SSLSocket;
         friend class SSLServer;
         friend class TCPServer;
@@ -355,6 +375,7 @@ namespace elle
       | Concrete sockets |
       `-----------------*/
       protected:
+        friend class Relay;
         friend class TCPServer;
         friend class TCPSocket;
         // friend class UDPServer;
@@ -1,4 +1,8 @@
+#include <elle/finally.hh>
+
 #include <elle/reactor/network/SocketOperation.hxx>
+#include <elle/reactor/network/metrics.hh>
+#include <elle/reactor/network/shaper.hh>
 
 namespace elle
 {
@@ -329,7 +333,31 @@ namespace elle
                                                DurationOpt timeout,
                                                int* bytes_read)
       {
-        this->_read(buf, timeout, false, bytes_read);
+        if (this->read_shaper())
+        {
+          // Read piecewise so every piece is shaped.
+          auto total = 0;
+          elle::SafeFinally report([&]
+            {
+              if (bytes_read)
+                *bytes_read = total;
+            });
+          while (total < signed(buf.size()))
+          {
+            auto some = 0;
+            try
+            {
+              total += this->read_some(buf.range(total), timeout, &some);
+            }
+            catch (...)
+            {
+              total += some;
+              throw;
+            }
+          }
+        }
+        else
+          this->_read(buf, timeout, false, bytes_read);
       }
 
       template <typename AsioSocket, typename EndPoint>
@@ -338,7 +366,20 @@ namespace elle
                                                     DurationOpt timeout,
                                                     int* bytes_read)
       {
-        return this->_read(buf, timeout, true, bytes_read);
+        if (auto shaper = this->read_shaper())
+        {
+          auto const granted = shaper->acquire(buf.size());
+          auto read = 0;
+          elle::SafeFinally refund([&]
+            {
+              shaper->refund(granted - read);
+              if (bytes_read)
+                *bytes_read = read;
+            });
+          return this->_read(buf.range(0, granted), timeout, true, &read);
+        }
+        else
+          return this->_read(buf, timeout, true, bytes_read);
       }
 
       template <typename AsioSocket, typename EndPoint>
@@ -354,6 +395,8 @@ namespace elle
                          some ? "up to " : "",
                          buf.size(),
                          timeout ? elle::sprintf(" in %s", timeout.get()): "");
+        auto const& metrics = this->metrics();
+        auto cached = 0u;
         if (this->_streambuffer.size())
         {
           std::istream s(&this->_streambuffer);
@@ -364,6 +407,8 @@ namespace elle
           {
             ELLE_DEBUG("%s: completed read of %s (cached) bytes: %s",
                        *this, size, buf);
+            if (metrics)
+              metrics->read(size, Duration(0));
             if (bytes_read)
               *bytes_read = size;
             return size;
@@ -371,10 +416,12 @@ namespace elle
           else if (size)
             ELLE_TRACE("%s: read %s cached bytes, carrying on", *this, size);
           buf = buf.range(size);
+          cached = size;
         }
         using Spe = SocketSpecialization<AsioSocket>;
         auto read = Read<Self, typename Spe::Socket> (
           *this, Spe::socket(*this->socket()), buf, some);
+        auto const start = Clock::now();
         bool finished;
         try
         {
@@ -390,11 +437,15 @@ namespace elle
         if (!finished)
         {
           ELLE_TRACE("%s: read timed out", *this);
+          if (metrics)
+            metrics->timeout();
           if (bytes_read)
             *bytes_read = read.read();
           throw TimeOut();
         }
         ELLE_TRACE("%s: completed read of %s bytes", *this, read.read());
+        if (metrics)
+          metrics->read(cached + read.read(), Clock::now() - start);
         ELLE_DUMP(": %s", buf);
 
         auto data = elle::ConstWeakBuffer(buf.contents(), read.read());
@@ -480,6 +531,7 @@ namespace elle
         ELLE_TRACE_SCOPE("%s: read until %s", *this, delimiter);
         ReadUntil<Self, AsioSocket> read(*this, *this->socket(),
                                          this->_streambuffer, delimiter);
+        auto const start = Clock::now();
         bool finished;
         try
         {
@@ -493,8 +545,12 @@ namespace elle
         if (!finished)
         {
           ELLE_TRACE("%s: read until timed out", *this);
+          if (auto const& metrics = this->metrics())
+            metrics->timeout();
           throw TimeOut();
         }
+        if (auto const& metrics = this->metrics())
+          metrics->read(read.buffer().size(), Clock::now() - start);
         return std::move(read.buffer());
       }
 
@@ -559,16 +615,38 @@ namespace elle
         ELLE_LOG_COMPONENT("elle.reactor.network.Socket");
         if (reactor::scheduler().current())
         {
+          auto const start = Clock::now();
           {
             Lock lock(this->_write_mutex);
             ELLE_TRACE_SCOPE("%s: write %s bytes", this, buffer.size());
-            Write<Self, AsioSocket> write(*this, *this->socket(), buffer);
-            write.run();
+            if (auto shaper = this->write_shaper())
+              for (auto offset = Size(0); offset < buffer.size();)
+              {
+                auto const granted = shaper->acquire(buffer.size() - offset);
+                Write<Self, AsioSocket> write(
+                  *this, *this->socket(),
+                  buffer.range(offset, offset + granted));
+                write.run();
+                offset += granted;
+              }
+            else
+            {
+              Write<Self, AsioSocket> write(*this, *this->socket(), buffer);
+              write.run();
+            }
           }
+          if (auto const& metrics = this->metrics())
+            metrics->write(buffer.size(), Clock::now() - start);
           this->_async_write();
         }
         else
         {
+          // Outside of a thread we cannot wait: account for the bytes, later
+          // writes will be delayed accordingly.
+          if (auto shaper = this->write_shaper())
+            shaper->consume(buffer.size());
+          if (auto const& metrics = this->metrics())
+            metrics->queue(buffer.size());
           this->_async_writes.emplace_back(buffer.contents(), buffer.size());
           this->_async_write();
         }
@@ -593,6 +671,13 @@ namespace elle
             [this]
             (const boost::system::error_code& error, std::size_t written)
             {
+              if (auto const& metrics = this->metrics())
+              {
+                auto const size = this->_async_writes.front().size();
+                metrics->queue(-int64_t(size));
+                if (!error)
+                  metrics->write(size, Duration(0));
+              }
               this->_async_writes.pop_front();
               if (error == boost::system::errc::operation_canceled)
                 return;
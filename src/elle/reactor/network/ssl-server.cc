@@ -105,7 +105,9 @@ namespace elle
       std::unique_ptr<SSLSocket>
       SSLServer::accept()
       {
-        return this->_sockets.get();
+        auto res = this->_sockets.get();
+        this->_instrument(*res);
+        return res;
       }
 
       std::unique_ptr<Socket>
@@ -1,4 +1,6 @@
+#include <elle/err.hh>
 #include <elle/log.hh>
+#include <elle/os/environ.hh>
 #include <elle/reactor/network/SocketOperation.hh>
 #include <elle/reactor/network/Error.hh>
 #include <elle/reactor/network/ssl-socket.hh>
@@ -14,10 +16,25 @@ namespace elle
   {
     namespace network
     {
+      namespace
+      {
+        /// Lifetime of cached sessions, in seconds.
+        auto const session_timeout =
+          elle::os::getenv("ELLE_REACTOR_SSL_SESSION_TIMEOUT", 3600);
+        /// Maximum number of peers we keep a client session for.
+        auto const client_sessions =
+          elle::os::getenv("ELLE_REACTOR_SSL_CLIENT_SESSIONS", 4096u);
+      }
+
+      /*-------------.
+      | Construction |
+      `-------------*/
+
       SSLCertificate::SSLCertificate(SSLCertificateMethod meth)
         : _context(meth)
       {
         this->_context.set_options(boost::asio::ssl::verify_none);
+        this->_setup();
       }
 
       SSLCertificate::SSLCertificate(std::vector<char> const& certificate,
@@ -34,6 +51,7 @@ namespace elle
         this->_context.use_private_key(const_buffer(key.data(), key.size()),
                                        boost::asio::ssl::context::pem);
         this->_context.use_tmp_dh(const_buffer(dh.data(), dh.size()));
+        this->_setup();
       }
 
       SSLCertificate::SSLCertificate(std::string const& certificate,
@@ -48,6 +66,96 @@ namespace elle
         this->_context.use_private_key_file(key,
                                             boost::asio::ssl::context::pem);
         this->_context.use_tmp_dh_file(dhfile);
+        this->_setup();
+      }
+
+      void
+      SSLCertificate::_setup()
+      {
+        this->_handshakes = 0;
+        this->_resumptions = 0;
+        auto const ctx = this->_context.native_handle();
+        // The internal store serves servers, clients sessions are stored per
+        // peer by SSLSocket::_new_session.
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_BOTH);
+        SSL_CTX_set_timeout(ctx, session_timeout);
+        static unsigned char const id_context[] = "elle.reactor";
+        SSL_CTX_set_session_id_context(ctx, id_context, sizeof(id_context) - 1);
+        SSL_CTX_sess_set_new_cb(ctx, &SSLSocket::_new_session);
+      }
+
+      std::shared_ptr<SSLCertificate>
+      SSLCertificate::shared(SSLCertificateMethod meth)
+      {
+        // Leaked on purpose: contexts must not outlive OpenSSL at exit.
+        static auto& mutex = *new std::mutex;
+        static auto& contexts =
+          *new std::unordered_map<int, std::shared_ptr<SSLCertificate>>;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& res = contexts[meth];
+        if (!res)
+        {
+          ELLE_TRACE("create shared SSL context for method %s", meth);
+          res = std::make_shared<SSLCertificate>(meth);
+        }
+        return res;
+      }
+
+      /*-------------------.
+      | Session resumption |
+      `-------------------*/
+
+      void
+      SSLCertificate::session_ticket_keys(elle::ConstWeakBuffer keys)
+      {
+        if (keys.size() != 48)
+          elle::err("session ticket keys must be 48 bytes, got %s",
+                    keys.size());
+        if (!SSL_CTX_set_tlsext_ticket_keys(
+              this->_context.native_handle(),
+              const_cast<elle::Buffer::Byte*>(keys.contents()), keys.size()))
+          elle::err("unable to set session ticket keys");
+      }
+
+      int
+      SSLCertificate::handshakes() const
+      {
+        return this->_handshakes;
+      }
+
+      int
+      SSLCertificate::resumptions() const
+      {
+        return this->_resumptions;
+      }
+
+      void
+      SSLCertificate::_handshaked(SSL* ssl)
+      {
+        ++this->_handshakes;
+        if (SSL_session_reused(ssl))
+          ++this->_resumptions;
+      }
+
+      std::shared_ptr<SSL_SESSION>
+      SSLCertificate::_session(SSLEndPoint const& peer)
+      {
+        std::lock_guard<std::mutex> lock(this->_sessions_mutex);
+        auto it = this->_sessions.find(peer);
+        if (it == this->_sessions.end())
+          return nullptr;
+        return it->second;
+      }
+
+      void
+      SSLCertificate::_session(SSLEndPoint const& peer, SSL_SESSION* session)
+      {
+        auto s = std::shared_ptr<SSL_SESSION>(session, &SSL_SESSION_free);
+        std::lock_guard<std::mutex> lock(this->_sessions_mutex);
+        if (this->_sessions.size() >= client_sessions &&
+            this->_sessions.find(peer) == this->_sessions.end())
+          this->_sessions.erase(this->_sessions.begin());
+        this->_sessions[peer] = std::move(s);
       }
 
       SSLCertificateOwner::SSLCertificateOwner(
@@ -55,7 +163,7 @@ namespace elle
         : _certificate(std::move(certificate))
       {
         if (this->_certificate == nullptr)
-          this->_certificate.reset(new SSLCertificate());
+          this->_certificate = SSLCertificate::shared();
         ELLE_ASSERT(this->_certificate != nullptr);
       }
 
@@ -101,6 +209,9 @@ namespace elle
 
       SSLSocket::~SSLSocket()
       {
+        // Stop accepting sessions on our behalf.
+        if (this->_socket)
+          SSL_set_app_data(this->_socket->native_handle(), nullptr);
         // Flush before shutting SSL down.
         this->_final_flush();
         try
@@ -195,9 +306,19 @@ namespace elle
       SSLSocket::_client_handshake()
       {
         ELLE_TRACE_SCOPE("%s: handshake as client", *this);
+        auto const ssl = this->_socket->native_handle();
+        SSL_set_app_data(ssl, this);
+        if (auto session = this->certificate()->_session(this->peer()))
+        {
+          ELLE_DEBUG("%s: attempt to resume session", *this);
+          SSL_set_session(ssl, session.get());
+        }
         SSLHandshake handshaker(*this, SSLStream::handshake_type::client);
         if (!handshaker.run(this->_timeout))
           throw TimeOut();
+        this->certificate()->_handshaked(ssl);
+        ELLE_DEBUG("%s: session %s", *this,
+                   SSL_session_reused(ssl) ? "resumed" : "established");
       }
 
       void
@@ -207,6 +328,26 @@ namespace elle
         SSLHandshake handshaker(*this, SSLStream::handshake_type::server);
         if (!handshaker.run(timeout))
           throw TimeOut();
+        auto const ssl = this->_socket->native_handle();
+        // Server sockets from an SSLServer share its certificate, others
+        // were given theirs by reference.
+        auto const ctx = SSL_get_SSL_CTX(ssl);
+        if (ctx == this->certificate()->context().native_handle())
+          this->certificate()->_handshaked(ssl);
+        ELLE_DEBUG("%s: session %s", *this,
+                   SSL_session_reused(ssl) ? "resumed" : "established");
+      }
+
+      int
+      SSLSocket::_new_session(SSL* ssl, SSL_SESSION* session)
+      {
+        // Only client sockets register themselves.
+        auto const socket = static_cast<SSLSocket*>(SSL_get_app_data(ssl));
+        if (!socket)
+          return 0;
+        ELLE_DEBUG("%s: store session", *socket);
+        socket->certificate()->_session(socket->peer(), session);
+        return 1;
       }
 
 
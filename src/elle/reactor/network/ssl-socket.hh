@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <map>
+#include <mutex>
+
 #include <elle/reactor/network/socket.hh>
 #include <elle/reactor/network/resolve.hh>
 #include <elle/reactor/network/TCPSocket.hh>
@@ -15,13 +19,20 @@ namespace elle
   {
     namespace network
     {
+      class SSLSocket;
+
       /// An SSL context.
       ///
       /// SSLCertificate is just an helper for boost::asio::ssl::context.
+      ///
+      /// Sessions are cached server side, both by ID and through session
+      /// tickets, and client side per peer endpoint, so reconnections resume
+      /// the previous session instead of performing a full handshake.
       class SSLCertificate
       {
       public:
         using SSLCertificateMethod = boost::asio::ssl::context::method;
+        using SSLEndPoint = boost::asio::ip::tcp::endpoint;
 
         /// Create an SSLCertificate.
         ///
@@ -55,9 +66,54 @@ namespace elle
                        std::string const& dhfile,
                        SSLCertificateMethod meth =
                          boost::asio::ssl::context::tlsv1_server);
+        /// The client SSLCertificate shared by all sockets using \a meth.
+        ///
+        /// Sharing the context spares its creation for every socket and lets
+        /// them reuse each other sessions.
+        ///
+        /// @param meth The ssl::context::method to use.
+        static
+        std::shared_ptr<SSLCertificate>
+        shared(SSLCertificateMethod meth =
+               boost::asio::ssl::context::tlsv1_client);
 
       private:
+        void
+        _setup();
         ELLE_ATTRIBUTE_RX(boost::asio::ssl::context, context);
+
+      /*--------------------.
+      | Session resumption  |
+      `--------------------*/
+      public:
+        /// Set the keys protecting session tickets, so that servers sharing
+        /// them accept each other tickets.
+        ///
+        /// @param keys 48 bytes of key material.
+        void
+        session_ticket_keys(elle::ConstWeakBuffer keys);
+        /// Number of handshakes performed with this context.
+        int
+        handshakes() const;
+        /// Number of handshakes that resumed a previous session.
+        int
+        resumptions() const;
+      private:
+        friend class SSLSocket;
+        /// Account for a completed handshake.
+        void
+        _handshaked(SSL* ssl);
+        /// The session last established with \a peer, if any.
+        std::shared_ptr<SSL_SESSION>
+        _session(SSLEndPoint const& peer);
+        /// Remember \a session, whose ownership we take, for \a peer.
+        void
+        _session(SSLEndPoint const& peer, SSL_SESSION* session);
+        ELLE_ATTRIBUTE(std::atomic<int>, handshakes);
+        ELLE_ATTRIBUTE(std::atomic<int>, resumptions);
+        ELLE_ATTRIBUTE(std::mutex, sessions_mutex);
+        ELLE_ATTRIBUTE((std::map<SSLEndPoint, std::shared_ptr<SSL_SESSION>>),
+                       sessions);
       };
 
       using SSLStream = boost::asio::ssl::stream<boost::asio::ip::tcp::socket>;
@@ -136,6 +192,7 @@ namespace elle
       | Connection |
       `-----------*/
       private:
+        friend class SSLCertificate;
         friend class SSLServer;
         SSLSocket(std::unique_ptr<SSLStream> socket,
                   SSLEndPoint const& endpoint,
@@ -144,6 +201,10 @@ namespace elle
         /// No check of certificate is done by default
         void
         _client_handshake();
+        /// Store sessions the peer hands out for later resumption.
+        static
+        int
+        _new_session(SSL* ssl, SSL_SESSION* session);
         void
         _server_handshake(reactor::DurationOpt const& timeout);
         void
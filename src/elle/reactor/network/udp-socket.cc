@@ -1,5 +1,6 @@
 #include <boost/lexical_cast.hpp>
 
+#include <elle/err.hh>
 #include <elle/log.hh>
 #include <elle/memory.hh>
 #include <elle/optional.hh>
@@ -70,12 +71,23 @@ namespace elle
       `--------------*/
 
       void
-      UDPSocket::bind(EndPoint const& endpoint)
+      UDPSocket::bind(EndPoint const& endpoint, bool reuse_port)
       {
         if (endpoint.address().is_v6())
           socket()->open(boost::asio::ip::udp::v6()); // gives us mapped v4 too
         else
           socket()->open(boost::asio::ip::udp::v4());
+        if (reuse_port)
+        {
+#ifdef SO_REUSEPORT
+          using ReusePort =
+            boost::asio::detail::socket_option::boolean<SOL_SOCKET,
+                                                        SO_REUSEPORT>;
+          socket()->set_option(ReusePort(true));
+#else
+          elle::err("SO_REUSEPORT is not supported on this platform");
+#endif
+        }
         socket()->bind(endpoint);
       }
 
@@ -66,8 +66,11 @@ namespace elle
         /// Bind the UDPSocket to the given Endpoint.
         ///
         /// \param endpoint The endpoint to connect to.
+        /// \param reuse_port Whether to set SO_REUSEPORT, letting several
+        ///                   sockets share the endpoint. The kernel then
+        ///                   dispatches datagrams by hashing the peer address.
         void
-        bind(EndPoint const& endpoint);
+        bind(EndPoint const& endpoint, bool reuse_port = false);
 
       /*-----.
       | Read |
@@ -32,6 +32,7 @@ namespace elle
         // Socket is now connected so make it into a TCPSocket.
         std::unique_ptr<UnixDomainSocket> res(
           new UnixDomainSocket(std::move(new_socket), peer));
+        this->_instrument(*res);
         ELLE_TRACE("%s: got connection: %s", *this, *res);
         return res;
       }
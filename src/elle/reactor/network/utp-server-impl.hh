@@ -20,7 +20,7 @@ namespace elle
         : public std::enable_shared_from_this<UTPServer::Impl>
       {
       public:
-        Impl();
+        Impl(int shards = 1);
         ~Impl();
         std::unique_ptr<UTPSocket>
         accept();
@@ -32,23 +32,16 @@ namespace elle
         listen(EndPoint const& ep);
         void
         on_accept(utp_socket* s);
-        void
-        send_to(
-          elle::ConstWeakBuffer buf,
-          EndPoint where,
-          std::function<void(boost::system::error_code const&)> on_error = {});
-        void
-        _send();
-        void
-        _send_cont(boost::system::error_code const&, size_t);
         /// Import from libutp/utp.h.
         using utp_context = ::struct_utp_context;
-        ELLE_ATTRIBUTE(utp_context*, ctx);
+        class Shard;
+        /// The shard owning connections with the given peer.
+        Shard&
+        shard(EndPoint const& peer);
         ELLE_ATTRIBUTE_R(std::unique_ptr<RDVSocket>, socket);
         ELLE_ATTRIBUTE_R(unsigned char, xorify);
         ELLE_ATTRIBUTE(std::vector<std::unique_ptr<UTPSocket>>, accept_queue);
         ELLE_ATTRIBUTE(Barrier, accept_barrier);
-        ELLE_ATTRIBUTE(std::unique_ptr<Thread>, listener);
         ELLE_ATTRIBUTE(std::unique_ptr<Thread>, checker);
         struct SendBuffer
         {
@@ -65,8 +58,45 @@ namespace elle
           EndPoint endpoint;
           std::function<void(boost::system::error_code const&)> on_error;
         };
-        ELLE_ATTRIBUTE(std::deque<SendBuffer>, send_buffer);
-        ELLE_ATTRIBUTE(bool, sending);
+      public:
+        /// An utp context and the UDP socket it sends through.
+        ///
+        /// Every shard binds the listening endpoint with SO_REUSEPORT. The
+        /// kernel spreads incoming datagrams among shard sockets by peer
+        /// address, and the receiving listener hands them to the context of
+        /// the shard owning that peer (see Impl::shard), so all packets of a
+        /// connection are processed by the same context and answered from
+        /// the same socket.
+        class Shard
+        {
+        public:
+          Shard(Impl& owner, int index);
+          void
+          send_to(
+            elle::ConstWeakBuffer buf,
+            EndPoint where,
+            std::function<void(boost::system::error_code const&)> on_error = {});
+          void
+          _send();
+          void
+          _send_cont(boost::system::error_code const&, size_t);
+          void
+          _check_icmp();
+          void
+          _listen();
+          ELLE_ATTRIBUTE_R(Impl&, owner);
+          ELLE_ATTRIBUTE_R(int, index);
+          ELLE_ATTRIBUTE_R(utp_context*, ctx);
+          /// The socket we send through: the RDV socket for the first shard,
+          /// an owned UDP socket for the others.
+          ELLE_ATTRIBUTE_R(UDPSocket*, socket);
+          ELLE_ATTRIBUTE(std::unique_ptr<UDPSocket>, own_socket);
+          ELLE_ATTRIBUTE(std::deque<SendBuffer>, send_buffer);
+          ELLE_ATTRIBUTE(bool, sending);
+          ELLE_ATTRIBUTE(std::unique_ptr<Thread>, listener);
+          friend class Impl;
+        };
+        ELLE_ATTRIBUTE_R(std::vector<std::unique_ptr<Shard>>, shards);
         ELLE_ATTRIBUTE(int, icmp_fd);
         ELLE_ATTRIBUTE_RX(std::vector<Thread::unique_ptr>,
                           socket_shutdown_threads);
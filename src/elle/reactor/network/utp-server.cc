@@ -11,6 +11,7 @@
 # include <sys/socket.h>
 #endif
 
+#include <boost/functional/hash.hpp>
 #include <boost/range/algorithm_ext/erase.hpp>
 
 #include <elle/Buffer.hh>
@@ -49,10 +50,10 @@ namespace elle
         }
 
         inline
-        UTPServer::Impl*
-        get_server(utp_callback_arguments* args)
+        UTPServer::Impl::Shard*
+        get_shard(utp_callback_arguments* args)
         {
-          return reinterpret_cast<UTPServer::Impl*>(
+          return reinterpret_cast<UTPServer::Impl::Shard*>(
             utp_context_get_userdata(args->context));
         }
 
@@ -82,17 +83,18 @@ namespace elle
             else
               elle::err("unknown protocol %s", sin->sin_family);
           }();
-          auto server = get_server(args);
-          ELLE_ASSERT(server);
+          auto shard = get_shard(args);
+          ELLE_ASSERT(shard);
+          auto const xorify = shard->owner().xorify();
           auto buf = elle::ConstWeakBuffer(args->buf, args->len);
-          if (server->xorify())
+          if (xorify)
           {
             auto copy = elle::Buffer(args->buf, args->len);
             for (unsigned int i = 0; i < args->len; ++i)
-              copy[i] ^= server->xorify();
+              copy[i] ^= xorify;
             buf = elle::WeakBuffer(copy.contents(), copy.size());
           }
-          server->send_to(
+          shard->send_to(
             buf,
             ep,
             [
@@ -157,8 +159,7 @@ namespace elle
         on_accept(utp_callback_arguments* args)
         {
           ELLE_DEBUG("on_accept");
-          auto server = get_server(args);
-          server->on_accept(args->socket);
+          get_shard(args)->owner().on_accept(args->socket);
           return 0;
         }
 
@@ -186,8 +187,8 @@ namespace elle
       | Construction |
       `-------------*/
 
-      UTPServer::UTPServer()
-        : _impl(std::make_shared<UTPServer::Impl>())
+      UTPServer::UTPServer(int shards)
+        : _impl(std::make_shared<UTPServer::Impl>(shards))
       {}
 
 
@@ -207,6 +208,12 @@ namespace elle
         this->_impl->_xorify = v;
       }
 
+      int
+      UTPServer::shards() const
+      {
+        return this->_impl->_shards.size();
+      }
+
       /*-----------.
       | Networking |
       `-----------*/
@@ -286,12 +293,30 @@ namespace elle
       | Impl |
       `-----*/
 
-      UTPServer::Impl::Impl()
-        : _ctx(utp_init(2))
-        , _xorify(0)
+      UTPServer::Impl::Impl(int shards)
+        : _xorify(0)
         , _accept_barrier("UTPServer accept")
-        , _sending(false)
         , _icmp_fd(-1)
+      {
+        ELLE_ASSERT_GTE(shards, 1);
+#ifndef SO_REUSEPORT
+        if (shards > 1)
+        {
+          ELLE_WARN("%s: SO_REUSEPORT is unavailable, use a single shard",
+                    this);
+          shards = 1;
+        }
+#endif
+        for (int i = 0; i < shards; ++i)
+          this->_shards.emplace_back(std::make_unique<Shard>(*this, i));
+      }
+
+      UTPServer::Impl::Shard::Shard(Impl& owner, int index)
+        : _owner(owner)
+        , _index(index)
+        , _ctx(utp_init(2))
+        , _socket(nullptr)
+        , _sending(false)
       {
         utp_context_set_userdata(this->_ctx, this);
         utp_set_callback(this->_ctx, UTP_ON_FIREWALL, &on_firewall);
@@ -309,6 +334,26 @@ namespace elle
           utp_context_set_option(this->_ctx, UTP_LOG_DEBUG, 1);
       }
 
+      UTPServer::Impl::Shard&
+      UTPServer::Impl::shard(EndPoint const& peer)
+      {
+        if (this->_shards.size() == 1)
+          return *this->_shards.front();
+        // Hash v4 peers identically whether they are seen as plain or
+        // v4-mapped addresses.
+        auto address = peer.address();
+        if (address.is_v6() && address.to_v6().is_v4_mapped())
+          address = address.to_v6().to_v4();
+        std::size_t hash = peer.port();
+        if (address.is_v4())
+          for (auto byte: address.to_v4().to_bytes())
+            boost::hash_combine(hash, byte);
+        else
+          for (auto byte: address.to_v6().to_bytes())
+            boost::hash_combine(hash, byte);
+        return *this->_shards[hash % this->_shards.size()];
+      }
+
       UTPServer::Impl::~Impl()
       {
         try
@@ -378,18 +423,31 @@ namespace elle
         ELLE_DEBUG("icmp type %s code %s ip %s port %s payload %s",
                    type, code, inet_ntoa(sa.sin_addr), ntohs(sa.sin_port),
                    res - offset_udp_payload);
+        auto* ctx = this->shard(
+          EndPoint(boost::asio::ip::address_v4(ntohl(sa.sin_addr.s_addr)),
+                   ntohs(sa.sin_port))).ctx();
         if (type == 3 && code == 4)
           utp_process_icmp_fragmentation(
-            this->_ctx, buf + offset_udp_payload, res - offset_udp_payload,
+            ctx, buf + offset_udp_payload, res - offset_udp_payload,
             (struct sockaddr*)&sa,
             sizeof(sa), 0); // FIXME properly fill next_hop_mtu
         else
-          utp_process_icmp_error(this->_ctx, buf+offset_udp_payload,
+          utp_process_icmp_error(ctx, buf+offset_udp_payload,
             res - offset_udp_payload,
             (struct sockaddr*)&sa,
             sizeof(sa));
 #endif
-        // Code coming straight from ucat libutp example.
+        for (auto& shard: this->_shards)
+          shard->_check_icmp();
+      }
+
+      void
+      UTPServer::Impl::Shard::_check_icmp()
+      {
+        ELLE_LOG_COMPONENT("elle.reactor.network.UTPServer.ICMP");
+        // Code coming straight from ucat libutp example. Errors are queued on
+        // the socket that sent the offending packet, which is the one of the
+        // shard owning the peer.
 #if defined ELLE_LINUX
         int fd = this->_socket->socket()->native_handle();
         unsigned char vec_buf[4096], ancillary_buf[4096];
@@ -496,59 +554,36 @@ namespace elle
       void
       UTPServer::Impl::listen(EndPoint const& ep)
       {
-        ELLE_TRACE("%s: listen to %s", this, ep);
+        ELLE_TRACE("%s: listen to %s with %s shards",
+                   this, ep, this->_shards.size());
+        auto const reuse_port = this->_shards.size() > 1;
         this->_socket = std::make_unique<RDVSocket>();
         this->_socket->close();
-        this->_socket->bind(ep);
+        this->_socket->bind(ep, reuse_port);
+        // Bind every shard to the actual port, in case we were given 0.
+        auto const bound =
+          EndPoint(ep.address(), this->_socket->local_endpoint().port());
+        for (auto& shard: this->_shards)
+        {
+          if (shard->_index == 0)
+            shard->_socket = this->_socket.get();
+          else
+          {
+            shard->_own_socket = std::make_unique<UDPSocket>();
+            shard->_own_socket->close();
+            shard->_own_socket->bind(bound, reuse_port);
+            shard->_socket = shard->_own_socket.get();
+          }
 #ifdef ELLE_LINUX
-        int on = 1;
-        /* Set the option, so we can receive errors */
-        setsockopt(this->_socket->socket()->native_handle(), SOL_IP, IP_RECVERR,
-                   (char*)&on, sizeof(on));
+          int on = 1;
+          /* Set the option, so we can receive errors */
+          setsockopt(shard->_socket->socket()->native_handle(),
+                     SOL_IP, IP_RECVERR, (char*)&on, sizeof(on));
 #endif
-        this->_listener = std::make_unique<Thread>(
-          elle::sprintf("UTPServer(%s)", this->_socket->local_endpoint().port()),
-          [this]
-          {
-            elle::Buffer buf;
-            while (true)
-            {
-              buf.size(20000);
-              EndPoint source;
-              try
-              {
-                if (!this->_socket->socket()->is_open())
-                {
-                  ELLE_DEBUG("Socket closed, exiting");
-                  return;
-                }
-                auto sz = this->_socket->receive_from
-                  (elle::WeakBuffer(buf.mutable_contents(), buf.size()), source);
-                buf.size(sz);
-                if (this->_xorify)
-                {
-                  for (auto i= 0u; i < sz; ++i)
-                    buf[i] ^= this->_xorify;
-                }
-                auto* raw = source.data();
-                ELLE_TRACE("%s: received %s bytes", this, sz);
-                utp_process_udp(this->_ctx, buf.contents(), sz, raw,
-                                source.size());
-                utp_issue_deferred_acks(this->_ctx);
-              }
-              catch (elle::reactor::Terminate const&)
-              {
-                this->_cleanup();
-                throw;
-              }
-              catch (std::exception const& e)
-              {
-                ELLE_TRACE("listener exception %s", e.what());
-                // go on, this error might concern one of the many peers we deal
-                // with.
-              }
-            }
-          });
+          shard->_listener = std::make_unique<Thread>(
+            elle::sprintf("UTPServer(%s, %s)", bound.port(), shard->_index),
+            [s = shard.get()] { s->_listen(); });
+        }
         this->_checker.reset(new Thread("UTP checker", [this] {
               try
               {
@@ -559,7 +594,8 @@ namespace elle
                     {
                       return !t || t->done();
                     });
-                  utp_check_timeouts(this->_ctx);
+                  for (auto& shard: this->_shards)
+                    utp_check_timeouts(shard->_ctx);
                   reactor::sleep(50ms);
                   this->_check_icmp();
                 }
@@ -575,7 +611,59 @@ namespace elle
       }
 
       void
-      UTPServer::Impl::send_to(elle::ConstWeakBuffer buf, EndPoint where,
+      UTPServer::Impl::Shard::_listen()
+      {
+        elle::Buffer buf;
+        while (true)
+        {
+          buf.size(20000);
+          EndPoint source;
+          try
+          {
+            if (!this->_socket->socket()->is_open())
+            {
+              ELLE_DEBUG("Socket closed, exiting");
+              return;
+            }
+            auto sz = this->_socket->UDPSocket::receive_from
+              (elle::WeakBuffer(buf.mutable_contents(), buf.size()), source);
+            // RDV traffic may land on any shard socket, let the RDV socket
+            // handle it.
+            if (this->_owner._socket->process(
+                  elle::WeakBuffer(buf.mutable_contents(), sz), source))
+              continue;
+            buf.size(sz);
+            if (auto const xorify = this->_owner._xorify)
+            {
+              for (auto i= 0u; i < sz; ++i)
+                buf[i] ^= xorify;
+            }
+            auto* raw = source.data();
+            auto& shard = this->_owner.shard(source);
+            ELLE_TRACE("%s: received %s bytes for shard %s",
+                       this, sz, shard._index);
+            utp_process_udp(shard._ctx, buf.contents(), sz, raw,
+                            source.size());
+            utp_issue_deferred_acks(shard._ctx);
+          }
+          catch (elle::reactor::Terminate const&)
+          {
+            if (this->_index == 0)
+              this->_owner._cleanup();
+            throw;
+          }
+          catch (std::exception const& e)
+          {
+            ELLE_TRACE("listener exception %s", e.what());
+            // go on, this error might concern one of the many peers we deal
+            // with.
+          }
+        }
+      }
+
+      void
+      UTPServer::Impl::Shard::send_to(elle::ConstWeakBuffer buf,
+                                      EndPoint where,
         std::function<void(boost::system::error_code const&)> on_error)
       {
         this->_send_buffer.emplace_back(elle::Buffer(buf.contents(), buf.size()),
@@ -613,7 +701,7 @@ namespace elle
       }
 
       void
-      UTPServer::Impl::_send()
+      UTPServer::Impl::Shard::_send()
       {
         auto& buf = this->_send_buffer.front();
         ELLE_TRACE_SCOPE(
@@ -633,7 +721,8 @@ namespace elle
       };
 
       void
-      UTPServer::Impl::_send_cont(boost::system::error_code const& erc, size_t)
+      UTPServer::Impl::Shard::_send_cont(boost::system::error_code const& erc,
+                                         size_t)
       {
         if (erc == boost::asio::error::operation_aborted)
           return;
@@ -667,16 +756,27 @@ namespace elle
             this->_checker->terminate();
             reactor::wait(*this->_checker);
           }
-          if (this->_listener)
+          for (auto& shard: this->_shards)
+            if (shard->_listener)
+            {
+              shard->_listener->terminate();
+              reactor::wait(*shard->_listener);
+            }
+          for (auto& shard: this->_shards)
           {
-            this->_listener->terminate();
-            reactor::wait(*this->_listener);
+            shard->_socket->socket()->close();
+            shard->_socket->close();
+            shard->_socket = nullptr;
+            shard->_own_socket.reset();
           }
-          this->_socket->socket()->close();
-          this->_socket->close();
           this->_socket.reset(nullptr);
         }
-        utp_destroy(this->_ctx);
+        for (auto& shard: this->_shards)
+          if (shard->_ctx)
+          {
+            utp_destroy(shard->_ctx);
+            shard->_ctx = nullptr;
+          }
       }
     }
   }
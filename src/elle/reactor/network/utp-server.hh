@@ -20,7 +20,12 @@ namespace elle
         /// Construct an UTP server.
         ///
         /// XXX: Add xorify to the constructor?
-        UTPServer();
+        ///
+        /// \param shards The number of utp contexts, each with its own UDP
+        ///               socket bound to the listening endpoint through
+        ///               SO_REUSEPORT. Connections are spread among them by
+        ///               hashing the peer endpoint.
+        UTPServer(int shards = 1);
 
       /*-----------.
       | Attributes |
@@ -28,6 +33,9 @@ namespace elle
       public:
         /// Apply a xor on every single bytes with the given char.
         ELLE_attribute_rw(unsigned char, xorify);
+        /// The number of utp contexts connections are spread among.
+        int
+        shards() const;
 
       /*-----------.
       | Networking |
@@ -22,6 +22,8 @@ namespace elle
       public:
         /// Import from libutp/utp.h.
         using utp_socket = ::UTPSocket;
+        /// Import from libutp/utp.h.
+        using utp_context = ::struct_utp_context;
         /// From reactor/network/utp-socket.hh.
         friend class UTPSocket;
 
@@ -73,6 +75,10 @@ namespace elle
         _destroyed();
         void
         _write_cont();
+        /// Move the unconnected socket to the given context, so it is driven
+        /// by the shard owning its peer.
+        void
+        _attach(utp_context* ctx);
       private:
         void
         _read();
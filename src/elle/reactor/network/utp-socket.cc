@@ -94,7 +94,7 @@ namespace elle
       UTPSocket::UTPSocket(UTPServer& server)
         : UTPSocket(std::make_unique<Impl>(
                       server._impl,
-                      utp_create_socket(server._impl->_ctx),
+                      utp_create_socket(server._impl->shards().front()->ctx()),
                       false))
       {
         this->_impl->_destroyed_barrier.open();
@@ -103,7 +103,7 @@ namespace elle
       UTPSocket::UTPSocket(UTPServer& server, std::string const& host, int port)
         : UTPSocket(std::make_unique<Impl>(
                       server._impl,
-                      utp_create_socket(server._impl->_ctx),
+                      utp_create_socket(server._impl->shards().front()->ctx()),
                       false))
       {
         connect(host, port);
@@ -217,6 +217,18 @@ namespace elle
         this->_socket = nullptr;
       }
 
+      void
+      UTPSocket::Impl::_attach(utp_context* ctx)
+      {
+        if (utp_get_context(this->_socket) == ctx)
+          return;
+        ELLE_DEBUG("%s: move to the peer's shard", this);
+        utp_set_userdata(this->_socket, nullptr);
+        utp_close(this->_socket);
+        this->_socket = utp_create_socket(ctx);
+        utp_set_userdata(this->_socket, this);
+      }
+
       void
       UTPSocket::Impl::_read()
       {
@@ -300,6 +312,13 @@ namespace elle
         }
         if (res)
           elle::err("Failed to resolve %s", host);
+        if (auto server = this->_impl->_server.lock())
+        {
+          auto peer = EndPoint();
+          memcpy(peer.data(), ai->ai_addr, ai->ai_addrlen);
+          peer.resize(ai->ai_addrlen);
+          this->_impl->_attach(server->shard(peer).ctx());
+        }
         this->_impl->_destroyed_barrier.close();
         utp_connect(this->_impl->_socket, ai->ai_addr, ai->ai_addrlen);
         freeaddrinfo(ai);
@@ -459,6 +478,18 @@ namespace elle
         return this->_impl->peer();
       }
 
+      bool
+      UTPSocket::connected() const
+      {
+        return this->_impl->_open && this->_impl->_socket;
+      }
+
+      std::size_t
+      UTPSocket::available() const
+      {
+        return this->_impl->_read_buffer.size();
+      }
+
       UTPSocket::EndPoint
       UTPSocket::Impl::peer() const
       {
@@ -69,6 +69,12 @@ namespace elle
         /// Get the EndPoint of the peer.
         EndPoint
         peer() const;
+        /// Whether the connection is established and was not closed.
+        bool
+        connected() const;
+        /// Number of received bytes not read yet.
+        std::size_t
+        available() const;
 
       /*----------.
       | Printable |
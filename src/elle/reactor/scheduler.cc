@@ -16,6 +16,7 @@
 # include <elle/reactor/backend/boost/backend.hh>
 #endif
 #include <elle/reactor/exception.hh>
+#include <elle/reactor/network/resolve.hh>
 #include <elle/reactor/Operation.hh>
 #include <elle/reactor/scheduler.hh>
 #include <elle/reactor/Thread.hh>
@@ -601,6 +602,18 @@ namespace elle
         });
       }
 
+    /*---------.
+    | Resolver |
+    `---------*/
+
+    network::Resolver&
+    Scheduler::resolver()
+    {
+      if (!this->_resolver)
+        this->_resolver = std::make_unique<network::Resolver>();
+      return *this->_resolver;
+    }
+
     /*--------.
     | Signals |
     `--------*/
@@ -291,6 +291,16 @@ namespace elle
       ELLE_ATTRIBUTE_RX(boost::asio::io_service, io_service);
       ELLE_ATTRIBUTE(std::unique_ptr<boost::asio::io_service::work>, io_service_work);
 
+    /*---------.
+    | Resolver |
+    `---------*/
+    public:
+      /// The host name resolver, and its cache, of this scheduler.
+      network::Resolver&
+      resolver();
+    private:
+      ELLE_ATTRIBUTE(std::unique_ptr<network::Resolver>, resolver);
+
     /*--------.
     | Details |
     `--------*/
@@ -2,7 +2,9 @@
 
 ELLE_LOG_COMPONENT("elle.protocol.Channel.test");
 
+#include <elle/With.hh>
 #include <elle/compiler.hh>
+#include <elle/os/environ.hh>
 #include <elle/test.hh>
 
 #include <elle/protocol/ChanneledStream.hh>
@@ -10,6 +12,9 @@ ELLE_LOG_COMPONENT("elle.protocol.Channel.test");
 #include <elle/reactor/network/Error.hh>
 #include <elle/reactor/network/TCPServer.hh>
 #include <elle/reactor/network/TCPSocket.hh>
+#include <elle/reactor/Scope.hh>
+
+using namespace std::literals;
 
 template <typename Server, typename Client>
 void
@@ -80,6 +85,182 @@ ELLE_TEST_SCHEDULED(eof_read)
     });
 }
 
+/// Run \a f with two connected ChanneledStreams.
+static
+void
+connected(elle::Version const& version,
+          std::function<void (elle::protocol::ChanneledStream&,
+                              elle::protocol::ChanneledStream&)> const& f)
+{
+  using elle::protocol::ChanneledStream;
+  using elle::protocol::Serializer;
+  auto server = elle::reactor::network::TCPServer{};
+  server.listen();
+  std::unique_ptr<elle::reactor::network::TCPSocket> alice_socket;
+  std::unique_ptr<elle::reactor::network::TCPSocket> bob_socket;
+  std::unique_ptr<Serializer> alice_serializer;
+  std::unique_ptr<Serializer> bob_serializer;
+  std::unique_ptr<ChanneledStream> alice;
+  std::unique_ptr<ChanneledStream> bob;
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "alice",
+      [&]
+      {
+        alice_socket = server.accept();
+        alice_serializer.reset(new Serializer(*alice_socket, version));
+        alice.reset(new ChanneledStream(*alice_serializer));
+      });
+    scope.run_background(
+      "bob",
+      [&]
+      {
+        bob_socket.reset(
+          new elle::reactor::network::TCPSocket("127.0.0.1", server.port()));
+        bob_serializer.reset(new Serializer(*bob_socket, version));
+        bob.reset(new ChanneledStream(*bob_serializer));
+      });
+    elle::reactor::wait(scope);
+  };
+  f(*alice, *bob);
+}
+
+// Check a small packet is not stuck behind a large one on another channel.
+ELLE_TEST_SCHEDULED(interleave)
+{
+  connected(
+    elle::Version(0, 4, 0),
+    [] (elle::protocol::ChanneledStream& alice,
+        elle::protocol::ChanneledStream& bob)
+    {
+      BOOST_CHECK(alice.framed());
+      auto const big = elle::Buffer(std::string(64 << 20, 'b'));
+      auto const small = elle::Buffer("small");
+      auto bulk = elle::protocol::Channel(alice);
+      auto rpc = elle::protocol::Channel(alice);
+      elle::reactor::Barrier started;
+      auto big_sent = false;
+      elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+      {
+        scope.run_background(
+          "bulk",
+          [&]
+          {
+            bulk.write(big);
+            big_sent = true;
+          });
+        scope.run_background(
+          "bob",
+          [&]
+          {
+            auto bulk = bob.accept();
+            started.open();
+            auto rpc = bob.accept();
+            BOOST_CHECK_EQUAL(rpc.read(), small);
+            BOOST_CHECK(bulk.read() == big);
+          });
+        elle::reactor::wait(started);
+        rpc.write(small);
+        BOOST_CHECK(!big_sent);
+        elle::reactor::wait(scope);
+      };
+    });
+}
+
+// Check a writer stops when its reader does not keep up.
+ELLE_TEST_SCHEDULED(flow_control)
+{
+  elle::os::setenv("ELLE_PROTOCOL_CHANNEL_WINDOW", "65536", true);
+  connected(
+    elle::Version(0, 4, 0),
+    [] (elle::protocol::ChanneledStream& alice,
+        elle::protocol::ChanneledStream& bob)
+    {
+      elle::os::unsetenv("ELLE_PROTOCOL_CHANNEL_WINDOW");
+      BOOST_CHECK_EQUAL(alice.window(), 65536);
+      auto const packet = elle::Buffer(std::string(16384, 'p'));
+      auto channel = elle::protocol::Channel(alice);
+      auto sent = 0;
+      elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+      {
+        scope.run_background(
+          "alice",
+          [&]
+          {
+            for (int i = 0; i < 100; ++i)
+            {
+              channel.write(packet);
+              ++sent;
+            }
+          });
+        auto peer = bob.accept();
+        elle::reactor::sleep(valgrind(100ms, 5));
+        // The window fits 4 packets.
+        BOOST_CHECK_EQUAL(sent, 4);
+        BOOST_CHECK_LE(channel.credit(), 0);
+        for (int i = 0; i < 100; ++i)
+          BOOST_CHECK_EQUAL(peer.read(), packet);
+        elle::reactor::wait(scope);
+      };
+      BOOST_CHECK_EQUAL(sent, 100);
+    });
+}
+
+// Check an interrupted packet is dropped and the channel goes on.
+ELLE_TEST_SCHEDULED(interrupted)
+{
+  connected(
+    elle::Version(0, 4, 0),
+    [] (elle::protocol::ChanneledStream& alice,
+        elle::protocol::ChanneledStream& bob)
+    {
+      auto const big = elle::Buffer(std::string(64 << 20, 'b'));
+      auto channel = elle::protocol::Channel(alice);
+      elle::reactor::Barrier started;
+      elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+      {
+        auto& writer = scope.run_background(
+          "writer",
+          [&]
+          {
+            channel.write(big);
+            BOOST_FAIL("write should have been interrupted");
+          });
+        scope.run_background(
+          "bob",
+          [&]
+          {
+            auto peer = bob.accept();
+            started.open();
+            BOOST_CHECK_EQUAL(peer.read(), elle::Buffer("ok"));
+            BOOST_CHECK_EQUAL(peer.read(), elle::Buffer("ok again"));
+          });
+        elle::reactor::wait(started);
+        writer.terminate_now();
+        channel.write(elle::Buffer("ok"));
+        channel.write(elle::Buffer("ok again"));
+        elle::reactor::wait(scope);
+      };
+    });
+}
+
+// Check older versions still send packets whole.
+ELLE_TEST_SCHEDULED(unframed)
+{
+  connected(
+    elle::Version(0, 3, 0),
+    [] (elle::protocol::ChanneledStream& alice,
+        elle::protocol::ChanneledStream& bob)
+    {
+      BOOST_CHECK(!alice.framed());
+      auto channel = elle::protocol::Channel(alice);
+      channel.write(elle::Buffer("hello"));
+      auto peer = bob.accept();
+      BOOST_CHECK_EQUAL(peer.read(), elle::Buffer("hello"));
+    });
+}
+
 ELLE_TEST_SUITE()
 {
   auto& suite = boost::unit_test::framework::master_test_suite();
@@ -89,4 +270,8 @@ ELLE_TEST_SUITE()
     eof->add(ELLE_TEST_CASE(eof_accept, "accept"), 0, valgrind(2));
     eof->add(ELLE_TEST_CASE(eof_read, "read"), 0, valgrind(2));
   }
+  suite.add(BOOST_TEST_CASE(interleave), 0, valgrind(10));
+  suite.add(BOOST_TEST_CASE(flow_control), 0, valgrind(5));
+  suite.add(BOOST_TEST_CASE(interrupted), 0, valgrind(10));
+  suite.add(BOOST_TEST_CASE(unframed), 0, valgrind(2));
 }
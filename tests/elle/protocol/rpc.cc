@@ -1,8 +1,13 @@
+#include <elle/finally.hh>
+
 #include <elle/protocol/ChanneledStream.hh>
 #include <elle/protocol/RPC.hh>
 #include <elle/protocol/Serializer.hh>
+#include <elle/protocol/StaticRPC.hh>
+#include <elle/protocol/exceptions.hh>
 
 #include <elle/reactor/asio.hh>
+#include <elle/reactor/Scope.hh>
 #include <elle/reactor/network/Error.hh>
 #include <elle/reactor/network/TCPServer.hh>
 #include <elle/reactor/network/TCPSocket.hh>
@@ -15,6 +20,8 @@
 
 ELLE_LOG_COMPONENT("elle.protocol.test");
 
+using namespace std::literals;
+
 struct TestConfig
 {
   bool sync;
@@ -39,6 +46,10 @@ struct DummyRPC:
     , suicide("suicide", *this)
     , count("count", *this)
     , wait("wait", *this)
+    , hold("hold", *this)
+    , limited("limited", *this)
+    , notify("notify", *this)
+    , range("range", *this)
   {}
 
   RemoteProcedure<int> answer;
@@ -48,6 +59,10 @@ struct DummyRPC:
   RemoteProcedure<void> suicide;
   RemoteProcedure<int> count;
   RemoteProcedure<void> wait;
+  RemoteProcedure<int, int> hold;
+  RemoteProcedure<void> limited;
+  RemoteProcedure<void, int> notify;
+  RemoteProcedure<elle::reactor::Generator<int>, int> range;
 };
 
 class RPCServer
@@ -56,6 +71,9 @@ public:
   RPCServer(TestConfig config)
     : _config(config)
     , _counter(0)
+    , _held(0)
+    , _produced(0)
+    , _rpc(nullptr)
     , _server()
     , _thread(elle::sprintf("%s runner", *this), [this] { this->_run(); })
   {
@@ -88,6 +106,8 @@ public:
     elle::protocol::ChanneledStream channels(sched, s, _config.version);
 
     DummyRPC rpc(channels);
+    this->_rpc = &rpc;
+    elle::SafeFinally forget([this] { this->_rpc = nullptr; });
     rpc.answer = [] { return 42; };
     rpc.square = [] (int x) { return x * x; };
     rpc.concat = []
@@ -113,6 +133,34 @@ public:
         return this->_counter;
       };
     rpc.wait = [this] { ++this->_counter; elle::reactor::sleep(); };
+    rpc.hold = [this] (int x)
+      {
+        ++this->_counter;
+        ++this->_held;
+        elle::SafeFinally release([this] { --this->_held; });
+        elle::reactor::wait(this->_hold_barrier);
+        return x;
+      };
+    rpc.limited = [this]
+      {
+        ++this->_counter;
+        elle::reactor::wait(this->_hold_barrier);
+      };
+    rpc.limited.admission().concurrency(1);
+    rpc.limited.admission().queue(1);
+    rpc.notify = [this] (int x) { this->_counter += x; };
+    rpc.range = [this] (int n)
+      {
+        return elle::reactor::Generator<int>(
+          [this, n] (elle::reactor::yielder<int> const& yield)
+          {
+            for (int i = 0; i < n; ++i)
+            {
+              ++this->_produced;
+              yield(i);
+            }
+          });
+      };
     try
     {
       if (this->_config.sync)
@@ -126,7 +174,13 @@ public:
 
   ELLE_ATTRIBUTE_R(TestConfig, config);
   ELLE_ATTRIBUTE_R(int, counter);
+  /// Calls to hold in progress.
+  ELLE_ATTRIBUTE_R(int, held);
+  /// Results sent by range.
+  ELLE_ATTRIBUTE_R(int, produced);
+  ELLE_ATTRIBUTE_R(DummyRPC*, rpc);
   ELLE_ATTRIBUTE_RX(elle::reactor::Barrier, count_barrier)
+  ELLE_ATTRIBUTE_RX(elle::reactor::Barrier, hold_barrier)
   ELLE_ATTRIBUTE(elle::reactor::network::TCPServer, server);
   ELLE_ATTRIBUTE(elle::reactor::Thread, thread);
 };
@@ -211,6 +265,238 @@ ELLE_TEST_SCHEDULED(parallel, (TestConfig, config))
   BOOST_CHECK(inserted.empty());
 }
 
+/*-------------.
+| Multiplexing |
+`-------------*/
+
+ELLE_TEST_SCHEDULED(out_of_order, (TestConfig, config))
+{
+  if (config.sync || config.version < elle::Version(0, 4, 0))
+    return;
+  RPCServer server(config);
+  elle::reactor::network::TCPSocket socket("127.0.0.1", server.port());
+  elle::protocol::Serializer s(socket, config.version, config.checksum);
+  elle::protocol::ChanneledStream channels(s, config.version);
+  DummyRPC rpc(channels);
+  BOOST_CHECK(rpc.multiplexed());
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    // Pipeline many calls, the first ones being held by the server.
+    for (int i = 0; i < 4; ++i)
+      scope.run_background(
+        elle::sprintf("hold %s", i),
+        [&, i] { BOOST_CHECK_EQUAL(rpc.hold(i), i); });
+    do
+    {
+      elle::reactor::yield();
+    }
+    while (server.counter() != 4);
+    // Later calls are answered first.
+    for (int i = 0; i < 16; ++i)
+      BOOST_CHECK_EQUAL(rpc.square(i), i * i);
+    BOOST_CHECK_EQUAL(server.counter(), 4);
+    server.hold_barrier().open();
+    elle::reactor::wait(scope);
+  };
+}
+
+/*---------.
+| Deadline |
+`---------*/
+
+ELLE_TEST_SCHEDULED(deadline, (TestConfig, config))
+{
+  if (config.version < elle::Version(0, 4, 0))
+    return;
+  RPCServer server(config);
+  elle::reactor::network::TCPSocket socket("127.0.0.1", server.port());
+  elle::protocol::Serializer s(socket, config.version, config.checksum);
+  elle::protocol::ChanneledStream channels(s, config.version);
+  DummyRPC rpc(channels);
+  rpc.hold.timeout(100ms);
+  BOOST_CHECK_THROW(rpc.hold(1), elle::reactor::Timeout);
+  // The call is cancelled on the server too.
+  while (server.held())
+    elle::reactor::sleep(10ms);
+  BOOST_CHECK_EQUAL(server.counter(), 1);
+  BOOST_CHECK_EQUAL(rpc.square(3), 9);
+}
+
+/*----------.
+| Admission |
+`----------*/
+
+ELLE_TEST_SCHEDULED(admission, (TestConfig, config))
+{
+  if (config.sync || config.version < elle::Version(0, 4, 0))
+    return;
+  RPCServer server(config);
+  elle::reactor::network::TCPSocket socket("127.0.0.1", server.port());
+  elle::protocol::Serializer s(socket, config.version, config.checksum);
+  elle::protocol::ChanneledStream channels(s, config.version);
+  DummyRPC rpc(channels);
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    for (int i = 0; i < 2; ++i)
+      scope.run_background(elle::sprintf("limited %s", i),
+                           [&] { rpc.limited(); });
+    do
+    {
+      elle::reactor::yield();
+    }
+    while (!server.rpc() || server.rpc()->limited.admission().queued() != 1);
+    auto const& admission = server.rpc()->limited.admission();
+    BOOST_CHECK_EQUAL(admission.running(), 1);
+    // One running and one queued: further calls are rejected.
+    BOOST_CHECK_THROW(rpc.limited(), elle::protocol::RPCError);
+    BOOST_CHECK_EQUAL(admission.rejected(), 1);
+    server.hold_barrier().open();
+    elle::reactor::wait(scope);
+    BOOST_CHECK_EQUAL(server.counter(), 2);
+    BOOST_CHECK_EQUAL(admission.latency().count(), 2);
+    BOOST_CHECK_EQUAL(admission.queue_time().count(), 2);
+    BOOST_CHECK_GE(admission.latency().percentile(0.5),
+                   admission.latency().percentile(0.1));
+  };
+}
+
+/*-----.
+| Post |
+`-----*/
+
+ELLE_TEST_SCHEDULED(post, (TestConfig, config))
+{
+  RPCServer server(config);
+  elle::reactor::network::TCPSocket socket("127.0.0.1", server.port());
+  elle::protocol::Serializer s(socket, config.version, config.checksum);
+  elle::protocol::ChanneledStream channels(s, config.version);
+  DummyRPC rpc(channels);
+  rpc.notify.post(2);
+  rpc.notify.post(3);
+  while (server.counter() != 5)
+    elle::reactor::sleep(10ms);
+  BOOST_CHECK_EQUAL(rpc.square(3), 9);
+}
+
+/*----------.
+| Streaming |
+`----------*/
+
+ELLE_TEST_SCHEDULED(stream, (TestConfig, config))
+{
+  RPCServer server(config);
+  elle::reactor::network::TCPSocket socket("127.0.0.1", server.port());
+  elle::protocol::Serializer s(socket, config.version, config.checksum);
+  elle::protocol::ChanneledStream channels(s, config.version);
+  DummyRPC rpc(channels);
+  if (config.version < elle::Version(0, 4, 0))
+  {
+    BOOST_CHECK_THROW(rpc.range(3), elle::protocol::RPCError);
+    return;
+  }
+  auto expected = 0;
+  for (auto i: rpc.range(10))
+    BOOST_CHECK_EQUAL(i, expected++);
+  BOOST_CHECK_EQUAL(expected, 10);
+  // The server does not run ahead of a slow consumer.
+  {
+    auto results = rpc.range(100000);
+    for (auto i: results)
+    {
+      BOOST_CHECK_EQUAL(i, 0);
+      elle::reactor::sleep(100ms);
+      break;
+    }
+    BOOST_CHECK_LE(server.produced(), 10 + 3 * rpc.stream_window());
+  }
+  BOOST_CHECK_EQUAL(rpc.square(3), 9);
+}
+
+/*-----------------.
+| Static interface |
+`-----------------*/
+
+namespace symbols
+{
+  ELLE_DAS_SYMBOL(square);
+  ELLE_DAS_SYMBOL(concat);
+  ELLE_DAS_SYMBOL(range);
+}
+
+struct Calculator
+{
+  int
+  square(int x)
+  {
+    return x * x;
+  }
+
+  std::string
+  concat(std::string const& a, std::string const& b)
+  {
+    return a + b;
+  }
+
+  elle::reactor::Generator<int>
+  range(int n)
+  {
+    return elle::reactor::Generator<int>(
+      [n] (elle::reactor::yielder<int> const& yield)
+      {
+        for (int i = 0; i < n; ++i)
+          yield(i);
+      });
+  }
+};
+
+using CalculatorRPC = elle::protocol::StaticRPC<
+  elle::serialize::InputBinaryArchive,
+  elle::serialize::OutputBinaryArchive,
+  symbols::Symbol_square::Formal<int (int)>,
+  symbols::Symbol_concat::Formal<
+    std::string (std::string const&, std::string const&)>,
+  symbols::Symbol_range::Formal<elle::reactor::Generator<int> (int)>>;
+
+ELLE_TEST_SCHEDULED(static_interface, (TestConfig, config))
+{
+  elle::reactor::network::TCPServer server;
+  server.listen();
+  Calculator calculator;
+  elle::reactor::Thread serve(
+    "serve",
+    [&]
+    {
+      auto socket = server.accept();
+      elle::protocol::Serializer s(
+        *socket, config.version, config.checksum);
+      elle::protocol::ChanneledStream channels(s, config.version);
+      CalculatorRPC rpc(channels, calculator);
+      try
+      {
+        if (config.sync)
+          rpc.run();
+        else
+          rpc.parallel_run();
+      }
+      catch (elle::reactor::network::ConnectionClosed&)
+      {}
+    });
+  elle::SafeFinally stop([&] { serve.terminate_now(); });
+  elle::reactor::network::TCPSocket socket("127.0.0.1", server.port());
+  elle::protocol::Serializer s(socket, config.version, config.checksum);
+  elle::protocol::ChanneledStream channels(s, config.version);
+  CalculatorRPC rpc(channels);
+  BOOST_CHECK_EQUAL(rpc.call(symbols::square, 3), 9);
+  BOOST_CHECK_EQUAL(rpc.call(symbols::concat, "foo", "bar"), "foobar");
+  if (config.version >= elle::Version(0, 4, 0))
+  {
+    auto expected = 0;
+    for (auto i: rpc.call(symbols::range, 3))
+      BOOST_CHECK_EQUAL(i, expected++);
+    BOOST_CHECK_EQUAL(expected, 3);
+  }
+}
+
 /*--------------.
 | Disconnection |
 `--------------*/
@@ -260,15 +546,25 @@ ELLE_TEST_SUITE()
     {false, true,  elle::Version(0, 2, 0)},
     {false, false, elle::Version(0, 1, 0)},
     {false, false, elle::Version(0, 2, 0)},
+    {true,  false, elle::Version(0, 4, 0)},
+    {true,  true,  elle::Version(0, 4, 0)},
+    {false, true,  elle::Version(0, 4, 0)},
+    {false, false, elle::Version(0, 4, 0)},
   };
   auto test = [&](std::string const& name, std::function<void(TestConfig)> f)
   {
-    for (int i=0; i<8; ++i)
+    for (auto const& config: configs)
       suite.add(
-        BOOST_TEST_CASE(std::bind(f, configs[i])), 0, valgrind(1, 10));
+        BOOST_TEST_CASE(std::bind(f, config)), 0, valgrind(1, 10));
   };
   test("rpc", &rpc);
   test("terminate", &terminate);
   test("parallel", &parallel);
   test("disconnection", &disconnection);
+  test("out_of_order", &out_of_order);
+  test("deadline", &deadline);
+  test("admission", &admission);
+  test("post", &post);
+  test("stream", &stream);
+  test("static_interface", &static_interface);
 }
@@ -8,7 +8,11 @@
 
 #include <elle/cryptography/random.hh>
 
+#include <elle/os/environ.hh>
+
 #include <elle/protocol/Channel.hh>
+#include <elle/protocol/Checksum.hh>
+#include <elle/protocol/Compression.hh>
 #include <elle/protocol/ChanneledStream.hh>
 #include <elle/protocol/exceptions.hh>
 
@@ -405,7 +409,8 @@ dialog(elle::Version const& version,
 
 #define CASES(function)                                                 \
   for (auto const& version: {elle::Version{0, 1, 0},                    \
-                             elle::Version{0, 2, 0}})                   \
+                             elle::Version{0, 2, 0},                    \
+                             elle::Version{0, 4, 0}})                   \
     for (auto checksum: {true, false})                                  \
       ELLE_LOG("case: version = %s, checksum = %s", version, checksum)  \
         function(version, checksum)                                     \
@@ -711,6 +716,122 @@ ELLE_TEST_SCHEDULED(interruption)
   CASES(_interruption);
 }
 
+static
+void
+_streaming(elle::Version const& version,
+           bool checksum)
+{
+  auto const packet = elle::Buffer(std::string((2 << 18) + 11, 'y'));
+  // Stream a packet from a source, checking chunks are bounded.
+  auto const stream = [&] (elle::protocol::Serializer& s)
+    {
+      auto offset = elle::Buffer::Size(0);
+      s.write(packet.size(),
+              [&] (elle::WeakBuffer chunk)
+              {
+                BOOST_CHECK_LE(chunk.size(), s.chunk_size());
+                memcpy(chunk.mutable_contents(), packet.contents() + offset,
+                       chunk.size());
+                offset += chunk.size();
+              });
+      BOOST_CHECK_EQUAL(offset, packet.size());
+    };
+  // Receive a packet by chunks and reassemble it.
+  auto const receive = [&] (elle::protocol::Serializer& s)
+    {
+      auto res = elle::Buffer();
+      auto announced = elle::Buffer::Size(0);
+      auto chunks = 0;
+      auto const size = s.read(
+        [&] (elle::ConstWeakBuffer chunk)
+        {
+          BOOST_CHECK_LE(chunk.size(), s.chunk_size());
+          res.append(chunk.contents(), chunk.size());
+          ++chunks;
+        },
+        [&] (elle::Buffer::Size size)
+        {
+          announced = size;
+        });
+      BOOST_CHECK_EQUAL(size, announced);
+      BOOST_CHECK_EQUAL(size, res.size());
+      if (version >= elle::Version(0, 2, 0))
+        BOOST_CHECK_GT(chunks, 1);
+      return res;
+    };
+  dialog<Connector>(
+    version,
+    checksum,
+    [] (Connector&) {},
+    [&] (elle::protocol::Serializer& s)
+    {
+      stream(s);
+      stream(s);
+      // A failing source interrupts the packet.
+      auto chunks = 0;
+      BOOST_CHECK_THROW(
+        s.write(packet.size(),
+                [&] (elle::WeakBuffer chunk)
+                {
+                  if (++chunks == 3)
+                    throw elle::Error("source failed");
+                  memset(chunk.mutable_contents(), 'z', chunk.size());
+                }),
+        elle::Error);
+      s.write(elle::Buffer("ok"));
+    },
+    [&] (elle::protocol::Serializer& s)
+    {
+      BOOST_CHECK_EQUAL(s.read(), packet);
+      BOOST_CHECK_EQUAL(receive(s), packet);
+      // Streaming versions interrupt the packet midway, others never send
+      // it.
+      if (version >= elle::Version(0, 4, 0) ||
+          version >= elle::Version(0, 2, 0) && !checksum)
+        BOOST_CHECK_THROW(
+          s.read([] (elle::ConstWeakBuffer) {}),
+          elle::protocol::InterruptionError);
+      BOOST_CHECK_EQUAL(s.read(), elle::Buffer("ok"));
+    });
+}
+
+ELLE_TEST_SCHEDULED(streaming)
+{
+  CASES(_streaming);
+}
+
+static
+void
+_gather(elle::Version const& version,
+        bool checksum)
+{
+  // Pieces straddling chunk boundaries.
+  auto const header = elle::Buffer("header");
+  auto const body = elle::Buffer(std::string((2 << 17) + 5, 'g'));
+  auto expected = elle::Buffer(header);
+  expected.append(body.contents(), body.size());
+  expected.append(header.contents(), header.size());
+  dialog<Connector>(
+    version,
+    checksum,
+    [] (Connector&) {},
+    [&] (elle::protocol::Serializer& s)
+    {
+      s.write(elle::protocol::Stream::Buffers{header, body, header});
+      s.write(elle::protocol::Stream::Buffers{});
+    },
+    [&] (elle::protocol::Serializer& s)
+    {
+      BOOST_CHECK_EQUAL(s.read(), expected);
+      BOOST_CHECK_EQUAL(s.read(), elle::Buffer());
+    });
+}
+
+ELLE_TEST_SCHEDULED(gather)
+{
+  CASES(_gather);
+}
+
 ELLE_TEST_SCHEDULED(eof)
 {
   static std::string const data(
@@ -1088,6 +1209,237 @@ ELLE_TEST_SCHEDULED(read_interruption, (elle::Version, version))
   elle::reactor::wait(elle::reactor::Waitables({&writer, &reader}));
 }
 
+ELLE_TEST_SCHEDULED(hasher)
+{
+  using elle::protocol::Checksum;
+  auto const digest = [] (Checksum algorithm, std::string const& data)
+    {
+      elle::protocol::Hasher hasher(algorithm);
+      // Feed odd-sized pieces to exercise incremental computation.
+      for (auto i = 0u; i < data.size(); i += 7)
+        hasher.update(elle::ConstWeakBuffer(data.data() + i,
+                                            std::min<int>(7, data.size() - i)));
+      return hasher.digest();
+    };
+  auto const hex = [] (elle::Buffer const& b)
+    {
+      return elle::sprintf("%x", b);
+    };
+  BOOST_CHECK_EQUAL(hex(digest(Checksum::crc32c, "123456789")), "0xe3069283");
+  BOOST_CHECK_EQUAL(hex(digest(Checksum::xxh64, "")), "0xef46db3751d8e999");
+  BOOST_CHECK_EQUAL(hex(digest(Checksum::xxh64, "abc")), "0x44bc2cf5ad770999");
+  BOOST_CHECK_EQUAL(
+    hex(digest(Checksum::xxh64, "Nobody inspects the spammish repetition")),
+    "0xfbcea83c8a378bf1");
+  BOOST_CHECK_EQUAL(hex(digest(Checksum::sha1, "abc")),
+                    "0xa9993e364706816aba3e25717850c26c9cd0d89d");
+}
+
+// Check peers agree on the best common checksum and can exchange packets with
+// it.
+ELLE_TEST_SCHEDULED(checksums)
+{
+  using elle::protocol::Checksum;
+  auto const negotiate = [] (std::string const& alice_offer,
+                             std::string const& bob_offer,
+                             elle::Version const& alice_version =
+                               elle::Version(0, 4, 0))
+    -> boost::optional<Checksum>
+    {
+      Connector sockets;
+      std::unique_ptr<elle::protocol::Serializer> alice;
+      std::unique_ptr<elle::protocol::Serializer> bob;
+      elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+      {
+        // Offers are read before the constructor first yields.
+        auto const setup = [&] (
+          std::unique_ptr<elle::protocol::Serializer>& s,
+          Focket& socket,
+          std::string const& offer,
+          elle::Version const& version)
+          {
+            scope.run_background(
+              "setup",
+              [&, offer, version]
+              {
+                if (offer.empty())
+                  elle::os::unsetenv("ELLE_PROTOCOL_CHECKSUMS");
+                else
+                  elle::os::setenv("ELLE_PROTOCOL_CHECKSUMS", offer, true);
+                s.reset(new elle::protocol::Serializer(socket, version));
+              });
+          };
+        setup(alice, sockets.alice(), alice_offer, alice_version);
+        setup(bob, sockets.bob(), bob_offer, elle::Version(0, 4, 0));
+        elle::reactor::wait(scope);
+      };
+      elle::os::unsetenv("ELLE_PROTOCOL_CHECKSUMS");
+      BOOST_CHECK_EQUAL(alice->checksum(), bob->checksum());
+      BOOST_CHECK_EQUAL(alice->checksum_algorithm(),
+                        bob->checksum_algorithm());
+      auto const packet = elle::Buffer(std::string((2 << 17) + 3, 'c'));
+      elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+      {
+        scope.run_background("write", [&] { alice->write(packet); });
+        BOOST_CHECK_EQUAL(bob->read(), packet);
+        elle::reactor::wait(scope);
+      };
+      if (alice->checksum())
+        return alice->checksum_algorithm();
+      else
+        return boost::none;
+    };
+  BOOST_CHECK_EQUAL(negotiate("", ""), Checksum::crc32c);
+  BOOST_CHECK_EQUAL(negotiate("xxh64,sha1", ""), Checksum::xxh64);
+  BOOST_CHECK_EQUAL(negotiate("sha1", "crc32c,sha1"), Checksum::sha1);
+  BOOST_CHECK(!negotiate("crc32c", "xxh64"));
+  // Older peers only know SHA-1.
+  BOOST_CHECK_EQUAL(negotiate("", "", elle::Version(0, 3, 0)), Checksum::sha1);
+}
+
+ELLE_TEST_SCHEDULED(compressor)
+{
+  auto const text = [] (int n)
+    {
+      auto res = elle::Buffer();
+      for (int i = 0; i < n; ++i)
+      {
+        auto const entry =
+          elle::sprintf("{\"id\": %s, \"name\": \"entry\"}", i);
+        res.append(entry.data(), entry.size());
+      }
+      return res;
+    };
+  elle::protocol::Compressor compressor;
+  // Small packets are not worth it.
+  BOOST_CHECK(!compressor.compress("short"));
+  // Random data does not compress, whether probed or not.
+  {
+    auto const random =
+      elle::cryptography::random::generate<elle::Buffer>(1 << 17);
+    BOOST_CHECK(!compressor.compress(
+                  elle::ConstWeakBuffer(random.contents(), 1024)));
+    BOOST_CHECK(!compressor.compress(random));
+  }
+  BOOST_CHECK_EQUAL(compressor.statistics().skipped, 3);
+  for (auto size: {64, 100000})
+  {
+    auto const packet = text(size);
+    auto const compressed = compressor.compress(packet);
+    BOOST_REQUIRE(compressed);
+    BOOST_CHECK_LT(compressed->size(), packet.size() / 3);
+    BOOST_CHECK_EQUAL(compressor.decompress(*compressed), packet);
+  }
+  BOOST_CHECK_EQUAL(compressor.statistics().compressed, 2);
+  BOOST_CHECK_EQUAL(compressor.statistics().decompressed, 2);
+  BOOST_CHECK_GT(compressor.statistics().ratio(), 3);
+  // A dictionary helps small messages.
+  {
+    auto const message = elle::Buffer(
+      "{\"procedure\": \"fetch\", \"args\": [\"block\", 42]}"
+      "{\"procedure\": \"fetch\", \"args\": [\"block\", 43]}");
+    elle::protocol::Compressor with(message, 0, 16);
+    elle::protocol::Compressor without({}, 0, 16);
+    auto const a = with.compress(message);
+    auto const b = without.compress(message);
+    BOOST_REQUIRE(a);
+    BOOST_REQUIRE(b);
+    BOOST_CHECK_LT(a->size(), b->size());
+    BOOST_CHECK_EQUAL(with.decompress(*a), message);
+    BOOST_CHECK_THROW(without.decompress(*a), elle::protocol::Error);
+  }
+  // Corrupted data is detected.
+  {
+    auto const packet = text(64);
+    auto compressed = *compressor.compress(packet);
+    compressed.size(compressed.size() / 2);
+    BOOST_CHECK_THROW(compressor.decompress(compressed),
+                      elle::protocol::Error);
+  }
+}
+
+// Check compression is used only when both peers agree, and packets go
+// through either way.
+ELLE_TEST_SCHEDULED(compression)
+{
+  auto const text = [] (int n)
+    {
+      auto res = elle::Buffer();
+      for (int i = 0; i < n; ++i)
+      {
+        auto const entry = elle::sprintf("entry %s, ", i);
+        res.append(entry.data(), entry.size());
+      }
+      return res;
+    };
+  auto const packets = std::vector<elle::Buffer>{
+    elle::Buffer("small"),
+    text(100000),
+    elle::cryptography::random::generate<elle::Buffer>(1 << 17),
+  };
+  auto const dictionary = elle::Buffer("entry , entry , entry ");
+  for (auto alice_compress: {true, false})
+    for (auto version: {elle::Version(0, 3, 0), elle::Version(0, 4, 0)})
+    {
+      Connector sockets;
+      std::unique_ptr<elle::protocol::Serializer> alice;
+      std::unique_ptr<elle::protocol::Serializer> bob;
+      elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+      {
+        scope.run_background(
+          "alice",
+          [&]
+          {
+            alice.reset(new elle::protocol::Serializer(
+                          sockets.alice(), version, true, {}, {}, 2 << 16,
+                          alice_compress, dictionary));
+          });
+        scope.run_background(
+          "bob",
+          [&]
+          {
+            bob.reset(new elle::protocol::Serializer(
+                        sockets.bob(), version, true, {}, {}, 2 << 16,
+                        true, dictionary));
+          });
+        elle::reactor::wait(scope);
+      };
+      auto const compressed =
+        alice_compress && version >= elle::Version(0, 4, 0);
+      BOOST_CHECK_EQUAL(bool(alice->compressor()), compressed);
+      BOOST_CHECK_EQUAL(bool(bob->compressor()), compressed);
+      elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+      {
+        scope.run_background(
+          "write",
+          [&]
+          {
+            for (auto const& p: packets)
+              alice->write(p);
+          });
+        BOOST_CHECK_EQUAL(bob->read(), packets[0]);
+        BOOST_CHECK_EQUAL(bob->read(), packets[1]);
+        // Compressed packets can be read by chunks too.
+        auto res = elle::Buffer();
+        bob->read([&] (elle::ConstWeakBuffer c)
+                  {
+                    res.append(c.contents(), c.size());
+                  });
+        BOOST_CHECK_EQUAL(res, packets[2]);
+        elle::reactor::wait(scope);
+      };
+      if (compressed)
+      {
+        auto const& stats = alice->compressor()->statistics();
+        ELLE_LOG("compression: %s", stats);
+        BOOST_CHECK_EQUAL(stats.compressed, 1);
+        BOOST_CHECK_EQUAL(stats.skipped, 2);
+        BOOST_CHECK_EQUAL(bob->compressor()->statistics().decompressed, 1);
+        BOOST_CHECK_GT(stats.ratio(), 2);
+      }
+    }
+}
+
 ELLE_TEST_SUITE()
 {
   auto& suite = boost::unit_test::framework::master_test_suite();
@@ -1098,16 +1450,23 @@ ELLE_TEST_SUITE()
   suite.add(BOOST_TEST_CASE(corruption), 0, valgrind(3, 10));
   suite.add(BOOST_TEST_CASE(interruption), 0, valgrind(6, 15));
   suite.add(BOOST_TEST_CASE(interruption2), 0, valgrind(6, 15));
+  suite.add(BOOST_TEST_CASE(streaming), 0, valgrind(6, 10));
+  suite.add(BOOST_TEST_CASE(gather), 0, valgrind(6, 10));
   {
     auto sub = BOOST_TEST_SUITE("read_interruption");
     suite.add(sub);
     for (auto const& version: {elle::Version(0, 1, 0),
                                elle::Version(0, 2, 0),
-                               elle::Version(0, 3, 0)})
+                               elle::Version(0, 3, 0),
+                               elle::Version(0, 4, 0)})
       sub->add(ELLE_TEST_CASE(std::bind(read_interruption, version),
                               elle::sprintf("%s", version)), 0, valgrind(1));
   }
   suite.add(BOOST_TEST_CASE(eof), 0, valgrind(3));
   suite.add(BOOST_TEST_CASE(message), 0, valgrind(3));
   suite.add(BOOST_TEST_CASE(ping), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(hasher), 0, valgrind(1));
+  suite.add(BOOST_TEST_CASE(checksums), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(compressor), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(compression), 0, valgrind(3));
 }
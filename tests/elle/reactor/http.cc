@@ -1,5 +1,8 @@
+#include <cstdio>
 #include <utility>
 
+#include <unistd.h>
+
 #include <boost/algorithm/string.hpp>
 #include <elle/reactor/asio.hh>
 #include <boost/test/unit_test.hpp>
@@ -17,6 +20,7 @@
 #include <elle/reactor/http/exceptions.hh>
 #include <elle/reactor/network/Error.hh>
 #include <elle/reactor/network/TCPServer.hh>
+#include <elle/reactor/network/TCPSocket.hh>
 #include <elle/reactor/scheduler.hh>
 #include <elle/reactor/semaphore.hh>
 #include <elle/reactor/signal.hh>
@@ -789,6 +793,245 @@ ELLE_TEST_SCHEDULED(redirection)
   BOOST_CHECK_EQUAL(r.headers().at("Location"), "http://example.org/other");
 }
 
+ELLE_TEST_SCHEDULED(pipelining)
+{
+  HTTPServer server;
+  elle::reactor::Barrier fast_served;
+  server.register_route(
+    "/slow", elle::reactor::http::Method::GET,
+    [&] (HTTPServer::Headers const&,
+         HTTPServer::Cookies const&,
+         HTTPServer::Parameters const&,
+         elle::Buffer const&) -> std::string
+    {
+      // Handled concurrently with the next request, answered first anyway.
+      elle::reactor::wait(fast_served);
+      return "slow";
+    });
+  server.register_route(
+    "/fast", elle::reactor::http::Method::POST,
+    [&] (HTTPServer::Headers const&,
+         HTTPServer::Cookies const&,
+         HTTPServer::Parameters const&,
+         elle::Buffer const& body) -> std::string
+    {
+      fast_served.open();
+      return body.string();
+    });
+  elle::reactor::network::TCPSocket socket("127.0.0.1", server.port());
+  socket.write(
+    "GET /slow HTTP/1.1\r\n"
+    "\r\n"
+    "POST /fast HTTP/1.1\r\n"
+    "Content-Length: 4\r\n"
+    "\r\n"
+    "fastPOST /fast HTTP/1.1\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "2\r\nla\r\n3\r\nst!\r\n0\r\n\r\n");
+  auto response = std::string();
+  try
+  {
+    while (true)
+      response += socket.read_some(4096).string();
+  }
+  catch (elle::reactor::network::ConnectionClosed const&)
+  {}
+  ELLE_LOG("responses: %s", response);
+  auto const slow = response.find("\r\n\r\nslow");
+  auto const fast = response.find("\r\n\r\nfast");
+  auto const last = response.find("\r\n\r\nlast!");
+  BOOST_CHECK(slow != std::string::npos);
+  BOOST_CHECK(fast != std::string::npos);
+  BOOST_CHECK(last != std::string::npos);
+  BOOST_CHECK_LT(slow, fast);
+  BOOST_CHECK_LT(fast, last);
+  // The connection is kept alive until the client asks otherwise.
+  BOOST_CHECK_EQUAL(response.find("Connection: close"),
+                    response.rfind("Connection: "));
+  BOOST_CHECK_LT(fast, response.find("Connection: close"));
+}
+
+ELLE_TEST_SCHEDULED(streaming)
+{
+  HTTPServer server;
+  server.register_streaming_route(
+    "/stream", elle::reactor::http::Method::GET,
+    [&] (HTTPServer::Headers const&,
+         HTTPServer::Cookies const&,
+         HTTPServer::Parameters const&,
+         elle::Buffer const&,
+         HTTPServer::ResponseWriter& writer)
+    {
+      for (auto const& part: {"he", "", "llo ", "world"})
+      {
+        writer.write(elle::ConstWeakBuffer(part));
+        elle::reactor::yield();
+      }
+      writer.write(elle::ConstWeakBuffer(std::string(100000, '!')));
+    });
+  // Twice, to check the connection is reused after a chunked response.
+  for (int i = 0; i < 2; ++i)
+  {
+    auto page = elle::reactor::http::get(server.url("stream"));
+    BOOST_CHECK_EQUAL(page.size(), 100011);
+    BOOST_CHECK_EQUAL(page.range(0, 11), elle::ConstWeakBuffer("hello world"));
+  }
+}
+
+class CountingHttpServer
+  : public HTTPServer
+{
+public:
+  int connections = 0;
+
+protected:
+  void
+  _serve(std::unique_ptr<elle::reactor::network::Socket> socket) override
+  {
+    ++this->connections;
+    HTTPServer::_serve(std::move(socket));
+  }
+};
+
+ELLE_TEST_SCHEDULED(connection_reuse)
+{
+  CountingHttpServer server;
+  server.register_route("/reuse", elle::reactor::http::Method::GET,
+                        [&] (HTTPServer::Headers const&,
+                             HTTPServer::Cookies const&,
+                             HTTPServer::Parameters const&,
+                             elle::Buffer const&) -> std::string
+                        {
+                          return "reuse";
+                        });
+  for (int i = 0; i < 4; ++i)
+    BOOST_CHECK_EQUAL(elle::reactor::http::get(server.url("reuse")),
+                      elle::ConstWeakBuffer("reuse"));
+  // Sequential requests, even from fresh Requests, share the connection.
+  BOOST_CHECK_EQUAL(server.connections, 1);
+  elle::reactor::http::Client client;
+  for (int i = 0; i < 2; ++i)
+    BOOST_CHECK_EQUAL(client.get(server.url("reuse")),
+                      elle::ConstWeakBuffer("reuse"));
+  BOOST_CHECK_LE(server.connections, 2);
+}
+
+ELLE_TEST_SCHEDULED(dual_stack)
+{
+  auto tcp = std::make_unique<elle::reactor::network::TCPServer>();
+  tcp->listen(0, true);
+  auto const port = tcp->port();
+  HTTPServer server(std::move(tcp));
+  server.register_route("/v6", elle::reactor::http::Method::GET,
+                        [&] (HTTPServer::Headers const&,
+                             HTTPServer::Cookies const&,
+                             HTTPServer::Parameters const&,
+                             elle::Buffer const&) -> std::string
+                        {
+                          return "v6";
+                        });
+  auto const url = elle::sprintf("http://[::1]:%s/v6", port);
+  BOOST_CHECK_EQUAL(elle::reactor::http::get(url),
+                    elle::ConstWeakBuffer("v6"));
+  // HTTP/2 is only negotiated over TLS, cleartext falls back to HTTP/1.1.
+  auto const conf = elle::reactor::http::Request::Configuration(
+    30s, {}, elle::reactor::http::Version::v20);
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    for (int i = 0; i < 4; ++i)
+      scope.run_background(
+        elle::sprintf("request %s", i),
+        [&]
+        {
+          BOOST_CHECK_EQUAL(elle::reactor::http::get(url, conf),
+                            elle::ConstWeakBuffer("v6"));
+        });
+    elle::reactor::wait(scope);
+  };
+}
+
+ELLE_TEST_SCHEDULED(body_sink)
+{
+  HTTPServer server;
+  auto const body = std::string(1 << 20, 'x');
+  server.register_route("/sink", elle::reactor::http::Method::GET,
+                        [&] (HTTPServer::Headers const&,
+                             HTTPServer::Cookies const&,
+                             HTTPServer::Parameters const&,
+                             elle::Buffer const&) -> std::string
+                        {
+                          return body;
+                        });
+  elle::reactor::http::Request r(server.url("sink"));
+  auto received = std::size_t(0);
+  auto paused = false;
+  elle::reactor::Signal pause;
+  r.body_sink(
+    [&] (elle::ConstWeakBuffer chunk)
+    {
+      // Apply backpressure once, the chunk must be handed over again.
+      if (!paused && received > 0)
+      {
+        paused = true;
+        pause.signal();
+        return false;
+      }
+      BOOST_CHECK(std::all_of(chunk.begin(), chunk.end(),
+                              [] (char c) { return c == 'x'; }));
+      received += chunk.size();
+      return true;
+    });
+  elle::reactor::Thread resume("resume", [&]
+    {
+      elle::reactor::wait(pause);
+      elle::reactor::sleep(100ms);
+      BOOST_CHECK_LT(received, body.size());
+      r.resume();
+    });
+  elle::reactor::wait(r);
+  BOOST_CHECK(paused);
+  BOOST_CHECK_EQUAL(received, body.size());
+  BOOST_CHECK_EQUAL(r.status(), elle::reactor::http::StatusCode::OK);
+}
+
+ELLE_TEST_SCHEDULED(body_source)
+{
+  HTTPServer server;
+  server.register_route("/source", elle::reactor::http::Method::POST,
+                        [&] (HTTPServer::Headers const&,
+                             HTTPServer::Cookies const&,
+                             HTTPServer::Parameters const&,
+                             elle::Buffer const& body) -> std::string
+                        {
+                          return body.string();
+                        });
+  {
+    auto const first = std::string(100000, 'a');
+    auto const second = std::string("bcd");
+    elle::reactor::http::Request r(server.url("source"),
+                                   elle::reactor::http::Method::POST,
+                                   "text/plain");
+    r.body_source({elle::ConstWeakBuffer(first),
+                   elle::ConstWeakBuffer(second)});
+    BOOST_CHECK_EQUAL(r.response(), elle::ConstWeakBuffer(first + second));
+  }
+  {
+    auto file = std::unique_ptr<FILE, int (*)(FILE*)>(std::tmpfile(),
+                                                       &std::fclose);
+    auto const content = std::string("skip file content");
+    std::fwrite(content.data(), 1, content.size(), file.get());
+    std::fflush(file.get());
+    ::lseek(fileno(file.get()), 5, SEEK_SET);
+    elle::reactor::http::Request r(server.url("source"),
+                                   elle::reactor::http::Method::POST,
+                                   "text/plain");
+    r.body_source(fileno(file.get()));
+    BOOST_CHECK_EQUAL(r.response(), elle::ConstWeakBuffer("file content"));
+  }
+}
+
 ELLE_TEST_SUITE()
 {
   auto& suite = boost::unit_test::framework::master_test_suite();
@@ -819,4 +1062,10 @@ ELLE_TEST_SUITE()
   suite.add(BOOST_TEST_CASE(query_string), 0, valgrind(1));
   suite.add(BOOST_TEST_CASE(keep_alive), 0, valgrind(1));
   suite.add(BOOST_TEST_CASE(redirection), 0, valgrind(1));
+  suite.add(BOOST_TEST_CASE(pipelining), 0, valgrind(1));
+  suite.add(BOOST_TEST_CASE(streaming), 0, valgrind(1));
+  suite.add(BOOST_TEST_CASE(connection_reuse), 0, valgrind(1));
+  suite.add(BOOST_TEST_CASE(dual_stack), 0, valgrind(1));
+  suite.add(BOOST_TEST_CASE(body_sink), 0, valgrind(5));
+  suite.add(BOOST_TEST_CASE(body_source), 0, valgrind(5));
 }
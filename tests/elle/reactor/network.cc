@@ -12,13 +12,23 @@
 
 #include <elle/reactor/asio.hh>
 #include <elle/reactor/Scope.hh>
+#include <elle/reactor/network/connection-pool.hh>
 #include <elle/reactor/network/Error.hh>
+#include <elle/reactor/network/rdv-socket.hh>
+#include <elle/reactor/network/rdv.hh>
 #include <elle/reactor/network/resolve.hh>
 #include <elle/reactor/network/TCPServer.hh>
 #include <elle/reactor/network/TCPSocket.hh>
 #include <elle/reactor/network/server.hh>
+#include <elle/reactor/network/metrics.hh>
+#include <elle/reactor/network/relay.hh>
+#include <elle/reactor/network/shaper.hh>
 #include <elle/reactor/network/socket.hh>
 #ifdef REACTOR_NETWORK_UNIX_DOMAIN_SOCKET
+# ifdef ELLE_LINUX
+#  include <elle/reactor/network/shm-server.hh>
+#  include <elle/reactor/network/shm-socket.hh>
+# endif
 # include <elle/reactor/network/unix-domain-server.hh>
 # include <elle/reactor/network/unix-domain-socket.hh>
 #endif
@@ -36,6 +46,10 @@ using elle::reactor::Signal;
 using elle::reactor::network::TCPSocket;
 using elle::reactor::network::TCPServer;
 #ifdef REACTOR_NETWORK_UNIX_DOMAIN_SOCKET
+# ifdef ELLE_LINUX
+using elle::reactor::network::ShmServer;
+using elle::reactor::network::ShmSocket;
+# endif
 using elle::reactor::network::UnixDomainSocket;
 using elle::reactor::network::UnixDomainServer;
 #endif
@@ -637,6 +651,395 @@ ELLE_TEST_SCHEDULED(resolution_abort)
   };
 }
 
+/*-----------------.
+| Resolution cache |
+`-----------------*/
+
+namespace
+{
+  using elle::reactor::network::Resolver;
+  using elle::reactor::network::ResolveOptions;
+
+  Resolver::Address
+  address(std::string const& repr)
+  {
+    return Resolver::Address::from_string(repr);
+  }
+}
+
+ELLE_TEST_SCHEDULED(resolution_cache)
+{
+  auto queries = 0;
+  auto ttl = elle::DurationOpt{};
+  auto v6_delay = elle::Duration(10ms);
+  // Stub resolver knowing a single dual-stack host.
+  auto resolver = Resolver(
+    [&] (std::string const& hostname, bool v6)
+    {
+      ++queries;
+      elle::reactor::sleep(v6 ? v6_delay : 10ms);
+      if (hostname != "stub.elle")
+        throw elle::reactor::network::ResolutionError(hostname, "stub");
+      auto res = Resolver::Answer{};
+      res.ttl = ttl;
+      if (v6)
+        res.addresses = {address("::1"), address("::2")};
+      else
+        res.addresses = {address("127.0.0.1"), address("127.0.0.2")};
+      return res;
+    });
+  auto const v4 = Resolver::Addresses{
+    address("127.0.0.1"), address("127.0.0.2")};
+  // Families are interleaved, IPv6 first.
+  auto const dual = Resolver::Addresses{
+    address("::1"), address("127.0.0.1"), address("::2"), address("127.0.0.2")};
+  // Concurrent requests share lookups.
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    for (int i = 0; i < 3; ++i)
+      scope.run_background(
+        "resolve",
+        [&]
+        {
+          BOOST_CHECK(resolver.resolve("stub.elle", ResolveOptions(false))
+                      == dual);
+        });
+    elle::reactor::wait(scope);
+  };
+  BOOST_CHECK_EQUAL(queries, 2);
+  BOOST_CHECK(resolver.resolve("stub.elle", ResolveOptions(false)) == dual);
+  BOOST_CHECK(resolver.resolve("stub.elle") == v4);
+  BOOST_CHECK_EQUAL(queries, 2);
+  BOOST_CHECK_EQUAL(resolver.lookups(), 2);
+  // Address literals are not looked up.
+  BOOST_CHECK(resolver.resolve("10.0.0.1") ==
+              Resolver::Addresses{address("10.0.0.1")});
+  BOOST_CHECK_EQUAL(queries, 2);
+  // Failures are cached.
+  BOOST_CHECK_THROW(resolver.resolve("missing.elle"),
+                    elle::reactor::network::ResolutionError);
+  BOOST_CHECK_THROW(resolver.resolve("missing.elle"),
+                    elle::reactor::network::ResolutionError);
+  BOOST_CHECK_EQUAL(queries, 3);
+  // Answers expire with their TTL.
+  resolver.clear();
+  ttl = 50ms;
+  resolver.resolve("stub.elle");
+  resolver.resolve("stub.elle");
+  BOOST_CHECK_EQUAL(queries, 4);
+  elle::reactor::sleep(100ms);
+  resolver.resolve("stub.elle");
+  BOOST_CHECK_EQUAL(queries, 5);
+  // A slow IPv6 answer is not waited for once IPv4 answered.
+  resolver.clear();
+  v6_delay = 10s;
+  resolver.resolution_delay(20ms);
+  BOOST_CHECK(resolver.resolve("stub.elle", ResolveOptions(false)) == v4);
+}
+
+ELLE_TEST_SCHEDULED(happy_eyeballs)
+{
+  TCPServer server;
+  server.listen(0);
+  // The IPv6 address is in the discard-only prefix, so the attempt either
+  // fails or hangs and IPv4 must win.
+  elle::reactor::network::resolver().lookup(
+    [] (std::string const&, bool v6)
+    {
+      auto res = Resolver::Answer{};
+      res.addresses = {address(v6 ? "100::1" : "127.0.0.1")};
+      return res;
+    });
+  elle::reactor::Thread accept("accept", [&] { server.accept(); });
+  auto socket = TCPSocket("dual.elle", server.port(), 5s);
+  BOOST_CHECK_EQUAL(socket.peer().address(), address("127.0.0.1"));
+  elle::reactor::wait(accept);
+}
+
+/*-----------------.
+| Connection pool  |
+`-----------------*/
+
+ELLE_TEST_SCHEDULED(connection_pool)
+{
+  TCPServer server;
+  server.listen();
+  auto const port = server.port();
+  auto accepted = 0;
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    // Echo lines, close the connection on "close".
+    scope.run_background(
+      "server",
+      [&]
+      {
+        while (true)
+        {
+          auto socket = std::shared_ptr<TCPSocket>(server.accept());
+          ++accepted;
+          scope.run_background(
+            "echo",
+            [socket]
+            {
+              try
+              {
+                while (true)
+                {
+                  auto line = socket->read_until("\n");
+                  if (line.string() == "close\n")
+                    return;
+                  socket->write(line);
+                }
+              }
+              catch (elle::reactor::network::ConnectionClosed const&)
+              {}
+            });
+        }
+      });
+    elle::reactor::network::ConnectionPool<TCPSocket> pool;
+    pool.max_per_endpoint(2);
+    auto echo = [&] (TCPSocket& socket)
+      {
+        socket.write(elle::ConstWeakBuffer("echo\n"));
+        BOOST_CHECK_EQUAL(socket.read_until("\n").string(), "echo\n");
+      };
+    // Connections are reused.
+    {
+      auto c = pool.checkout("127.0.0.1", port);
+      BOOST_CHECK(!c.reused());
+      echo(*c);
+    }
+    {
+      auto c = pool.checkout("127.0.0.1", port);
+      BOOST_CHECK(c.reused());
+      echo(*c);
+    }
+    BOOST_CHECK_EQUAL(accepted, 1);
+    BOOST_CHECK_EQUAL(pool.hits(), 1);
+    // Per endpoint limit.
+    {
+      auto c1 = pool.checkout("127.0.0.1", port);
+      auto c2 = pool.checkout("127.0.0.1", port);
+      echo(*c2);
+      BOOST_CHECK_EQUAL(pool.size(), 2);
+      pool.checkout_timeout(50ms);
+      BOOST_CHECK_THROW(pool.checkout("127.0.0.1", port),
+                        elle::reactor::network::TimeOut);
+      pool.checkout_timeout(elle::DurationOpt());
+      c1.discard();
+      BOOST_CHECK_EQUAL(pool.size(), 1);
+    }
+    BOOST_CHECK_EQUAL(pool.idle(), 1);
+    // Connections closed by the peer are not handed out.
+    {
+      auto c = pool.checkout("127.0.0.1", port);
+      c->write(elle::ConstWeakBuffer("close\n"));
+    }
+    elle::reactor::sleep(100ms);
+    {
+      auto c = pool.checkout("127.0.0.1", port);
+      BOOST_CHECK(!c.reused());
+      echo(*c);
+    }
+    BOOST_CHECK_EQUAL(pool.evictions(), 1);
+    // Warm up.
+    pool.warm_up("127.0.0.1", port, 2);
+    BOOST_CHECK_EQUAL(pool.idle(), 2);
+    // Idle connections expire.
+    pool.idle_timeout(50ms);
+    elle::reactor::sleep(100ms);
+    {
+      auto c = pool.checkout("127.0.0.1", port);
+      BOOST_CHECK(!c.reused());
+    }
+    pool.clear();
+    BOOST_CHECK_EQUAL(pool.size(), 0);
+    scope.terminate_now();
+  };
+}
+
+ELLE_TEST_SCHEDULED(shaper)
+{
+  using elle::reactor::network::Shaper;
+  TCPServer server;
+  server.listen();
+  auto const size = 320 * 1024;
+  auto received = elle::Buffer();
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "server",
+      [&]
+      {
+        auto socket = server.accept();
+        received = socket->read(size);
+      });
+    TCPSocket socket("127.0.0.1", server.port());
+    auto shaper = std::make_shared<Shaper>("test", 1024 * 1024, 64 * 1024);
+    socket.write_shaper(shaper);
+    auto const payload = std::string(size, 'x');
+    auto const start = elle::Clock::now();
+    socket.write(elle::ConstWeakBuffer(payload));
+    // The first burst goes through, the rest at 1MiB/s.
+    BOOST_CHECK_GE(elle::Clock::now() - start, 200ms);
+    BOOST_CHECK_EQUAL(shaper->statistics().bytes, size);
+    BOOST_CHECK_EQUAL(shaper->statistics().operations, 5);
+    BOOST_CHECK_GE(shaper->statistics().waits, 1);
+    elle::reactor::wait(scope);
+  };
+  BOOST_CHECK_EQUAL(received.size(), size);
+  // Children of a shaper share its rate in proportion of their weight.
+  auto group = std::make_shared<Shaper>("group", 1024 * 1024, 16 * 1024);
+  auto light = std::make_shared<Shaper>("light", 0, 0, group, 1);
+  auto heavy = std::make_shared<Shaper>("heavy", 0, 0, group, 3);
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    for (auto child: {light, heavy})
+      scope.run_background(
+        elle::sprintf("%s", child),
+        [child]
+        {
+          while (true)
+            child->acquire(4096);
+        });
+    elle::reactor::sleep(500ms);
+    scope.terminate_now();
+  };
+  auto const ratio = double(heavy->statistics().bytes) /
+    light->statistics().bytes;
+  BOOST_CHECK_GE(ratio, 2.5);
+  BOOST_CHECK_LE(ratio, 3.5);
+  BOOST_CHECK_EQUAL(group->statistics().bytes,
+                    light->statistics().bytes + heavy->statistics().bytes);
+}
+
+ELLE_TEST_SCHEDULED(metrics)
+{
+  using elle::reactor::network::Metrics;
+  TCPServer server;
+  server.metrics(std::make_shared<Metrics>("metrics-test"));
+  server.listen();
+  std::unique_ptr<elle::reactor::network::Socket> accepted;
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "server",
+      [&]
+      {
+        accepted = server.accept();
+        BOOST_CHECK(accepted->metrics());
+        BOOST_CHECK_EQUAL(accepted->read(5), "hello");
+        accepted->write(elle::ConstWeakBuffer("world!"));
+        BOOST_CHECK_THROW(accepted->read(1, 10ms),
+                          elle::reactor::network::TimeOut);
+      });
+    TCPSocket socket("127.0.0.1", server.port());
+    socket.write(elle::ConstWeakBuffer("hello"));
+    BOOST_CHECK_EQUAL(socket.read(6), "world!");
+    elle::reactor::wait(scope);
+  };
+  auto const own = accepted->metrics()->snapshot();
+  BOOST_CHECK_EQUAL(own.bytes_in, 5);
+  BOOST_CHECK_EQUAL(own.bytes_out, 6);
+  BOOST_CHECK_EQUAL(own.reads, 1);
+  BOOST_CHECK_EQUAL(own.writes, 1);
+  BOOST_CHECK_EQUAL(own.timeouts, 1);
+  BOOST_CHECK_EQUAL(own.queued, 0);
+  auto const group = Metrics::snapshot("metrics-test");
+  BOOST_CHECK_EQUAL(group.connections, 1);
+  BOOST_CHECK_EQUAL(group.bytes_in, 5);
+  BOOST_CHECK_EQUAL(group.bytes_out, 6);
+  BOOST_CHECK_EQUAL(server.metrics()->snapshot().connections, 1);
+  BOOST_CHECK(Metrics::snapshots().count("metrics-test"));
+}
+
+ELLE_TEST_SCHEDULED(relay)
+{
+  using elle::reactor::network::ConnectionClosed;
+  using elle::reactor::network::Relay;
+  TCPServer front;
+  front.listen();
+  TCPServer back;
+  back.listen();
+  auto const payload = std::string(256 * 1024, 'r');
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "relay",
+      [&]
+      {
+        auto client = front.accept();
+        TCPSocket upstream("127.0.0.1", back.port());
+        Relay relay(*client, upstream);
+        relay.run();
+#ifdef ELLE_LINUX
+        BOOST_CHECK(relay.spliced());
+#endif
+        BOOST_CHECK_EQUAL(relay.forward_bytes(), payload.size());
+        BOOST_CHECK_EQUAL(relay.backward_bytes(), 5);
+      });
+    scope.run_background(
+      "backend",
+      [&]
+      {
+        auto socket = back.accept();
+        BOOST_CHECK_EQUAL(socket->read(payload.size()).string(), payload);
+        // The client half-closed its side, which the relay forwarded.
+        BOOST_CHECK_THROW(socket->read(1), ConnectionClosed);
+        socket->write(elle::ConstWeakBuffer("reply"));
+      });
+    TCPSocket client("127.0.0.1", front.port());
+    client.write(elle::ConstWeakBuffer(payload));
+    client.socket()->shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+    BOOST_CHECK_EQUAL(client.read(5), "reply");
+    BOOST_CHECK_THROW(client.read(1), ConnectionClosed);
+    elle::reactor::wait(scope);
+  };
+}
+
+#if defined(REACTOR_NETWORK_UNIX_DOMAIN_SOCKET) && defined(ELLE_LINUX)
+ELLE_TEST_SCHEDULED(shm_socket)
+{
+  ShmServer server;
+  server.listen();
+  // Larger than the rings, so both peers have to wait for each other.
+  auto const payload = [&]
+    {
+      auto res = std::string(100000, 0);
+      for (unsigned i = 0; i < res.size(); ++i)
+        res[i] = i % 251;
+      return res.replace(0, 5, "hello");
+    }();
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "server",
+      [&]
+      {
+        auto socket = server.accept();
+        BOOST_CHECK_EQUAL(socket->read_until("\n").string(), "hello\n");
+        BOOST_CHECK_EQUAL(socket->read(payload.size()).string(), payload);
+        socket->write(elle::ConstWeakBuffer(payload));
+        *socket << "bye" << std::endl;
+      });
+    ShmSocket socket(server.local_endpoint(), {}, 4096);
+    BOOST_CHECK_EQUAL(socket.capacity(), 4096);
+    socket.write(elle::ConstWeakBuffer("hello\nhello"));
+    socket.write(elle::ConstWeakBuffer(payload.substr(5)));
+    BOOST_CHECK_EQUAL(socket.read(payload.size()).string(), payload);
+    auto line = std::string();
+    std::getline(socket, line);
+    BOOST_CHECK_EQUAL(line, "bye");
+    elle::reactor::wait(scope);
+    // The server closed its end.
+    BOOST_CHECK_THROW(socket.read_some(1),
+                      elle::reactor::network::ConnectionClosed);
+    BOOST_CHECK_THROW(socket.write(elle::ConstWeakBuffer("lost")),
+                      elle::reactor::network::ConnectionClosed);
+  };
+}
+#endif
+
 ELLE_TEST_SCHEDULED(read_terminate_recover)
 {
   char wbuf[100];
@@ -801,6 +1204,118 @@ ELLE_TEST_SCHEDULED(async_write)
   elle::reactor::wait(read);
 }
 
+/*----.
+| RDV |
+`----*/
+
+static
+void
+rdv_encoding()
+{
+  namespace rdv = elle::reactor::network::rdv;
+  rdv::Message message;
+  message.id = "alice";
+  message.command = rdv::Command::connect_requested;
+  message.source_endpoint = rdv::Endpoint(
+    boost::asio::ip::address::from_string("10.0.0.1"), 7890);
+  message.target_endpoint = rdv::Endpoint(
+    boost::asio::ip::address::from_string("fe80::1"), 443);
+  message.target_address = "bob";
+  for (auto binary: {false, true})
+  {
+    auto const packet = rdv::encode(message, binary);
+    bool decoded_binary = !binary;
+    auto const decoded = rdv::decode(packet, decoded_binary);
+    BOOST_CHECK_EQUAL(decoded_binary, binary);
+    BOOST_CHECK_EQUAL(decoded.id, message.id);
+    BOOST_CHECK(decoded.command == message.command);
+    BOOST_CHECK_EQUAL(decoded.source_endpoint, message.source_endpoint);
+    BOOST_CHECK_EQUAL(decoded.target_endpoint, message.target_endpoint);
+    BOOST_CHECK_EQUAL(decoded.target_address, message.target_address);
+  }
+  {
+    bool binary = false;
+    auto const packet = rdv::encode(message, true);
+    BOOST_CHECK_THROW(
+      rdv::decode(elle::ConstWeakBuffer(packet.contents(), packet.size() - 1),
+                  binary),
+      elle::Error);
+  }
+}
+
+ELLE_TEST_SCHEDULED(rdv_contact)
+{
+  namespace rdv = elle::reactor::network::rdv;
+  using elle::reactor::network::RDVSocket;
+  using elle::reactor::network::UDPSocket;
+  auto const loopback = rdv::Endpoint(
+    boost::asio::ip::address::from_string("127.0.0.1"), 0);
+  RDVSocket alice;
+  RDVSocket bob;
+  // Candidates that never answer.
+  UDPSocket silent_a;
+  UDPSocket silent_b;
+  for (UDPSocket* socket:
+         std::initializer_list<UDPSocket*>{&alice, &bob, &silent_a, &silent_b})
+  {
+    socket->close();
+    socket->bind(loopback);
+  }
+  auto received = 0;
+  elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+  {
+    scope.run_background(
+      "alice",
+      [&]
+      {
+        auto buffer = elle::Buffer(5000);
+        rdv::Endpoint source;
+        while (true)
+          alice.receive_from(elle::WeakBuffer(buffer), source);
+      });
+    scope.run_background(
+      "bob",
+      [&]
+      {
+        auto buffer = elle::Buffer(5000);
+        rdv::Endpoint source;
+        while (true)
+        {
+          auto const size =
+            bob.UDPSocket::receive_from(elle::WeakBuffer(buffer), source);
+          // Lose the first probe so it has to be retransmitted.
+          if (received++ == 0)
+            continue;
+          bob.process(elle::WeakBuffer(buffer.mutable_contents(), size),
+                      source);
+        }
+      });
+    auto const candidates = std::vector<rdv::Endpoint>{
+      silent_a.local_endpoint(), silent_b.local_endpoint(),
+      bob.local_endpoint()};
+    auto const contact = [&]
+      {
+        auto const start = elle::Clock::now();
+        BOOST_CHECK_EQUAL(alice.contact("", candidates, 5s),
+                          bob.local_endpoint());
+        auto const res = elle::Clock::now() - start;
+        BOOST_TEST_MESSAGE(elle::sprintf("time to connect: %s", res));
+        return res;
+      };
+    // The lost probe is retransmitted well before the former fixed 500ms.
+    auto const lossy = contact();
+    BOOST_CHECK_LT(lossy, 400ms);
+    // Retransmitted probes do not measure the round-trip time, the next one
+    // does.
+    BOOST_CHECK(!alice.rtt());
+    auto const clean = contact();
+    BOOST_CHECK_LT(clean, lossy);
+    BOOST_CHECK(alice.rtt());
+    BOOST_CHECK_LT(*alice.rtt(), 100ms);
+    scope.terminate_now();
+  };
+}
+
 /*-----------.
 | Test suite |
 `-----------*/
@@ -826,6 +1341,9 @@ ELLE_TEST_SUITE()
   INFINIT_REACTOR_NETWORK_TEST(TCP);
 #ifdef REACTOR_NETWORK_UNIX_DOMAIN_SOCKET
   INFINIT_REACTOR_NETWORK_TEST(UnixDomain);
+# ifdef ELLE_LINUX
+  INFINIT_REACTOR_NETWORK_TEST(Shm);
+# endif
 #endif
 #undef INFINIT_REACTOR_NETWORK_TEST
   suite.add(BOOST_TEST_CASE(socket_destruction), 0, 10);
@@ -836,8 +1354,19 @@ ELLE_TEST_SUITE()
   suite.add(BOOST_TEST_CASE(underflow), 0, 10);
   suite.add(BOOST_TEST_CASE(read_write_cancel), 0, 10);
   suite.add(BOOST_TEST_CASE(resolution_abort), 0, 2);
+  suite.add(BOOST_TEST_CASE(resolution_cache), 0, 5);
+  suite.add(BOOST_TEST_CASE(happy_eyeballs), 0, 10);
+  suite.add(BOOST_TEST_CASE(connection_pool), 0, 10);
+  suite.add(BOOST_TEST_CASE(shaper), 0, 10);
+  suite.add(BOOST_TEST_CASE(metrics), 0, 10);
+  suite.add(BOOST_TEST_CASE(relay), 0, 10);
+#if defined(REACTOR_NETWORK_UNIX_DOMAIN_SOCKET) && defined(ELLE_LINUX)
+  suite.add(BOOST_TEST_CASE(shm_socket), 0, 10);
+#endif
   suite.add(BOOST_TEST_CASE(read_terminate_recover), 0, 1);
   suite.add(BOOST_TEST_CASE(read_terminate_recover_iostream), 0, 1);
   suite.add(BOOST_TEST_CASE(read_terminate_deadlock), 0, 1);
   suite.add(BOOST_TEST_CASE(async_write), 0, 10);
+  suite.add(BOOST_TEST_CASE(rdv_encoding), 0, 1);
+  suite.add(BOOST_TEST_CASE(rdv_contact), 0, 10);
 }
@@ -710,6 +710,42 @@ ELLE_TEST_SCHEDULED(shutdown_asynchronous_concurrent)
   };
 }
 
+// Check reconnections resume the previous session.
+ELLE_TEST_SCHEDULED(session_resumption)
+{
+  auto certificate = load_certificate();
+  auto& server_certificate = *certificate;
+  SSLServer server(std::move(certificate));
+  server.listen();
+  auto const port = std::to_string(server.port());
+  auto const client_certificate = SSLCertificate::shared();
+  auto const handshakes = client_certificate->handshakes();
+  auto const resumptions = client_certificate->resumptions();
+  for (int i = 0; i < 3; ++i)
+  {
+    elle::With<elle::reactor::Scope>() << [&] (elle::reactor::Scope& scope)
+    {
+      scope.run_background(
+        "server",
+        [&]
+        {
+          auto socket = server.accept();
+          socket->write(elle::ConstWeakBuffer("ping"));
+        });
+      {
+        SSLSocket client("127.0.0.1", port);
+        BOOST_CHECK(client.certificate() == client_certificate);
+        BOOST_CHECK_EQUAL(client.read(4).string(), "ping");
+      }
+      elle::reactor::wait(scope);
+    };
+  }
+  BOOST_CHECK_EQUAL(client_certificate->handshakes() - handshakes, 3);
+  BOOST_CHECK_EQUAL(client_certificate->resumptions() - resumptions, 2);
+  BOOST_CHECK_EQUAL(server_certificate.handshakes(), 3);
+  BOOST_CHECK_EQUAL(server_certificate.resumptions(), 2);
+}
+
 ELLE_TEST_SUITE()
 {
   auto& suite = boost::unit_test::framework::master_test_suite();
@@ -726,6 +762,7 @@ ELLE_TEST_SUITE()
   suite.add(BOOST_TEST_CASE(shutdown_asynchronous_timeout), 0, valgrind(2));
   suite.add(BOOST_TEST_CASE(shutdown_asynchronous_concurrent), 0, valgrind(2));
   suite.add(BOOST_TEST_CASE(shutdown_timeout), 0, valgrind(3));
+  suite.add(BOOST_TEST_CASE(session_resumption), 0, valgrind(3));
 
 }
 
@@ -204,6 +204,42 @@ ELLE_TEST_SCHEDULED(destruction)
   }
 }
 
+#ifdef ELLE_LINUX
+ELLE_TEST_SCHEDULED(sharded)
+{
+  UTPServer server(4);
+  BOOST_CHECK_EQUAL(server.shards(), 4);
+  server.listen(0);
+  auto const port = server.local_endpoint().port();
+  std::vector<std::unique_ptr<UTPServer>> clients;
+  std::vector<std::unique_ptr<UTPSocket>> sockets;
+  for (int i = 0; i < 8; ++i)
+  {
+    clients.emplace_back(std::make_unique<UTPServer>());
+    clients.back()->listen(0);
+    sockets.emplace_back(std::make_unique<UTPSocket>(*clients.back()));
+    sockets.back()->connect("127.0.0.1", port);
+    auto accepted = server.accept();
+    auto const data = elle::sprintf("client %s", i);
+    sockets.back()->write(data);
+    ELLE_ASSERT_EQ(accepted->read(data.size()).string(), data);
+    accepted->write(data);
+    ELLE_ASSERT_EQ(sockets.back()->read(data.size()).string(), data);
+  }
+  // A sharded server connects out just as well.
+  auto accepted = std::unique_ptr<UTPSocket>{};
+  elle::reactor::Thread acceptor("acceptor", [&]
+    {
+      accepted = clients.front()->accept();
+    });
+  UTPSocket out(server);
+  out.connect("127.0.0.1", clients.front()->local_endpoint().port());
+  elle::reactor::wait(acceptor);
+  out.write("sharded");
+  ELLE_ASSERT_EQ(accepted->read(7).string(), "sharded");
+}
+#endif
+
 SocketPair::SocketPair()
 {
   srv1.listen(0);
@@ -231,4 +267,7 @@ ELLE_TEST_SUITE()
   suite.add(BOOST_TEST_CASE(big), 0, valgrind(2));
   suite.add(BOOST_TEST_CASE(many), 0, valgrind(8));
   suite.add(BOOST_TEST_CASE(destruction), 0, valgrind(2));
+#ifdef ELLE_LINUX
+  suite.add(BOOST_TEST_CASE(sharded), 0, valgrind(4));
+#endif
 }